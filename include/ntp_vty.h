@@ -34,13 +34,17 @@ typedef struct ntp_cli_ntp_server_params_s {
     char *version;          /* 3 or 4 */
     char *keyid;            /* 1-65534 */
     void *key_row;/* ptr to the key entry - (ovsrec_ntp_key *) */
+    char *refid;            /* Reference clocks only, up to 4 chars */
+    char *feed;             /* SHM reference clocks only, "<source>:<path>" */
+    char *nts;              /* NTS instead of a key */
 } ntp_cli_ntp_server_params_t;
 
 typedef struct ntp_cli_ntp_auth_key_params_s {
     bool no_form;           /* TRUE/FALSE */
 
     char *key;              /* 1-65534 */
-    char *md5_pwd;	    /* 8-16 chars */
+    char *algorithm;        /* md5, sha1, sha256, aes128cmac */
+    char *password;         /* md5: 8-16 chars, others: hex key */
 } ntp_cli_ntp_auth_key_params_t;
 
 typedef struct ntp_cli_ntp_trusted_key_params_s {
@@ -114,6 +118,45 @@ config_finish_result (enum ovsdb_idl_txn_status status)
 #define NTP_DEFAULT_INT                                 0
 #define NTP_DEFAULT_ZERO_STR                            "0"
 
+/* Kernel clock state (adjtimex) published by ops-ntpd in System:ntp_status */
+#define SYSTEM_NTP_STATUS_KERNEL_OFFSET                 "kernel_offset"
+#define SYSTEM_NTP_STATUS_KERNEL_FREQUENCY              "kernel_frequency"
+#define SYSTEM_NTP_STATUS_KERNEL_MAXERROR               "kernel_maxerror"
+#define SYSTEM_NTP_STATUS_KERNEL_ESTERROR               "kernel_esterror"
+#define SYSTEM_NTP_STATUS_KERNEL_SYNC_STATUS            "kernel_sync_status"
+#define SYSTEM_NTP_STATUS_KERNEL_CLOCK_STATE            "kernel_clock_state"
+
+/* Sync summary published by ops-ntpd in System:ntp_status */
+#define SYSTEM_NTP_STATUS_SYNC_PEER                     "sync_peer"
+#define SYSTEM_NTP_STATUS_SYNC_STRATUM                  "sync_stratum"
+#define SYSTEM_NTP_STATUS_SYNC_POLL                     "sync_poll"
+#define SYSTEM_NTP_STATUS_SYNC_OFFSET                   "sync_offset"
+#define SYSTEM_NTP_STATUS_SYNC_REFTIME                  "sync_reftime"
+#define SYSTEM_NTP_STATUS_SYNC_STATE                    "sync_state"
+#define SYSTEM_NTP_STATUS_SYNC_LAST_CHANGE              "sync_last_change"
+#define SYSTEM_NTP_STATUS_SYNC_STATE_SYNCHRONIZED       "synchronized"
+
+/* NTP daemon supervision state published by ops-ntpd in System:ntp_status */
+#define SYSTEM_NTP_STATUS_NTPD_RESTARTS                 "ntpd_restarts"
+#define SYSTEM_NTP_STATUS_NTPD_UPTIME                   "ntpd_uptime"
+#define SYSTEM_NTP_STATUS_TIME_TO_STABLE_OFFSET         "time_to_stable_offset"
+
+/* Association clock-health statistics published by ops-ntpd */
+#define NTP_ASSOC_STATUS_OFFSET_P50                     "offset_p50"
+#define NTP_ASSOC_STATUS_OFFSET_P95                     "offset_p95"
+#define NTP_ASSOC_STATUS_OFFSET_P99                     "offset_p99"
+#define NTP_ASSOC_STATUS_ALLAN_DEV_TAU_1                "allan_deviation_tau_1"
+#define NTP_ASSOC_STATUS_ALLAN_DEV_TAU_4                "allan_deviation_tau_4"
+#define NTP_ASSOC_STATUS_ALLAN_DEV_TAU_16               "allan_deviation_tau_16"
+#define NTP_ASSOC_STATUS_STATS_SAMPLES                  "stats_samples"
+#define NTP_ASSOC_STATUS_REACH_LOSS_COUNT               "reach_loss_count"
+
+/* NTS association state published by ops-ntpd */
+#define NTP_ASSOC_STATUS_NTS_COOKIES                    "nts_cookies"
+#define NTP_ASSOC_STATUS_NTS_KE_COUNT                   "nts_ke_count"
+#define NTP_ASSOC_STATUS_NTS_COOKIE_REFRESHES           "nts_cookie_refreshes"
+#define NTP_ASSOC_STATUS_NTS_LAST_KE                    "nts_last_ke"
+
 /* NTP Help strings */
 #define NTP_STR                    "NTP Client configuration\n"
 #define NTP_SERVER_STR             "NTP Association configuration\n"
@@ -121,20 +164,63 @@ config_finish_result (enum ovsdb_idl_txn_status status)
 #define NTP_SERVER_PREFER_STR      "NTP Association preference configuration\n"
 #define NTP_SERVER_VERSION_STR     "NTP Association version configuration\n"
 #define NTP_SERVER_VERSION_NUM_STR "NTP Version\n"
+#define NTP_SERVER_VRF_STR         "NTP Association VRF configuration\n"
+#define NTP_SERVER_VRF_NAME_STR    "VRF name\n"
+#define NTP_SERVER_NTS_STR         "NTP Association authenticated with NTS (chrony backend)\n"
+#define NTP_SERVERS_STR            "NTP Association configuration for a list of servers\n"
+#define NTP_SERVERS_LIST_STR       "NAME [prefer] [version <3-4>] [key-id <1-65534> | nts] ...\n"
+#define NTP_REFCLOCK_STR           "NTP Reference clock configuration\n"
+#define NTP_REFCLOCK_PPS_STR       "PPS signal of /dev/ppsN (ntpd ATOM driver)\n"
+#define NTP_REFCLOCK_SHM_STR       "Shared memory segment N (ntpd SHM driver)\n"
+#define NTP_REFCLOCK_UNIT_STR      "Reference clock unit N\n"
+#define NTP_REFCLOCK_PREFER_STR    "Reference clock preference configuration\n"
+#define NTP_REFCLOCK_REFID_STR     "Reference clock identifier configuration\n"
+#define NTP_REFCLOCK_REFID_ID_STR  "Reference clock identifier, up to 4 characters\n"
+#define NTP_REFCLOCK_FEED_STR      "Local time source written to the shared memory segment by ops-ntpd\n"
+#define NTP_REFCLOCK_FEED_PHC_STR  "PTP hardware clock\n"
+#define NTP_REFCLOCK_FEED_SOCKET_STR "Unix datagram socket receiving time samples\n"
+#define NTP_REFCLOCK_FEED_PATH_STR "Absolute path of the PTP clock device or of the socket\n"
+#define NTP_SERVE_STR              "NTP Server mode, serve time to downstream hosts\n"
+#define NTP_SERVE_ALLOW_STR        "NTP Server mode client network configuration\n"
+#define NTP_SERVE_ALLOW_IPV4_STR   "Client IPv4 network\n"
+#define NTP_SERVE_ALLOW_IPV6_STR   "Client IPv6 network\n"
+#define NTP_SERVE_RATE_LIMIT_STR   "NTP Server mode client rate limit configuration\n"
+#define NTP_SERVE_AVERAGE_STR      "Average interval between the requests of a client\n"
+#define NTP_SERVE_MINIMUM_STR      "Minimum interval between the requests of a client\n"
+#define NTP_SERVE_INTERVAL_STR     "Interval, log2 seconds\n"
+#define NTP_NTS_STR                "NTS (Network Time Security) configuration\n"
+#define NTP_NTS_TRUSTED_CERTS_STR  "CA certificates trusted to authenticate the NTS-KE servers\n"
+#define NTP_NTS_CERTS_PATH_STR     "Absolute path of a PEM file of CA certificates\n"
 #define NTP_AUTH_STR               "NTP Authentication configuration\n"
 #define NTP_AUTH_ENABLE_STR        "NTP Authentication Enable/Disable\n"
 #define NTP_AUTH_KEY_STR           "NTP Authentication Key configuration\n"
 #define NTP_TRUST_KEY_STR          "NTP Trusted Key configuration\n"
 #define NTP_MD5_STR                "MD5 Password configuration\n"
+#define NTP_SHA1_STR               "SHA-1 key configuration\n"
+#define NTP_SHA256_STR             "SHA-256 key configuration\n"
+#define NTP_AES128CMAC_STR         "AES-128-CMAC key configuration\n"
 #define NTP_KEY_ID_STR             "NTP Key ID\n"
 #define NTP_KEY_NUM_STR            "NTP Key Number\n"
-#define NTP_MD5_PASSWORD_STR       "NTP MD5 Password <8-16> chars\n"
+#define NTP_KEY_PASSWORD_STR       "MD5 password <8-16> chars, or key of 40 (sha1), 64 (sha256) or 32 (aes128cmac) hex digits\n"
 #define NTP_SHOW_STR               "Show NTP information\n"
 #define NTP_SHOW_ASSOC_STR         "Show NTP Association summary\n"
 #define NTP_SHOW_STATUS_STR        "Show NTP Status information\n"
 #define NTP_SHOW_STATISTICS_STR    "Show NTP Statistics information\n"
+#define NTP_SHOW_STATISTICS_ASSOC_STR "Show NTP Association clock-health statistics\n"
 #define NTP_SHOW_AUTH_KEYS_STR     "Show NTP Authentication Keys information\n"
 #define NTP_SHOW_TRUST_KEYS_STR    "Show NTP Trusted Keys information\n"
+#define NTP_SHOW_NTS_STR           "Show NTS (Network Time Security) association information\n"
+#define NTP_SHOW_CLIENTS_STR       "Show the NTP clients with the highest request rate (server mode)\n"
 #define MAX_CHARS_IN_NTP_SERVER_NAME 57
 
+/* The top clients are only kept by ops-ntpd, read through unixctl */
+#define NTP_CLIENTS_APPCTL_CMD     "ovs-appctl -t ops_ntpd ntpd/clients"
+#define NTP_CLIENTS_LINE_MAX       256
+
+/* Keywords of the "ntp servers" list */
+#define NTP_SERVERS_PREFER_KW      "prefer"
+#define NTP_SERVERS_VERSION_KW     "version"
+#define NTP_SERVERS_KEY_ID_KW      "key-id"
+#define NTP_SERVERS_NTS_KW         "nts"
+
 #endif // _NTPD_VTY_H
@@ -27,4 +27,109 @@
 
 vtysh_ret_val vtysh_config_context_ntp_clientcallback(void *p_private);
 
+/* Reference clocks are NTP associations on the ntpd pseudo address
+ * 127.127.<driver>.<unit>, shared by the "ntp refclock" command and the
+ * running-config.
+ */
+#define NTP_REFCLOCK_ADDRESS_FMT     "127.127.%d.%d"
+#define NTP_REFCLOCK_DRIVER_PPS      22
+#define NTP_REFCLOCK_DRIVER_SHM      28
+#define NTP_REFCLOCK_PPS_KW          "pps"
+#define NTP_REFCLOCK_SHM_KW          "shm"
+#define NTP_REFCLOCK_PPS_REFID       "PPS"
+#define NTP_REFCLOCK_SHM_REFID       "SHM"
+#define NTP_REFCLOCK_UNIT_MAX        3
+#define NTP_REFCLOCK_REFID_MAX_LEN   4
+
+/* Local time source of a SHM reference clock, fed by ops-ntpd.
+ * Stored as "<source>:<path>" in the association attributes.
+ */
+#define NTP_REFCLOCK_ATTRIB_FEED     "refclock_feed"
+#define NTP_REFCLOCK_FEED_FMT        "%s:%s"
+#define NTP_REFCLOCK_FEED_PATH_MAX   64
+
+/* Server mode, in System:ntp_config. The allowed client networks are a
+ * comma separated list of "<address>/<prefix>", every network when empty.
+ * The rate limit intervals are log2 seconds.
+ */
+#define SYSTEM_NTP_CONFIG_SERVER_ENABLE        "server_enable"
+#define SYSTEM_NTP_CONFIG_SERVER_ALLOW         "server_allow"
+#define SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE  "server_rate_average"
+#define SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM  "server_rate_minimum"
+#define NTP_SERVER_RATE_AVERAGE_DEFAULT        3
+#define NTP_SERVER_RATE_MINIMUM_DEFAULT        1
+#define NTP_SERVER_ALLOW_MAX                   16
+
+/* NTS (Network Time Security, RFC 8915) association, "true" in the
+ * association attributes. It is authenticated with NTS-KE instead of a
+ * key, and is NTP version 4 only.
+ */
+#define NTP_ASSOC_ATTRIB_NTS         "nts"
+
+/* CA certificates trusted to authenticate the NTS-KE servers, in
+ * System:ntp_config. The system CAs are trusted when it is not set.
+ */
+#define SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS    "nts_trusted_certs"
+#define NTP_NTS_CERTS_PATH_MAX                 128
+
+/* Authentication key algorithms. NTP_Key has no algorithm column: the
+ * key_password of a SHA-1, SHA-256 or AES-128-CMAC key is stored as
+ * "<algorithm>:<hex key>", a bare password is an MD5 key.
+ */
+#define NTP_KEY_ALGORITHM_MD5        "md5"
+#define NTP_KEY_ALGORITHM_SHA1       "sha1"
+#define NTP_KEY_ALGORITHM_SHA256     "sha256"
+#define NTP_KEY_ALGORITHM_AES128CMAC "aes128cmac"
+#define NTP_KEY_PASSWORD_FMT         "%s:%s"
+#define NTP_KEY_HEX_LEN_MAX          64
+
+/* Returns the refclock keyword ("pps", "shm") of an association address
+ * and its unit, NULL if the address is not a reference clock.
+ */
+static inline const char *
+ntp_refclock_parse_address(const char *address, int *punit)
+{
+    int driver = 0;
+    int unit = 0;
+    char end = '\0';
+
+    if (2 != sscanf(address, NTP_REFCLOCK_ADDRESS_FMT "%c", &driver, &unit, &end)) {
+        return NULL;
+    }
+    if ((unit < 0) || (unit > NTP_REFCLOCK_UNIT_MAX)) {
+        return NULL;
+    }
+    *punit = unit;
+    if (NTP_REFCLOCK_DRIVER_PPS == driver) {
+        return NTP_REFCLOCK_PPS_KW;
+    }
+    if (NTP_REFCLOCK_DRIVER_SHM == driver) {
+        return NTP_REFCLOCK_SHM_KW;
+    }
+    return NULL;
+}
+
+/* Returns the algorithm keyword of an NTP_Key key_password and points
+ * 'psecret' to its key.
+ */
+static inline const char *
+ntp_key_parse_password(const char *password, const char **psecret)
+{
+    static const char *algorithms[] = { NTP_KEY_ALGORITHM_SHA1,
+                                        NTP_KEY_ALGORITHM_SHA256,
+                                        NTP_KEY_ALGORITHM_AES128CMAC };
+    size_t len = 0;
+    int i;
+
+    for (i = 0; i < sizeof(algorithms) / sizeof(algorithms[0]); i++) {
+        len = strlen(algorithms[i]);
+        if ((0 == strncmp(password, algorithms[i], len)) && (':' == password[len])) {
+            *psecret = password + len + 1;
+            return algorithms[i];
+        }
+    }
+    *psecret = password;
+    return NTP_KEY_ALGORITHM_MD5;
+}
+
 #endif /* VTYSH_OVSDB_NTP_CONTEXT_H */
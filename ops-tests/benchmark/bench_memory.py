@@ -0,0 +1,196 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Benchmark for the resident memory of ops-ntpd.
+ - Compares two layouts of the status commits:
+   . process: a transaction manager process forked with multiprocessing,
+     with its own IDL connection, as ops-ntpd used to run
+   . single: the status committed on the IDL connection of the daemon
+ - Each layout runs in a fresh interpreter. It imports ops_ntpd and opens
+   its IDL connections to a private ovsdb-server, then reports the RSS
+   and PSS of its processes. PSS splits the pages shared by the forked
+   process, RSS counts them in both.
+ - Without ovsdb-server only the interpreters are measured, the IDL
+   replicas are not.
+
+ Usage:
+   bench_memory.py --associations 64
+'''
+
+import os
+import sys
+import json
+import time
+import shutil
+import argparse
+import tempfile
+import subprocess
+import multiprocessing
+
+BENCH_DIR = os.path.dirname(os.path.realpath(__file__))
+REPO_DIR = os.path.realpath(os.path.join(BENCH_DIR, "..", ".."))
+sys.path.insert(0, REPO_DIR)
+
+DEFAULT_SCHEMA = "/usr/share/openvswitch/vswitch.ovsschema"
+LAYOUTS = ["process", "single"]
+
+
+def bench_process_memory(pid):
+    '''
+    Returns the RSS and PSS of process 'pid', in KB
+    '''
+    rss = 0
+    pss = 0
+    with open("/proc/%d/status" % (pid), "r") as f:
+        for line in f:
+            if line.startswith("VmRSS:"):
+                rss = int(line.split()[1])
+    smaps = "/proc/%d/smaps_rollup" % (pid)
+    if not os.path.exists(smaps):
+        smaps = "/proc/%d/smaps" % (pid)
+    with open(smaps, "r") as f:
+        for line in f:
+            if line.startswith("Pss:"):
+                pss += int(line.split()[1])
+    return rss, pss
+
+
+def bench_wait_idl(idl):
+    deadline = time.time() + 10
+    while time.time() < deadline:
+        idl.run()
+        if idl.change_seqno:
+            return
+        time.sleep(0.05)
+    raise RuntimeError("IDL did not get the database contents")
+
+
+def bench_sync_mgr(remote, ready, stop):
+    '''
+    The transaction manager process of the 'process' layout
+    '''
+    import ops_ntpd_sync_to_ovsdb
+    sync_mgr = None
+    if remote is not None:
+        ops_ntpd_sync_to_ovsdb.def_db = remote
+        sync_mgr = ops_ntpd_sync_to_ovsdb.NTPTransactionMgr()
+    ready.send(True)
+    stop.recv()
+    if sync_mgr is not None:
+        sync_mgr.close()
+
+
+def bench_layout(layout, remote, schema):
+    '''
+    Runs ops-ntpd in 'layout' and returns the memory of its processes
+    '''
+    import bench_status_pipeline
+    bench_status_pipeline.bench_stub_platform_modules()
+    import ovs.vlog
+    import ops_ntpd
+    import ops_ntpd_sync_to_ovsdb
+    ovs.vlog.Vlog.init(None)
+    ops_ntpd.ovs_schema = schema
+    ops_ntpd_sync_to_ovsdb.ovs_schema = schema
+    if remote is not None:
+        ops_ntpd.ops_ntpd_setup_ovsdb_monitoring(remote)
+        bench_wait_idl(ops_ntpd.idl)
+        ops_ntpd.ops_ntpd_init_transaction_mgr()
+
+    pids = [os.getpid()]
+    child = None
+    if layout == "process":
+        ready, child_ready = multiprocessing.Pipe()
+        child_stop, stop = multiprocessing.Pipe()
+        child = multiprocessing.Process(target=bench_sync_mgr,
+                                        args=(remote, child_ready,
+                                              child_stop))
+        child.start()
+        ready.recv()
+        pids.append(child.pid)
+    memory = [bench_process_memory(pid) for pid in pids]
+    if child is not None:
+        stop.send(True)
+        child.join()
+    if remote is not None:
+        ops_ntpd.idl.close()
+    return {"layout": layout, "processes": len(pids),
+            "rss_kb": sum([m[0] for m in memory]),
+            "pss_kb": sum([m[1] for m in memory])}
+
+
+def bench_report(results, idl):
+    print("ops-ntpd memory, %s" %
+          ("with IDL replicas" if idl else "interpreters only, no IDL"))
+    for result in results:
+        print("  %-8s processes %d  rss %8d KB  pss %8d KB" %
+              (result["layout"], result["processes"], result["rss_kb"],
+               result["pss_kb"]))
+    before, after = results
+    print("  saved    rss %8d KB  pss %8d KB" %
+          (before["rss_kb"] - after["rss_kb"],
+           before["pss_kb"] - after["pss_kb"]))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--associations", type=int, default=8)
+    parser.add_argument("--schema", default=DEFAULT_SCHEMA)
+    parser.add_argument("--output", default=None,
+                        help="Write the results as JSON to this file")
+    parser.add_argument("--layout", choices=LAYOUTS, default=None,
+                        help=argparse.SUPPRESS)
+    parser.add_argument("--remote", default=None, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.layout is not None:
+        print(json.dumps(bench_layout(args.layout, args.remote,
+                                      args.schema)))
+        return 0
+
+    import bench_status_pipeline
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-bench-")
+    server = None
+    try:
+        if os.path.exists(args.schema) and \
+                subprocess.call(["which", "ovsdb-server"],
+                                stdout=open(os.devnull, "w")) == 0:
+            server = bench_status_pipeline.OvsdbServer(args.schema,
+                                                       workdir)
+            server.populate(args.associations)
+        results = []
+        for layout in LAYOUTS:
+            command = [sys.executable, os.path.realpath(__file__),
+                       "--layout", layout, "--schema", args.schema]
+            if server is not None:
+                command += ["--remote", server.remote]
+            output = subprocess.check_output(command)
+            results.append(json.loads(output.strip().split("\n")[-1]))
+    finally:
+        if server is not None:
+            server.stop()
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    bench_report(results, server is not None)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=4, sort_keys=True)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
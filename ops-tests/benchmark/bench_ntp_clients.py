@@ -0,0 +1,273 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ NTP client load generator for the ops-ntpd server mode.
+ - Simulates well behaved clients, polling at a low rate, and flooding
+   clients against one NTP server, each from its own socket.
+ - NTPD rate limits per source address. With --source-base every client
+   binds the next address from the base (e.g. 127.0.1.1 on the switch
+   itself, any 127/8 address is local), so clients are told apart.
+ - Every request is matched to its response by its transmit timestamp.
+   Responses are counted as answered, or as Kiss-o'-Death (stratum 0,
+   'RATE', 'DENY' or 'RSTR' refid), requests not answered within
+   --timeout as lost.
+ - Reports per client class the counts and the response latency
+   percentiles. Exits with a non-zero status when less than
+   --min-answered-pct of the well behaved clients requests are
+   answered, so that a flood starving them fails the run.
+
+ Usage:
+   bench_ntp_clients.py --server 127.0.0.1 --source-base 127.0.1.1 \
+       --clients 8 --rate 1 --flooders 2 --flood-rate 200 --duration 30
+'''
+
+import sys
+import json
+import time
+import struct
+import socket
+import select
+import argparse
+
+NTP_PACKET_FORMAT = "!BBbbII4sQQQQ"
+NTP_PACKET_LEN = struct.calcsize(NTP_PACKET_FORMAT)
+# Seconds between the NTP (1900) and the Unix (1970) epochs
+NTP_EPOCH_OFFSET = 2208988800
+# LI 0, version 4, mode 3 (client)
+NTP_CLIENT_FLAGS = (4 << 3) | 3
+NTP_KOD_CODES = ["RATE", "DENY", "RSTR"]
+
+
+def bench_ntp_timestamp(now):
+    return int((now + NTP_EPOCH_OFFSET) * (1 << 32))
+
+
+def bench_request(xmt):
+    return struct.pack(NTP_PACKET_FORMAT, NTP_CLIENT_FLAGS, 0, 0, 0, 0, 0,
+                       "\0\0\0\0", 0, 0, 0, xmt)
+
+
+def bench_parse_response(data):
+    '''
+    Returns the (stratum, refid, origin timestamp) of a response, None
+    if it is not an NTP response
+    '''
+    if len(data) < NTP_PACKET_LEN:
+        return None
+    fields = struct.unpack(NTP_PACKET_FORMAT, data[:NTP_PACKET_LEN])
+    return (fields[1], fields[6], fields[8])
+
+
+def bench_percentile(values, pct):
+    if not values:
+        return None
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * pct / 100.0))]
+
+
+class BenchClient(object):
+
+    def __init__(self, name, source, server, rate):
+        '''
+        A client sending 'rate' requests per second to 'server' from
+        the 'source' address, any local address when None
+        '''
+        self.name = name
+        self.server = server
+        self.interval = 1.0 / rate
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setblocking(0)
+        self.sock.bind((source or "0.0.0.0", 0))
+        self.next_send = 0
+        # Transmit timestamp -> send time
+        self.pending = {}
+        self.sent = 0
+        self.answered = 0
+        self.kod = {}
+        self.lost = 0
+        self.latencies = []
+
+    def send(self, now):
+        xmt = bench_ntp_timestamp(now)
+        while xmt in self.pending:
+            xmt += 1
+        try:
+            self.sock.sendto(bench_request(xmt), self.server)
+        except socket.error:
+            # Counted as lost
+            pass
+        self.pending[xmt] = now
+        self.sent += 1
+        self.next_send = max(self.next_send + self.interval, now)
+
+    def receive(self, now):
+        while True:
+            try:
+                data = self.sock.recv(1024)
+            except socket.error:
+                return
+            response = bench_parse_response(data)
+            if response is None or response[2] not in self.pending:
+                continue
+            (stratum, refid, origin) = response
+            sent = self.pending.pop(origin)
+            if stratum == 0 and refid in NTP_KOD_CODES:
+                self.kod[refid] = self.kod.get(refid, 0) + 1
+                continue
+            self.answered += 1
+            self.latencies.append((now - sent) * 1000)
+
+    def expire(self, now, timeout):
+        for xmt, sent in self.pending.items():
+            if now - sent >= timeout:
+                del self.pending[xmt]
+                self.lost += 1
+
+
+def bench_run(server, classes, duration, timeout):
+    '''
+    Runs the clients of 'classes', a list of (name, sources, rate), for
+    'duration' seconds and returns the results per class
+    '''
+    clients = []
+    for (name, sources, rate) in classes:
+        clients += [BenchClient(name, source, server, rate)
+                    for source in sources]
+    by_sock = dict([(client.sock, client) for client in clients])
+    start = time.time()
+    for client in clients:
+        client.next_send = start
+    end = start + duration
+    while True:
+        now = time.time()
+        if now >= end + timeout:
+            break
+        next_event = end + timeout
+        for client in clients:
+            if now < end and now >= client.next_send:
+                client.send(now)
+            if now < end:
+                next_event = min(next_event, client.next_send)
+            client.expire(now, timeout)
+        readable = select.select(by_sock.keys(), [], [],
+                                 max(next_event - time.time(), 0))[0]
+        now = time.time()
+        for sock in readable:
+            by_sock[sock].receive(now)
+    for client in clients:
+        client.lost += len(client.pending)
+        client.sock.close()
+
+    results = {}
+    for (name, sources, rate) in classes:
+        members = [c for c in clients if c.name == name]
+        latencies = sum([c.latencies for c in members], [])
+        kod = {}
+        for c in members:
+            for code, count in c.kod.iteritems():
+                kod[code] = kod.get(code, 0) + count
+        sent = sum([c.sent for c in members])
+        answered = sum([c.answered for c in members])
+        results[name] = {
+            "clients": len(members),
+            "rate": rate,
+            "sent": sent,
+            "answered": answered,
+            "answered_pct": 100.0 * answered / sent if sent else 0.0,
+            "kod": kod,
+            "lost": sum([c.lost for c in members]),
+            "latency_p50_ms": bench_percentile(latencies, 50),
+            "latency_p95_ms": bench_percentile(latencies, 95),
+            "latency_p99_ms": bench_percentile(latencies, 99),
+        }
+    return results
+
+
+def bench_sources(source_base, first, count):
+    '''
+    Returns the source addresses of 'count' clients, from the address
+    'first' after 'source_base'
+    '''
+    if source_base is None:
+        return [None] * count
+    base = struct.unpack("!I", socket.inet_aton(source_base))[0]
+    return [socket.inet_ntoa(struct.pack("!I", base + first + i))
+            for i in range(count)]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="NTP client load generator")
+    parser.add_argument("--server", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=123)
+    parser.add_argument("--source-base", default=None,
+                        help="First client source address")
+    parser.add_argument("--clients", type=int, default=8,
+                        help="Well behaved clients")
+    parser.add_argument("--rate", type=float, default=1.0,
+                        help="Requests per second of a well behaved client")
+    parser.add_argument("--flooders", type=int, default=1,
+                        help="Flooding clients")
+    parser.add_argument("--flood-rate", type=float, default=200.0,
+                        help="Requests per second of a flooding client")
+    parser.add_argument("--duration", type=float, default=30.0)
+    parser.add_argument("--timeout", type=float, default=1.0,
+                        help="Seconds after which a request is lost")
+    parser.add_argument("--min-answered-pct", type=float, default=None,
+                        help="Fail when fewer well behaved requests are "
+                        "answered")
+    parser.add_argument("--output", default=None,
+                        help="Write the results to this JSON file")
+    args = parser.parse_args()
+
+    classes = [("clients", bench_sources(args.source_base, 0, args.clients),
+                args.rate)]
+    if args.flooders > 0:
+        classes.append(("flooders",
+                        bench_sources(args.source_base, args.clients,
+                                      args.flooders),
+                        args.flood_rate))
+    results = bench_run((args.server, args.port), classes, args.duration,
+                        args.timeout)
+
+    print("%-10s %7s %8s %8s %8s %8s %8s %9s %9s" %
+          ("class", "clients", "sent", "answered", "kod", "lost",
+           "answ %", "p50 ms", "p99 ms"))
+    for name, result in sorted(results.iteritems()):
+        print("%-10s %7d %8d %8d %8d %8d %8.1f %9s %9s" %
+              (name, result["clients"], result["sent"], result["answered"],
+               sum(result["kod"].values()), result["lost"],
+               result["answered_pct"],
+               "%.3f" % result["latency_p50_ms"]
+               if result["latency_p50_ms"] is not None else "-",
+               "%.3f" % result["latency_p99_ms"]
+               if result["latency_p99_ms"] is not None else "-"))
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.min_answered_pct is not None and \
+            results["clients"]["answered_pct"] < args.min_answered_pct:
+        print("FAILED: %.1f%% of the well behaved requests answered, "
+              "%.1f%% expected" % (results["clients"]["answered_pct"],
+                                   args.min_answered_pct))
+        return 1
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
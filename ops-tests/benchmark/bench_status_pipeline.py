@@ -0,0 +1,271 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Benchmark for the ops-ntpd status pipeline.
+ - Runs the collection (ntpq exec), parse and OVSDB commit stages of a
+   status refresh against the stub ntpq and a private ovsdb-server.
+ - Reports per-cycle latency of every stage, CPU time (including the
+   forked ntpq processes), memory growth and the OVSDB transaction rate.
+ - Exits with a non-zero status when the p95 cycle latency is above
+   --max-cycle-ms, so it can be used to gate regressions.
+
+ Usage:
+   bench_status_pipeline.py --associations 1,8,64 --cycles 50
+'''
+
+import os
+import sys
+import gc
+import json
+import time
+import shutil
+import argparse
+import resource
+import tempfile
+import subprocess
+
+BENCH_DIR = os.path.dirname(os.path.realpath(__file__))
+REPO_DIR = os.path.realpath(os.path.join(BENCH_DIR, "..", ".."))
+sys.path.insert(0, REPO_DIR)
+
+try:
+    import tracemalloc
+except ImportError:
+    tracemalloc = None
+
+DEFAULT_SCHEMA = "/usr/share/openvswitch/vswitch.ovsschema"
+
+
+def bench_stub_platform_modules():
+    '''
+    ops_ntpd imports OpenSwitch platform modules which are not needed
+    to run the status pipeline. Stub them when they are not installed.
+    '''
+    import types
+    for name, attrs in [("ops_eventlog", ["event_log_init", "log_event"]),
+                        ("ops_diagdump", ["init_diag_dump_basic"])]:
+        try:
+            __import__(name)
+        except ImportError:
+            module = types.ModuleType(name)
+            for attr in attrs:
+                setattr(module, attr, lambda *args, **kwargs: None)
+            sys.modules[name] = module
+
+
+class OvsdbServer(object):
+    '''
+    A private ovsdb-server with the OpenSwitch schema and the rows needed
+    by the status pipeline.
+    '''
+
+    def __init__(self, schema, workdir):
+        self.workdir = workdir
+        self.db = os.path.join(workdir, "bench.db")
+        self.sock = os.path.join(workdir, "db.sock")
+        self.pidfile = os.path.join(workdir, "ovsdb-server.pid")
+        self.remote = "unix:" + self.sock
+        with open(schema, "r") as f:
+            self.schema = json.load(f)
+        subprocess.check_call(["ovsdb-tool", "create", self.db, schema])
+        subprocess.check_call(["ovsdb-server", self.db,
+                               "--remote=punix:" + self.sock,
+                               "--unixctl=" + os.path.join(workdir, "ctl"),
+                               "--pidfile=" + self.pidfile, "--detach"])
+
+    def populate(self, associations):
+        system = {"cur_cfg": 1}
+        ops = []
+        system_columns = self.schema["tables"]["System"]["columns"]
+        if "vrfs" in system_columns:
+            ops.append({"op": "insert", "table": "VRF",
+                        "row": {"name": "vrf_default"},
+                        "uuid-name": "vrf0"})
+            system["vrfs"] = ["set", [["named-uuid", "vrf0"]]]
+        ops.append({"op": "insert", "table": "System", "row": system})
+        for i in range(associations):
+            row = {"address": "10.%d.%d.%d" % ((i >> 16) & 0xff,
+                                               (i >> 8) & 0xff,
+                                               (i & 0xff) + 1)}
+            if "vrfs" in system_columns:
+                row["vrf"] = ["named-uuid", "vrf0"]
+            ops.append({"op": "insert", "table": "NTP_Association",
+                        "row": row})
+        subprocess.check_call(["ovsdb-client", "transact", self.remote,
+                               json.dumps([self.schema["name"]] + ops)],
+                              stdout=open(os.devnull, "w"))
+
+    def stop(self):
+        with open(self.pidfile, "r") as f:
+            os.kill(int(f.read().strip()), 15)
+
+
+def bench_percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p * len(values)))]
+
+
+def bench_run(ops_ntpd, sync_mgr, associations, cycles):
+    '''
+    Runs 'cycles' status refreshes and returns the measured numbers.
+    '''
+    os.environ["NTPQ_STUB_ASSOCIATIONS"] = str(associations)
+    stages = {"collect": [], "parse": [], "commit": [], "cycle": []}
+    exec_time = [0.0]
+    run_command = ops_ntpd.ops_ntpd_run_command
+
+    def timed_run_command(command):
+        start = time.time()
+        try:
+            return run_command(command)
+        finally:
+            exec_time[0] += time.time() - start
+
+    ops_ntpd.ops_ntpd_run_command = timed_run_command
+    gc.collect()
+    objects_before = len(gc.get_objects())
+    rss_before = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    if tracemalloc is not None:
+        tracemalloc.start()
+    ru_self = resource.getrusage(resource.RUSAGE_SELF)
+    ru_children = resource.getrusage(resource.RUSAGE_CHILDREN)
+    commits = 0
+    bench_start = time.time()
+
+    for cycle in range(cycles):
+        ntpd_updates = {"associations_info": {}, "statistics": {},
+                        "status": {}}
+        exec_time[0] = 0.0
+        start = time.time()
+        ops_ntpd.ops_ntpd_get_ntpd_associations_info(ntpd_updates)
+        ops_ntpd.ops_ntpd_get_ntpd_global_status(ntpd_updates)
+        collected = time.time()
+        stages["collect"].append(exec_time[0])
+        stages["parse"].append(collected - start - exec_time[0])
+
+        sync_mgr.update_info(ntpd_updates)
+        commits += 1
+        committed = time.time()
+        stages["commit"].append(committed - collected)
+        stages["cycle"].append(committed - start)
+
+    elapsed = time.time() - bench_start
+    ru_self_end = resource.getrusage(resource.RUSAGE_SELF)
+    ru_children_end = resource.getrusage(resource.RUSAGE_CHILDREN)
+    result = {"associations": associations, "cycles": cycles}
+    for stage, values in stages.items():
+        result[stage] = {
+            "p50_ms": bench_percentile(values, 0.50) * 1000,
+            "p95_ms": bench_percentile(values, 0.95) * 1000,
+            "max_ms": max(values) * 1000}
+    result["cpu_self_ms_per_cycle"] = \
+        ((ru_self_end.ru_utime + ru_self_end.ru_stime) -
+         (ru_self.ru_utime + ru_self.ru_stime)) * 1000 / cycles
+    result["cpu_ntpq_ms_per_cycle"] = \
+        ((ru_children_end.ru_utime + ru_children_end.ru_stime) -
+         (ru_children.ru_utime + ru_children.ru_stime)) * 1000 / cycles
+    result["ovsdb_txn_per_sec"] = commits / elapsed
+    if tracemalloc is not None:
+        current, peak = tracemalloc.get_traced_memory()
+        tracemalloc.stop()
+        result["alloc_peak_kb"] = peak / 1024.0
+    gc.collect()
+    result["objects_retained"] = len(gc.get_objects()) - objects_before
+    result["rss_growth_kb"] = \
+        resource.getrusage(resource.RUSAGE_SELF).ru_maxrss - rss_before
+    ops_ntpd.ops_ntpd_run_command = run_command
+    return result
+
+
+def bench_report(result):
+    print("associations=%d cycles=%d" % (result["associations"],
+                                         result["cycles"]))
+    for stage in ["collect", "parse", "commit", "cycle"]:
+        print("  %-8s p50 %8.3f ms  p95 %8.3f ms  max %8.3f ms" %
+              (stage, result[stage]["p50_ms"], result[stage]["p95_ms"],
+               result[stage]["max_ms"]))
+    print("  cpu      self %.3f ms/cycle  ntpq %.3f ms/cycle" %
+          (result["cpu_self_ms_per_cycle"],
+           result["cpu_ntpq_ms_per_cycle"]))
+    print("  ovsdb    %.1f txn/s" % result["ovsdb_txn_per_sec"])
+    if "alloc_peak_kb" in result:
+        print("  memory   peak alloc %.1f KB" % result["alloc_peak_kb"])
+    print("  memory   retained objects %d  rss growth %d KB" %
+          (result["objects_retained"], result["rss_growth_kb"]))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--associations", default="1,8",
+                        help="Comma separated association counts")
+    parser.add_argument("--cycles", type=int, default=50)
+    parser.add_argument("--schema", default=DEFAULT_SCHEMA)
+    parser.add_argument("--max-cycle-ms", type=float, default=None,
+                        help="Fail when the p95 cycle latency is above")
+    parser.add_argument("--output", default=None,
+                        help="Write the results as JSON to this file")
+    args = parser.parse_args()
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-bench-")
+    bindir = os.path.join(workdir, "bin")
+    os.mkdir(bindir)
+    os.symlink(os.path.join(BENCH_DIR, "stub_ntpq.py"),
+               os.path.join(bindir, "ntpq"))
+    os.environ["PATH"] = bindir + os.pathsep + os.environ["PATH"]
+
+    bench_stub_platform_modules()
+    import ovs.vlog
+    import ops_ntpd
+    import ops_ntpd_sync_to_ovsdb
+    ovs.vlog.Vlog.init(None)
+    # Never touch the RTC of the machine running the benchmark
+    ops_ntpd.ops_ntpd_rtc_sync = lambda synchronized: None
+    ops_ntpd_sync_to_ovsdb.ovs_schema = args.schema
+
+    results = []
+    failed = False
+    try:
+        for associations in [int(x) for x in args.associations.split(",")]:
+            server = OvsdbServer(args.schema,
+                                 tempfile.mkdtemp(dir=workdir))
+            try:
+                server.populate(associations)
+                ops_ntpd_sync_to_ovsdb.def_db = server.remote
+                sync_mgr = ops_ntpd_sync_to_ovsdb.NTPTransactionMgr()
+                result = bench_run(ops_ntpd, sync_mgr, associations,
+                                   args.cycles)
+                sync_mgr.close()
+            finally:
+                server.stop()
+            bench_report(result)
+            results.append(result)
+            if args.max_cycle_ms is not None and \
+                    result["cycle"]["p95_ms"] > args.max_cycle_ms:
+                print("  FAIL: p95 cycle latency above %.3f ms" %
+                      args.max_cycle_ms)
+                failed = True
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=4, sort_keys=True)
+    return 1 if failed else 0
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,121 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Stub ntpq used by the ops-ntpd benchmarks.
+ - Replays the captured 'apeers', 'rv' and 'sysstats' outputs found in
+   the fixtures directory for a configurable number of associations.
+ - The number of associations is taken from NTPQ_STUB_ASSOCIATIONS
+   (default 8). The first association is the system peer.
+ - NTPQ_STUB_NETNS_BASE maps network namespaces to the first octet of
+   the association addresses ("red=20,blue=30", default 10), so that
+   the namespace an ntpq ran in can be told from its output.
+ - Any other command (keyid, passwd, :config ...) is accepted silently.
+'''
+
+import os
+import sys
+import time
+import subprocess
+
+FIXTURES_DIR = os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                            "fixtures")
+ASSOCID_BASE = 10000
+
+
+def stub_read_fixture(name):
+    with open(os.path.join(FIXTURES_DIR, name), "r") as f:
+        return f.read()
+
+
+def stub_address_base():
+    mapping = os.environ.get("NTPQ_STUB_NETNS_BASE")
+    if not mapping:
+        return 10
+    netns = subprocess.Popen(["ip", "netns", "identify", str(os.getpid())],
+                             stdout=subprocess.PIPE).communicate()[0].strip()
+    for entry in mapping.split(","):
+        name, base = entry.split("=")
+        if name == netns:
+            return int(base)
+    return 10
+
+
+def stub_associations():
+    count = int(os.environ.get("NTPQ_STUB_ASSOCIATIONS", "8"))
+    base = stub_address_base()
+    now = int(time.time())
+    assocs = []
+    for i in range(count):
+        assocs.append({
+            "assid": ASSOCID_BASE + i,
+            "remote": "%d.%d.%d.%d" % (base, (i >> 16) & 0xff,
+                                       (i >> 8) & 0xff, (i & 0xff) + 1),
+            "tally": "*" if i == 0 else "+",
+            "selection": "sel_sys.peer" if i == 0 else "sel_candidate",
+            # Make every refresh look like a new poll with a new offset
+            "when": (now + i) % 64,
+            "offset": "%.3f" % (((now + i) % 17 - 8) / 100.0),
+        })
+    return assocs
+
+
+def stub_apeers(assocs):
+    lines = stub_read_fixture("apeers.txt").splitlines()
+    out = lines[:2]
+    for assoc in assocs:
+        out.append(lines[2].format(**assoc))
+    return "\n".join(out) + "\n"
+
+
+def stub_rv(assocs, assid):
+    for assoc in assocs:
+        if str(assoc["assid"]) == assid:
+            return stub_read_fixture("rv.txt").format(**assoc)
+    return "***Server reports a bad association ID\n"
+
+
+def stub_sysstats():
+    uptime = int(time.time()) % 100000
+    return stub_read_fixture("sysstats.txt").format(
+        uptime=uptime, packets=uptime * 8, processed=uptime * 4)
+
+
+def main(argv):
+    commands = []
+    i = 1
+    while i < len(argv):
+        if argv[i] == "-c" and i + 1 < len(argv):
+            commands.append(argv[i + 1].strip())
+            i += 2
+        else:
+            i += 1
+
+    assocs = stub_associations()
+    out = ""
+    for command in commands:
+        if command == "apeers":
+            out += stub_apeers(assocs)
+        elif command.startswith("rv "):
+            out += stub_rv(assocs, command.split()[1])
+        elif command == "sysstats":
+            out += stub_sysstats()
+    sys.stdout.write(out)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -512,6 +512,28 @@ def ntp_add_server_all_options(dut, step):
     step('\n### === server (with all options) addition test end === ###\n')
 
 
+def ntp_show_statistics_associations(dut, step):
+    step('\n### === association statistics display test start === ###')
+    dump = dut("show ntp statistics associations")
+    lines = dump.splitlines()
+    count = 0
+    for line in lines:
+        if ("OFFSET-P50" in line and "ADEV-1" in line and
+           "REACH-LOSS" in line):
+            step('\n### statistics header present as per show cli - '
+                 'passed ###')
+            count = count + 1
+        if ("5.5.5.5" in line):
+            step('\n### server present as per show cli - passed ###')
+            count = count + 1
+
+    assert count == 2,\
+            '\n### association statistics display test failed ###'
+
+    step('\n### association statistics display test passed ###')
+    step('\n### === association statistics display test end === ###\n')
+
+
 def ntp_add_more_than_8_servers(dut, step):
     step('\n### === addition of more than 8 servers test start === ###')
     morethan8serverserror = "Maximum number of configurable NTP server limit has been reached"
@@ -673,6 +695,211 @@ def ntp_add_server_with_long_server_name(dut, step):
          '\n')
 
 
+def ntp_add_servers_bulk(dut, step):
+    step('\n### === bulk server addition test start === ###')
+    dut("configure terminal")
+    count = 0
+
+    ''' one invalid entry rejects the whole list '''
+    lines = dut("ntp servers 11.1.1.1 127.0.0.1")
+    if "No server configured, 127.0.0.1 was rejected" in lines:
+        count += 1
+
+    dut("ntp servers 11.1.1.1 prefer 12.1.1.1 version 4 13.1.1.1")
+    dut("end")
+
+    dump = dut("show running-config")
+    lines = dump.splitlines()
+    for line in lines:
+        if ("ntp server 11.1.1.1 prefer" in line):
+            count = count + 1
+        if ("ntp server 12.1.1.1 version 4" in line):
+            count = count + 1
+        if ("ntp server 13.1.1.1" in line):
+            count = count + 1
+
+    ''' clean up '''
+    dut("configure terminal")
+    dut("no ntp servers 11.1.1.1 12.1.1.1 13.1.1.1")
+    dut("end")
+
+    dump = dut("show running-config")
+    lines = dump.splitlines()
+    for line in lines:
+        if ("11.1.1.1" in line or "12.1.1.1" in line or "13.1.1.1" in line):
+            count = count - 1
+
+    assert count == 4,\
+            '\n### bulk server addition test failed ###'
+
+    step('\n### bulk server addition test passed ###')
+    step('\n### === bulk server addition test end === ###\n')
+
+
+def ntp_add_server_vrf_option(dut, step):
+    step('\n### === server (with vrf option) addition test start === ###')
+    dut("configure terminal")
+    count = 0
+
+    lines = dut("ntp server 14.1.1.1 vrf no_such_vrf")
+    if "VRF no_such_vrf does not exist" in lines:
+        count += 1
+
+    dut("ntp server 14.1.1.1 vrf vrf_default")
+    dut("end")
+
+    dump = dut("show running-config")
+    lines = dump.splitlines()
+    for line in lines:
+        if ("ntp server 14.1.1.1" in line):
+            count = count + 1
+        if ("vrf" in line and "14.1.1.1" in line):
+            count = count - 1
+
+    dut("configure terminal")
+    dut("no ntp server 14.1.1.1 vrf vrf_default")
+    dut("end")
+
+    dump = dut("show running-config")
+    if "14.1.1.1" in dump:
+        count = count - 1
+
+    assert count == 2,\
+        '\n### server (with vrf option) addition test failed ###'
+
+    step('\n### server (with vrf option) addition test passed ###')
+    step('\n### === server (with vrf option) addition test end === ###\n')
+
+
+def ntp_add_refclock(dut, step):
+    step('\n### === reference clock addition test start === ###')
+    dut("configure terminal")
+    count = 0
+
+    lines = dut("ntp refclock shm 2 refid GPS!")
+    if "Reference clock identifier should be" in lines:
+        count += 1
+
+    dut("ntp refclock shm 2 refid GPS")
+    dut("ntp refclock pps 0 prefer")
+    dut("ntp refclock shm 3 feed phc /dev/ptp0")
+    dut("end")
+
+    dump = dut("show running-config")
+    lines = dump.splitlines()
+    for line in lines:
+        if ("ntp refclock shm 2 refid GPS" in line):
+            count = count + 1
+        if ("ntp refclock pps 0 prefer" in line):
+            count = count + 1
+        if ("ntp refclock shm 3 feed phc /dev/ptp0" in line):
+            count = count + 1
+
+    dut("configure terminal")
+    dut("no ntp refclock shm 2")
+    dut("no ntp refclock pps 0")
+    dut("no ntp refclock shm 3")
+    dut("end")
+
+    dump = dut("show running-config")
+    if "ntp refclock" in dump:
+        count = count - 1
+
+    assert count == 4,\
+        '\n### reference clock addition test failed ###'
+
+    step('\n### reference clock addition test passed ###')
+    step('\n### === reference clock addition test end === ###\n')
+
+
+def ntp_serve_config(dut, step):
+    step('\n### === server mode configuration test start === ###')
+    dut("configure terminal")
+    count = 0
+
+    lines = dut("ntp serve allow 10.1.0.0/40")
+    if "Invalid client network" in lines:
+        count += 1
+
+    dut("ntp serve")
+    dut("ntp serve allow 10.1.2.3/16")
+    dut("ntp serve allow fd00::/8")
+    dut("ntp serve rate-limit average 4 minimum 2")
+    dut("end")
+
+    dump = dut("show running-config")
+    lines = dump.splitlines()
+    for line in lines:
+        if (line.strip() == "ntp serve"):
+            count = count + 1
+        if ("ntp serve allow 10.1.0.0/16" in line):
+            count = count + 1
+        if ("ntp serve allow fd00::/8" in line):
+            count = count + 1
+        if ("ntp serve rate-limit average 4 minimum 2" in line):
+            count = count + 1
+
+    dump = dut("show ntp status")
+    if "NTP server mode is enabled" in dump:
+        count = count + 1
+
+    dut("configure terminal")
+    dut("no ntp serve rate-limit")
+    dut("no ntp serve allow 10.1.0.0/16")
+    dut("no ntp serve allow fd00::/8")
+    dut("no ntp serve")
+    dut("end")
+
+    dump = dut("show running-config")
+    if "ntp serve" in dump:
+        count = count - 1
+
+    assert count == 6,\
+        '\n### server mode configuration test failed ###'
+
+    step('\n### server mode configuration test passed ###')
+    step('\n### === server mode configuration test end === ###\n')
+
+
+def ntp_auth_key_algorithms_config(dut, step):
+    step('\n### === auth-key algorithms test start === ###')
+    sha1_key = "0123456789abcdef0123456789abcdef01234567"
+    sha256_key = "0123456789abcdef" * 4
+    aes_key = "0123456789abcdef0123456789abcdef"
+    dut("configure terminal")
+    count = 0
+
+    lines = dut("ntp authentication-key 21 sha256 %s" % (sha1_key))
+    if "sha256 key should be 64 hexadecimal digits" in lines:
+        count += 1
+
+    dut("ntp authentication-key 20 sha1 %s" % (sha1_key))
+    dut("ntp authentication-key 21 sha256 %s" % (sha256_key))
+    dut("ntp authentication-key 22 aes128cmac %s" % (aes_key.upper()))
+    dut("end")
+
+    dump = dut("show running-config")
+    for key in ["20 sha1 %s" % (sha1_key), "21 sha256 %s" % (sha256_key),
+                "22 aes128cmac %s" % (aes_key)]:
+        if "ntp authentication-key %s" % (key) in dump:
+            count = count + 1
+
+    dump = dut("show ntp authentication-keys")
+    if "aes128cmac" in dump and aes_key in dump:
+        count = count + 1
+
+    dut("configure terminal")
+    for key in ["20", "21", "22"]:
+        dut("no ntp authentication-key %s" % (key))
+    dut("end")
+
+    assert count == 5,\
+        '\n### auth-key algorithms test failed ###'
+
+    step('\n### auth-key algorithms test passed ###')
+    step('\n### === auth-key algorithms test end === ###\n')
+
+
 def test_ct_ntp_config(topology, step):
     ops1 = topology.get("ops1")
     assert ops1 is not None
@@ -687,6 +914,8 @@ def test_ct_ntp_config(topology, step):
 
     ntp_tool_on_gpwd_add(ops1, step)
 
+    ntp_auth_key_algorithms_config(ops1, step)
+
     ntp_add_server_no_options(ops1, step)
 
     ntp_add_server_prefer_option(ops1, step)
@@ -697,12 +926,22 @@ def test_ct_ntp_config(topology, step):
 
     ntp_add_server_with_long_server_name(ops1, step)
 
+    ntp_add_servers_bulk(ops1, step)
+
+    ntp_add_server_vrf_option(ops1, step)
+
+    ntp_add_refclock(ops1, step)
+
+    ntp_serve_config(ops1, step)
+
     ntp_add_server_with_invalid_server_name(ops1, step)
 
     ntp_add_server_key_id_option(ops1, step)
 
     ntp_add_server_all_options(ops1, step)
 
+    ntp_show_statistics_associations(ops1, step)
+
     ntp_add_more_than_8_servers(ops1, step)
 
     ntp_modify_8th_ntp_server(ops1, step)
@@ -0,0 +1,141 @@
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Fixtures shared by the ops-ntpd local tests.
+ - Importing this module puts the repository and the benchmark directory
+   on the module path.
+ - check() counts the failures, result() prints the outcome of the test
+   and returns its exit status.
+ - setup_platform() stubs the OpenSwitch platform modules missing on the
+   build host, load_ops_ntpd() also imports ops_ntpd.
+ - TestIdl is an in-memory IDL replica for the code reading ops_ntpd.idl.
+ - TestClock stands in for the time module, with a time under the
+   control of the test.
+'''
+
+import os
+import sys
+import time
+
+LOCAL_DIR = os.path.dirname(os.path.realpath(__file__))
+REPO_DIR = os.path.realpath(os.path.join(LOCAL_DIR, "..", ".."))
+BENCH_DIR = os.path.join(REPO_DIR, "ops-tests", "benchmark")
+sys.path.insert(0, REPO_DIR)
+sys.path.insert(0, BENCH_DIR)
+
+DEFAULT_VRF_UUID = "vrf-default-uuid"
+
+failures = 0
+
+
+def check(cond, message):
+    global failures
+    if not cond:
+        print("FAIL: %s" % (message))
+        failures += 1
+
+
+def result():
+    print("%s" % ("FAILED" if failures else "PASSED"))
+    return 1 if failures else 0
+
+
+def setup_platform():
+    import bench_status_pipeline
+    bench_status_pipeline.bench_stub_platform_modules()
+    import ovs.vlog
+    ovs.vlog.Vlog.init(None)
+
+
+def load_ops_ntpd(fresh=False):
+    '''
+    Returns the ops_ntpd module, reloaded when 'fresh' like for a new run
+    of ops-ntpd. It never touches the RTC of the machine running the test.
+    '''
+    setup_platform()
+    import ops_ntpd
+    if fresh:
+        ops_ntpd = reload(ops_ntpd)
+    ops_ntpd.ops_ntpd_rtc_sync = lambda synchronized: None
+    return ops_ntpd
+
+
+class TestDatum(object):
+
+    def __init__(self, uuid):
+        self.uuid = uuid
+
+    def to_json(self):
+        return ["uuid", self.uuid]
+
+
+class TestRow(object):
+
+    def __init__(self, **columns):
+        self.__dict__.update(columns)
+
+
+class TestTable(object):
+
+    def __init__(self, rows):
+        self.rows = dict(enumerate(rows))
+
+
+class TestIdl(object):
+    '''
+    The System row, with 'ntp_config' and the other 'system' columns, the
+    NTP_Key and NTP_Association rows, and the default VRF
+    '''
+
+    def __init__(self, ntp_config, keys=[], associations=[], **system):
+        self.system = TestRow(ntp_config=ntp_config, **system)
+        self.tables = {
+            "System": TestTable([self.system]),
+            "NTP_Key": TestTable(keys),
+            "NTP_Association": TestTable(associations),
+            "VRF": TestTable([]),
+        }
+        self.tables["VRF"].rows = {
+            DEFAULT_VRF_UUID: TestRow(name="vrf_default")}
+
+
+def association_row(address, **columns):
+    '''
+    Returns an NTP_Association row of the default VRF
+    '''
+    columns.setdefault("association_attributes", {})
+    columns.setdefault("key_id", [])
+    return TestRow(address=address,
+                   _data={"vrf": TestDatum(DEFAULT_VRF_UUID)}, **columns)
+
+
+class TestClock(object):
+    '''
+    The time module, with time() returning 'now' and sleep() advancing it
+    '''
+
+    def __init__(self, now=1000000.0):
+        self.now = now
+
+    def time(self):
+        return self.now
+
+    def sleep(self, seconds):
+        self.now += seconds
+
+    def __getattr__(self, name):
+        return getattr(time, name)
@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Software SHM reference clock used by the ops-ntpd local tests.
+ - Writes time samples into the System V shared memory segment read by
+   the NTPD SHM driver (127.127.28.<unit>), the way gpsd does, so a
+   refclock association can be tested without a GNSS receiver.
+ - The sample is the system clock plus a configurable offset, written
+   once per second with the ops-ntpd SHM feeder code.
+
+ Usage:
+   ./shm_writer.py [--unit N] [--offset SECONDS] [--count N]
+'''
+
+import os
+import sys
+import time
+import argparse
+
+REPO_DIR = os.path.realpath(os.path.join(os.path.dirname(
+    os.path.realpath(__file__)), "..", ".."))
+sys.path.insert(0, REPO_DIR)
+
+from ops_ntpd_shm import ops_ntpd_shm_attach, ops_ntpd_shm_detach, \
+    ops_ntpd_shm_write_sample
+
+
+def main(argv):
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--unit", type=int, default=2)
+    parser.add_argument("--offset", type=float, default=0.0,
+                        help="offset of the source from the system clock")
+    parser.add_argument("--count", type=int, default=0,
+                        help="number of samples, 0 for no limit")
+    args = parser.parse_args(argv[1:])
+
+    (shmid, shm) = ops_ntpd_shm_attach(args.unit)
+    written = 0
+    try:
+        while args.count == 0 or written < args.count:
+            now = time.time()
+            ops_ntpd_shm_write_sample(shm, now + args.offset, now)
+            written += 1
+            time.sleep(1)
+    except KeyboardInterrupt:
+        pass
+    ops_ntpd_shm_detach(shm)
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
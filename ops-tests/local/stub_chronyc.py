@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Stub chronyc used by the ops-ntpd local tests.
+ - Answers the 'sources', 'sourcestats', 'ntpdata', 'serverstats',
+   'tracking' and 'authdata' reports in CSV (-c), as chronyc does, for
+   one PPS reference clock selected as the system peer and one NTS
+   server, 10.0.0.1.
+ - Every invocation is appended, with the socket it was given with -h,
+   to the file named by CHRONYC_STUB_LOG as a JSON line.
+'''
+
+import os
+import sys
+import json
+
+SOURCES = [
+    "#,*,PPS,0,4,377,3,0.000000012,0.000000015,0.000000200",
+    "^,+,10.0.0.1,2,6,377,20,-0.000250000,-0.000251000,0.000030000",
+]
+SOURCESTATS = [
+    "PPS,16,8,240,0.000,0.001,0.000000010,0.000000120",
+    "10.0.0.1,12,7,700,-0.012,0.020,-0.000240000,0.000045000",
+]
+NTPDATA = [
+    "10.0.0.1,123,10.0.0.254,Normal,4,Server,2,6,-23,0.001200,0.002500,"
+    "C0A80001,192.168.0.1,1475000000.250000000,-0.000250000,0.001100,"
+    "0.000020,0.000015,0.000000,0,D,K,0,0,0,0",
+]
+SERVERSTATS = [
+    "42,3,0,0,0,0,0,0,0",
+]
+TRACKING = [
+    "50505300,PPS,1,1475000000.250000000,0.000000012,0.000000015,"
+    "0.000000200,-12.345,0.001,0.010,0.000000001,0.000001000,16.0,Normal",
+]
+AUTHDATA = [
+    "PPS,-,0,-,0,-,0,0,0,0",
+    "10.0.0.1,NTS,1,15,256,33,0,0,8,100",
+]
+REPORTS = {
+    "sources": SOURCES,
+    "sourcestats": SOURCESTATS,
+    "ntpdata": NTPDATA,
+    "serverstats": SERVERSTATS,
+    "tracking": TRACKING,
+    "authdata": AUTHDATA,
+}
+
+
+def main(argv):
+    args = argv[1:]
+    socket = None
+    if "-h" in args:
+        socket = args[args.index("-h") + 1]
+        del args[args.index("-h"):args.index("-h") + 2]
+    commands = [x for x in args if not x.startswith("-")]
+    log = os.environ.get("CHRONYC_STUB_LOG")
+    if log is not None:
+        with open(log, "a") as f:
+            f.write(json.dumps({"socket": socket, "commands": commands}) +
+                    "\n")
+    for command in commands:
+        for line in REPORTS.get(command, []):
+            sys.stdout.write(line + "\n")
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,117 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Stub DNS server used by the ops-ntpd local tests.
+ - Answers A and AAAA queries over UDP from a table of
+   name -> (addresses, ttl), NXDOMAIN for unknown names. The table can
+   be changed while the server runs.
+ - Every answer can be delayed, to make a slow nameserver.
+ - Counts the queries received per name.
+
+ Usage:
+   ./stub_dns.py PORT NAME=ADDRESS[,ADDRESS...][/TTL] ...
+'''
+
+import sys
+import time
+import socket
+import struct
+import threading
+
+DNS_TYPE_A = 1
+DNS_TYPE_AAAA = 28
+DNS_CLASS_IN = 1
+
+
+class StubDNSServer(object):
+
+    def __init__(self, records, port=0, delay=0):
+        self.records = records
+        self.delay = delay
+        self.queries = {}
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("127.0.0.1", port))
+        self.port = self.sock.getsockname()[1]
+        self.thread = None
+
+    def start(self):
+        self.thread = threading.Thread(target=self.run)
+        self.thread.daemon = True
+        self.thread.start()
+
+    def stop(self):
+        self.sock.close()
+
+    def answer(self, query):
+        (qid, flags, qdcount) = struct.unpack("!HHH", query[:6])
+        offset = 12
+        labels = []
+        while ord(query[offset]) != 0:
+            length = ord(query[offset])
+            labels.append(query[offset + 1:offset + 1 + length])
+            offset += length + 1
+        (qtype, qclass) = struct.unpack("!HH", query[offset + 1:offset + 5])
+        question = query[12:offset + 5]
+        name = ".".join(labels)
+        self.queries[name] = self.queries.get(name, 0) + 1
+
+        if name not in self.records:
+            return struct.pack("!HHHHHH", qid, 0x8183, 1, 0, 0, 0) + question
+        (addresses, ttl) = self.records[name]
+        family = socket.AF_INET if qtype == DNS_TYPE_A else socket.AF_INET6
+        answers = ""
+        count = 0
+        for address in addresses:
+            try:
+                rdata = socket.inet_pton(family, address)
+            except socket.error:
+                continue
+            # Name compressed as a pointer to the question
+            answers += struct.pack("!HHHIH", 0xc00c, qtype, DNS_CLASS_IN,
+                                   ttl, len(rdata)) + rdata
+            count += 1
+        return struct.pack("!HHHHHH", qid, 0x8180, 1, count, 0, 0) + \
+            question + answers
+
+    def run(self):
+        while True:
+            try:
+                query, source = self.sock.recvfrom(512)
+            except socket.error:
+                return
+            time.sleep(self.delay)
+            try:
+                self.sock.sendto(self.answer(query), source)
+            except socket.error:
+                return
+
+
+def main(argv):
+    records = {}
+    for arg in argv[2:]:
+        name, value = arg.split("=")
+        ttl = 60
+        if "/" in value:
+            value, ttl = value.split("/")
+        records[name] = (value.split(","), int(ttl))
+    server = StubDNSServer(records, int(argv[1]))
+    server.run()
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,76 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Stub ntpd used by the ops-ntpd local tests.
+ - Daemonizes like ntpd, or stays in the foreground with -n, writes the
+   pid of the daemon to the file given with -p and records the network
+   namespace it runs in, with its command line, in <pidfile>.info as
+   JSON.
+ - Run as chronyd (-f <conf>), the pid file is the 'pidfile' of the
+   configuration and -d keeps it in the foreground.
+ - The daemon only waits to be killed.
+'''
+
+import os
+import sys
+import json
+import time
+import subprocess
+
+
+def chronyd_pid_file(conf_file):
+    with open(conf_file, "r") as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) == 2 and fields[0] == "pidfile":
+                return fields[1]
+    return "/var/run/chrony/chronyd.pid"
+
+
+def main(argv):
+    if "-f" in argv:
+        pid_file = chronyd_pid_file(argv[argv.index("-f") + 1])
+    else:
+        pid_file = argv[argv.index("-p") + 1]
+    netns = subprocess.Popen(["ip", "netns", "identify", str(os.getpid())],
+                             stdout=subprocess.PIPE).communicate()[0].strip()
+    with open(pid_file + ".info", "w") as f:
+        json.dump({"netns": netns, "argv": argv[1:]}, f)
+
+    if "-n" in argv or "-d" in argv:
+        with open(pid_file, "w") as f:
+            f.write("%d\n" % os.getpid())
+        while True:
+            time.sleep(60)
+
+    pid = os.fork()
+    if pid > 0:
+        with open(pid_file, "w") as f:
+            f.write("%d\n" % pid)
+        return 0
+
+    # Let the caller collect our output, as ntpd does
+    os.setsid()
+    devnull = os.open(os.devnull, os.O_RDWR)
+    for fd in [0, 1, 2]:
+        os.dup2(devnull, fd)
+    while True:
+        time.sleep(60)
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,218 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the hitless restart of ops-ntpd.
+ - A first run starts the default instance and synchronizes it, then
+   exits leaving ntpd running. ntpd and ntpq are replaced by stubs, the
+   ntpq stub reports 10.0.0.1 and 10.0.0.2 as live associations.
+ - A second run, a reloaded ops_ntpd module, adopts that ntpd: same pid,
+   no restart, and only the differences between what ntpd runs and the
+   configuration are pushed.
+ - Checks that nothing is adopted without the saved configuration or
+   with another backend, that an adopted ntpd which exits is restarted,
+   and that the daemons of a previous run are stopped otherwise.
+
+ Usage:
+   ./test_adopt.py
+'''
+
+import os
+import sys
+import time
+import json
+import signal
+import shutil
+import tempfile
+
+from ntpd_test_util import (LOCAL_DIR, BENCH_DIR, check, result,
+                            setup_platform, load_ops_ntpd)
+
+
+def test_setup(workdir):
+    bindir = os.path.join(workdir, "bin")
+    os.mkdir(bindir)
+    for name, stub in [("ntpq", os.path.join(BENCH_DIR, "stub_ntpq.py")),
+                       ("ntpdc", os.path.join(BENCH_DIR, "stub_ntpq.py")),
+                       ("ntpd", os.path.join(LOCAL_DIR, "stub_ntpd.py"))]:
+        os.symlink(stub, os.path.join(bindir, name))
+    os.environ["PATH"] = bindir + os.pathsep + os.environ["PATH"]
+    os.environ["NTPQ_STUB_ASSOCIATIONS"] = "2"
+
+
+def test_load_ops_ntpd():
+    '''
+    Returns a freshly loaded ops_ntpd module, like a new run of ops-ntpd
+    '''
+    ops_ntpd = load_ops_ntpd(fresh=True)
+    ops_ntpd.time.sleep = lambda seconds: None
+    return ops_ntpd
+
+
+def test_configure(ops_ntpd, addresses):
+    '''
+    Runs the reconciliation for a list of default VRF addresses, returns
+    the server configs pushed to ntpd
+    '''
+    update_map = {}
+    for address in addresses:
+        ops_ntpd.ops_ntpd_setup_ntp_config_map(
+            update_map, "vrf_default", address, 0,
+            ops_ntpd.DEFAULT_NTP_KEY_ID, ops_ntpd.DEFAULT_NTP_REF_CLOCK_ID,
+            ops_ntpd.DEFAULT_NTP_PREF, ops_ntpd.DEFAULT_NTP_VERSION)
+    server_configs = ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+        update_map)
+    key_configs, keys_file_content = \
+        ops_ntpd.ops_ntpd_check_updates_with_ntp_keys({})
+    ops_ntpd.ops_ntpd_sync_updates_to_vrf_instances(server_configs,
+                                                    key_configs,
+                                                    keys_file_content)
+    ops_ntpd.ops_ntpd_save_applied_state()
+    return server_configs
+
+
+def test_daemon_pid(pid_file, old_pid=None):
+    '''
+    Waits for a daemon, other than 'old_pid', to write its pid file and
+    returns its pid
+    '''
+    deadline = time.time() + 5
+    while time.time() < deadline:
+        try:
+            with open(pid_file, "r") as f:
+                pid = int(f.read())
+            if pid != old_pid:
+                return pid
+        except (IOError, ValueError):
+            pass
+        time.sleep(0.05)
+    return None
+
+
+def test_first_run(workdir):
+    ops_ntpd = test_load_ops_ntpd()
+    ops_ntpd.ops_ntpd_setup_ntpq_integration(workdir)
+    instance = ops_ntpd.ntpd_instances["vrf_default"]
+    ops_ntpd.ops_ntpd_setup_instance_files(instance, workdir + "/")
+    instance.interface = "eth0"
+    ops_ntpd.ops_ntpd_setup_ntpd_default_config_file(workdir)
+    ops_ntpd.ops_ntpd_setup_ntpd_default_keys_file(workdir)
+    ops_ntpd.ops_ntpd_start_ntpd(None)
+    pid = test_daemon_pid(instance.pid_file)
+    check(pid is not None and pid == instance.supervisor.pid(),
+          "ntpd not started")
+    test_configure(ops_ntpd, ["10.0.0.1", "10.0.0.3"])
+    applied = ops_ntpd.ops_ntpd_state_load(
+        os.path.join(workdir, ops_ntpd.NTP_APPLIED_STATE_FILE))
+    check(applied.get("backend") == "ntpd" and
+          len(applied.get("associations", [])) == 2,
+          "applied configuration %s" % (applied))
+    # ops-ntpd exits, ntpd is left running
+    return pid
+
+
+def test_adopt(workdir, pid):
+    ops_ntpd = test_load_ops_ntpd()
+    ntpd_info = ops_ntpd.ops_ntpd_adopt_ntpd_instances(workdir + "/")
+    check(ntpd_info is not None, "ntpd not adopted")
+    if ntpd_info is None:
+        return
+    instance = ops_ntpd.ntpd_instances["vrf_default"]
+    check(instance.supervisor.pid() == pid,
+          "adopted pid %s, expected %d" % (instance.supervisor.pid(), pid))
+    check(abs(instance.supervisor.started - time.time()) < 60,
+          "adopted start time %s" % (instance.supervisor.started))
+    check(ops_ntpd.ntpq_info[1] in open(instance.keys_file).read(),
+          "control key not read back")
+    # 10.0.0.3 is not live, 10.0.0.2 is live but not configured
+    check(sorted(ops_ntpd.g_ntpa_map.keys()) ==
+          [("vrf_default", "10.0.0.1"), ("vrf_default", "10.0.0.2")],
+          "seeded associations %s" % (ops_ntpd.g_ntpa_map.keys()))
+
+    server_configs = test_configure(ops_ntpd, ["10.0.0.1", "10.0.0.3"])
+    check(server_configs == {"vrf_default": [
+        ":config unconfig 10.0.0.2", ":config server 10.0.0.3 version 3"]},
+        "first sync configs %s" % (server_configs))
+    check(test_daemon_pid(instance.pid_file) == pid, "ntpd restarted")
+    server_configs = test_configure(ops_ntpd, ["10.0.0.1", "10.0.0.3"])
+    check(server_configs == {}, "second sync configs %s" % (server_configs))
+
+    # An adopted ntpd which exits is restarted like a child
+    os.kill(pid, signal.SIGKILL)
+    deadline = time.time() + 5
+    while instance.supervisor.pid() is not None and time.time() < deadline:
+        instance.supervisor.poll(time.time())
+        time.sleep(0.05)
+    check(instance.supervisor.pid() is None, "exit not detected")
+    instance.supervisor.restart_at = time.time()
+    check(instance.supervisor.poll(time.time()), "ntpd not restarted")
+    new_pid = test_daemon_pid(instance.pid_file, pid)
+    check(new_pid is not None and new_pid == instance.supervisor.pid(),
+          "ntpd not restarted, pid %s" % (new_pid))
+
+
+def test_not_adopted(workdir):
+    applied_file = os.path.join(workdir, "ops_ntp.applied")
+    with open(applied_file, "r") as f:
+        applied = json.load(f)
+    pid = test_daemon_pid(os.path.join(workdir, "ntpd.pid"))
+
+    # Another backend
+    applied["backend"] = "chrony"
+    with open(applied_file, "w") as f:
+        json.dump(applied, f)
+    ops_ntpd = test_load_ops_ntpd()
+    check(ops_ntpd.ops_ntpd_adopt_ntpd_instances(workdir + "/") is None,
+          "adopted with another backend")
+
+    # No saved configuration
+    os.unlink(applied_file)
+    ops_ntpd = test_load_ops_ntpd()
+    check(ops_ntpd.ops_ntpd_adopt_ntpd_instances(workdir + "/") is None,
+          "adopted without configuration")
+    check(ops_ntpd.g_ntpa_map == {}, "associations seeded")
+
+    # A fresh start stops the daemon of the previous run
+    ops_ntpd.ops_ntpd_stop_stale_ntpd_instances(workdir + "/")
+    check(not os.path.exists("/proc/%d" % (pid)) or
+          open("/proc/%d/stat" % (pid)).read().split(")")[1].split()[0] ==
+          "Z", "stale ntpd not stopped")
+
+
+def main():
+    setup_platform()
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-adopt-")
+    test_setup(workdir)
+    try:
+        pid = test_first_run(workdir)
+        if pid is not None:
+            test_adopt(workdir, pid)
+            test_not_adopted(workdir)
+    finally:
+        pid = test_daemon_pid(os.path.join(workdir, "ntpd.pid"))
+        if pid is not None:
+            try:
+                os.kill(pid, signal.SIGKILL)
+            except OSError:
+                pass
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,236 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the time daemon backends of ops-ntpd.
+ - Checks the chrony.conf and the chronyc commands of the chrony
+   backend.
+ - Starts the default instance with the ntpd backend, then switches to
+   chrony and back. ntpd, chronyd, ntpq and chronyc are replaced by
+   stubs, the chronyc stub logs the commands it gets.
+ - Checks that associations are added at runtime through chronyc, that
+   a new reference clock restarts chronyd, and that the chronyc reports
+   are published like the ntpq ones.
+
+ Usage:
+   ./test_backend.py
+'''
+
+import os
+import sys
+import json
+import time
+import shutil
+import tempfile
+
+from ntpd_test_util import LOCAL_DIR, BENCH_DIR, check, result, load_ops_ntpd
+
+PPS_ADDRESS = "127.127.22.0"
+SHM_ADDRESS = "127.127.28.1"
+
+
+def test_setup(workdir):
+    bindir = os.path.join(workdir, "bin")
+    os.mkdir(bindir)
+    for name, stub in [("ntpq", os.path.join(BENCH_DIR, "stub_ntpq.py")),
+                       ("ntpdc", os.path.join(BENCH_DIR, "stub_ntpq.py")),
+                       ("ntpd", os.path.join(LOCAL_DIR, "stub_ntpd.py")),
+                       ("chronyd", os.path.join(LOCAL_DIR, "stub_ntpd.py")),
+                       ("chronyc", os.path.join(LOCAL_DIR,
+                                                "stub_chronyc.py"))]:
+        os.symlink(stub, os.path.join(bindir, name))
+    os.environ["PATH"] = bindir + os.pathsep + os.environ["PATH"]
+    os.environ["NTPQ_STUB_ASSOCIATIONS"] = "1"
+    os.environ["CHRONYC_STUB_LOG"] = os.path.join(workdir, "chronyc.log")
+
+
+def test_configure(ops_ntpd, addresses):
+    '''
+    Runs the reconciliation for a list of default VRF addresses
+    '''
+    update_map = {}
+    for address in addresses:
+        ops_ntpd.ops_ntpd_setup_ntp_config_map(
+            update_map, "vrf_default", address, 0,
+            ops_ntpd.DEFAULT_NTP_KEY_ID, ops_ntpd.DEFAULT_NTP_REF_CLOCK_ID,
+            ops_ntpd.DEFAULT_NTP_PREF, ops_ntpd.DEFAULT_NTP_VERSION)
+    server_configs = ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+        update_map)
+    keys_file_content = ops_ntpd.ops_ntpd_get_ntpd_default_keys_file_content()
+    ops_ntpd.ops_ntpd_sync_updates_to_vrf_instances(server_configs, [],
+                                                    keys_file_content)
+
+
+def test_daemon_pid(instance):
+    '''
+    Waits for the daemon of an instance to write its pid file, returns
+    the pid and the arguments of the daemon
+    '''
+    deadline = time.time() + 5
+    while time.time() < deadline:
+        try:
+            with open(instance.pid_file, "r") as f:
+                pid = int(f.read())
+            if pid == instance.supervisor.pid():
+                with open(instance.pid_file + ".info", "r") as f:
+                    return (pid, json.load(f)["argv"])
+        except (IOError, ValueError):
+            pass
+        time.sleep(0.05)
+    return (None, [])
+
+
+def test_chronyc_commands(workdir):
+    try:
+        with open(os.path.join(workdir, "chronyc.log"), "r") as f:
+            return [json.loads(line) for line in f]
+    except IOError:
+        return []
+
+
+def test_chrony_conf(ops_ntpd_conf):
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_chrony_conf(
+        [("10.0.0.1", "vrf_default", "5", ".LOCL.", "true", "3"),
+         (PPS_ADDRESS, "vrf_default", "0", "-", "false", "3"),
+         (SHM_ADDRESS, "vrf_default", "0", "GPS", "true", "3")],
+        "/etc/ntp/ops_ntp.keys", "/etc/ntp/chronyd.sock",
+        "/etc/ntp/ntpd.pid")
+    check(conf.split("\n")[1:] ==
+          ["keyfile /etc/ntp/ops_ntp.keys",
+           "bindcmdaddress /etc/ntp/chronyd.sock",
+           "cmdport 0",
+           "pidfile /etc/ntp/ntpd.pid",
+           "makestep 1 3",
+           "server 10.0.0.1 iburst key 5 prefer",
+           "refclock PPS /dev/pps0 refid PPS poll 4",
+           "refclock SHM 1 refid GPS poll 4 prefer",
+           ""], "chrony.conf %s" % (conf))
+
+
+def test_chrony_configs(ops_ntpd_backend):
+    backend = ops_ntpd_backend.NTPDChronyBackend(lambda command: None)
+    configs = backend.server_add_configs(
+        ("10.0.0.2", "vrf_default", "5", ".LOCL.", "true", "4"))
+    check(configs == ["add server 10.0.0.2 iburst key 5 prefer"],
+          "add configs %s" % (configs))
+    configs = backend.server_delete_configs("10.0.0.2")
+    check(configs == ["delete 10.0.0.2"], "delete configs %s" % (configs))
+    # chronyd only reads its reference clocks at startup
+    configs = backend.server_add_configs(
+        (PPS_ADDRESS, "vrf_default", "0", "-", "false", "3"))
+    check(configs == [ops_ntpd_backend.NTPD_BACKEND_RESTART],
+          "refclock configs %s" % (configs))
+    check(backend.discipline_configs(False) ==
+          [ops_ntpd_backend.NTPD_BACKEND_RESTART], "discipline configs")
+
+
+def test_switch(ops_ntpd, workdir):
+    instance = ops_ntpd.ntpd_instances["vrf_default"]
+    (pid, argv) = test_daemon_pid(instance)
+    check(pid is not None and "-c" in argv, "ntpd not started, %s" % (argv))
+    test_configure(ops_ntpd, ["10.0.0.1"])
+
+    ops_ntpd.ops_ntpd_switch_backend("chrony")
+    check(ops_ntpd.ntpd_backend.name == "chrony", "backend not switched")
+    (chronyd_pid, argv) = test_daemon_pid(instance)
+    check(chronyd_pid is not None and chronyd_pid != pid and
+          argv[:2] == ["-d", "-f"], "chronyd not started, %s" % (argv))
+    with open(instance.conf_file, "r") as f:
+        conf = f.read().split("\n")
+    check("server 10.0.0.1 iburst" in conf, "chrony.conf %s" % (conf))
+    socket = os.path.join(workdir, "chronyd.sock")
+    check("bindcmdaddress %s" % (socket) in conf, "chrony.conf %s" % (conf))
+
+    # New servers are added to the running chronyd
+    test_configure(ops_ntpd, ["10.0.0.1", "10.0.0.2"])
+    commands = test_chronyc_commands(workdir)
+    check({"socket": socket, "commands": ["add server 10.0.0.2 iburst"]}
+          in commands, "chronyc commands %s" % (commands))
+    check(test_daemon_pid(instance)[0] == chronyd_pid, "chronyd restarted")
+
+    # A new reference clock restarts chronyd
+    test_configure(ops_ntpd, ["10.0.0.1", "10.0.0.2", PPS_ADDRESS])
+    (pid, argv) = test_daemon_pid(instance)
+    check(pid is not None and pid != chronyd_pid, "chronyd not restarted")
+    with open(instance.conf_file, "r") as f:
+        conf = f.read().split("\n")
+    check("refclock PPS /dev/pps0 refid PPS poll 4" in conf,
+          "chrony.conf %s" % (conf))
+
+    ntpd_updates = {"associations_info": {}, "statistics": {}, "status": {}}
+    ops_ntpd.ops_ntpd_get_ntpd_associations_info(ntpd_updates)
+    ops_ntpd.ops_ntpd_get_ntpd_global_status(ntpd_updates)
+    info = ntpd_updates["associations_info"]["vrf_default"]
+    check(sorted(info.keys()) == ["10.0.0.1", PPS_ADDRESS],
+          "associations %s" % (info.keys()))
+    pps = info.get(PPS_ADDRESS, {})
+    check(pps.get("peer_status_word") == "system_peer" and
+          pps.get("peer_type") == "local_ref_clock" and
+          pps.get("remote_peer_ref_id") == ".PPS.", "pps status %s" % (pps))
+    server = info.get("10.0.0.1", {})
+    check(server.get("peer_status_word") == "candidate" and
+          server.get("time_offset") == "-0.250" and
+          server.get("jitter") == "0.045" and
+          server.get("root_dispersion") == "2.500" and
+          server.get("remote_peer_ref_id") == "192.168.0.1" and
+          server.get("polling_interval") == "64",
+          "server status %s" % (server))
+    status = ntpd_updates["status"]
+    check(status.get("sync_peer") == PPS_ADDRESS, "status %s" % (status))
+    check(status.get("uptime", "").isdigit(), "status %s" % (status))
+    statistics = ntpd_updates["statistics"]
+    check(statistics.get("ntp_pkts_received") == "42" and
+          statistics.get("ntp_pkts_rate_limited") == "3" and
+          statistics.get("ntp_pkts_declined") == "-",
+          "statistics %s" % (statistics))
+
+    # Back to ntpd, with the complete configuration
+    ops_ntpd.ops_ntpd_switch_backend("ntpd")
+    (ntpd_pid, argv) = test_daemon_pid(instance)
+    check(ntpd_pid is not None and "-c" in argv, "ntpd not restarted")
+    with open(instance.conf_file, "r") as f:
+        conf = f.read().split("\n")
+    check("server 10.0.0.2 version 3" in conf, "ntp.conf %s" % (conf))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_conf
+    import ops_ntpd_backend
+    ops_ntpd.time.sleep = lambda seconds: None
+
+    test_chrony_conf(ops_ntpd_conf)
+    test_chrony_configs(ops_ntpd_backend)
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-backend-")
+    test_setup(workdir)
+    try:
+        ops_ntpd.ops_ntpd_setup_ntpq_integration(workdir)
+        instance = ops_ntpd.ntpd_instances["vrf_default"]
+        ops_ntpd.ops_ntpd_setup_instance_files(instance, workdir + "/")
+        ops_ntpd.ops_ntpd_setup_ntpd_default_config_file(workdir)
+        ops_ntpd.ops_ntpd_setup_ntpd_default_keys_file(workdir)
+        ops_ntpd.ops_ntpd_start_ntpd(None)
+        test_switch(ops_ntpd, workdir)
+    finally:
+        ops_ntpd.ops_ntpd_stop_ntpd_instances()
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,202 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd top clients table.
+ - Checks the parsing of the ntpq mrulist and chronyc clients outputs,
+   and the 'maxlstint' cursor of the incremental fetches.
+ - Drives the client table with simulated fetches and times, and checks
+   the request rates, also of a client missing from a fetch, the
+   eviction of the least active clients and the 'ntpd/clients' unixctl
+   reply.
+
+ Usage:
+   ./test_clients.py
+'''
+
+import sys
+
+from ntpd_test_util import check, result, load_ops_ntpd
+
+MRULIST = """Ctrl-C will stop MRU retrieval and display partial results.
+Retrieved 4 unique MRU entries and 0 updated duplicates
+lstint avgint rstr r m v  count rport remote address
+==============================================================================
+     0      1    1d0 L 3 4    120   123 10.1.1.5
+     2     64    1d0 . 3 4     12 40123 10.1.1.6
+     5     64    1d0 . 4 4     30   123 10.0.0.1
+    30   1024    1d0 . 3 3      2   123 fd00::6
+"""
+
+CHRONYC_CLIENTS = [
+    "10.1.1.5,120,40,0,0,1,0,0,127,4294967295",
+    "10.1.1.6,12,0,6,6,2,0,0,127,4294967295",
+    "127.0.0.1,0,0,127,127,4294967295,3,0,0,1",
+    "fd00::6,2,0,127,127,30,0,0,127,4294967295",
+]
+
+
+class TestConnection(object):
+
+    def __init__(self):
+        self.replied = None
+        self.error = None
+
+    def reply(self, body):
+        self.replied = body
+
+    def reply_error(self, body):
+        self.error = body
+
+
+def test_backends(ops_ntpd_backend, ops_ntpd_vrf):
+    instance = ops_ntpd_vrf.NTPDInstance("vrf_default")
+    instance.conf_file = "/etc/ntp/ops_ntp.conf"
+    commands = []
+
+    def run_ntpq(command):
+        commands.append(command)
+        return ("", (MRULIST, ""))
+    backend = ops_ntpd_backend.NTPDClassicBackend(run_ntpq)
+    clients = backend.read_clients(instance, None)
+    check(commands[-1] == "ntpq -n -c \"mrulist\"", "command %s" % (commands))
+    # The server NTPD polls (mode 4) is not a client
+    check([c["address"] for c in clients] ==
+          ["10.1.1.5", "10.1.1.6", "fd00::6"], "clients %s" % (clients))
+    check(clients[0] == {"address": "10.1.1.5", "count": 120, "avgint": 1,
+                         "lstint": 0, "limited": True},
+          "client %s" % (clients[0]))
+    check(not clients[1]["limited"], "client %s" % (clients[1]))
+    backend.read_clients(instance, 12)
+    check(commands[-1] == "ntpq -n -c \"mrulist maxlstint=12\"",
+          "command %s" % (commands))
+
+    def run_chronyc(command):
+        commands.append(command)
+        return ("", ("\n".join(CHRONYC_CLIENTS) + "\n", ""))
+    backend = ops_ntpd_backend.NTPDChronyBackend(run_chronyc)
+    clients = backend.read_clients(instance, None)
+    check(commands[-1].endswith("-c -n clients"), "command %s" % (commands))
+    # chronyc only clients are skipped
+    check([c["address"] for c in clients] ==
+          ["10.1.1.5", "10.1.1.6", "fd00::6"], "clients %s" % (clients))
+    check(clients[0]["avgint"] == 1.0 and clients[0]["limited"] and
+          clients[1]["avgint"] == 64.0 and clients[2]["avgint"] is None,
+          "clients %s" % (clients))
+    clients = backend.read_clients(instance, 12)
+    check([c["address"] for c in clients] == ["10.1.1.5", "10.1.1.6"],
+          "clients seen within 12 s %s" % (clients))
+
+
+def test_table(ops_ntpd_clients):
+    table = ops_ntpd_clients.NTPDClientTable(max_clients=3)
+
+    def entry(address, count, avgint=None, lstint=0, limited=False):
+        return {"address": address, "count": count, "avgint": avgint,
+                "lstint": lstint, "limited": limited}
+
+    now = 1000.0
+    check(table.cursor("vrf_default", now) is None, "first fetch cursor")
+    table.update("vrf_default", now,
+                 [entry("10.1.1.5", 100, 1), entry("10.1.1.6", 10, 64),
+                  entry("10.1.1.7", 1, None, 600)])
+    top = table.top()
+    check([c[1] for c in top] == ["10.1.1.5", "10.1.1.6", "10.1.1.7"],
+          "top %s" % (top))
+    check(top[0][2]["rate"] == 1.0 and top[1][2]["rate"] == 1.0 / 64 and
+          top[2][2]["rate"] == 0.0, "initial rates %s" % (top))
+
+    now += 10
+    check(table.cursor("vrf_default", now) ==
+          10 + ops_ntpd_clients.CLIENTS_CURSOR_MARGIN, "cursor")
+    # 10.1.1.6 floods, 10.1.1.5 stopped and is not in the fetch
+    table.update("vrf_default", now, [entry("10.1.1.6", 510, 64)])
+    clients = dict([(c[1], c[2]) for c in table.top()])
+    check(clients["10.1.1.6"]["rate"] == 1.0 / 64 + 0.5 * (50 - 1.0 / 64),
+          "flooding rate %s" % (clients["10.1.1.6"]))
+    check(clients["10.1.1.5"]["rate"] == 0.5, "decayed rate %s" %
+          (clients["10.1.1.5"]))
+    check(table.top(1)[0][1] == "10.1.1.6", "top %s" % (table.top(1)))
+
+    # NTPD dropped and re-created the entry. 10.1.1.5 is back after a
+    # missed fetch, its 20 packets were sent over 20 s.
+    now += 10
+    table.update("vrf_default", now,
+                 [entry("10.1.1.6", 20, 64), entry("10.1.1.5", 120, 1)])
+    check(table.clients[("vrf_default", "10.1.1.6")]["count"] == 20,
+          "recycled %s" % (table.clients))
+    check(table.clients[("vrf_default", "10.1.1.5")]["rate"] ==
+          0.5 + 0.5 * (1.0 - 0.5), "back after a missed fetch %s" %
+          (table.clients))
+
+    # The least active client is evicted
+    table.update("red", now, [entry("10.2.1.1", 50, 2)])
+    check(len(table.clients) == 3 and table.evictions == 1 and
+          ("vrf_default", "10.1.1.7") not in table.clients,
+          "eviction %s" % (table.clients))
+
+    table.prune(["vrf_default"])
+    check(all([k[0] == "vrf_default" for k in table.clients]) and
+          "red" not in table.fetched, "prune %s" % (table.clients))
+
+    lines = table.dump(now, 1)
+    check(len(lines) == 3 and "10.1.1.6" in lines[1] and
+          "2 client(s) tracked, 1 evicted" in lines[2], "dump %s" % (lines))
+
+
+def test_unixctl(ops_ntpd):
+    conn = TestConnection()
+    ops_ntpd.ntpd_backend.server_policy = None
+    ops_ntpd.ops_ntpd_show_ntpd_clients(conn, [], None)
+    check(conn.replied == "NTP server mode is disabled\n",
+          "reply %s" % (conn.replied))
+
+    ops_ntpd.ntpd_backend.server_policy = {"allow": [], "average": 3,
+                                           "minimum": 1}
+    ops_ntpd.client_table.update("vrf_default", 1000.0, [
+        {"address": "10.1.1.%d" % (i), "count": i, "avgint": i,
+         "lstint": 0, "limited": False} for i in range(1, 5)])
+    conn = TestConnection()
+    ops_ntpd.ops_ntpd_show_ntpd_clients(conn, ["2"], None)
+    lines = conn.replied.split("\n")
+    check("10.1.1.1 " in lines[1] and "10.1.1.2 " in lines[2] and
+          "4 client(s) tracked" in lines[3], "reply %s" % (conn.replied))
+    conn = TestConnection()
+    ops_ntpd.ops_ntpd_show_ntpd_clients(conn, ["two"], None)
+    check(conn.error is not None and conn.replied is None,
+          "invalid count %s" % (conn.replied))
+
+    # Disabling the server mode drops the table on the next refresh
+    ops_ntpd.ntpd_backend.server_policy = None
+    ops_ntpd.ops_ntpd_refresh_clients()
+    check(not ops_ntpd.client_table.clients, "table not cleared")
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_vrf
+    import ops_ntpd_clients
+    import ops_ntpd_backend
+
+    test_backends(ops_ntpd_backend, ops_ntpd_vrf)
+    test_table(ops_ntpd_clients)
+    test_unixctl(ops_ntpd)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,135 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd config change debounce.
+ - The IDL is replaced by an in-memory replica, the clock by a test
+   clock stepped by the test, and ops_ntpd_check_updates_from_ovsdb()
+   by a counter.
+ - Checks that a burst of config changes is applied once, when the
+   config has been quiet for the debounce window, and that changes
+   which never stop are applied once the max latency has passed since
+   the first one.
+
+ Usage:
+   ./test_config_debounce.py
+'''
+
+import sys
+
+from ntpd_test_util import check, result, load_ops_ntpd, TestIdl, TestClock
+
+# In milliseconds, multiples of the test step so that the deadlines are
+# exact
+TEST_DEBOUNCE_MS = 500
+TEST_MAX_LATENCY_MS = 2000
+TEST_STEP_MS = 125
+
+
+class TestDebounceIdl(TestIdl):
+
+    def __init__(self):
+        TestIdl.__init__(self, {
+            "config_debounce_ms": str(TEST_DEBOUNCE_MS),
+            "config_max_latency_ms": str(TEST_MAX_LATENCY_MS)})
+        self.change_seqno = 1
+
+    def change(self):
+        '''
+        A config change, as seen by the IDL
+        '''
+        self.change_seqno += 1
+        self.system.ntp_config["refresh"] = str(self.change_seqno)
+
+
+class TestDebounce(object):
+    '''
+    Steps the test clock through the main loop config checks, and counts
+    the calls of ops_ntpd_check_updates_from_ovsdb()
+    '''
+
+    def __init__(self, ops_ntpd):
+        self.ops_ntpd = ops_ntpd
+        self.clock = TestClock()
+        self.start = self.clock.now
+        self.calls = []
+        self.idl = TestDebounceIdl()
+        ops_ntpd.idl = self.idl
+        ops_ntpd.seqno = self.idl.change_seqno
+        ops_ntpd.config_digest = ops_ntpd.ops_ntpd_get_config_digest()
+        ops_ntpd.ops_ntpd_check_updates_from_ovsdb = \
+            lambda: self.calls.append(self.ms())
+
+    def ms(self):
+        return int(round((self.clock.now - self.start) * 1000))
+
+    def step(self, change=False):
+        if change:
+            self.idl.change()
+        self.ops_ntpd.ops_ntpd_check_config_changes(self.clock.now)
+        self.clock.sleep(TEST_STEP_MS / 1000.0)
+
+    def run_until(self, ms, change_every=None):
+        while self.ms() < ms:
+            self.step(change_every is not None and
+                      self.ms() % change_every == 0)
+
+
+def test_burst(ops_ntpd):
+    debounce = TestDebounce(ops_ntpd)
+    # A change on each step for 500 ms, the last one at 375 ms
+    debounce.run_until(500, TEST_STEP_MS)
+    debounce.run_until(375 + TEST_DEBOUNCE_MS)
+    check(debounce.calls == [], "applied within the debounce window %s"
+          % (debounce.calls))
+    debounce.run_until(5000)
+    check(debounce.calls == [375 + TEST_DEBOUNCE_MS],
+          "burst applied at %s" % (debounce.calls))
+    check(ops_ntpd.ops_ntpd_get_config_deadline() is None,
+          "deadline left %s" % (ops_ntpd.ops_ntpd_get_config_deadline()))
+
+
+def test_max_latency(ops_ntpd):
+    debounce = TestDebounce(ops_ntpd)
+    # A change every 250 ms never leaves the config quiet for 500 ms
+    debounce.run_until(TEST_MAX_LATENCY_MS, 250)
+    check(debounce.calls == [], "applied before the max latency %s"
+          % (debounce.calls))
+    debounce.run_until(TEST_MAX_LATENCY_MS + 250, 250)
+    check(debounce.calls == [TEST_MAX_LATENCY_MS],
+          "forced at %s" % (debounce.calls))
+
+    # The changes pending after the forced call start a new window
+    debounce.run_until(2 * TEST_MAX_LATENCY_MS + 250, 250)
+    check(len(debounce.calls) == 1, "second call before the max latency %s"
+          % (debounce.calls))
+    debounce.run_until(2 * TEST_MAX_LATENCY_MS + 500, 250)
+    check(debounce.calls == [TEST_MAX_LATENCY_MS,
+                             2 * TEST_MAX_LATENCY_MS + 250],
+          "second forced call at %s" % (debounce.calls))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+
+    test_burst(ops_ntpd)
+    test_max_latency(ops_ntpd)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,168 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd server name resolution.
+ - A stub DNS server on the loopback serves the server names, with a
+   slow answer and a short TTL.
+ - Checks that names are resolved off the main loop, that NTPD is
+   configured with addresses only, that an address change at TTL
+   expiry reconfigures NTPD, and that the status of an association
+   configured by name is reported under its name, also as the sync
+   peer.
+
+ Usage:
+   ./test_dns_resolver.py
+'''
+
+import os
+import sys
+import time
+import shutil
+import tempfile
+
+from ntpd_test_util import BENCH_DIR, check, result, load_ops_ntpd
+
+from stub_dns import StubDNSServer
+
+TEST_NAME = "ntp1.ops-ntpd.test"
+UNKNOWN_NAME = "unknown.ops-ntpd.test"
+# The stub ntpq reports a single association, 10.0.0.1
+TEST_ADDRESS = "10.0.0.1"
+TEST_NEW_ADDRESS = "10.0.0.2"
+TEST_TTL = 1
+TEST_DELAY = 0.3
+
+
+def test_wait_seqno(resolver, seqno, timeout):
+    deadline = time.time() + timeout
+    while resolver.seqno == seqno and time.time() < deadline:
+        time.sleep(0.05)
+    return resolver.seqno != seqno
+
+
+def test_configure(ops_ntpd, names):
+    '''
+    Runs the association reconciliation for a list of configured names,
+    as ops_ntpd_check_updates_from_ovsdb() does, and returns the server
+    configs for NTPD
+    '''
+    update_map = {}
+    for name in names:
+        address = ops_ntpd.dns_resolver.lookup("vrf_default", name)
+        if address is None:
+            continue
+        ops_ntpd.ops_ntpd_setup_ntp_config_map(
+            update_map, "vrf_default", name, 0, ops_ntpd.DEFAULT_NTP_KEY_ID,
+            ops_ntpd.DEFAULT_NTP_REF_CLOCK_ID, ops_ntpd.DEFAULT_NTP_PREF,
+            ops_ntpd.DEFAULT_NTP_VERSION, address)
+    ops_ntpd.dns_resolver.retain(set([("vrf_default", x) for x in names]))
+    return ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+        update_map).get("vrf_default", [])
+
+
+def test_dns_resolver(ops_ntpd, dns):
+    resolver = ops_ntpd.dns_resolver
+    names = [TEST_NAME, UNKNOWN_NAME]
+
+    # The lookup never waits for the nameserver
+    start = time.time()
+    configs = test_configure(ops_ntpd, names)
+    check(time.time() - start < TEST_DELAY / 2,
+          "lookup blocked for %.3f s" % (time.time() - start))
+    check(configs == [], "unresolved names configured: %s" % (configs))
+
+    seqno = resolver.seqno
+    check(test_wait_seqno(resolver, seqno, 5), "%s not resolved" % TEST_NAME)
+    configs = test_configure(ops_ntpd, names)
+    check(configs == [":config server %s version 3" % (TEST_ADDRESS)],
+          "configs %s" % (configs))
+    check(resolver.lookup("vrf_default", UNKNOWN_NAME) is None,
+          "%s resolved" % (UNKNOWN_NAME))
+
+    # The status of the association is reported under its name
+    ntpd_updates = {"associations_info": {}, "statistics": {}, "status": {}}
+    ops_ntpd.ops_ntpd_get_ntpd_associations_info(ntpd_updates)
+    assoc_info = ntpd_updates["associations_info"]["vrf_default"]
+    check(assoc_info.keys() == [TEST_NAME], "status keys %s" % (
+          assoc_info.keys()))
+    check(assoc_info.get(TEST_NAME, {}).get("remote_peer_address") ==
+          TEST_ADDRESS, "status %s" % (assoc_info))
+    check(ntpd_updates["status"].get("sync_peer") == TEST_NAME,
+          "sync peer %s" % (ntpd_updates["status"].get("sync_peer")))
+
+    # The name is queried again when the TTL expires, a new address
+    # changes the seqno and NTPD is moved to the new address
+    queries = dns.queries[TEST_NAME]
+    dns.records[TEST_NAME] = ([TEST_NEW_ADDRESS], TEST_TTL)
+    seqno = resolver.seqno
+    check(test_wait_seqno(resolver, seqno, 5), "TTL expiry not handled")
+    check(dns.queries[TEST_NAME] > queries, "name not queried again")
+    configs = test_configure(ops_ntpd, names)
+    check(configs == [":config unconfig %s" % (TEST_ADDRESS),
+                      ":config server %s version 3" % (TEST_NEW_ADDRESS)],
+          "configs %s" % (configs))
+
+    # An unchanged answer keeps the seqno
+    seqno = resolver.seqno
+    time.sleep(TEST_TTL * 2 + TEST_DELAY * 2)
+    check(resolver.seqno == seqno, "unchanged address bumped the seqno")
+
+    # A failing nameserver keeps the last known address
+    dns.stop()
+    time.sleep(TEST_TTL * 2)
+    check(resolver.lookup("vrf_default", TEST_NAME) == TEST_NEW_ADDRESS,
+          "address lost on DNS failure")
+
+    # Removed names are forgotten
+    configs = test_configure(ops_ntpd, [])
+    check(configs == [":config unconfig %s" % (TEST_NEW_ADDRESS)],
+          "configs %s" % (configs))
+    check(resolver.dump() == [], "cache %s" % (resolver.dump()))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_dns
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-dns-")
+    os.symlink(os.path.join(BENCH_DIR, "stub_ntpq.py"),
+               os.path.join(workdir, "ntpq"))
+    os.environ["PATH"] = workdir + os.pathsep + os.environ["PATH"]
+    os.environ["NTPQ_STUB_ASSOCIATIONS"] = "1"
+    dns = StubDNSServer({TEST_NAME: ([TEST_ADDRESS], TEST_TTL)},
+                        delay=TEST_DELAY)
+    dns.start()
+    ops_ntpd_dns.MIN_DNS_TTL = TEST_TTL
+    ops_ntpd_dns.DNS_TIMEOUT = TEST_DELAY * 2
+    ops_ntpd_dns.DNS_RETRY_INTERVAL = TEST_TTL
+    ops_ntpd_dns.ops_ntpd_dns_nameservers = \
+        lambda netns: [("127.0.0.1", dns.port)]
+    # Keep the test away from /etc/hosts and the host nameservers
+    ops_ntpd_dns.ops_ntpd_dns_getaddrinfo = lambda name: []
+    ops_ntpd.dns_resolver.start()
+    try:
+        test_dns_resolver(ops_ntpd, dns)
+    finally:
+        ops_ntpd.dns_resolver.stop()
+        dns.stop()
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,309 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd staged key rotation.
+ - Rotates the key of every keyed association through the OVSDB
+   reconciliation, against a model of ntpd: the keys it read, the keys
+   it trusts, and the reach register of each association, shifted on
+   every poll.
+ - Checks that installing a key, retiring a key, rotating the material
+   of a key in use and toggling authentication never reset an
+   association, that the associations are switched to their new key id
+   one at a time, that every association not being switched stays at
+   reach 377 throughout, and that the old key stays installed and
+   trusted until it is no longer used and its grace period ended.
+
+ Usage:
+   ./test_key_rotation.py
+'''
+
+import sys
+import shutil
+import tempfile
+
+from ntpd_test_util import (check, result, load_ops_ntpd, TestRow, TestIdl,
+                            association_row)
+
+OLD_KEY = "sha1:" + "0123456789abcdef" * 2 + "01234567"
+NEW_KEY = "sha256:" + "fedcba9876543210" * 4
+# New material of the new key, rotated under its key id
+ROTATED_KEY = "sha256:" + "0f1e2d3c4b5a6978" * 4
+KEYED_SERVERS = ["10.0.0.1", "10.0.0.2", "10.0.0.3"]
+UNKEYED_SERVER = "10.0.0.4"
+# Seconds between two polls of the model
+POLL_INTERVAL = 64
+RETIRE_GRACE = 3600
+
+
+class TestClock(object):
+
+    def __init__(self):
+        self.now = 1000000.0
+
+    def time(self):
+        return self.now
+
+    def sleep(self, seconds):
+        pass
+
+
+def test_idl(ntp_config, keys, associations):
+    '''
+    'keys' maps a key id to its password, 'associations' maps an address
+    to its key id (None without key)
+    '''
+    key_rows = dict([(k, TestRow(key_id=k, key_password=v, trust_enable=True))
+                     for k, v in keys.iteritems()])
+    association_rows = [
+        association_row(address, key_id=[key_rows[key_id]]
+                        if key_id is not None else [])
+        for address, key_id in associations.iteritems()]
+    return TestIdl(ntp_config, key_rows.values(), association_rows)
+
+
+def test_daemon_backend(ops_ntpd_backend):
+    '''
+    Returns an ntpd backend class driving a model of ntpd. The servers
+    accept both the old and the new key.
+    '''
+
+    class TestDaemonBackend(ops_ntpd_backend.NTPDClassicBackend):
+
+        def __init__(self, run_command):
+            ops_ntpd_backend.NTPDClassicBackend.__init__(self, run_command)
+            self.installed = set()
+            # Key id -> key material read
+            self.materials = {}
+            self.trusted = set()
+            # Address -> [key id, reach register]
+            self.peers = {}
+            self.resets = []
+            self.restarts = 0
+
+        def push(self, instance, configs, keys_changed, control):
+            if configs is not None and \
+                    ops_ntpd_backend.NTPD_BACKEND_RESTART in configs:
+                self.restarts += 1
+                return
+            if keys_changed:
+                # readkeys
+                with open(instance.keys_file, "r") as f:
+                    fields = [line.split() for line in f
+                              if line.strip() and not line.startswith("#")]
+                self.installed = set([int(x[0]) for x in fields
+                                      if int(x[0]) != control[0]])
+                self.materials = dict([(int(x[0]), x[2]) for x in fields])
+            for config in configs or []:
+                words = config.split()[1:]
+                if words[:2] == ["unconfig", "trustedkey"]:
+                    self.trusted -= set([int(x) for x in words[2:]])
+                elif words[0] == "trustedkey":
+                    self.trusted |= set([int(x) for x in words[1:]])
+                elif words[0] == "unconfig":
+                    del self.peers[words[1]]
+                    self.resets.append(words[1])
+                elif words[0] == "server":
+                    key_id = None
+                    if "key" in words:
+                        key_id = int(words[words.index("key") + 1])
+                    self.peers[words[1]] = [key_id, 0]
+
+        def poll(self):
+            for peer in self.peers.itervalues():
+                answered = peer[0] is None or \
+                    (peer[0] in self.installed and peer[0] in self.trusted)
+                peer[1] = ((peer[1] << 1) | answered) & 0xff
+
+        def read_associations(self, instance):
+            table = {}
+            for address, (key_id, reach) in self.peers.iteritems():
+                table[address] = {
+                    ops_ntpd_backend.NTPQ_REMOTE: address,
+                    ops_ntpd_backend.NTPQ_REFID: "GPS",
+                    ops_ntpd_backend.NTPQ_ST: "1",
+                    ops_ntpd_backend.NTPQ_T: "u",
+                    ops_ntpd_backend.NTPQ_WHEN: "1",
+                    ops_ntpd_backend.NTPQ_POLL: str(POLL_INTERVAL),
+                    ops_ntpd_backend.NTPQ_REACH: "%o" % (reach),
+                    ops_ntpd_backend.NTPQ_DELAY: "0.100",
+                    ops_ntpd_backend.NTPQ_OFFSET: "0.010",
+                    ops_ntpd_backend.NTPQ_JITTER: "0.010",
+                    ops_ntpd_backend.NTPQ_ROOT_DISPERSION: "0.500",
+                    ops_ntpd_backend.NTPQ_PEER_STATUS_WORD:
+                        "sel_candidate" if reach & 1 else "sel_reject",
+                    ops_ntpd_backend.NTPQ_ASSOCID: "1",
+                    ops_ntpd_backend.NTPQ_REFERENCE_TIME: "-",
+                }
+            return table
+
+    return TestDaemonBackend
+
+
+def test_apply(ops_ntpd, ntp_config, keys, associations):
+    ops_ntpd.idl = test_idl(ntp_config, keys, associations)
+    ops_ntpd.ops_ntpd_check_updates_from_ovsdb()
+
+
+def test_poll(ops_ntpd, clock, apply_args):
+    '''
+    Runs one poll of the model and the status refresh, the next stage
+    of the rotation is applied like the main loop does. Returns the
+    reach registers.
+    '''
+    backend = ops_ntpd.ntpd_backend
+    seqno = ops_ntpd.key_rotation.seqno
+    clock.now += POLL_INTERVAL
+    backend.poll()
+    ops_ntpd.ops_ntpd_get_instance_associations_info(
+        ops_ntpd.ntpd_instances["vrf_default"], {})
+    ops_ntpd.key_rotation.run(clock.now)
+    if seqno != ops_ntpd.key_rotation.seqno:
+        test_apply(ops_ntpd, *apply_args)
+    return dict([(a, p[1]) for a, p in backend.peers.iteritems()])
+
+
+def test_rotation(ops_ntpd, clock):
+    backend = ops_ntpd.ntpd_backend
+    ntp_config = {"authentication_enable": "true",
+                  "key_retire_grace": str(RETIRE_GRACE)}
+    associations = dict([(a, 1) for a in KEYED_SERVERS])
+    associations[UNKEYED_SERVER] = None
+    apply_args = (ntp_config, {1: OLD_KEY}, associations)
+    test_apply(ops_ntpd, *apply_args)
+    for i in range(8):
+        reach = test_poll(ops_ntpd, clock, apply_args)
+    check(all([r == 0xff for r in reach.values()]) and len(reach) == 4,
+          "initial reach %s" % (reach))
+
+    # Install: the new key is read and trusted next to the old one
+    apply_args = (ntp_config, {1: OLD_KEY, 2: NEW_KEY}, associations)
+    test_apply(ops_ntpd, *apply_args)
+    reach = test_poll(ops_ntpd, clock, apply_args)
+    check(backend.installed == set([1, 2]) and
+          backend.trusted == set([1, 2]), "keys %s trusted %s" %
+          (backend.installed, backend.trusted))
+    check(backend.resets == [] and all([r == 0xff for r in reach.values()]),
+          "install reset %s reach %s" % (backend.resets, reach))
+
+    # Switch: the old key is removed from OVSDB at the same time
+    associations = dict([(a, 2) for a in KEYED_SERVERS])
+    associations[UNKEYED_SERVER] = None
+    apply_args = (ntp_config, {2: NEW_KEY}, associations)
+    test_apply(ops_ntpd, *apply_args)
+    for i in range(100):
+        reach = test_poll(ops_ntpd, clock, apply_args)
+        switching = [a for a, r in reach.items() if r != 0xff]
+        check(len(switching) <= 1, "switching together %s" % (reach))
+        check(reach[UNKEYED_SERVER] == 0xff, "unkeyed reach %s" % (reach))
+        if any([p[0] == 1 for p in backend.peers.values()]):
+            check(1 in backend.installed and 1 in backend.trusted,
+                  "old key retired while in use")
+        if not switching and not ops_ntpd.key_rotation.switching:
+            break
+    check(sorted(backend.resets) == KEYED_SERVERS,
+          "switched associations %s" % (backend.resets))
+    check(all([backend.peers[a][0] == 2 for a in KEYED_SERVERS]),
+          "peers %s" % (backend.peers))
+    check(1 in backend.installed and 1 in backend.trusted,
+          "old key retired before its grace period ended")
+
+    # Retire: once the grace period ended
+    resets = len(backend.resets)
+    for i in range(RETIRE_GRACE / POLL_INTERVAL + 2):
+        reach = test_poll(ops_ntpd, clock, apply_args)
+        check(all([r == 0xff for r in reach.values()]),
+              "retire reach %s" % (reach))
+    check(backend.installed == set([2]) and backend.trusted == set([2]),
+          "old key not retired, keys %s trusted %s" %
+          (backend.installed, backend.trusted))
+    check(not ops_ntpd.key_rotation.retiring, "retiring %s" %
+          (ops_ntpd.key_rotation.retiring))
+
+    # Rotating the material of a key in use keeps its key id, the
+    # associations are not touched
+    material = backend.materials[2]
+    apply_args = (ntp_config, {2: ROTATED_KEY}, associations)
+    test_apply(ops_ntpd, *apply_args)
+    for i in range(8):
+        reach = test_poll(ops_ntpd, clock, apply_args)
+        check(all([r == 0xff for r in reach.values()]),
+              "rotated material reach %s" % (reach))
+    check(backend.materials[2] != material and
+          backend.installed == set([2]) and backend.trusted == set([2]),
+          "material not rotated, keys %s trusted %s" %
+          (backend.installed, backend.trusted))
+    check(len(backend.resets) == resets, "rotated material resets %s" %
+          (backend.resets))
+
+    # Toggling authentication only trusts and untrusts the keys
+    test_apply(ops_ntpd, dict(ntp_config, authentication_enable="false"),
+               {2: ROTATED_KEY}, associations)
+    check(backend.trusted == set(), "trusted %s" % (backend.trusted))
+    test_apply(ops_ntpd, *apply_args)
+    check(backend.trusted == set([2]), "trusted %s" % (backend.trusted))
+    check(len(backend.resets) == resets and backend.restarts == 0,
+          "resets %s restarts %d" % (backend.resets, backend.restarts))
+
+
+def test_timeout(ops_ntpd_keys):
+    rotation = ops_ntpd_keys.NTPDKeyRotation(grace=0)
+    switched = rotation.select_switches(
+        [("vrf_default", "10.0.0.1"), ("vrf_default", "10.0.0.2"),
+         ("red", "10.1.0.1")], 0)
+    check(sorted(switched) == [("red", "10.1.0.1"),
+                               ("vrf_default", "10.0.0.1")],
+          "one switch per VRF %s" % (switched))
+    check(rotation.select_switches([("vrf_default", "10.0.0.2")], 1) == [],
+          "second switch in a VRF")
+    rotation.observe("vrf_default", "10.0.0.1", "17")
+    rotation.run(ops_ntpd_keys.KEY_SWITCH_TIMEOUT - 1)
+    check(rotation.seqno == 0, "switch ended early")
+    rotation.run(ops_ntpd_keys.KEY_SWITCH_TIMEOUT)
+    check(rotation.seqno == 2 and not rotation.switching,
+          "switches not timed out %s" % (rotation.switching))
+
+    # Without grace period, an unused key is retired at once
+    keys = rotation.merge_keys({}, {1: ("password", True)}, set(), 0)
+    check(keys == {}, "keys %s" % (keys))
+    keys = rotation.merge_keys({}, {1: ("password", True)}, set([1]), 0)
+    check(keys == {1: ("password", True)}, "used key retired %s" % (keys))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_keys
+    import ops_ntpd_backend
+    clock = TestClock()
+    ops_ntpd.time = clock
+
+    test_timeout(ops_ntpd_keys)
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-key-rotation-")
+    try:
+        ops_ntpd.ops_ntpd_setup_ntpq_integration(workdir)
+        ops_ntpd.ops_ntpd_setup_instance_files(
+            ops_ntpd.ntpd_instances["vrf_default"], workdir + "/")
+        ops_ntpd.ntpd_backend = test_daemon_backend(ops_ntpd_backend)(
+            lambda command: None)
+        test_rotation(ops_ntpd, clock)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,136 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd authentication keys.
+ - Checks the parsing of the NTP_Key passwords ('<algorithm>:<hex key>',
+   or a bare MD5 password) and the keys files rendered from them for
+   ntpd and chronyd.
+ - Checks that the control key is SHA-1, that ntpq and ntpdc are given
+   its key type, and that a keys file with a control key of another type
+   is not adopted.
+
+ Usage:
+   ./test_keys.py
+'''
+
+import os
+import sys
+import shutil
+import tempfile
+
+from ntpd_test_util import check, result, load_ops_ntpd
+
+SHA1_KEY = "0123456789abcdef0123456789abcdef01234567"
+SHA256_KEY = "0123456789abcdef" * 4
+AES_KEY = "0123456789ABCDEF0123456789abcdef"
+
+
+def test_parse(ops_ntpd_conf):
+    parse = ops_ntpd_conf.ops_ntpd_conf_parse_key
+    check(parse("password") == ("md5", "password"), "MD5 password")
+    check(parse("pass:word") == ("md5", "pass:word"), "MD5 password with ':'")
+    check(parse("sha1:" + SHA1_KEY) == ("sha1", SHA1_KEY), "SHA-1 key")
+    check(parse("sha256:" + SHA256_KEY) == ("sha256", SHA256_KEY),
+          "SHA-256 key")
+    check(parse("aes128cmac:" + AES_KEY) == ("aes128cmac", AES_KEY.lower()),
+          "AES-128-CMAC key")
+    for password in ["sha1:" + SHA1_KEY[:-1], "sha256:" + SHA1_KEY,
+                     "aes128cmac:" + AES_KEY[:-1] + "g",
+                     "aes128cmac:0x" + AES_KEY[2:],
+                     "aes128cmac: " + AES_KEY[1:]]:
+        check(parse(password) is None, "invalid key %s" % (password))
+
+
+def test_render(ops_ntpd_conf):
+    keys = {10: ("password", True), 2: ("sha1:" + SHA1_KEY, True),
+            300: ("sha256:" + SHA256_KEY, True),
+            40: ("aes128cmac:" + AES_KEY, True)}
+    content = ops_ntpd_conf.ops_ntpd_conf_render_keys(
+        65535, "0123456789abcdef0123", keys).split("\n")
+    check(content == [ops_ntpd_conf.CONF_HEADER,
+                      " 65535 SHA1 0123456789abcdef0123",
+                      " 2 SHA1 " + SHA1_KEY,
+                      " 10 MD5 password",
+                      " 40 AES128CMAC " + AES_KEY.lower(),
+                      " 300 SHA256 " + SHA256_KEY,
+                      ""], "keys file %s" % (content))
+
+    content = ops_ntpd_conf.ops_ntpd_conf_render_chrony_keys(
+        65535, "0123456789abcdef0123", keys).split("\n")
+    check(content == [ops_ntpd_conf.CONF_HEADER,
+                      "65535 SHA1 0123456789abcdef0123",
+                      "2 SHA1 HEX:" + SHA1_KEY,
+                      "10 MD5 password",
+                      "40 AES128 HEX:" + AES_KEY.lower(),
+                      "300 SHA256 HEX:" + SHA256_KEY,
+                      ""], "chrony keys file %s" % (content))
+
+
+def test_control_key(ops_ntpd, ops_ntpd_conf, ops_ntpd_backend,
+                     ops_ntpd_vrf, workdir):
+    (key_id, password) = ops_ntpd.ops_ntpd_setup_ntpq_integration(workdir)
+    check(len(password) == ops_ntpd_conf.CONTROL_KEY_LENGTH,
+          "control key %s" % (password))
+
+    keys_file = os.path.join(workdir, "ntp.keys")
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(
+        keys_file, ops_ntpd_conf.ops_ntpd_conf_render_keys(key_id, password,
+                                                           {}))
+    check(ops_ntpd_conf.ops_ntpd_conf_read_control_key(keys_file, key_id) ==
+          password, "control key not read back")
+    # Rendered by a previous ops-ntpd with an MD5 control key
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(
+        keys_file, " %d MD5 0123456789abcdef\n" % (key_id))
+    check(ops_ntpd_conf.ops_ntpd_conf_read_control_key(keys_file, key_id) is
+          None, "MD5 control key adopted")
+
+    commands = []
+
+    def run_command(command):
+        commands.append(command)
+        return ("", ("", ""))
+    ops_ntpd_backend.time.sleep = lambda seconds: None
+    backend = ops_ntpd_backend.NTPDClassicBackend(run_command)
+    instance = ops_ntpd_vrf.NTPDInstance("vrf_default")
+    backend.push(instance, [":config trustedkey 2"], True,
+                 (key_id, password))
+    check(len(commands) == 2 and
+          all([c.startswith("ntp") and "-c \"keytype sha1\"" in c and
+               "-c \"passwd %s\"" % (password) in c for c in commands]),
+          "control commands %s" % (commands))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_vrf
+    import ops_ntpd_conf
+    import ops_ntpd_backend
+
+    test_parse(ops_ntpd_conf)
+    test_render(ops_ntpd_conf)
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-keys-")
+    try:
+        test_control_key(ops_ntpd, ops_ntpd_conf, ops_ntpd_backend,
+                         ops_ntpd_vrf, workdir)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,196 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd log rotation and diagnostic dump.
+ - Checks the size capped rotation of a log kept open in append mode by
+   a writer, as ntpd and the supervised daemons do.
+ - Checks the bounded tail and time window reads of ntpd and chronyd
+   logs, and the redaction of the keys files.
+ - Checks the diagnostic dump against a large log and a large
+   configuration file.
+
+ Usage:
+   ./test_log.py
+'''
+
+import os
+import sys
+import time
+import shutil
+import tempfile
+
+from ntpd_test_util import check, result, load_ops_ntpd, TestIdl
+
+SHA1_KEY = "0123456789abcdef0123456789abcdef01234567"
+
+
+def ntpd_line(stamp, message):
+    return "%s ntpd[100]: %s\n" % (
+        time.strftime("%d %b %H:%M:%S", time.localtime(stamp)), message)
+
+
+def chronyd_line(stamp, message):
+    return "%s %s\n" % (
+        time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime(stamp)), message)
+
+
+def test_rotate(ops_ntpd_log, workdir):
+    log_file = os.path.join(workdir, "ops_ntp.log")
+    writer = open(log_file, "a", 0)
+    writer.write("a" * 99 + "\n")
+    check(not ops_ntpd_log.ops_ntpd_log_rotate(log_file, 100, 2),
+          "rotated at the limit")
+    writer.write("first\n")
+    check(ops_ntpd_log.ops_ntpd_log_rotate(log_file, 100, 2), "not rotated")
+    check(os.path.getsize(log_file) == 0 and
+          os.path.getsize(log_file + ".1") == 106, "first rotation")
+    # The writer keeps appending at the new end of the file
+    writer.write("b" * 200 + "\n")
+    check(os.path.getsize(log_file) == 201, "append after truncation")
+    ops_ntpd_log.ops_ntpd_log_rotate(log_file, 100, 2)
+    writer.write("c" * 200 + "\n")
+    ops_ntpd_log.ops_ntpd_log_rotate(log_file, 100, 2)
+    with open(log_file + ".1") as f:
+        check(f.read().startswith("c"), "newest copy")
+    with open(log_file + ".2") as f:
+        check(f.read().startswith("b"), "oldest copy")
+    check(not os.path.exists(log_file + ".3"), "too many copies")
+    writer.write("d" * 200 + "\n")
+    ops_ntpd_log.ops_ntpd_log_rotate(log_file, 100, 0)
+    with open(log_file + ".1") as f:
+        check(f.read().startswith("c"), "copied without copies")
+    writer.close()
+    check(not ops_ntpd_log.ops_ntpd_log_rotate(
+        os.path.join(workdir, "missing.log"), 100, 2), "missing log")
+
+
+def test_tail(ops_ntpd_log, workdir):
+    # Whole seconds, as the timestamps of the lines
+    now = int(time.time())
+    log_file = os.path.join(workdir, "tail.log")
+    with open(log_file, "w") as f:
+        for i in range(3000):
+            f.write(ntpd_line(now - 3000 + i, "line %d" % (i)))
+            if i % 100 == 0:
+                f.write(" continued %d\n" % (i))
+    lines = ops_ntpd_log.ops_ntpd_log_tail(log_file, lines=3)
+    check(len(lines) == 3 and lines[-1].endswith("line 2999\n"),
+          "tail %s" % (lines))
+    lines = ops_ntpd_log.ops_ntpd_log_tail(log_file, lines=100000,
+                                           max_bytes=1000)
+    check(sum([len(x) for x in lines]) <= 1000 and
+          lines[-1].endswith("line 2999\n") and
+          lines[0].startswith(time.strftime("%d ", time.localtime(now - 1))),
+          "bounded tail %s" % (lines[:2]))
+    lines = ops_ntpd_log.ops_ntpd_log_tail(log_file, since=now - 300,
+                                           now=now)
+    check(lines[0].endswith("line 2700\n") and
+          lines[1] == " continued 2700\n" and len(lines) == 303,
+          "window %s" % (lines[:2]))
+    check(ops_ntpd_log.ops_ntpd_log_tail(log_file, since=now + 10,
+                                         now=now) == [], "empty window")
+
+    with open(log_file, "w") as f:
+        for i in range(10):
+            f.write(chronyd_line(now - 10 + i, "chronyd %d" % (i)))
+    lines = ops_ntpd_log.ops_ntpd_log_tail(log_file, since=now - 2.5,
+                                           now=now)
+    check(len(lines) == 2 and lines[0].endswith("chronyd 8\n"),
+          "chronyd window %s" % (lines))
+    check(ops_ntpd_log.ops_ntpd_log_line_time("no timestamp here", now) is
+          None, "line without timestamp")
+
+
+def test_redact(ops_ntpd_log, ops_ntpd_conf):
+    keys = {10: ("password", True), 2: ("sha1:" + SHA1_KEY, True)}
+    for content in [ops_ntpd_conf.ops_ntpd_conf_render_keys(65535, "secret",
+                                                            keys),
+                    ops_ntpd_conf.ops_ntpd_conf_render_chrony_keys(
+                        65535, "secret", keys)]:
+        lines = [ops_ntpd_log.ops_ntpd_log_redact_keys(x) for x in
+                 content.splitlines(True)]
+        redacted = "".join(lines)
+        check("secret" not in redacted and "password" not in redacted and
+              SHA1_KEY not in redacted and
+              redacted.startswith(ops_ntpd_conf.CONF_HEADER) and
+              "2 SHA1 <redacted>\n" in redacted and
+              "10 MD5 <redacted>\n" in redacted, "redacted %s" % (redacted))
+
+
+def test_diagnostics(ops_ntpd, ops_ntpd_log, ops_ntpd_conf, workdir):
+    conf_file = os.path.join(workdir, "ntp.conf")
+    keys_file = os.path.join(workdir, "ntp.keys")
+    log_file = os.path.join(workdir, "diag.log")
+    with open(conf_file, "w") as f:
+        f.write("server 10.0.0.1\n")
+    with open(keys_file, "w") as f:
+        f.write(ops_ntpd_conf.ops_ntpd_conf_render_keys(
+            65535, "secret", {10: ("password", True)}))
+    now = time.time()
+    with open(log_file, "w") as f:
+        for i in range(100000):
+            f.write(ntpd_line(now - 100000 + i, "line %d" % (i)))
+    ops_ntpd.ntpd_info = (conf_file, keys_file, log_file)
+
+    ops_ntpd.idl = TestIdl({})
+    dump = ops_ntpd.ops_ntpd_diagnostics_handler(["basic", "ntpd"])
+    check("server 10.0.0.1" in dump and "secret" not in dump and
+          "password" not in dump, "configuration and keys")
+    check(dump.count(" ntpd[100]: line ") == 500 and
+          "line 99999\n" in dump and "line 99499\n" not in dump,
+          "default tail")
+    ops_ntpd.idl = TestIdl({"diag_log_window": "60"})
+    dump = ops_ntpd.ops_ntpd_diagnostics_handler(["basic", "ntpd"])
+    # The dump runs a moment after the log was written
+    check(58 <= dump.count(" ntpd[100]: line ") <= 60 and
+          "line 99999\n" in dump, "window")
+    ops_ntpd.idl = TestIdl({"diag_log_lines": "1000000"})
+    dump = ops_ntpd.ops_ntpd_diagnostics_handler(["basic", "ntpd"])
+    check(len(dump) < 2 * ops_ntpd_log.DIAG_LOG_MAX_BYTES,
+          "bounded dump %d" % (len(dump)))
+    with open(conf_file, "w") as f:
+        for i in range(100000):
+            f.write("server 10.%d.%d.%d\n" % (i >> 16, (i >> 8) & 255,
+                                               i & 255))
+    dump = ops_ntpd.ops_ntpd_diagnostics_handler(["basic", "ntpd"])
+    check(len(dump) < 2 * ops_ntpd_log.DIAG_LOG_MAX_BYTES and
+          "server 10.1.134.159\n" in dump and "server 10.0.0.0\n" not in dump,
+          "bounded configuration %d" % (len(dump)))
+    ops_ntpd.idl = TestIdl({"log_max_size_kb": "x"})
+    check(ops_ntpd.ops_ntpd_get_log_settings() ==
+          (1024 * 1024, 2, 500, 0), "invalid settings")
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_log
+    import ops_ntpd_conf
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-log-")
+    try:
+        test_rotate(ops_ntpd_log, workdir)
+        test_tail(ops_ntpd_log, workdir)
+        test_redact(ops_ntpd_log, ops_ntpd_conf)
+        test_diagnostics(ops_ntpd, ops_ntpd_log, ops_ntpd_conf, workdir)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
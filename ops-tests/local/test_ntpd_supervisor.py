@@ -0,0 +1,181 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd supervision of NTPD.
+ - ntpd is replaced by a stub, which is killed to simulate crashes.
+ - Checks that the NTPD left by a previous run is stopped through its
+   pid file while an unrelated process holding a stale pid is left
+   alone, that a crashed NTPD is restarted with a doubling backoff, that
+   restarts and uptime are counted, and that a stopped NTPD stays
+   stopped.
+ - Checks that the pid of an adopted NTPD, once reused by an unrelated
+   process, is reported exited and never signalled.
+
+ Usage:
+   ./test_ntpd_supervisor.py
+'''
+
+import os
+import sys
+import time
+import shutil
+import signal
+import tempfile
+import subprocess
+
+from ntpd_test_util import LOCAL_DIR, check, result, setup_platform
+
+TEST_BACKOFF = 0.2
+
+
+def test_process_alive(pid):
+    # Processes which are not our children may linger as zombies
+    try:
+        with open("/proc/%d/stat" % (pid), "r") as f:
+            return f.read().split(")")[-1].split()[0] != "Z"
+    except IOError:
+        return False
+
+
+def test_wait(cond, timeout=5):
+    deadline = time.time() + timeout
+    while not cond() and time.time() < deadline:
+        time.sleep(0.05)
+    return cond()
+
+
+def test_wait_pid_file(pid_file, pid):
+    def written():
+        try:
+            with open(pid_file, "r") as f:
+                return int(f.read()) == pid
+        except (IOError, ValueError):
+            return False
+    return test_wait(written)
+
+
+def test_stale_ntpd(ops_ntpd_supervisor, ntpd, pid_file):
+    # A pid file naming an unrelated process is left alone
+    sleeper = subprocess.Popen(["sleep", "60"])
+    with open(pid_file, "w") as f:
+        f.write("%d\n" % (sleeper.pid))
+    ops_ntpd_supervisor.ops_ntpd_supervisor_stop_stale(pid_file)
+    check(sleeper.poll() is None, "unrelated process killed")
+    sleeper.kill()
+    sleeper.wait()
+
+    # The ntpd of a previous run is stopped
+    subprocess.check_call([ntpd, "-p", pid_file])
+    with open(pid_file, "r") as f:
+        pid = int(f.read())
+    check(test_process_alive(pid), "stale ntpd not running")
+    ops_ntpd_supervisor.ops_ntpd_supervisor_stop_stale(pid_file)
+    check(test_wait(lambda: not test_process_alive(pid)),
+          "stale ntpd still running")
+    check(not os.path.exists(pid_file), "stale pid file left")
+
+
+def test_adopted_pid_reuse(ops_ntpd_supervisor, ntpd, pid_file, log_file):
+    subprocess.check_call([ntpd, "-p", pid_file])
+    with open(pid_file, "r") as f:
+        pid = int(f.read())
+    adopted = ops_ntpd_supervisor.NTPDAdoptedProcess(pid, pid_file)
+    check(adopted.poll() is None, "adopted ntpd not running")
+    os.kill(pid, signal.SIGKILL)
+    check(test_wait(lambda: adopted.poll() is not None),
+          "adopted ntpd still running")
+
+    # The pid of the adopted ntpd now belongs to an unrelated process
+    sleeper = subprocess.Popen(["sleep", "60"])
+    supervisor = ops_ntpd_supervisor.NTPDSupervisor(
+        "test", [ntpd, "-n", "-p", pid_file], pid_file, log_file)
+    supervisor.process = ops_ntpd_supervisor.NTPDAdoptedProcess(
+        sleeper.pid, pid_file)
+    supervisor.started = time.time()
+    check(supervisor.process.poll() == -1, "reused pid reported alive")
+    supervisor.process.terminate()
+    supervisor.process.kill()
+    supervisor.stop()
+    check(sleeper.poll() is None, "unrelated process signalled")
+    sleeper.kill()
+    sleeper.wait()
+
+
+def test_supervisor(ops_ntpd_supervisor, ntpd, pid_file, log_file):
+    supervisor = ops_ntpd_supervisor.NTPDSupervisor(
+        "test", [ntpd, "-n", "-p", pid_file], pid_file, log_file)
+    check(supervisor.start(), "ntpd not started")
+    pid = supervisor.pid()
+    check(test_wait_pid_file(pid_file, pid), "pid file not written")
+    time.sleep(1)
+    check(supervisor.uptime(time.time()) >= 1, "uptime %d" %
+          (supervisor.uptime(time.time())))
+
+    # A crash is restarted once the backoff expired
+    os.kill(pid, signal.SIGKILL)
+    check(test_wait(lambda: supervisor.process.poll() is not None),
+          "ntpd not killed")
+    now = time.time()
+    check(not supervisor.poll(now), "restarted without backoff")
+    check(supervisor.pid() is None, "crashed ntpd still tracked")
+    check(supervisor.uptime(now) == 0, "uptime of a crashed ntpd")
+    check(supervisor.poll(now + TEST_BACKOFF), "ntpd not restarted")
+    check(supervisor.restarts == 1, "restarts %d" % (supervisor.restarts))
+    check(supervisor.pid() not in [None, pid], "pid %s" % supervisor.pid())
+
+    # Crashing again right away doubles the backoff
+    pid = supervisor.pid()
+    os.kill(pid, signal.SIGKILL)
+    test_wait(lambda: supervisor.process.poll() is not None)
+    now = time.time()
+    supervisor.poll(now)
+    check(abs(supervisor.restart_at - now - 2 * TEST_BACKOFF) < 0.01,
+          "backoff %.3f" % (supervisor.restart_at - now))
+    check(supervisor.poll(now + 2 * TEST_BACKOFF), "ntpd not restarted")
+    check(supervisor.restarts == 2, "restarts %d" % (supervisor.restarts))
+
+    # Stopping goes through the process handle and is final
+    pid = supervisor.pid()
+    supervisor.stop()
+    check(not test_process_alive(pid), "ntpd still running")
+    check(not os.path.exists(pid_file), "pid file left")
+    check(not supervisor.poll(time.time() + 3600), "stopped ntpd restarted")
+
+
+def main():
+    setup_platform()
+    import ops_ntpd_supervisor
+    ops_ntpd_supervisor.DEFAULT_RESTART_BACKOFF = TEST_BACKOFF
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-supervisor-")
+    ntpd = os.path.join(workdir, "ntpd")
+    os.symlink(os.path.join(LOCAL_DIR, "stub_ntpd.py"), ntpd)
+    pid_file = os.path.join(workdir, "ntpd.pid")
+    log_file = os.path.join(workdir, "ntpd.log")
+    try:
+        test_stale_ntpd(ops_ntpd_supervisor, ntpd, pid_file)
+        test_adopted_pid_reuse(ops_ntpd_supervisor, ntpd, pid_file,
+                               log_file)
+        test_supervisor(ops_ntpd_supervisor, ntpd, pid_file, log_file)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
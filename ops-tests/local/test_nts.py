@@ -0,0 +1,308 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd NTS associations.
+ - Checks the chrony.conf and the chronyc commands of NTS associations,
+   and that the ntpd backend leaves them out.
+ - Checks the parsing of the chronyc authdata report, the NTS-KE
+   handshake counter derived from it, and the cookie refreshes counted
+   from the responses in the reach register.
+ - Checks that moving an association from a key to NTS is a staged
+   switch, and that the NTS status is published with the association.
+ - When chronyd, chronyc and openssl are installed and the test runs as
+   root, creates a self-signed CA, runs a chronyd NTS server on
+   unprivileged ports and a chronyd client with the rendered
+   chrony.conf, and checks that the client gets its cookies. Prints
+   SKIP for that part otherwise.
+
+ Usage:
+   ./test_nts.py
+'''
+
+import os
+import sys
+import time
+import shutil
+import tempfile
+import subprocess
+import distutils.spawn
+
+from ntpd_test_util import check, result, load_ops_ntpd
+
+NTS_SERVER_NTP_PORT = 11123
+NTS_SERVER_KE_PORT = 14460
+CHRONYD_TIMEOUT = 30
+
+
+class TestInstance(object):
+    '''
+    The parts of an NTPDInstance the chrony backend uses, run on the
+    host
+    '''
+
+    def __init__(self, vrf_name, working_dir):
+        self.vrf_name = vrf_name
+        self.working_dir_path = working_dir
+        self.conf_file = os.path.join(working_dir, "chrony.conf")
+        self.keys_file = os.path.join(working_dir, "chrony.keys")
+        self.pid_file = os.path.join(working_dir, "chronyd.pid")
+        self.drift_file = None
+        self.discipline = False
+
+    def command(self, command):
+        return command
+
+    def working_dir(self):
+        return self.working_dir_path + "/"
+
+
+def test_conf(ops_ntpd_conf, ops_ntpd_backend):
+    associations = [("10.0.0.1", "vrf_default", "5", "-", "false", "4"),
+                    ("10.0.0.2", "vrf_default", "nts", "-", "true", "4")]
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_chrony_conf(
+        associations, "/etc/ntp/ops_ntp.keys", "/etc/ntp/chronyd.sock",
+        "/etc/ntp/ntpd.pid", None, None, "/etc/ntp",
+        "/etc/ntp/nts-ca.pem").split("\n")
+    check("ntsdumpdir /etc/ntp" in conf and
+          "ntstrustedcerts /etc/ntp/nts-ca.pem" in conf and
+          "server 10.0.0.1 iburst key 5" in conf and
+          "server 10.0.0.2 iburst nts prefer" in conf,
+          "chrony.conf %s" % (conf))
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_chrony_conf(
+        associations[:1], "/etc/ntp/ops_ntp.keys", "/etc/ntp/chronyd.sock",
+        "/etc/ntp/ntpd.pid")
+    check("nts" not in conf, "chrony.conf without NTS %s" % (conf))
+
+    instance = TestInstance("vrf_default", "/etc/ntp")
+    backend = ops_ntpd_backend.NTPDClassicBackend(lambda command: None)
+    conf = backend.render_conf(instance, 65535, associations, [5], True)
+    check("server 10.0.0.1 version 4 key 5" in conf and
+          "10.0.0.2" not in conf, "ntp.conf %s" % (conf))
+    check(backend.server_add_configs(associations[1]) == [],
+          "ntpd NTS configs")
+    check(backend.nts_configs() == [], "ntpd NTS certificates configs")
+
+    backend = ops_ntpd_backend.NTPDChronyBackend(lambda command: None)
+    configs = backend.server_add_configs(associations[1], True)
+    check(configs == ["add server 10.0.0.2 iburst nts prefer"],
+          "chronyc configs %s" % (configs))
+    check(backend.nts_configs() == [ops_ntpd_backend.NTPD_BACKEND_RESTART],
+          "chronyd NTS certificates configs")
+
+
+def test_read_nts(ops_ntpd_backend, ops_ntpd_nts):
+    import stub_chronyc
+    commands = []
+
+    def run_chronyc(command):
+        commands.append(command)
+        return ("", ("\n".join(stub_chronyc.AUTHDATA +
+                               ["10.0.0.3,NTS,0,-,0,-,3,1,0,0",
+                                "10.0.0.4,NTS,1"]) + "\n", ""))
+    backend = ops_ntpd_backend.NTPDChronyBackend(run_chronyc)
+    nts = backend.read_nts(TestInstance("vrf_default", "/etc/ntp"))
+    check(commands[-1].endswith("-c -n authdata"), "command %s" % (commands))
+    # Not NTS, and truncated rows, are skipped
+    check(nts == {"10.0.0.1": {ops_ntpd_nts.NTS_LAST_KE: 33,
+                               ops_ntpd_nts.NTS_COOKIES: 8},
+                  "10.0.0.3": {ops_ntpd_nts.NTS_LAST_KE: None,
+                               ops_ntpd_nts.NTS_COOKIES: 0}},
+          "authdata %s" % (nts))
+    backend = ops_ntpd_backend.NTPDClassicBackend(run_chronyc)
+    check(backend.read_nts(None) == {}, "ntpd NTS state")
+
+
+def test_tracker(ops_ntpd_nts):
+    tracker = ops_ntpd_nts.NTPDNTSTracker()
+    key = ("vrf_default", "10.0.0.1")
+
+    def entry(last_ke, cookies):
+        return {ops_ntpd_nts.NTS_LAST_KE: last_ke,
+                ops_ntpd_nts.NTS_COOKIES: cookies}
+
+    def counters(status):
+        return (status["nts_cookies"], status["nts_ke_count"],
+                status["nts_cookie_refreshes"], status["nts_last_ke"])
+
+    def update(entry, now, when, reach):
+        return tracker.update(key, entry, now, when, "64", reach)
+
+    now = 1000.0
+    status = update(entry(None, 0), now, "-", "0")
+    check(counters(status) == ("0", "0", "0", "-"), "no handshake %s" %
+          (status))
+    # The first response carries a fresh cookie
+    status = update(entry(2, 8), now + 2, "1", "1")
+    check(counters(status) == ("8", "1", "1", "2"), "handshake %s" %
+          (status))
+    # A lost response spends a cookie
+    status = update(entry(66, 7), now + 66, "65", "2")
+    check(counters(status) == ("7", "1", "1", "66"), "lost response %s" %
+          (status))
+    status = update(entry(130, 8), now + 130.6, "1", "5")
+    check(counters(status) == ("8", "1", "2", "130"), "refresh %s" %
+          (status))
+    # Two responses between two refreshes, the cookie count is unchanged
+    status = update(entry(258, 8), now + 258, "1", "27")
+    check(counters(status) == ("8", "1", "4", "258"), "held cookies %s" %
+          (status))
+    # The server rotated its keys, a new handshake gets 8 cookies
+    status = update(entry(1, 8), now + 400, "1", "57")
+    check(counters(status) == ("8", "2", "5", "1"), "new handshake %s" %
+          (status))
+    # Not reported, the counters are kept
+    status = update(None, now + 410, "11", "57")
+    check(counters(status) == ("8", "2", "5", "-"), "not reported %s" %
+          (status))
+
+    tracker.prune([("vrf_default", "10.0.0.2")])
+    check(tracker.associations == {}, "prune %s" % (tracker.associations))
+
+
+def test_reconcile(ops_ntpd, ops_ntpd_backend):
+    import stub_chronyc
+    ops_ntpd.ntpd_backend = ops_ntpd_backend.NTPDChronyBackend(
+        lambda command: ("", ("\n".join(stub_chronyc.REPORTS.get(
+            command.split()[-1], [])) + "\n", "")))
+    ops_ntpd.g_ntpa_map = {}
+    ops_ntpd.key_rotation = ops_ntpd.NTPDKeyRotation()
+
+    def configure(key_id):
+        update_map = {}
+        ops_ntpd.ops_ntpd_setup_ntp_config_map(
+            update_map, "vrf_default", "10.0.0.1", 0, key_id,
+            ops_ntpd.DEFAULT_NTP_REF_CLOCK_ID, ops_ntpd.DEFAULT_NTP_PREF,
+            "4")
+        return ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+            update_map)
+
+    configs = configure("5")
+    check(configs == {"vrf_default": ["add server 10.0.0.1 iburst key 5"]},
+          "add configs %s" % (configs))
+    configs = configure("nts")
+    check(configs == {"vrf_default": ["delete 10.0.0.1",
+                                      "add server 10.0.0.1 iburst nts"]},
+          "switch configs %s" % (configs))
+    check("vrf_default" in ops_ntpd.key_rotation.switching,
+          "switch %s" % (ops_ntpd.key_rotation.switching))
+
+    info = {}
+    instance = TestInstance("vrf_default", "/etc/ntp")
+    ops_ntpd.ops_ntpd_get_instance_associations_info(instance, info)
+    status = info.get("10.0.0.1", {})
+    check(status.get("nts_cookies") == "8" and
+          status.get("nts_ke_count") == "1" and
+          status.get("nts_last_ke") == "33", "NTS status %s" % (status))
+    check([k for k, v in info.iteritems() if "nts_cookies" in v] ==
+          ["10.0.0.1"], "NTS associations %s" % (info.keys()))
+    # Reach 377 ends the switch
+    check(ops_ntpd.key_rotation.switching == {},
+          "switch %s" % (ops_ntpd.key_rotation.switching))
+
+
+def test_chronyd(ops_ntpd_conf, ops_ntpd_backend, ops_ntpd_nts, workdir):
+    chronyd = distutils.spawn.find_executable("chronyd")
+    chronyc = distutils.spawn.find_executable("chronyc")
+    openssl = distutils.spawn.find_executable("openssl")
+    if chronyd is None or chronyc is None or openssl is None or \
+            os.getuid() != 0:
+        print("SKIP: chronyd, chronyc, openssl or root not available")
+        return
+    # Self-signed CA, also the certificate of the NTS-KE server
+    cert = os.path.join(workdir, "ca.pem")
+    key = os.path.join(workdir, "ca.key")
+    subprocess.check_call([openssl, "req", "-x509", "-newkey", "rsa:2048",
+                           "-nodes", "-days", "1", "-subj",
+                           "/CN=ops-ntpd-test", "-addext",
+                           "subjectAltName=IP:127.0.0.1",
+                           "-keyout", key, "-out", cert])
+    server_dir = os.path.join(workdir, "server")
+    os.mkdir(server_dir)
+    server_conf = os.path.join(server_dir, "chrony.conf")
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(server_conf, "\n".join([
+        "local stratum 1",
+        "allow 127.0.0.1",
+        "port %d" % (NTS_SERVER_NTP_PORT),
+        "ntsport %d" % (NTS_SERVER_KE_PORT),
+        "ntsserverkey %s" % (key),
+        "ntsservercert %s" % (cert),
+        "ntsdumpdir %s" % (server_dir),
+        "bindcmdaddress %s/chronyd.sock" % (server_dir),
+        "cmdport 0",
+        "pidfile %s/chronyd.pid" % (server_dir)]) + "\n")
+
+    client = TestInstance("vrf_default", os.path.join(workdir, "client"))
+    os.mkdir(client.working_dir_path)
+    backend = ops_ntpd_backend.NTPDChronyBackend(
+        lambda command: ("", subprocess.Popen(
+            command, shell=True, stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE).communicate()))
+    backend.nts_trusted_certs = cert
+    conf = backend.render_conf(
+        client, 1, [("127.0.0.1", "vrf_default", ops_ntpd_conf.NTS_KEY_ID,
+                     "-", "false", "4")], [], False)
+    conf = conf.replace(" iburst nts", " iburst nts port %d ntsport %d" %
+                        (NTS_SERVER_NTP_PORT, NTS_SERVER_KE_PORT))
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(client.conf_file, conf)
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(
+        client.keys_file, backend.render_keys(1, "test", {}))
+
+    server = subprocess.Popen([chronyd, "-d", "-x", "-f", server_conf])
+    daemon = subprocess.Popen([chronyd] + backend.daemon_argv(client)[1:])
+    nts = {}
+    try:
+        deadline = time.time() + CHRONYD_TIMEOUT
+        while time.time() < deadline:
+            time.sleep(2)
+            nts = backend.read_nts(client).get("127.0.0.1", {})
+            if nts.get(ops_ntpd_nts.NTS_COOKIES):
+                break
+    finally:
+        daemon.terminate()
+        daemon.wait()
+        server.terminate()
+        server.wait()
+    check(nts.get(ops_ntpd_nts.NTS_COOKIES) > 0 and
+          nts.get(ops_ntpd_nts.NTS_LAST_KE) is not None,
+          "no NTS cookies %s" % (nts))
+    # The cookies are kept for the next run of the client
+    check(any([x.endswith(".nts") for x in
+               os.listdir(client.working_dir_path)]),
+          "NTS cookies not dumped %s" % (os.listdir(client.working_dir_path)))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_nts
+    import ops_ntpd_conf
+    import ops_ntpd_backend
+
+    test_conf(ops_ntpd_conf, ops_ntpd_backend)
+    test_read_nts(ops_ntpd_backend, ops_ntpd_nts)
+    test_tracker(ops_ntpd_nts)
+    test_reconcile(ops_ntpd, ops_ntpd_backend)
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-nts-")
+    try:
+        test_chronyd(ops_ntpd_conf, ops_ntpd_backend, ops_ntpd_nts, workdir)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd main loop phase latency.
+ - Checks the histogram buckets, quantiles and the timing of a phase
+   that raises.
+ - Checks the 'ntpd/perf' unixctl reply.
+
+ Usage:
+   ./test_perf.py
+'''
+
+import sys
+
+from ntpd_test_util import check, result, load_ops_ntpd
+
+
+class TestConnection(object):
+
+    def __init__(self):
+        self.replied = None
+        self.error = None
+
+    def reply(self, body):
+        self.replied = body
+
+    def reply_error(self, body):
+        self.error = body
+
+
+def test_histogram(ops_ntpd_perf):
+    perf = ops_ntpd_perf.NTPDPerf()
+    for ms in [0.5, 1, 1.5, 3, 3, 40, 40, 40, 150, 9000]:
+        perf.record(ops_ntpd_perf.PERF_GLOBAL_STATUS, ms / 1000.0)
+    histogram = perf.phases[ops_ntpd_perf.PERF_GLOBAL_STATUS]
+    check(histogram.buckets == [2, 1, 2, 0, 0, 3, 0, 1, 0, 0, 0, 0, 1],
+          "buckets %s" % (histogram.buckets))
+    check(histogram.count == 10 and abs(histogram.max - 9000) < 1e-6,
+          "count %d max %f" % (histogram.count, histogram.max))
+    check(histogram.quantile(0.50) == 5, "p50 %s" % (histogram.quantile(0.5)))
+    check(abs(histogram.quantile(0.99) - 9000) < 1e-6,
+          "p99 %s" % (histogram.quantile(0.99)))
+
+    try:
+        with perf.measure(ops_ntpd_perf.PERF_CHECK_UPDATES):
+            raise ValueError("failed phase")
+    except ValueError:
+        pass
+    check(perf.phases[ops_ntpd_perf.PERF_CHECK_UPDATES].count == 1,
+          "raising phase not timed")
+
+    lines = perf.dump(perf.since + 60)
+    check(lines[0].startswith("Phase latency over the last 60 s") and
+          lines[2].startswith(ops_ntpd_perf.PERF_GLOBAL_STATUS) and
+          "<=1:2 <=2:1 <=5:2 <=50:3 <=200:1 >5000:1" in lines[3] and
+          lines[4].startswith(ops_ntpd_perf.PERF_CHECK_UPDATES),
+          "dump %s" % (lines))
+    perf.reset()
+    check(perf.phases == {}, "not reset")
+
+
+def test_unixctl(ops_ntpd, ops_ntpd_perf):
+    ops_ntpd.ops_ntpd_run_command("true")
+    ops_ntpd.perf_stats.record(ops_ntpd_perf.PERF_STATUS_COMMIT, 0.004)
+
+    conn = TestConnection()
+    ops_ntpd.ops_ntpd_show_perf(conn, [], None)
+    check(conn.replied is not None and
+          ops_ntpd_perf.PERF_DAEMON_COMMAND in conn.replied and
+          ops_ntpd_perf.PERF_STATUS_COMMIT in conn.replied,
+          "reply %s" % (conn.replied))
+    conn = TestConnection()
+    ops_ntpd.ops_ntpd_show_perf(conn, ["reset"], None)
+    check(not ops_ntpd.perf_stats.phases, "not reset %s" % (conn.replied))
+    conn = TestConnection()
+    ops_ntpd.ops_ntpd_show_perf(conn, ["clear"], None)
+    check(conn.error is not None and conn.replied is None,
+          "invalid argument %s" % (conn.replied))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_perf
+
+    test_histogram(ops_ntpd_perf)
+    test_unixctl(ops_ntpd, ops_ntpd_perf)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,229 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd reference clock associations.
+ - Checks the ntp.conf lines and the ':config' lines of PPS and SHM
+   reference clocks, with their default and configured refids.
+ - Writes a sample with the SHM writer code of ops-ntpd and reads it
+   back from the shared memory segment, the way the NTPD SHM driver
+   does. When ntpd is tested, the samples come from shm_writer.py.
+ - Runs the ops-ntpd SHM feeder of an association with a socket feed,
+   and checks that the samples sent on the socket reach the segment.
+ - When ntpd is installed, runs it on the rendered ntp.conf with
+   'disable ntp' and checks that it reaches the SHM reference clock.
+   Prints SKIP for that part otherwise.
+
+ Usage:
+   ./test_refclock.py
+'''
+
+import os
+import sys
+import time
+import shutil
+import tempfile
+import subprocess
+import socket
+import distutils.spawn
+
+from ntpd_test_util import LOCAL_DIR, check, result, load_ops_ntpd
+
+SHM_ADDRESS = "127.127.28.2"
+PPS_ADDRESS = "127.127.22.0"
+SHM_UNIT = 2
+FEED_UNIT = 3
+NTPD_TIMEOUT = 40
+
+
+def test_conf_lines(ops_ntpd_conf):
+    lines = ops_ntpd_conf.ops_ntpd_conf_server_lines(
+        SHM_ADDRESS, 0, "-", "false", 3)
+    check(lines == ["server %s minpoll 4 maxpoll 4" % (SHM_ADDRESS),
+                    "fudge %s refid SHM" % (SHM_ADDRESS)],
+          "shm lines %s" % (lines))
+    lines = ops_ntpd_conf.ops_ntpd_conf_server_lines(
+        PPS_ADDRESS, 0, "GPS", "true", 3)
+    check(lines == ["server %s minpoll 4 maxpoll 4 prefer" % (PPS_ADDRESS),
+                    "fudge %s refid GPS flag3 1" % (PPS_ADDRESS)],
+          "pps lines %s" % (lines))
+    # Other local addresses are regular servers
+    lines = ops_ntpd_conf.ops_ntpd_conf_server_lines(
+        "127.127.1.0", 0, "-", "false", 4)
+    check(lines == ["server 127.127.1.0 version 4"], "lines %s" % (lines))
+
+
+def test_configs(ops_ntpd):
+    update_map = {}
+    ops_ntpd.ops_ntpd_setup_ntp_config_map(
+        update_map, "vrf_default", SHM_ADDRESS, 0, ops_ntpd.DEFAULT_NTP_KEY_ID,
+        "GPS", ops_ntpd.DEFAULT_NTP_PREF, ops_ntpd.DEFAULT_NTP_VERSION)
+    configs = ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+        update_map).get("vrf_default", [])
+    check(configs == [":config server %s minpoll 4 maxpoll 4" % (SHM_ADDRESS),
+                      ":config fudge %s refid GPS" % (SHM_ADDRESS)],
+          "add configs %s" % (configs))
+    configs = ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+        {}).get("vrf_default", [])
+    check(configs == [":config unconfig %s" % (SHM_ADDRESS)],
+          "delete configs %s" % (configs))
+
+
+def test_shm_writer(ops_ntpd_shm):
+    try:
+        (shmid, shm) = ops_ntpd_shm.ops_ntpd_shm_attach(SHM_UNIT)
+    except OSError as e:
+        print("SKIP: SysV shared memory unavailable : %s" % (str(e)))
+        return False
+    now = time.time()
+    count = shm.count
+    ops_ntpd_shm.ops_ntpd_shm_write_sample(shm, now + 0.5, now)
+    ops_ntpd_shm.ops_ntpd_shm_detach(shm)
+
+    # Read back through a new attachment, as NTPD would
+    (shmid, shm) = ops_ntpd_shm.ops_ntpd_shm_attach(SHM_UNIT, create=False)
+    check(shm.mode == 1 and shm.valid == 1, "sample not valid")
+    check(shm.count == count + 2, "count %d, was %d" % (shm.count, count))
+    check(shm.clockTimeStampSec - shm.receiveTimeStampSec in [0, 1],
+          "clock %d receive %d" % (shm.clockTimeStampSec,
+                                    shm.receiveTimeStampSec))
+    check(shm.receiveTimeStampSec == int(now), "receive time %d" % (
+          shm.receiveTimeStampSec))
+    ops_ntpd_shm.ops_ntpd_shm_detach(shm)
+    return True
+
+
+def test_wait_samples(feeder, samples, timeout):
+    deadline = time.time() + timeout
+    while feeder.samples < samples and time.time() < deadline:
+        time.sleep(0.05)
+    return feeder.samples >= samples
+
+
+def test_shm_feeder(ops_ntpd, ops_ntpd_shm, workdir):
+    path = os.path.join(workdir, "feed.sock")
+    feed = "socket:" + path
+    check(ops_ntpd_shm.ops_ntpd_shm_parse_feed("gps:" + path) is None,
+          "unknown source accepted")
+    check(ops_ntpd_shm.ops_ntpd_shm_parse_feed("socket:feed.sock") is None,
+          "relative path accepted")
+
+    # Only SHM reference clocks of the default VRF are fed
+    ops_ntpd.ops_ntpd_update_shm_feeders({FEED_UNIT: feed})
+    feeder = ops_ntpd.shm_feeders.get(FEED_UNIT)
+    check(feeder is not None, "feeder not started")
+    if feeder is None:
+        return
+    deadline = time.time() + 5
+    while not os.path.exists(path) and time.time() < deadline:
+        time.sleep(0.05)
+
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+    now = time.time()
+    # Malformed samples are dropped
+    sock.sendto("not a time", path)
+    sock.sendto("%.6f %.6f" % (now + 0.25, now), path)
+    check(test_wait_samples(feeder, 1, 5), "sample not fed")
+    (shmid, shm) = ops_ntpd_shm.ops_ntpd_shm_attach(FEED_UNIT, create=False)
+    check(shm.valid == 1 and shm.receiveTimeStampSec == int(now),
+          "receive time %d, sent %d" % (shm.receiveTimeStampSec, now))
+    check(shm.clockTimeStampSec == int(now + 0.25), "clock time %d" % (
+          shm.clockTimeStampSec))
+    check(feeder.samples == 1, "%d samples" % (feeder.samples))
+    ops_ntpd_shm.ops_ntpd_shm_detach(shm)
+
+    # Without receive time, the arrival time is used
+    sock.sendto("%.6f" % (now + 0.25), path)
+    check(test_wait_samples(feeder, 2, 5), "second sample not fed")
+    sock.close()
+
+    # An unchanged feed keeps its feeder, a changed one replaces it
+    ops_ntpd.ops_ntpd_update_shm_feeders({FEED_UNIT: feed})
+    check(ops_ntpd.shm_feeders.get(FEED_UNIT) is feeder, "feeder restarted")
+    ops_ntpd.ops_ntpd_update_shm_feeders({FEED_UNIT: "phc:/dev/no_ptp"})
+    check(ops_ntpd.shm_feeders.get(FEED_UNIT) is not feeder,
+          "feeder not replaced")
+    check(not os.path.exists(path), "socket left behind")
+    ops_ntpd.ops_ntpd_update_shm_feeders({})
+    check(ops_ntpd.shm_feeders == {}, "feeders %s" % (ops_ntpd.shm_feeders))
+
+
+def test_ntpd(ops_ntpd_conf, workdir):
+    ntpd = distutils.spawn.find_executable("ntpd")
+    ntpq = distutils.spawn.find_executable("ntpq")
+    if ntpd is None or ntpq is None or os.getuid() != 0:
+        print("SKIP: ntpd, ntpq or root not available")
+        return
+    conf_file = os.path.join(workdir, "ntp.conf")
+    keys_file = os.path.join(workdir, "ntp.keys")
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(
+        conf_file, ops_ntpd_conf.ops_ntpd_conf_render_conf(
+            1, [(SHM_ADDRESS, "vrf_default", 0, "-", "false", 3)], [],
+            discipline=False) + "keys %s\n" % (keys_file))
+    ops_ntpd_conf.ops_ntpd_conf_write_atomic(
+        keys_file, ops_ntpd_conf.ops_ntpd_conf_render_keys(1, "test", {}))
+    writer = subprocess.Popen([sys.executable,
+                               os.path.join(LOCAL_DIR, "shm_writer.py"),
+                               "--unit", str(SHM_UNIT), "--offset", "0.01"])
+    daemon = subprocess.Popen([ntpd, "-n", "-c", conf_file,
+                               "-p", os.path.join(workdir, "ntpd.pid")])
+    reach = "0"
+    try:
+        deadline = time.time() + NTPD_TIMEOUT
+        while reach == "0" and time.time() < deadline:
+            time.sleep(2)
+            try:
+                out = subprocess.check_output([ntpq, "-c", "rv &1 reach"])
+            except subprocess.CalledProcessError:
+                continue
+            if "reach=" in out:
+                reach = out.split("reach=")[1].split(",")[0].strip()
+    finally:
+        daemon.terminate()
+        daemon.wait()
+        writer.terminate()
+        writer.wait()
+    check(reach not in ["0", "00"], "SHM reference clock not reached")
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_conf
+    import ops_ntpd_shm
+
+    test_conf_lines(ops_ntpd_conf)
+    test_configs(ops_ntpd)
+    if test_shm_writer(ops_ntpd_shm):
+        workdir = tempfile.mkdtemp(prefix="ops-ntpd-refclock-")
+        try:
+            test_shm_feeder(ops_ntpd, ops_ntpd_shm, workdir)
+            test_ntpd(ops_ntpd_conf, workdir)
+        finally:
+            ops_ntpd.ops_ntpd_update_shm_feeders({})
+            shutil.rmtree(workdir, ignore_errors=True)
+            for unit in [SHM_UNIT, FEED_UNIT]:
+                try:
+                    (shmid, shm) = ops_ntpd_shm.ops_ntpd_shm_attach(
+                        unit, create=False)
+                    ops_ntpd_shm.ops_ntpd_shm_detach(shm, shmid)
+                except OSError:
+                    pass
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
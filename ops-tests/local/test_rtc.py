@@ -0,0 +1,142 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd hardware clock (RTC) sync.
+ - The rtc driver ioctls are replaced by a model of the RTC, which
+   holds whole seconds, and the system clock by a test clock.
+ - Checks that the RTC is only touched while synchronized, that a
+   drifted RTC is written on the first sync, that the RTC is then only
+   checked once the sync interval elapsed, or never with an interval of
+   0, and that a drift within the threshold is not written, also when
+   the system clock is in the middle of a second.
+
+ Usage:
+   ./test_rtc.py
+'''
+
+import os
+import sys
+import time
+import struct
+import calendar
+import tempfile
+
+from ntpd_test_util import check, result, setup_platform, TestClock
+
+
+class TestRtc(object):
+    '''
+    The rtc driver, through the fcntl.ioctl() calls of ops_ntpd_rtc
+    '''
+
+    def __init__(self, ops_ntpd_rtc, seconds):
+        self.rtc = ops_ntpd_rtc
+        self.seconds = seconds
+        self.reads = 0
+        self.writes = 0
+
+    def ioctl(self, fd, request, arg):
+        fmt = self.rtc.RTC_TIME_FORMAT
+        if request == self.rtc.RTC_RD_TIME:
+            self.reads += 1
+            tm = time.gmtime(self.seconds)
+            return struct.pack(fmt, tm.tm_sec, tm.tm_min, tm.tm_hour,
+                               tm.tm_mday, tm.tm_mon - 1, tm.tm_year - 1900,
+                               0, 0, 0)
+        if request == self.rtc.RTC_SET_TIME:
+            self.writes += 1
+            fields = struct.unpack(fmt, arg)
+            self.seconds = calendar.timegm(
+                (fields[5] + 1900, fields[4] + 1, fields[3], fields[2],
+                 fields[1], fields[0], 0, 0, 0))
+            return arg
+        raise IOError("unknown ioctl %x" % (request))
+
+
+def test_sync(ops_ntpd_rtc, clock):
+    rtc = TestRtc(ops_ntpd_rtc, int(clock.now) - 5)
+    ops_ntpd_rtc.fcntl = rtc
+    ops_ntpd_rtc.ops_ntpd_rtc_configure(3600, 1)
+
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(False)
+    check(rtc.reads == 0, "RTC read while not synchronized")
+
+    # The first sync writes the drifted RTC, rounded to the second
+    clock.now += 0.75
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(True)
+    check(rtc.writes == 1 and rtc.seconds == int(clock.now + 0.5),
+          "first sync writes %d rtc %d now %.2f" %
+          (rtc.writes, rtc.seconds, clock.now))
+
+    # Not checked again before the interval elapsed
+    rtc.seconds -= 5
+    clock.now += 3599
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(True)
+    check(rtc.reads == 1 and rtc.writes == 1,
+          "checked before the interval, reads %d" % (rtc.reads))
+    clock.now += 1
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(True)
+    check(rtc.reads == 2 and rtc.writes == 2,
+          "not written after the interval, writes %d" % (rtc.writes))
+
+    # One second behind a system clock near the end of its second is
+    # within the threshold: the RTC only holds whole seconds
+    clock.now = int(clock.now) + 3600.9
+    rtc.seconds = int(clock.now) - 1
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(True)
+    check(rtc.reads == 3 and rtc.writes == 2,
+          "written within the threshold, writes %d" % (rtc.writes))
+
+    # A drift within a larger threshold is left alone
+    ops_ntpd_rtc.ops_ntpd_rtc_configure(3600, 10)
+    clock.now += 3600
+    rtc.seconds = int(clock.now) + 5
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(True)
+    check(rtc.reads == 4 and rtc.writes == 2,
+          "written within the threshold of 10 s, writes %d" % (rtc.writes))
+
+    # Without interval, only the first sync checks the RTC
+    ops_ntpd_rtc.ops_ntpd_rtc_configure(0, 1)
+    clock.now += 86400
+    ops_ntpd_rtc.ops_ntpd_rtc_sync(True)
+    check(rtc.reads == 4, "checked without interval")
+    ops_ntpd_rtc.ops_ntpd_rtc_configure("x", None)
+    check(ops_ntpd_rtc.g_rtc_sync_interval ==
+          ops_ntpd_rtc.DEFAULT_RTC_SYNC_INTERVAL and
+          ops_ntpd_rtc.g_rtc_drift_threshold ==
+          ops_ntpd_rtc.DEFAULT_RTC_DRIFT_THRESHOLD, "invalid settings")
+
+
+def main():
+    setup_platform()
+    import ops_ntpd_rtc
+
+    clock = TestClock()
+    ops_ntpd_rtc.time = clock
+    (fd, device) = tempfile.mkstemp(prefix="ops-ntpd-rtc-")
+    os.close(fd)
+    ops_ntpd_rtc.RTC_DEVICE = device
+    try:
+        test_sync(ops_ntpd_rtc, clock)
+    finally:
+        os.unlink(device)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
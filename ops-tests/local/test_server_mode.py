@@ -0,0 +1,235 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd server mode.
+ - Checks the server mode policy read from System:ntp_config, and the
+   restrict, discard and ratelimit lines rendered from it for ntpd and
+   chronyd.
+ - Checks that a server mode change restarts the running ntpd (a stub)
+   with the new ntp.conf.
+ - Runs the client load generator against a stub server which sends a
+   Kiss-o'-Death to a client polling more than once per 0.5 s, and
+   checks that the flooding client gets KoDs while the well behaved
+   ones are answered.
+
+ Usage:
+   ./test_server_mode.py
+'''
+
+import os
+import sys
+import time
+import json
+import socket
+import struct
+import shutil
+import tempfile
+import threading
+
+from ntpd_test_util import (LOCAL_DIR, BENCH_DIR, check, result,
+                            load_ops_ntpd, TestIdl)
+
+
+def test_policy(ops_ntpd):
+    ops_ntpd.idl = TestIdl({})
+    check(ops_ntpd.ops_ntpd_get_server_policy() is None, "client only")
+    ops_ntpd.idl = TestIdl({"server_enable": "true"})
+    policy = ops_ntpd.ops_ntpd_get_server_policy()
+    check(policy == {"allow": [], "average": 3, "minimum": 1},
+          "default policy %s" % (policy))
+    ops_ntpd.idl = TestIdl({"server_enable": "true",
+                            "server_allow": "10.1.0.0/16, fd00::/8,bad/8",
+                            "server_rate_average": "5",
+                            "server_rate_minimum": "40"})
+    policy = ops_ntpd.ops_ntpd_get_server_policy()
+    check(policy == {"allow": ["10.1.0.0/16", "fd00::/8"], "average": 5,
+                     "minimum": 16}, "policy %s" % (policy))
+
+
+def test_conf(ops_ntpd_conf):
+    parse = ops_ntpd_conf.ops_ntpd_conf_parse_network
+    check(parse("10.1.2.3/16") == (socket.AF_INET, "10.1.0.0",
+                                   "255.255.0.0"), "IPv4 network")
+    check(parse("fd00:1::/32") == (socket.AF_INET6, "fd00:1::",
+                                   "ffff:ffff::"), "IPv6 network")
+    for network in ["10.0.0.0/33", "foo/8", "10.0.0.1", "fd00::/129"]:
+        check(parse(network) is None, "invalid network %s" % (network))
+
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_conf(65535, [], [])
+    check("restrict" not in conf and "discard" not in conf,
+          "client only ntp.conf %s" % (conf))
+
+    policy = {"allow": ["10.1.0.0/16", "fd00::/8"], "average": 3,
+              "minimum": 1}
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_conf(
+        65535, [], [], server_policy=policy).split("\n")
+    flags = "kod limited nomodify notrap nopeer noquery"
+    for line in ["discard average 3 minimum 1",
+                 "restrict default %s noserve" % (flags),
+                 "restrict -6 default %s noserve" % (flags),
+                 "restrict source nomodify notrap noquery",
+                 "restrict 127.0.0.1",
+                 "restrict -6 ::1",
+                 "restrict 10.1.0.0 mask 255.255.0.0 %s" % (flags),
+                 "restrict -6 fd00:: mask ff00:: %s" % (flags)]:
+        check(line in conf, "'%s' not in ntp.conf %s" % (line, conf))
+
+    # Every client is served without an allowed network
+    policy["allow"] = []
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_conf(
+        65535, [], [], server_policy=policy).split("\n")
+    check("restrict default %s" % (flags) in conf, "ntp.conf %s" % (conf))
+
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_chrony_conf(
+        [], "/etc/ntp/ops_ntp.keys", "/etc/ntp/chronyd.sock",
+        "/etc/ntp/ntpd.pid", server_policy=policy).split("\n")
+    check("allow" in conf and "ratelimit interval 3 burst 8" in conf,
+          "chrony.conf %s" % (conf))
+    # chronyd refuses an interval above 12
+    policy["average"] = 16
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_chrony_conf(
+        [], "/etc/ntp/ops_ntp.keys", "/etc/ntp/chronyd.sock",
+        "/etc/ntp/ntpd.pid", server_policy=policy).split("\n")
+    check("ratelimit interval 12 burst 8" in conf,
+          "chrony.conf %s" % (conf))
+    policy["allow"] = ["10.1.0.0/16"]
+    conf = ops_ntpd_conf.ops_ntpd_conf_render_chrony_conf(
+        [], "/etc/ntp/ops_ntp.keys", "/etc/ntp/chronyd.sock",
+        "/etc/ntp/ntpd.pid", server_policy=policy).split("\n")
+    check("allow 10.1.0.0/16" in conf and "allow" not in conf,
+          "chrony.conf %s" % (conf))
+
+
+def test_daemon_pid(pid_file, old_pid=None):
+    deadline = time.time() + 5
+    while time.time() < deadline:
+        try:
+            with open(pid_file, "r") as f:
+                pid = int(f.read())
+            if pid != old_pid:
+                return pid
+        except (IOError, ValueError):
+            pass
+        time.sleep(0.05)
+    return None
+
+
+def test_restart(ops_ntpd, workdir):
+    bindir = os.path.join(workdir, "bin")
+    os.mkdir(bindir)
+    for name, stub in [("ntpq", os.path.join(BENCH_DIR, "stub_ntpq.py")),
+                       ("ntpdc", os.path.join(BENCH_DIR, "stub_ntpq.py")),
+                       ("ntpd", os.path.join(LOCAL_DIR, "stub_ntpd.py"))]:
+        os.symlink(stub, os.path.join(bindir, name))
+    os.environ["PATH"] = bindir + os.pathsep + os.environ["PATH"]
+
+    ops_ntpd.ops_ntpd_setup_ntpq_integration(workdir)
+    instance = ops_ntpd.ntpd_instances["vrf_default"]
+    ops_ntpd.ops_ntpd_setup_instance_files(instance, workdir + "/")
+    ops_ntpd.ops_ntpd_setup_ntpd_default_config_file(workdir)
+    ops_ntpd.ops_ntpd_setup_ntpd_default_keys_file(workdir)
+    ops_ntpd.ops_ntpd_start_ntpd(None)
+    pid = test_daemon_pid(instance.pid_file)
+    check(pid is not None, "ntpd not started")
+
+    ops_ntpd.ntpd_backend.server_policy = {"allow": ["10.1.0.0/16"],
+                                           "average": 3, "minimum": 1}
+    keys_file_content = ops_ntpd.ops_ntpd_get_ntpd_default_keys_file_content()
+    ops_ntpd.ops_ntpd_sync_updates_to_vrf_instances(
+        {}, ops_ntpd.ntpd_backend.server_policy_configs(), keys_file_content)
+    new_pid = test_daemon_pid(instance.pid_file, pid)
+    check(new_pid is not None and new_pid == instance.supervisor.pid(),
+          "ntpd not restarted")
+    with open(instance.conf_file, "r") as f:
+        conf = f.read().split("\n")
+    check("discard average 3 minimum 1" in conf, "ntp.conf %s" % (conf))
+    with open(instance.pid_file + ".info", "r") as f:
+        check("-I" not in json.load(f)["argv"], "listening interface")
+
+
+def test_stub_server(sock, stop):
+    '''
+    Answers client requests, with a RATE KoD when the client sent its
+    previous request less than 0.5 s before
+    '''
+    last = {}
+    while not stop.is_set():
+        try:
+            data, peer = sock.recvfrom(1024)
+        except socket.timeout:
+            continue
+        now = time.time()
+        fields = struct.unpack("!BBbbII4sQQQQ", data[:48])
+        if now - last.get(peer[0], 0) < 0.5:
+            response = (0x24, 0, 0, 0, 0, 0, "RATE", 0, fields[10], 0, 0)
+        else:
+            response = (0x24, 2, 0, 0, 0, 0, "GPS\0", 0, fields[10], 0, 0)
+        last[peer[0]] = now
+        sock.sendto(struct.pack("!BBbbII4sQQQQ", *response), peer)
+
+
+def test_load_generator():
+    import bench_ntp_clients
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", 0))
+    sock.settimeout(0.1)
+    stop = threading.Event()
+    server = threading.Thread(target=test_stub_server, args=(sock, stop))
+    server.start()
+    try:
+        results = bench_ntp_clients.bench_run(
+            sock.getsockname(),
+            [("clients", bench_ntp_clients.bench_sources("127.0.1.1", 0, 3),
+              1.0),
+             ("flooders",
+              bench_ntp_clients.bench_sources("127.0.1.1", 3, 1), 50.0)],
+            2.0, 0.5)
+    finally:
+        stop.set()
+        server.join()
+        sock.close()
+    clients = results["clients"]
+    check(clients["sent"] >= 6 and clients["answered"] == clients["sent"]
+          and clients["lost"] == 0 and clients["kod"] == {},
+          "well behaved clients %s" % (clients))
+    check(clients["latency_p50_ms"] is not None, "latency %s" % (clients))
+    flooders = results["flooders"]
+    check(flooders["sent"] >= 50 and
+          flooders["kod"].get("RATE", 0) > flooders["answered"],
+          "flooders %s" % (flooders))
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_conf
+    ops_ntpd.time.sleep = lambda seconds: None
+
+    test_policy(ops_ntpd)
+    test_conf(ops_ntpd_conf)
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-server-mode-")
+    try:
+        test_restart(ops_ntpd, workdir)
+    finally:
+        ops_ntpd.ops_ntpd_stop_ntpd_instances()
+        shutil.rmtree(workdir, ignore_errors=True)
+    test_load_generator()
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
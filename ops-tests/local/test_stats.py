@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd association statistics.
+ - Feeds the statistics with the ntpq 'when', 'poll' and 'reach' values
+   of an association polled every 64 s and refreshed more often, and
+   checks the samples taken and the polls counted as lost: none while
+   every poll is answered, one per poll dropped, also when several polls
+   pass between two refreshes, and all of them while the peer is
+   unreachable.
+
+ Usage:
+   ./test_stats.py
+'''
+
+import sys
+
+from ntpd_test_util import check, result, setup_platform
+
+POLL = 64
+# Status refreshes per poll
+REFRESHES = 4
+
+
+class TestPeer(object):
+    '''
+    The ntpq view of an association, polled every POLL seconds
+    '''
+
+    def __init__(self, ops_ntpd_stats, address):
+        self.stats = ops_ntpd_stats
+        self.address = address
+        self.reach = 0
+        self.since_reply = None
+
+    def refresh(self):
+        when = "-" if self.since_reply is None else str(self.since_reply)
+        return self.stats.ops_ntpd_stats_update(
+            self.address, when, str(POLL), "%o" % (self.reach), "0.125")
+
+    def poll(self, answered, refresh=True):
+        '''
+        Polls the peer, then lets the time pass until the next poll, with
+        REFRESHES status refreshes or none
+        '''
+        self.reach = ((self.reach << 1) | int(answered)) & 0xff
+        if answered:
+            self.since_reply = 0
+        status = None
+        for index in range(REFRESHES):
+            if refresh:
+                status = self.refresh()
+            if self.since_reply is not None:
+                self.since_reply += POLL / REFRESHES
+        return status
+
+
+def test_reach_loss(ops_ntpd_stats):
+    peer = TestPeer(ops_ntpd_stats, ("vrf_default", "10.0.0.1"))
+    for index in range(20):
+        status = peer.poll(True)
+    check(status["reach_loss_count"] == "0" and
+          status["stats_samples"] == "20", "no loss %s" % (status))
+
+    # One poll dropped, when keeps growing until the next reply
+    peer.poll(False)
+    status = peer.poll(True)
+    check(status["reach_loss_count"] == "1" and
+          status["stats_samples"] == "21", "dropped poll %s" % (status))
+
+    # Several polls between two refreshes, the middle one dropped
+    peer.poll(True, refresh=False)
+    peer.poll(False, refresh=False)
+    status = peer.poll(True)
+    check(status["reach_loss_count"] == "2", "polls between refreshes %s" %
+          (status))
+
+    # Unreachable: the register empties, then stays at 0
+    for index in range(12):
+        status = peer.poll(False)
+    check(status["reach_loss_count"] == "14", "unreachable %s" % (status))
+    status = peer.poll(True)
+    check(status["reach_loss_count"] == "14" and
+          status["stats_samples"] == "23", "reachable again %s" % (status))
+
+
+def main():
+    setup_platform()
+    import ops_ntpd_stats
+
+    test_reach_loss(ops_ntpd_stats)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
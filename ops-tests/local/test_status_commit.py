@@ -0,0 +1,180 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd status commits on the IDL of the daemon.
+ - Checks that a status commit never blocks, that the updates given
+   while a transaction is in flight are merged into the next one, and
+   that a failed update releases the IDL.
+ - Checks that the status commits do not count as configuration
+   changes.
+
+ Usage:
+   ./test_status_commit.py
+'''
+
+import sys
+
+from ntpd_test_util import (check, result, load_ops_ntpd, TestIdl,
+                            association_row)
+
+
+class TestCommitIdl(TestIdl):
+
+    def __init__(self):
+        self.association = association_row(
+            "10.0.0.1", association_attributes={"prefer": "true"},
+            association_status={})
+        TestIdl.__init__(self, {"authentication_enable": "false"},
+                         associations=[self.association], ntp_status={},
+                         ntp_statistics={})
+        self.txn = None
+        self.runs = 0
+
+    def run(self):
+        self.runs += 1
+
+
+def test_transaction(ovs_idl, idl):
+    '''
+    Returns a transaction class for 'idl', committed once the test
+    completes it
+    '''
+
+    class TestTransaction(object):
+
+        SUCCESS = ovs_idl.Transaction.SUCCESS
+        UNCHANGED = ovs_idl.Transaction.UNCHANGED
+        INCOMPLETE = ovs_idl.Transaction.INCOMPLETE
+        ERROR = ovs_idl.Transaction.ERROR
+        started = []
+
+        def __init__(self, txn_idl):
+            assert txn_idl.txn is None, "transaction already in flight"
+            txn_idl.txn = self
+            self.idl = txn_idl
+            self.status = None
+            TestTransaction.started.append(self)
+
+        def commit(self):
+            if self.status is None:
+                return TestTransaction.INCOMPLETE
+            self.idl.txn = None
+            return self.status
+
+        def commit_block(self):
+            self.status = TestTransaction.SUCCESS
+            return self.commit()
+
+        def abort(self):
+            self.idl.txn = None
+
+    return TestTransaction
+
+
+def test_async_commit(ops_ntpd_sync_to_ovsdb, ops_ntpd_perf):
+    idl = TestCommitIdl()
+    ovs_idl = ops_ntpd_sync_to_ovsdb.ovs.db.idl
+    transaction = ovs_idl.Transaction
+    ovs_idl.Transaction = test_transaction(ovs_idl, idl)
+    try:
+        perf = ops_ntpd_perf.NTPDPerf()
+        mgr = ops_ntpd_sync_to_ovsdb.NTPTransactionMgr(idl, perf)
+        started = ovs_idl.Transaction.started
+
+        mgr.queue_info({"associations_info": {"vrf_default": {
+            "10.0.0.1": {"stratum": "2"}}}, "statistics": {"a": "1"},
+            "status": {"uptime": "10"}})
+        check(len(started) == 1 and mgr.txn is started[0] and
+              idl.association.association_status == {"stratum": "2"} and
+              idl.system.ntp_status == {"uptime": "10"},
+              "first commit %s" % (started))
+
+        # In flight: merged, nothing started
+        mgr.queue_info({"status": {"uptime": "12"}})
+        mgr.queue_info({"status": {"sync_state": "synchronized"},
+                        "statistics": {"a": "2"}})
+        mgr.run()
+        check(len(started) == 1 and mgr.pending ==
+              {"status": {"uptime": "12", "sync_state": "synchronized"},
+               "statistics": {"a": "2"}}, "pending %s" % (mgr.pending))
+
+        started[0].status = ovs_idl.Transaction.SUCCESS
+        mgr.run()
+        check(len(started) == 2 and mgr.pending is None and
+              idl.system.ntp_status == {"uptime": "12",
+                                        "sync_state": "synchronized"} and
+              idl.system.ntp_statistics == {"a": "2"},
+              "merged commit %s" % (idl.system.ntp_status))
+        check(perf.phases[ops_ntpd_perf.PERF_STATUS_UPDATE].count == 2 and
+              perf.phases[ops_ntpd_perf.PERF_STATUS_COMMIT].count == 1,
+              "perf %s" % (perf.phases.keys()))
+
+        # The last update is committed before the IDL is closed
+        mgr.queue_info({"status": {"uptime": "14"}})
+        started[1].status = ovs_idl.Transaction.SUCCESS
+        runs = idl.runs
+        mgr.flush(0.5)
+        check(mgr.txn is not None and idl.runs > runs and
+              idl.system.ntp_status["uptime"] == "14",
+              "flush %s" % (idl.system.ntp_status))
+        started[2].status = ovs_idl.Transaction.ERROR
+        mgr.flush(0.5)
+        check(mgr.txn is None and mgr.pending is None, "flushed")
+
+        # A failed update must not leave the IDL with a transaction
+        try:
+            mgr.queue_info({"associations_info": {"vrf_default": None}})
+            check(False, "invalid update committed")
+        except AttributeError:
+            pass
+        check(idl.txn is None and mgr.txn is None and mgr.pending is None,
+              "failed update")
+    finally:
+        ovs_idl.Transaction = transaction
+
+
+def test_config_digest(ops_ntpd):
+    idl = TestCommitIdl()
+    ops_ntpd.idl = idl
+    digest = ops_ntpd.ops_ntpd_get_config_digest()
+    idl.association.association_status = {"stratum": "3"}
+    idl.system.ntp_status = {"uptime": "20"}
+    idl.system.ntp_statistics = {"a": "3"}
+    check(ops_ntpd.ops_ntpd_get_config_digest() == digest,
+          "status changed the config digest")
+    idl.association.association_attributes["version"] = "4"
+    check(ops_ntpd.ops_ntpd_get_config_digest() != digest,
+          "association change")
+    digest = ops_ntpd.ops_ntpd_get_config_digest()
+    idl.system.ntp_config["authentication_enable"] = "true"
+    check(ops_ntpd.ops_ntpd_get_config_digest() != digest,
+          "ntp_config change")
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_perf
+    import ops_ntpd_sync_to_ovsdb
+
+    test_async_commit(ops_ntpd_sync_to_ovsdb, ops_ntpd_perf)
+    test_config_digest(ops_ntpd)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,138 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd kernel clock state.
+ - adjtimex() is replaced by a stub which fills a struct timex laid out
+   field by field from <sys/timex.h>, so a wrong field of the ctypes
+   structure shows up as a wrong value.
+ - Checks the kernel_* keys: the offset in microseconds, also from
+   nanoseconds with STA_NANO, the frequency in ppm, the errors, the sync
+   status with STA_UNSYNC, the clock state and a failing call.
+ - Also reads the real kernel clock state, which needs no privilege.
+
+ Usage:
+   ./test_timex.py
+'''
+
+import sys
+import errno
+import struct
+import ctypes
+
+from ntpd_test_util import check, result, setup_platform
+
+# struct timex from <sys/timex.h>, in native alignment: modes, offset,
+# freq, maxerror, esterror, status, constant, precision, tolerance,
+# time (tv_sec, tv_usec), tick, ppsfreq, jitter, shift, stabil, jitcnt,
+# calcnt, errcnt, stbcnt, tai and 11 reserved ints
+TIMEX_FORMAT = "@Illllillllllllillllli11i"
+
+STA_PLL = 0x0001
+
+
+class TestLibc(object):
+    '''
+    libc with an adjtimex() returning 'state' and the 'fields' of
+    struct timex
+    '''
+
+    def __init__(self, state, **fields):
+        self.state = state
+        self.fields = fields
+
+    def adjtimex(self, tx):
+        values = dict(modes=0, offset=0, freq=0, maxerror=0, esterror=0,
+                      status=0, tai=0)
+        values.update(self.fields)
+        data = struct.pack(
+            TIMEX_FORMAT, values["modes"], values["offset"],
+            values["freq"], values["maxerror"], values["esterror"],
+            values["status"], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            values["tai"], *([0] * 11))
+        # Never write past a ctypes structure of the wrong size
+        ctypes.memmove(ctypes.addressof(tx._obj), data,
+                       min(len(data), ctypes.sizeof(tx._obj)))
+        if self.state < 0:
+            ctypes.set_errno(errno.EPERM)
+        return self.state
+
+
+def test_layout(ops_ntpd_timex):
+    check(ctypes.sizeof(ops_ntpd_timex.Timex) ==
+          struct.calcsize(TIMEX_FORMAT), "struct timex size %d, expected %d"
+          % (ctypes.sizeof(ops_ntpd_timex.Timex),
+             struct.calcsize(TIMEX_FORMAT)))
+
+
+def test_read(ops_ntpd_timex):
+    ops_ntpd_timex.libc = TestLibc(
+        0, offset=1500000, freq=int(12.5 * 65536), maxerror=16000,
+        esterror=20, status=STA_PLL | ops_ntpd_timex.STA_NANO, tai=37)
+    status = ops_ntpd_timex.ops_ntpd_timex_read()
+    check(status == {"kernel_offset": "1500.000",
+                     "kernel_frequency": "12.500",
+                     "kernel_maxerror": "16000",
+                     "kernel_esterror": "20",
+                     "kernel_sync_status": "synchronized",
+                     "kernel_clock_state": "ok"},
+          "nanosecond status %s" % (status))
+    check(ops_ntpd_timex.ops_ntpd_timex_tai_offset() == 37, "tai offset")
+
+    ops_ntpd_timex.libc = TestLibc(
+        1, offset=-250, freq=-int(3.25 * 65536), maxerror=500,
+        esterror=1, status=ops_ntpd_timex.STA_UNSYNC)
+    status = ops_ntpd_timex.ops_ntpd_timex_read()
+    check(status == {"kernel_offset": "-250.000",
+                     "kernel_frequency": "-3.250",
+                     "kernel_maxerror": "500",
+                     "kernel_esterror": "1",
+                     "kernel_sync_status": "unsynchronized",
+                     "kernel_clock_state": "insert_leap"},
+          "microsecond status %s" % (status))
+
+    ops_ntpd_timex.libc = TestLibc(-1)
+    try:
+        ops_ntpd_timex.ops_ntpd_timex_read()
+        check(False, "failing adjtimex not reported")
+    except OSError as e:
+        check(e.errno == errno.EPERM, "errno %s" % (e.errno))
+
+
+def test_kernel(ops_ntpd_timex, libc):
+    ops_ntpd_timex.libc = libc
+    status = ops_ntpd_timex.ops_ntpd_timex_read()
+    check(status["kernel_sync_status"] in ["synchronized",
+                                           "unsynchronized"] and
+          status["kernel_clock_state"] in
+          ops_ntpd_timex.translate_clock_state.values() and
+          int(status["kernel_maxerror"]) >= 0, "kernel status %s" % (status))
+
+
+def main():
+    setup_platform()
+    import ops_ntpd_timex
+    libc = ops_ntpd_timex.libc
+
+    test_layout(ops_ntpd_timex)
+    test_read(ops_ntpd_timex)
+    test_kernel(ops_ntpd_timex, libc)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,199 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the per-VRF NTPD instances of ops-ntpd.
+ - Creates a network namespace for a test VRF, then drives the ops-ntpd
+   reconciliation with associations in the default and in the test VRF.
+ - ntpd and ntpq are replaced by stubs which report the namespace they
+   run in, to check that every instance runs, and is queried, in the
+   namespace of its VRF, and that the status lands in the right VRF.
+ - Checks that the VRF name is quoted in the shell commands of an
+   instance.
+ - Needs root for 'ip netns', prints SKIP for the instances otherwise.
+
+ Usage:
+   sudo ./test_vrf_instances.py
+'''
+
+import os
+import sys
+import json
+import time
+import shutil
+import tempfile
+import subprocess
+
+from ntpd_test_util import LOCAL_DIR, BENCH_DIR, check, result, load_ops_ntpd
+
+TEST_VRF = "ops-ntpd-test-red"
+TEST_VRF_BASE = 20
+DEFAULT_BASE = 10
+
+
+def test_setup(workdir):
+    bindir = os.path.join(workdir, "bin")
+    os.mkdir(bindir)
+    os.symlink(os.path.join(BENCH_DIR, "stub_ntpq.py"),
+               os.path.join(bindir, "ntpq"))
+    os.symlink(os.path.join(BENCH_DIR, "stub_ntpq.py"),
+               os.path.join(bindir, "ntpdc"))
+    os.symlink(os.path.join(LOCAL_DIR, "stub_ntpd.py"),
+               os.path.join(bindir, "ntpd"))
+    os.environ["PATH"] = bindir + os.pathsep + os.environ["PATH"]
+    os.environ["NTPQ_STUB_ASSOCIATIONS"] = "1"
+    os.environ["NTPQ_STUB_NETNS_BASE"] = "%s=%d" % (TEST_VRF, TEST_VRF_BASE)
+    subprocess.check_call(["ip", "netns", "add", TEST_VRF])
+
+
+def test_teardown(workdir):
+    subprocess.call(["ip", "netns", "del", TEST_VRF])
+    shutil.rmtree(workdir, ignore_errors=True)
+
+
+def test_configure(ops_ntpd, associations):
+    '''
+    Runs the reconciliation for a list of (vrf, address, prefer)
+    '''
+    update_map = {}
+    for (vrf, address, prefer) in associations:
+        ops_ntpd.ops_ntpd_setup_ntp_config_map(
+            update_map, vrf, address, 0, ops_ntpd.DEFAULT_NTP_KEY_ID,
+            ops_ntpd.DEFAULT_NTP_REF_CLOCK_ID, prefer,
+            ops_ntpd.DEFAULT_NTP_VERSION)
+    server_configs = ops_ntpd.ops_ntpd_check_updates_with_ntp_associations(
+        update_map)
+    keys_file_content = ops_ntpd.ops_ntpd_get_ntpd_default_keys_file_content()
+    ops_ntpd.ops_ntpd_sync_updates_to_vrf_instances(server_configs, [],
+                                                    keys_file_content)
+
+
+def test_wait_file(filename):
+    for i in range(50):
+        if os.path.exists(filename):
+            return True
+        time.sleep(0.1)
+    return False
+
+
+def test_process_alive(pid):
+    # The daemon is not our child, it may linger as a zombie
+    try:
+        with open("/proc/%d/stat" % (pid), "r") as f:
+            return f.read().split(")")[-1].split()[0] != "Z"
+    except IOError:
+        return False
+
+
+def test_command(ops_ntpd_vrf):
+    instance = ops_ntpd_vrf.NTPDInstance("red; touch /tmp/red")
+    check(instance.command("ntpq -p") ==
+          "ip netns exec 'red; touch /tmp/red' ntpq -p",
+          "quoted namespace %s" % (instance.command("ntpq -p")))
+    check(ops_ntpd_vrf.NTPDInstance("vrf_default").command("ntpq -p") ==
+          "ntpq -p", "default namespace")
+
+
+def test_vrf_instances(ops_ntpd, workdir):
+    instances = ops_ntpd.ntpd_instances
+
+    # A server in the test VRF starts an instance in its namespace
+    test_configure(ops_ntpd, [("vrf_default", "10.0.0.1", "true"),
+                              (TEST_VRF, "20.0.0.1", "false")])
+    check(TEST_VRF in instances, "no instance for %s" % (TEST_VRF))
+    instance = instances[TEST_VRF]
+    # ntpd runs in the foreground, wait for it to come up
+    check(test_wait_file(instance.pid_file), "ntpd of %s not started" %
+          (TEST_VRF))
+    with open(instance.pid_file + ".info", "r") as f:
+        info = json.load(f)
+    check(info["netns"] == TEST_VRF,
+          "ntpd ran in namespace '%s'" % (info["netns"]))
+    with open(instance.conf_file, "r") as f:
+        conf = f.read()
+    check("server 20.0.0.1 version 3\n" in conf, "server missing:\n" + conf)
+    check("server 10.0.0.1" not in conf, "default VRF server leaked")
+    check("disable ntp\n" in conf, "two instances discipline the clock")
+    check(instances["vrf_default"].discipline, "default VRF not disciplining")
+
+    # Status is collected from every namespace and kept per VRF
+    ntpd_updates = {"associations_info": {}, "statistics": {}, "status": {}}
+    ops_ntpd.ops_ntpd_get_ntpd_associations_info(ntpd_updates)
+    ops_ntpd.ops_ntpd_get_ntpd_global_status(ntpd_updates)
+    assoc_info = ntpd_updates["associations_info"]
+    check(assoc_info.get("vrf_default", {}).keys() == ["10.0.0.1"],
+          "default VRF status %s" % (assoc_info.get("vrf_default")))
+    check(assoc_info.get(TEST_VRF, {}).keys() == ["20.0.0.1"],
+          "test VRF status %s" % (assoc_info.get(TEST_VRF)))
+    check(ntpd_updates["status"].get("sync_peer") == "10.0.0.1",
+          "sync peer %s" % (ntpd_updates["status"].get("sync_peer")))
+
+    # Without default VRF servers the test VRF takes the discipline over
+    test_configure(ops_ntpd, [(TEST_VRF, "20.0.0.1", "false")])
+    check(instance.discipline, "test VRF not disciplining")
+    check(not instances["vrf_default"].discipline,
+          "default VRF still disciplining")
+    with open(instance.conf_file, "r") as f:
+        check("disable ntp\n" not in f.read(), "test VRF conf not updated")
+
+    # An unchanged configuration does not touch ntpd
+    digest = instance.conf_digest
+    test_configure(ops_ntpd, [(TEST_VRF, "20.0.0.1", "false")])
+    check(instance.conf_digest == digest, "unchanged config reloaded")
+
+    # Removing the last server of the VRF stops its instance
+    with open(instance.pid_file, "r") as f:
+        pid = int(f.read())
+    test_configure(ops_ntpd, [])
+    check(TEST_VRF not in instances, "instance left for %s" % (TEST_VRF))
+    for i in range(50):
+        if not test_process_alive(pid):
+            break
+        time.sleep(0.1)
+    check(not test_process_alive(pid), "ntpd of %s still running" % TEST_VRF)
+    check(instances["vrf_default"].discipline, "default VRF not disciplining")
+
+
+def main():
+    ops_ntpd = load_ops_ntpd()
+    import ops_ntpd_vrf
+    ops_ntpd.time.sleep = lambda seconds: None
+
+    test_command(ops_ntpd_vrf)
+    if os.geteuid() != 0:
+        print("SKIP: needs root for ip netns")
+        return result()
+
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-vrf-")
+    ops_ntpd_vrf.NTP_VRF_DIR = os.path.join(workdir, "vrf") + "/"
+    test_setup(workdir)
+    try:
+        ops_ntpd.ops_ntpd_setup_ntpq_integration(workdir)
+        default = ops_ntpd.ntpd_instances["vrf_default"]
+        default.conf_file = os.path.join(workdir, "ops_ntp.conf")
+        default.keys_file = os.path.join(workdir, "ops_ntp.keys")
+        test_vrf_instances(ops_ntpd, workdir)
+    finally:
+        for instance in ops_ntpd.ntpd_instances.values():
+            if instance.vrf_name != "vrf_default":
+                ops_ntpd.ops_ntpd_stop_vrf_instance(instance.vrf_name)
+        test_teardown(workdir)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
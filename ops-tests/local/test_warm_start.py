@@ -0,0 +1,157 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ Local test of the ops-ntpd warm start state.
+ - Checks the driftfile and the 'iburst' of the last known good server
+   in the rendered ntp.conf, chrony.conf and ':config' lines.
+ - Drives the stable offset tracking with simulated samples and times,
+   and checks the time to stable offset and the saved state, across a
+   simulated restart.
+
+ Usage:
+   ./test_warm_start.py
+'''
+
+import os
+import sys
+import shutil
+import tempfile
+
+from ntpd_test_util import check, result, setup_platform
+
+GOOD_SERVER = "10.0.0.1"
+OTHER_SERVER = "10.0.0.2"
+
+
+def test_conf(ops_ntpd_backend, ops_ntpd_vrf):
+    associations = [(GOOD_SERVER, "vrf_default", "0", ".LOCL.", "false", "3"),
+                    (OTHER_SERVER, "vrf_default", "0", ".LOCL.", "false",
+                     "3")]
+    instance = ops_ntpd_vrf.NTPDInstance("vrf_default")
+    instance.conf_file = "/etc/ntp/ops_ntp.conf"
+    instance.keys_file = "/etc/ntp/ops_ntp.keys"
+    instance.pid_file = "/etc/ntp/ntpd.pid"
+    instance.drift_file = "/var/lib/ntp/vrf_default.drift"
+
+    backend = ops_ntpd_backend.NTPDClassicBackend(lambda command: None)
+    conf = backend.render_conf(instance, 65535, associations, [], True)
+    conf = conf.split("\n")
+    check("driftfile /var/lib/ntp/vrf_default.drift" in conf,
+          "ntp.conf %s" % (conf))
+    check("server %s version 3" % (GOOD_SERVER) in conf,
+          "cold start ntp.conf %s" % (conf))
+
+    backend.warm_server = ("vrf_default", GOOD_SERVER)
+    conf = backend.render_conf(instance, 65535, associations, [], True)
+    conf = conf.split("\n")
+    check("server %s version 3 iburst" % (GOOD_SERVER) in conf and
+          "server %s version 3" % (OTHER_SERVER) in conf,
+          "warm start ntp.conf %s" % (conf))
+    configs = backend.server_add_configs(associations[0])
+    check(configs == [":config server %s version 3 iburst" % (GOOD_SERVER)],
+          "warm start configs %s" % (configs))
+    configs = backend.server_add_configs(associations[1])
+    check(configs == [":config server %s version 3" % (OTHER_SERVER)],
+          "configs %s" % (configs))
+    # The last known good server belongs to one VRF
+    backend.warm_server = ("red", GOOD_SERVER)
+    configs = backend.server_add_configs(associations[0])
+    check(configs == [":config server %s version 3" % (GOOD_SERVER)],
+          "other VRF configs %s" % (configs))
+
+    backend = ops_ntpd_backend.NTPDChronyBackend(lambda command: None)
+    conf = backend.render_conf(instance, 65535, associations, [], True)
+    check("driftfile /var/lib/ntp/vrf_default.drift" in conf.split("\n"),
+          "chrony.conf %s" % (conf))
+
+
+def test_stable_offset(ops_ntpd_state, workdir):
+    state_file = os.path.join(workdir, "state", "ops_ntp.state")
+    warm_start = ops_ntpd_state.NTPDWarmStart(state_file)
+    warm_start.load()
+    check(os.path.isdir(os.path.dirname(state_file)), "state dir not created")
+    check(warm_start.server() is None, "cold start %s" % (warm_start.state))
+
+    hold = ops_ntpd_state.STABLE_OFFSET_HOLD
+    started = 1000.0
+    # Unsynchronized, then converging, then within the band
+    samples = [(10, None, "-"), (20, GOOD_SERVER, "35.2"),
+               (100, GOOD_SERVER, "0.9"), (102, GOOD_SERVER, "1.4"),
+               (120, GOOD_SERVER, "-0.4"), (200, GOOD_SERVER, "0.2")]
+    for (t, peer, offset) in samples:
+        warm_start.update(started + t, started, "vrf_default", peer, offset)
+    check(warm_start.time_to_stable is None,
+          "stable too early %s" % (warm_start.time_to_stable))
+    check(not os.path.exists(state_file), "state saved before stable")
+
+    warm_start.update(started + 120 + hold, started, "vrf_default",
+                      GOOD_SERVER, "0.3")
+    check(warm_start.time_to_stable == 120,
+          "time to stable %s" % (warm_start.time_to_stable))
+    saved = ops_ntpd_state.ops_ntpd_state_load(state_file)
+    check(saved.get("server") == GOOD_SERVER and
+          saved.get("vrf") == "vrf_default" and "offset" not in saved,
+          "saved state %s" % (saved))
+
+    # Leaving the band does not change the time to stable offset
+    warm_start.update(started + 130 + hold, started, "vrf_default",
+                      GOOD_SERVER, "5.0")
+    check(warm_start.time_to_stable == 120,
+          "time to stable %s" % (warm_start.time_to_stable))
+
+    # A restarted daemon converges again
+    restarted = started + 1000
+    warm_start.update(restarted + 2, restarted, "vrf_default",
+                      GOOD_SERVER, "0.1")
+    check(warm_start.time_to_stable is None, "not reset on restart")
+    warm_start.update(restarted + 2 + hold, restarted, "vrf_default",
+                      GOOD_SERVER, "0.1")
+    check(warm_start.time_to_stable == 2,
+          "time to stable after restart %s" % (warm_start.time_to_stable))
+
+    # The next run starts warm
+    warm_start = ops_ntpd_state.NTPDWarmStart(state_file)
+    warm_start.load()
+    check(warm_start.server() == ("vrf_default", GOOD_SERVER),
+          "warm start server %s" % (str(warm_start.server())))
+
+    # A corrupted state is ignored
+    with open(state_file, "w") as f:
+        f.write("{\"server\": ")
+    warm_start.load()
+    check(warm_start.server() is None, "corrupted state %s" %
+          (warm_start.state))
+
+
+def main():
+    setup_platform()
+    import ops_ntpd_vrf
+    import ops_ntpd_state
+    import ops_ntpd_backend
+
+    test_conf(ops_ntpd_backend, ops_ntpd_vrf)
+    workdir = tempfile.mkdtemp(prefix="ops-ntpd-warm-start-")
+    try:
+        test_stable_offset(ops_ntpd_state, workdir)
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    return result()
+
+if __name__ == '__main__':
+    sys.exit(main())
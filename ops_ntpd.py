@@ -26,8 +26,8 @@ NOTES:
 
 import os
 import sys
+import glob
 import time
-import signal
 import copy
 import hashlib
 import argparse
@@ -39,8 +39,76 @@ import ovs.daemon
 import ovs.db.idl
 import ovs.unixctl
 import ovs.unixctl.server
-from ops_ntpd_sync_to_ovsdb import ops_ntpd_sync_mgr_run
-import multiprocessing
+from ops_ntpd_sync_to_ovsdb import NTPTransactionMgr
+from ops_ntpd_sync_to_ovsdb import ops_ntpd_sync_mgr_register_columns
+from ops_ntpd_stats import ops_ntpd_stats_update
+from ops_ntpd_stats import ops_ntpd_stats_prune
+from ops_ntpd_rtc import ops_ntpd_rtc_sync
+from ops_ntpd_rtc import ops_ntpd_rtc_configure
+from ops_ntpd_rtc import DEFAULT_RTC_SYNC_INTERVAL
+from ops_ntpd_rtc import DEFAULT_RTC_DRIFT_THRESHOLD
+from ops_ntpd_timex import ops_ntpd_timex_read
+from ops_ntpd_conf import ops_ntpd_conf_digest
+from ops_ntpd_conf import ops_ntpd_conf_write_atomic
+from ops_ntpd_conf import ops_ntpd_conf_refclock_driver
+from ops_ntpd_conf import ops_ntpd_conf_read_control_key
+from ops_ntpd_conf import ops_ntpd_conf_parse_network
+from ops_ntpd_conf import ops_ntpd_conf_parse_key
+from ops_ntpd_conf import CONTROL_KEY_LENGTH
+from ops_ntpd_conf import REFCLOCK_DRIVER_SHM
+from ops_ntpd_conf import NTS_KEY_ID
+from ops_ntpd_vrf import NTPDInstance
+from ops_ntpd_vrf import ops_ntpd_vrf_working_dir
+from ops_ntpd_vrf import ops_ntpd_vrf_select_discipline
+from ops_ntpd_vrf import DEFAULT_VRF_NAME
+from ops_ntpd_vrf import NTP_VRF_DIR
+from ops_ntpd_dns import NTPDResolver
+from ops_ntpd_dns import ops_ntpd_dns_is_address
+from ops_ntpd_supervisor import NTPDSupervisor
+from ops_ntpd_supervisor import ops_ntpd_supervisor_stop_stale
+from ops_ntpd_shm import NTPDShmFeeder
+from ops_ntpd_shm import NTP_REFCLOCK_ATTRIB_FEED
+from ops_ntpd_state import NTPDWarmStart
+from ops_ntpd_state import NTP_STATE_FILE
+from ops_ntpd_state import ops_ntpd_state_drift_file
+from ops_ntpd_state import ops_ntpd_state_load
+from ops_ntpd_backend import NTPD_BACKENDS
+from ops_ntpd_backend import DEFAULT_NTPD_BACKEND
+from ops_ntpd_backend import NTPQ_REMOTE
+from ops_ntpd_backend import NTPQ_REFID
+from ops_ntpd_backend import NTPQ_ST
+from ops_ntpd_backend import NTPQ_T
+from ops_ntpd_backend import NTPQ_WHEN
+from ops_ntpd_backend import NTPQ_POLL
+from ops_ntpd_backend import NTPQ_REACH
+from ops_ntpd_backend import NTPQ_DELAY
+from ops_ntpd_backend import NTPQ_OFFSET
+from ops_ntpd_backend import NTPQ_JITTER
+from ops_ntpd_backend import NTPQ_ROOT_DISPERSION
+from ops_ntpd_backend import NTPQ_REFERENCE_TIME
+from ops_ntpd_backend import NTPQ_PEER_STATUS_WORD
+from ops_ntpd_backend import NTPQ_ASSOCID
+from ops_ntpd_clients import NTPDClientTable
+from ops_ntpd_clients import CLIENTS_REFRESH_INTERVAL
+from ops_ntpd_clients import DEFAULT_TOP_CLIENTS
+from ops_ntpd_keys import NTPDKeyRotation
+from ops_ntpd_keys import DEFAULT_KEY_RETIRE_GRACE
+from ops_ntpd_nts import NTPDNTSTracker
+from ops_ntpd_perf import NTPDPerf
+from ops_ntpd_perf import PERF_ASSOCIATIONS_INFO
+from ops_ntpd_perf import PERF_GLOBAL_STATUS
+from ops_ntpd_perf import PERF_DAEMON_COMMAND
+from ops_ntpd_perf import PERF_RTC_SYNC
+from ops_ntpd_perf import PERF_CHECK_UPDATES
+from ops_ntpd_perf import PERF_SYNC_TO_NTPD
+from ops_ntpd_log import ops_ntpd_log_rotate
+from ops_ntpd_log import ops_ntpd_log_tail
+from ops_ntpd_log import ops_ntpd_log_redact_keys
+from ops_ntpd_log import DEFAULT_LOG_MAX_SIZE_KB
+from ops_ntpd_log import DEFAULT_LOG_ROTATE_COUNT
+from ops_ntpd_log import DEFAULT_DIAG_LOG_LINES
+from ops_ntpd_log import DIAG_CONF_MAX_BYTES
+from ops_ntpd_log import LOG_ROTATE_INTERVAL
 from ops_eventlog import event_log_init
 from ops_eventlog import log_event
 import ops_diagdump
@@ -56,7 +124,6 @@ vlog = ovs.vlog.Vlog("ops-ntpd")
 # Globals
 exiting = False
 seqno = 0
-ntpd_process = None
 ntpq_process = None
 ntpd_started = False
 ntpd_command = None
@@ -65,7 +132,6 @@ ntpq_info = None
 g_ntpa_map = {}
 g_ntpk_db = {}
 controlkey = 65535
-cmdline_str = ""
 auth_state = "false"
 default_assoc_info = {
     "remote_peer_address": "-",
@@ -102,8 +168,70 @@ translate_peer_type = {
     "B": "bcast_server",
     "M": "mcast_server"
 }
-transaction_queue = None
-sync_mgr_process = None
+# Commits the status on the IDL of the daemon, without blocking
+transaction_mgr = None
+# Digest of the configuration read from OVSDB, the status commits also
+# change the IDL
+config_digest = None
+last_kernel_status = None
+sync_summary_key = None
+sync_last_change = None
+config_first_change = None
+config_last_change = None
+# Debounce window and max latency of the config changes (seconds)
+config_debounce = None
+config_max_latency = None
+# NTPD instances, keyed by VRF name. The default VRF instance always
+# runs, the others only while their VRF has associations.
+ntpd_instances = {DEFAULT_VRF_NAME: NTPDInstance(DEFAULT_VRF_NAME)}
+# Server names are resolved off the main loop, NTPD only gets addresses
+dns_resolver = NTPDResolver()
+dns_seqno = 0
+# SHM reference clock feeders, keyed by SHM unit
+shm_feeders = {}
+# Time daemon driver, selected by System:ntp_config:backend. Control
+# commands go through ops_ntpd_run_command().
+ntpd_backend = NTPD_BACKENDS[DEFAULT_NTPD_BACKEND](
+    lambda command: ops_ntpd_run_command(command))
+# Driftfiles, last known good server and time to stable offset
+warm_start = NTPDWarmStart(NTP_STATE_FILE)
+# Digest of the configuration last saved for a hitless restart
+applied_state_digest = None
+# Top clients of the daemons in server mode, in memory only
+client_table = NTPDClientTable()
+# Staged key rotation: retiring keys and associations switching keys
+key_rotation = NTPDKeyRotation()
+rotation_seqno = 0
+# NTS-KE handshakes and cookie refreshes of the NTS associations
+nts_tracker = NTPDNTSTracker()
+# Latency histograms of the main loop phases
+perf_stats = NTPDPerf()
+
+# Main loop timing (seconds). The kernel clock state is published on
+# every iteration, the ntpq based status on every refresh interval.
+OPS_NTPD_LOOP_INTERVAL = 0.5
+OPS_NTPD_STATUS_REFRESH_INTERVAL = 2
+# Longest wait for the last status commit when ops-ntpd exits (seconds)
+OPS_NTPD_SHUTDOWN_COMMIT_TIMEOUT = 2
+
+# Configuration changes are coalesced until the config has been quiet for
+# the debounce window, or the max latency has passed since the first
+# pending change (milliseconds, overridable in System:ntp_config).
+DEFAULT_CONFIG_DEBOUNCE_MS = 500
+DEFAULT_CONFIG_MAX_LATENCY_MS = 5000
+
+# The daemons are left running when ops-ntpd exits, and adopted by its
+# next run, unless disabled in System:ntp_config
+DEFAULT_HITLESS_RESTART = "true"
+# Configuration last applied to the daemons, in the default working
+# directory, read back when they are adopted
+NTP_APPLIED_STATE_FILE = "ops_ntp.applied"
+
+# Server mode rate limit, log2 of the average and minimum intervals
+# (seconds) between the requests of a client
+DEFAULT_SERVER_RATE_AVERAGE = 3
+DEFAULT_SERVER_RATE_MINIMUM = 1
+MAX_SERVER_RATE_INTERVAL = 16
 
 # Defaults
 DEFAULT_NTP_KEY_ID = 0
@@ -116,6 +244,7 @@ DEFAULT_NTP_TRUST_ENABLE = False
 NTP_ASSOCIATION_TABLE = 'NTP_Association'
 NTP_KEY_TABLE = 'NTP_Key'
 SYSTEM_TABLE = 'System'
+VRF_TABLE = 'VRF'
 # Columns definitions
 SYSTEM_CUR_CFG = 'cur_cfg'
 SYSTEM_NTP_CONFIG = 'ntp_config'
@@ -126,60 +255,10 @@ NTP_ASSOCIATION_ATTR = 'association_attributes'
 NTP_KEY_ID = 'key_id'
 NTP_KEY_PASSWORD = 'key_password'
 NTP_KEY_TRUST_ENABLE = 'trust_enable'
-
-# String keys
-NTPQ_REMOTE = "remote"
-NTPQ_ASSOCID = "assid"
-NTPQ_REFID = "refid"
-NTPQ_ST = "st"
-NTPQ_T = "t"
-NTPQ_WHEN = "when"
-NTPQ_POLL = "poll"
-NTPQ_REACH = "reach"
-NTPQ_DELAY = "delay"
-NTPQ_OFFSET = "offset"
-NTPQ_JITTER = "jitter"
-
-NTPQ_REMOTE_PEER_ADDRESS = "remote_peer_address"
-NTPQ_REMOTE_PEER_REF_ID = "remote_peer_ref_id"
-NTPQ_ROOT_DISPERSION = "root_dispersion"
-NTPQ_STRATUM = "stratum"
-NTPQ_PEER_TYPE = "peer_type"
-NTPQ_LAST_POLLED = "last_polled"
-NTPQ_POLLING_INTERVAL = "polling_interval"
-NTPQ_REACHABILITY_REGISTER = "reachability_register"
-NTPQ_NETWORK_DELAY = "network_delay"
-NTPQ_TIME_OFFSET = "time_offset"
-NTPQ_JITTER = "jitter"
-NTPQ_REFERENCE_TIME = "reference_time"
-NTPQ_PEER_STATUS_WORD = "peer_status_word"
-NTPQ_ASSOCID = "associd"
-
-NTPQ_UPTIME = "uptime"
-NTPQ_SYSSTATS_RESET = "sysstats reset"
-NTPQ_PACKETS_RECEIVED = "packets received"
-NTPQ_CURRENT_VERSION = "current version"
-NTPQ_OLDER_VERSION = "older version"
-NTPQ_BAD_LENGTH_OR_FORMAT = "bad length or format"
-NTPQ_AUTHENTICATION_FAILED = "authentication failed"
-NTPQ_DECLINED = "declined"
-NTPQ_RESTRICTED = "restricted"
-NTPQ_RATE_LIMITED = "rate limited"
-NTPQ_KOD_RESPONSES = "KoD responses"
-NTPQ_PROCESSED_FOR_TIME = "processed for time"
+VRF_NAME = 'name'
 
 # NTP global info keys/columns
 NTP_UPTIME = "uptime"
-NTP_STAT_NTP_PKTS_RECEIVED = "ntp_pkts_received"
-NTP_STAT_NTP_PKTS_WITH_CURRENT_VERSION = "ntp_pkts_with_current_version"
-NTP_STAT_NTP_PKTS_WITH_OLDER_VERSION = "ntp_pkts_with_older_version"
-NTP_STAT_NTP_PKTS_WITH_BAD_LENGTH_OR_FORMAT = \
-    "ntp_pkts_with_bad_length_or_format"
-NTP_STAT_NTP_PKTS_WITH_AUTH_FAILED = "ntp_pkts_with_auth_failed"
-NTP_STAT_NTP_PKTS_DECLINED = "ntp_pkts_declined"
-NTP_STAT_NTP_PKTS_RESTRICTED = "ntp_pkts_restricted"
-NTP_STAT_NTP_PKTS_RATE_LIMITED = "ntp_pkts_rate_limited"
-NTP_STAT_NTP_PKTS_KOD_RESPONSES = "ntp_pkts_kod_responses"
 
 NTP_ASSOC_REMOTE_PEER_ADDRESS = "remote_peer_address"
 NTP_ASSOC_REMOTE_PEER_REF_ID = "remote_peer_ref_id"
@@ -196,6 +275,20 @@ NTP_ASSOC_PEER_STATUS_WORD = "peer_status_word"
 NTP_ASSOC_ASSOCID = "associd"
 NTP_ASSOC_REFERENCE_TIME = "reference_time"
 
+# Sync summary keys in System:ntp_status
+NTP_SYNC_PEER = "sync_peer"
+NTP_SYNC_STRATUM = "sync_stratum"
+NTP_SYNC_POLL = "sync_poll"
+NTP_SYNC_OFFSET = "sync_offset"
+NTP_SYNC_REFTIME = "sync_reftime"
+NTP_SYNC_STATE = "sync_state"
+NTP_SYNC_LAST_CHANGE = "sync_last_change"
+NTP_SYNC_STATE_SYNCHRONIZED = "synchronized"
+NTP_SYNC_STATE_UNSYNCHRONIZED = "unsynchronized"
+NTP_NTPD_RESTARTS = "ntpd_restarts"
+NTP_NTPD_UPTIME = "ntpd_uptime"
+NTP_TIME_TO_STABLE_OFFSET = "time_to_stable_offset"
+
 
 def ops_ntpd_create_working_dir(ntp_working_dir_path):
     '''
@@ -205,7 +298,7 @@ def ops_ntpd_create_working_dir(ntp_working_dir_path):
     try:
         ops_ntpd_cleanup_working_dir(ntp_working_dir_path)
     finally:
-        os.system("mkdir %s" % ntp_working_dir_path)
+        os.system("mkdir -p %s" % ntp_working_dir_path)
         os.system("chmod 700 %s" % ntp_working_dir_path)
 
 
@@ -213,10 +306,6 @@ def ops_ntpd_cleanup_working_dir(ntp_working_dir_path):
     os.system("rm -rf %s;" % (ntp_working_dir_path))
 
 
-def ops_ntpd_update_content_buffer(file_buffer, line):
-    return file_buffer + [line + "\n"]
-
-
 def ops_ntpd_get_file_contents(filename):
     fh = open(filename, 'r')
     contents = fh.readlines()
@@ -225,8 +314,7 @@ def ops_ntpd_get_file_contents(filename):
 
 
 def ops_ntpd_set_file_contents(filename, contents):
-    with open(filename, "w+") as f:
-        f.writelines(contents)
+    ops_ntpd_conf_write_atomic(filename, "".join(contents))
 
 
 def ops_ntpd_setup_ntpq_integration(ntp_working_dir_path):
@@ -235,13 +323,11 @@ def ops_ntpd_setup_ntpq_integration(ntp_working_dir_path):
        NTPQ communicates to NTPD using the control msg protocol.
        More info: http://doc.ntp.org/4.1.0/ntpq.htm
     '''
-    global ntpq_info, cmdline_str
+    global ntpq_info
     random_data = os.urandom(128)
-    controlkey_answer = hashlib.md5(random_data).hexdigest()[:16]
+    controlkey_answer = \
+        hashlib.sha1(random_data).hexdigest()[:CONTROL_KEY_LENGTH]
     ntpq_info = (controlkey, controlkey_answer)
-    # Build a commandline string to execute
-    cmdline_str = "ntpq -c \"keyid %d\" -c \"passwd %s\"" %\
-        (controlkey, controlkey_answer)
     return (controlkey, controlkey_answer)
 
 
@@ -253,22 +339,14 @@ def ops_ntpd_setup_ntpd_default_config_file(ntp_working_dir_path):
        to NTPD.
     '''
     global ntpq_info
+    global ntpd_instances
+    global ntpd_backend
     os.system("cd %s;" % ntp_working_dir_path)
-    conf = []
-    conf = ops_ntpd_update_content_buffer(conf,
-                                          "#This is generated from ops-ntpd")
-    conf = ops_ntpd_update_content_buffer(conf,
-                                          "tinker panic 0")
-    conf = ops_ntpd_update_content_buffer(conf,
-                                          "trustedkey %s" % (ntpq_info[0]))
-    conf = ops_ntpd_update_content_buffer(conf,
-                                          "requestkey %s" % (ntpq_info[0]))
-    conf = ops_ntpd_update_content_buffer(conf,
-                                          "controlkey %s" % (ntpq_info[0]))
-    conf = ops_ntpd_update_content_buffer(conf,
-                                          "enable mode7")
-    conf_file = ntp_working_dir_path + "ops_ntp.conf"
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    conf = ntpd_backend.render_conf(instance, ntpq_info[0], [], [], True)
+    conf_file = instance.conf_file
     ops_ntpd_set_file_contents(conf_file, conf)
+    instance.conf_digest = ops_ntpd_conf_digest(conf)
     return conf_file
 
 
@@ -279,9 +357,8 @@ def ops_ntpd_get_ntpd_default_keys_file_content():
        to NTPD.
     '''
     global ntpq_info
-    keys_content = "#This is generated from ops-ntpd\n"
-    keys_content += " %s MD5 %s\n" % (ntpq_info[0], ntpq_info[1])
-    return keys_content
+    global ntpd_backend
+    return ntpd_backend.render_keys(ntpq_info[0], ntpq_info[1], {})
 
 
 def ops_ntpd_setup_ntpd_default_keys_file(ntp_working_dir_path):
@@ -290,13 +367,13 @@ def ops_ntpd_setup_ntpd_default_keys_file(ntp_working_dir_path):
        default information in the keys file
     '''
     global ntpq_info
+    global ntpd_instances
     os.system("cd %s;" % ntp_working_dir_path)
-    keys_info = []
-    keys_info = ops_ntpd_update_content_buffer(
-            keys_info,
-            ops_ntpd_get_ntpd_default_keys_file_content())
-    keys_file = ntp_working_dir_path + "ops_ntp.keys"
+    keys_info = ops_ntpd_get_ntpd_default_keys_file_content()
+    keys_file = ntpd_instances[DEFAULT_VRF_NAME].keys_file
     ops_ntpd_set_file_contents(keys_file, keys_info)
+    ntpd_instances[DEFAULT_VRF_NAME].keys_digest = \
+        ops_ntpd_conf_digest(keys_info)
     return keys_file
 
 
@@ -314,12 +391,14 @@ def ops_ntpd_run_command(command):
        This function runs the command provided through 'command'
        and returns the error and output info
     '''
-    process = subprocess.Popen(args=command,
-                               stdout=subprocess.PIPE,
-                               stderr=subprocess.PIPE,
-                               shell=True)
-    error = process.stderr.read()
-    output = process.communicate()
+    global perf_stats
+    with perf_stats.measure(PERF_DAEMON_COMMAND):
+        process = subprocess.Popen(args=command,
+                                   stdout=subprocess.PIPE,
+                                   stderr=subprocess.PIPE,
+                                   shell=True)
+        error = process.stderr.read()
+        output = process.communicate()
     return error, output
 
 
@@ -332,91 +411,101 @@ def ops_ntpd_setup_ntp_key_map(ntpk_db, key_id, key_pass, trust_flag):
 
 def ops_ntpd_setup_ntp_config_map(ntpa_map, vrf, address,
                                   associd, key_id, ref_clock_id, prefer,
-                                  ntp_version):
+                                  ntp_version, ntpd_address=None):
     '''
        This function updates the 'ntpa_map' with information about
-       server config
+       server config. 'ntpd_address' is the address NTPD is configured
+       with when 'address' is a name.
     '''
+    if ntpd_address is None:
+        ntpd_address = address
     ntpa_map[(vrf, address)] = associd
-    ntpa_map[(vrf, address)] = (address, vrf,
+    ntpa_map[(vrf, address)] = (ntpd_address, vrf,
                                 key_id, ref_clock_id, prefer, ntp_version)
 
 
-def ops_ntpd_sync_updates_to_ntpd(server_configs, key_configs,
-                                  keys_file_content):
+def ops_ntpd_sync_updates_to_ntpd(instance, server_configs, key_configs,
+                                  conf_file_content, keys_file_content):
     '''
-       This function synchronizes information from OVSDB to NTPD
+       This function synchronizes information from OVSDB to the NTPD
+       instance of a VRF.
+       The rendered conf and keys files are written, and NTPD reloaded,
+       only when their content changed since the last sync.
     '''
-    global cmdline_str
-    global ntpd_info
     global ntpq_info
-    command = copy.copy(cmdline_str)
-    for config in server_configs + key_configs:
-        command += " -c \"%s\"" % (config)
-
-    ops_ntpd_set_file_contents(ntpd_info[1], keys_file_content)
-    e, o = ops_ntpd_run_command("ntpdc -c \"keyid %d\" -c \"passwd \
-            %s\" -c \"readkeys\"" % (ntpq_info[0], ntpq_info[1]))
-    time.sleep(2)
-    vlog.dbg("NTPDC command was %s: done" % e)
-    e, o = ops_ntpd_run_command(command)
-    vlog.dbg("NTPQ command was %s: done" % e)
-    vlog.dbg("Sync OVSDB -> NTPD : done")
+    global ntpd_backend
+    conf_digest = ops_ntpd_conf_digest(conf_file_content)
+    keys_digest = ops_ntpd_conf_digest(keys_file_content)
+    if conf_digest == instance.conf_digest and \
+            keys_digest == instance.keys_digest:
+        vlog.dbg("Sync OVSDB -> NTPD %s : no change" % (instance.vrf_name))
+        return
+
+    keys_changed = keys_digest != instance.keys_digest
+    if keys_changed:
+        ops_ntpd_set_file_contents(instance.keys_file, keys_file_content)
+        instance.keys_digest = keys_digest
+
+    configs = None
+    if conf_digest != instance.conf_digest:
+        ops_ntpd_set_file_contents(instance.conf_file, conf_file_content)
+        configs = server_configs + key_configs
+        instance.conf_digest = conf_digest
+    ntpd_backend.push(instance, configs, keys_changed, ntpq_info)
+    vlog.dbg("Sync OVSDB -> NTPD %s : done" % (instance.vrf_name))
 
 
 def ops_ntpd_get_ntpd_associations_info(ntpd_updates):
     '''
        This function creates a table containing all the
-       information about NTP associations
+       information about NTP associations, per VRF
        This information is used to push information into
        ntp_association_status into the NTP Associations
        table
     '''
-    a_table = {}
-    assoc_db = {}
-    associations_info_table = {}
-    err, cmd_output = ops_ntpd_run_command("ntpq -n -c \"apeers\"")
-    n_out = cmd_output[0].strip().split('\n')[2:]
-    for n in n_out:
-        n = n.strip().split()
-        a_entry = {}
-        a_entry[NTPQ_REMOTE] = n[0]
-        a_entry[NTPQ_REFID] = n[1]
-        a_entry[NTPQ_ASSOCID] = n[2]
-        a_entry[NTPQ_ST] = n[3]
-        a_entry[NTPQ_T] = n[4]
-        a_entry[NTPQ_WHEN] = n[5]
-        a_entry[NTPQ_POLL] = n[6]
-        a_entry[NTPQ_REACH] = n[7]
-        a_entry[NTPQ_DELAY] = n[8]
-        a_entry[NTPQ_OFFSET] = n[9]
-        a_entry[NTPQ_JITTER] = n[10]
-        a_table[a_entry[NTPQ_ASSOCID]] = a_entry
-        assoc_db[a_entry[NTPQ_ASSOCID]] = a_entry
-
-    for assoc_id in assoc_db.keys():
-        err, cmd_output = ops_ntpd_run_command(
-            "ntpq -n -c \"rv %s\"" % assoc_id)
-        n_out = " ".join(cmd_output[0].split("\n"))
-        n = n_out.split(",")
-        peer_status_word = [x.strip() for x in n if "sel_" in x][0]
-        root_dispersion = [x.strip() for x in n
-                           if "rootdisp" in x][0].strip().split("=")[1]
-        remote_peer_address = [x.strip() for x in n
-                               if "srcadr" in x][0].strip().split("=")[1]
-        reference_time = " ".join([n[i] + n[i + 1] for i in
-                                   range(len(n)) if "reftime" in n[i]][0].
-                                  strip().split("=")[1].split()[1:])
-        ref_id = [x.strip() for x in n if "refid" in x][
-            0].strip().split("=")[1]
-        if assoc_db[assoc_id][NTPQ_REFID][0] == ".":
-            ref_id = assoc_db[assoc_id][NTPQ_REFID]
-        a_table[assoc_id][NTPQ_REMOTE] = remote_peer_address
-        a_table[assoc_id][NTPQ_ROOT_DISPERSION] = root_dispersion
-        a_table[assoc_id][NTPQ_REFERENCE_TIME] = reference_time
-        a_table[assoc_id][NTPQ_PEER_STATUS_WORD] = peer_status_word
-        a_table[assoc_id][NTPQ_REFID] = ref_id
-        associations_info_table[remote_peer_address] = a_table[assoc_id]
+    global ntpd_instances
+    global nts_tracker
+    global perf_stats
+    synchronized = False
+    system_peer_info = None
+    stats_keys = []
+    for vrf_name, instance in ntpd_instances.iteritems():
+        associations_info = {}
+        peer_info = ops_ntpd_get_instance_associations_info(
+            instance, associations_info)
+        ntpd_updates["associations_info"][vrf_name] = associations_info
+        stats_keys += [(vrf_name, x) for x in associations_info.keys()]
+        # Only the instance disciplining the clock makes it synchronized
+        if instance.discipline and peer_info is not None:
+            synchronized = True
+            system_peer_info = peer_info
+    ops_ntpd_stats_prune(stats_keys)
+    nts_tracker.prune(stats_keys)
+    ops_ntpd_get_sync_summary(ntpd_updates, system_peer_info)
+    # Keep the hardware clock in line with the synchronized system clock
+    with perf_stats.measure(PERF_RTC_SYNC):
+        ops_ntpd_rtc_sync(synchronized)
+
+
+def ops_ntpd_get_instance_associations_info(instance, associations_info):
+    '''
+       This function fills 'associations_info' with the associations
+       of one NTPD instance, keyed by their configured address or name.
+       It returns the configured address or name of the system peer and
+       its information, if any.
+    '''
+    global g_ntpa_map
+    global ntpd_backend
+    global key_rotation
+    global nts_tracker
+    system_peer_info = None
+    # NTPD reports addresses, the associations may be configured by name
+    names = dict(((v[1], v[0]), k[1]) for k, v in g_ntpa_map.iteritems())
+    associations_info_table = ntpd_backend.read_associations(instance)
+    nts_names = set([k[1] for k, v in g_ntpa_map.iteritems()
+                     if v[1] == instance.vrf_name and v[2] == NTS_KEY_ID])
+    nts_table = ntpd_backend.read_nts(instance) if nts_names else {}
+    now = time.time()
 
     for address in associations_info_table.keys():
         assoc_info = copy.copy(default_assoc_info)
@@ -450,9 +539,72 @@ def ops_ntpd_get_ntpd_associations_info(ntpd_updates):
             associations_info_table[address][NTPQ_ASSOCID]
         assoc_info[NTP_ASSOC_REFERENCE_TIME] = \
             associations_info_table[address][NTPQ_REFERENCE_TIME]
-        ntpd_updates["associations_info"][address] = assoc_info
-        if assoc_info[NTP_ASSOC_PEER_STATUS_WORD] == "system_peer":
-            os.system("hwclock -w")
+        name = names.get((instance.vrf_name, address), address)
+        # Clock-health statistics (offset percentiles, allan deviation)
+        assoc_info.update(ops_ntpd_stats_update(
+            (instance.vrf_name, name),
+            associations_info_table[address][NTPQ_WHEN],
+            associations_info_table[address][NTPQ_POLL],
+            associations_info_table[address][NTPQ_REACH],
+            associations_info_table[address][NTPQ_OFFSET]))
+        if name in nts_names:
+            assoc_info.update(nts_tracker.update(
+                (instance.vrf_name, name), nts_table.get(address), now,
+                associations_info_table[address][NTPQ_WHEN],
+                associations_info_table[address][NTPQ_POLL],
+                associations_info_table[address][NTPQ_REACH]))
+        associations_info[name] = assoc_info
+        key_rotation.observe(instance.vrf_name, name,
+                             assoc_info[NTP_ASSOC_REACH_REGISTER])
+        # With a PPS reference clock the PPS peer is the system peer
+        if assoc_info[NTP_ASSOC_PEER_STATUS_WORD] in ["system_peer",
+                                                      "pps_peer"]:
+            system_peer_info = (name, assoc_info)
+    return system_peer_info
+
+
+def ops_ntpd_get_sync_summary(ntpd_updates, system_peer_info):
+    '''
+       This function adds a summary of the selected system peer to
+       ntp_status in the SYSTEM table, so that the sync state can be
+       read from a single row. The peer is shown as configured, by
+       address or by name.
+    '''
+    global sync_summary_key, sync_last_change
+    status = ntpd_updates["status"]
+    if system_peer_info is not None:
+        (name, peer_info) = system_peer_info
+        status[NTP_SYNC_STATE] = NTP_SYNC_STATE_SYNCHRONIZED
+        status[NTP_SYNC_PEER] = name
+        status[NTP_SYNC_STRATUM] = peer_info[NTP_ASSOC_STRATUM]
+        status[NTP_SYNC_POLL] = peer_info[NTP_ASSOC_POLLING_INTERVAL]
+        status[NTP_SYNC_OFFSET] = peer_info[NTP_ASSOC_TIME_OFFSET]
+        status[NTP_SYNC_REFTIME] = \
+            peer_info[NTP_ASSOC_REFERENCE_TIME]
+    else:
+        status[NTP_SYNC_STATE] = NTP_SYNC_STATE_UNSYNCHRONIZED
+        for key in [NTP_SYNC_PEER, NTP_SYNC_STRATUM, NTP_SYNC_POLL,
+                    NTP_SYNC_OFFSET, NTP_SYNC_REFTIME]:
+            status[key] = "-"
+
+    # Timestamp the last change of sync state or selected peer
+    key = (status[NTP_SYNC_STATE], status[NTP_SYNC_PEER])
+    if key != sync_summary_key:
+        sync_summary_key = key
+        sync_last_change = str(int(time.time()))
+    status[NTP_SYNC_LAST_CHANGE] = sync_last_change
+
+
+def ops_ntpd_get_discipline_instance():
+    '''
+       This function returns the NTPD instance disciplining the system
+       clock. Its state is the one reported as the global NTP status.
+    '''
+    global ntpd_instances
+    for instance in ntpd_instances.itervalues():
+        if instance.discipline:
+            return instance
+    return ntpd_instances[DEFAULT_VRF_NAME]
 
 
 def ops_ntpd_get_ntpd_global_status(ntpd_updates):
@@ -462,31 +614,32 @@ def ops_ntpd_get_ntpd_global_status(ntpd_updates):
        This information is used to push into
        ntp_status and ntp_statistics in the SYSTEM table
     '''
-    err, cmd_output = ops_ntpd_run_command("ntpq -n -c \"sysstats\"")
-    n_out = cmd_output[0].strip().split("\n")
-    sysstat_table = {}
-    for n in n_out:
-        n = [i.lstrip() for i in n.strip().split(":")]
-        sysstat_table[n[0]] = n[1]
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_RECEIVED] = \
-        str(sysstat_table[NTPQ_PACKETS_RECEIVED])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_WITH_CURRENT_VERSION] = \
-        str(sysstat_table[NTPQ_CURRENT_VERSION])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_WITH_OLDER_VERSION] = \
-        str(sysstat_table[NTPQ_OLDER_VERSION])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_WITH_BAD_LENGTH_OR_FORMAT] = \
-        str(sysstat_table[NTPQ_BAD_LENGTH_OR_FORMAT])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_WITH_AUTH_FAILED] = \
-        str(sysstat_table[NTPQ_AUTHENTICATION_FAILED])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_DECLINED] = \
-        str(sysstat_table[NTPQ_DECLINED])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_RESTRICTED] = \
-        str(sysstat_table[NTPQ_RESTRICTED])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_RATE_LIMITED] = \
-        str(sysstat_table[NTPQ_RATE_LIMITED])
-    ntpd_updates["statistics"][NTP_STAT_NTP_PKTS_KOD_RESPONSES] = \
-        str(sysstat_table[NTPQ_KOD_RESPONSES])
-    ntpd_updates["status"][NTP_UPTIME] = str(sysstat_table[NTPQ_UPTIME])
+    global ntpd_backend
+    global warm_start
+    instance = ops_ntpd_get_discipline_instance()
+    statistics, uptime = ntpd_backend.read_statistics(instance)
+    ntpd_updates["statistics"].update(statistics)
+    if uptime is None:
+        # The daemon does not report its uptime, the supervisor knows it
+        uptime = "0"
+        if instance.supervisor is not None:
+            uptime = str(instance.supervisor.uptime(time.time()))
+    ntpd_updates["status"][NTP_UPTIME] = uptime
+    status = ntpd_updates["status"]
+    status[NTP_TIME_TO_STABLE_OFFSET] = "-"
+    if instance.supervisor is not None:
+        now = time.time()
+        status[NTP_NTPD_RESTARTS] = str(instance.supervisor.restarts)
+        status[NTP_NTPD_UPTIME] = str(instance.supervisor.uptime(now))
+        peer = None
+        if status.get(NTP_SYNC_STATE) == NTP_SYNC_STATE_SYNCHRONIZED:
+            peer = status[NTP_SYNC_PEER]
+        warm_start.update(now, instance.supervisor.started,
+                          instance.vrf_name, peer,
+                          status.get(NTP_SYNC_OFFSET))
+        if warm_start.time_to_stable is not None:
+            status[NTP_TIME_TO_STABLE_OFFSET] = \
+                str(warm_start.time_to_stable)
 
 
 def ops_ntpd_sync_updates_to_ovsdb():
@@ -495,54 +648,113 @@ def ops_ntpd_sync_updates_to_ovsdb():
        send to the OVSDB as part of the status update.
     '''
     global g_ntpa_map
+    global perf_stats
     ntpd_updates = {}
     ntpd_updates["associations_info"] = {}
     ntpd_updates["statistics"] = {}
     ntpd_updates["status"] = {}
     try:
-        ops_ntpd_get_ntpd_associations_info(ntpd_updates)
-        ops_ntpd_get_ntpd_global_status(ntpd_updates)
-        str_ntpd_updates = json.dumps(ntpd_updates)
+        with perf_stats.measure(PERF_ASSOCIATIONS_INFO):
+            ops_ntpd_get_ntpd_associations_info(ntpd_updates)
+        with perf_stats.measure(PERF_GLOBAL_STATUS):
+            ops_ntpd_get_ntpd_global_status(ntpd_updates)
+        ntpd_updates["status"].update(ops_ntpd_timex_read())
         vlog.dbg("Sync information is \n %s" % (
             pprint.pformat(ntpd_updates, indent=5)))
 
-        ops_ntpd_send_info_to_transaction_mgr(str_ntpd_updates)
+        ops_ntpd_send_info_to_transaction_mgr(ntpd_updates)
         vlog.dbg("Sync NTPD -> OVSDB : done")
     except Exception as e:
         vlog.warn("Unable to sync NTPD info -> OVSDB : err %s" % (str(e)))
 
 
-def ops_ntpd_check_updates_with_ntp_associations(l_ntpa_map, trigger_reconfig):
+def ops_ntpd_refresh_clients():
+    '''
+       This function reads the clients seen by the daemons since the
+       previous refresh into the top clients table. Nothing is read
+       when the daemons only run as clients.
+    '''
+    global ntpd_backend
+    global ntpd_instances
+    global client_table
+    if ntpd_backend.server_policy is None:
+        client_table.clear()
+        return
+    client_table.prune(ntpd_instances.keys())
+    for vrf_name, instance in ntpd_instances.iteritems():
+        if instance.supervisor is None or instance.supervisor.pid() is None:
+            continue
+        now = time.time()
+        try:
+            entries = ntpd_backend.read_clients(
+                instance, client_table.cursor(vrf_name, now))
+        except Exception as e:
+            vlog.warn("Unable to read the NTP clients of %s : err %s" %
+                      (vrf_name, str(e)))
+            continue
+        client_table.update(vrf_name, now, entries)
+
+
+def ops_ntpd_sync_kernel_status_to_ovsdb():
+    '''
+       This function pushes the kernel clock state (adjtimex) to the
+       OVSDB. It does not involve NTPD, so it is cheap enough to run on
+       every iteration of the main loop.
+    '''
+    global last_kernel_status
+    try:
+        kernel_status = ops_ntpd_timex_read()
+        if kernel_status == last_kernel_status:
+            return
+        last_kernel_status = kernel_status
+        ops_ntpd_send_info_to_transaction_mgr({"status": kernel_status})
+    except Exception as e:
+        vlog.warn("Unable to sync kernel clock info -> OVSDB : err %s" %
+                  (str(e)))
+
+
+def ops_ntpd_association_server_info(v):
+    '''
+       This function returns the association settings logged with its
+       events
+    '''
+    if v[2] == NTS_KEY_ID:
+        return "prefer %s, ver %s, nts" % (str(v[4]), str(v[5]))
+    if v[2] != 0:
+        return "prefer %s, ver %s, key %s" % (str(v[4]), str(v[5]), str(v[2]))
+    return "prefer %s, ver %s" % (str(v[4]), str(v[5]))
+
+
+def ops_ntpd_check_updates_with_ntp_associations(l_ntpa_map):
     '''
         This function checks if there are any updates in the NTP
         associations and accordingly updates the global database
         with that info.
         It also provides what configuration change has to be sent
-        to the NTPD daemon.
+        to the NTPD daemon of each VRF.
+        An association whose only change is its key, or NTS, is switched
+        by the key rotation, one association per VRF at a time.
     '''
     global g_ntpa_map
+    global ntpd_backend
+    global key_rotation
     add = []
     delete = []
+    switches = []
     add_configs = []
-    revise_configs = []
-    add_template_string = ":config server "
-    delete_template_string = ":config unconfig "
     for k in list(set(l_ntpa_map.keys() + g_ntpa_map.keys())):
         if k in l_ntpa_map.keys():
             v = l_ntpa_map[k]
             event = ""
-            if v[2] != 0:
-                server_info = "prefer %s, ver %s, key %s" %\
-                            (str(v[4]), str(v[5]), str(v[2]))
-            else:
-                server_info = "prefer %s, ver %s" %\
-                            (str(v[4]), str(v[5]))
             if k not in g_ntpa_map.keys():
                 add.append(k)
                 g_ntpa_map[k] = v
                 event = "Add"
+            elif v[:2] + v[3:] == g_ntpa_map[k][:2] + g_ntpa_map[k][3:] \
+                    and v[2] != g_ntpa_map[k][2]:
+                switches.append(k)
             elif v != g_ntpa_map[k]:
-                delete.append(k)
+                delete.append((k[0], g_ntpa_map[k][0]))
                 add.append(k)
                 g_ntpa_map[k] = v
                 event = "Change"
@@ -550,40 +762,43 @@ def ops_ntpd_check_updates_with_ntp_associations(l_ntpa_map, trigger_reconfig):
                 log_event(
                           "NTP_ASSOC",
                           ["event", event],
-                          ["server", v[0]],
-                          ["server_info", server_info])
+                          ["server", k[1]],
+                          ["server_info",
+                           ops_ntpd_association_server_info(v)])
         else:
-            delete.append(k)
             v = g_ntpa_map[k]
+            delete.append((k[0], v[0]))
             log_event(
                       "NTP_ASSOC",
                       ["event", "Delete"],
-                      ["server", v[0]],
+                      ["server", k[1]],
                       ["server_info", ""])
             del g_ntpa_map[k]
-    delete_configs = [delete_template_string + x[1] for x in delete]
+    # NTPD and chronyd only set the key of an association when it is
+    # mobilized, it is re-mobilized with iburst to resume quickly
+    key_rotation.prune(l_ntpa_map.keys())
+    switched = key_rotation.select_switches(switches, time.time())
+    for k in switched:
+        delete.append((k[0], g_ntpa_map[k][0]))
+        add.append(k)
+        g_ntpa_map[k] = l_ntpa_map[k]
+        log_event(
+                  "NTP_ASSOC",
+                  ["event", "Change"],
+                  ["server", k[1]],
+                  ["server_info",
+                   ops_ntpd_association_server_info(l_ntpa_map[k])])
+    # Keys are (vrf, configured address), NTPD is configured with the
+    # resolved address of the values. Configs are (vrf, config) pairs.
+    delete_configs = [(x[0], config) for x in delete
+                      for config in ntpd_backend.server_delete_configs(x[1])]
     for x in add:
-        (addr, vrf, key_id, ref_clk, pref, ver) = g_ntpa_map[x]
-        add_config = add_template_string + addr
-        add_config += " version " + ver
-        if key_id != DEFAULT_NTP_KEY_ID:
-            add_config += " key " + key_id
-        if pref != DEFAULT_NTP_PREF:
-            add_config += " prefer"
-        add_configs += [add_config]
-    if trigger_reconfig is True:
-        for x in list(g_ntpa_map.keys()):
-            (addr, vrf, key_id, ref_clk, pref, ver) = g_ntpa_map[x]
-            if key_id != DEFAULT_NTP_KEY_ID:
-                revise_configs += [delete_template_string + addr]
-                if pref != DEFAULT_NTP_PREF:
-                    revise_configs += [
-                            add_template_string + addr +
-                            " version %s key %s prefer" % (ver, key_id)]
-                else:
-                    revise_configs += [add_template_string + addr +
-                                       " version %s key %s" % (ver, key_id)]
-    server_configs = revise_configs + delete_configs + add_configs
+        add_configs += [(g_ntpa_map[x][1], config) for config in
+                        ntpd_backend.server_add_configs(g_ntpa_map[x],
+                                                        x in switched)]
+    server_configs = {}
+    for (vrf, config) in delete_configs + add_configs:
+        server_configs.setdefault(vrf, []).append(config)
     vlog.dbg("server configs %s" % (pprint.pformat(server_configs)))
     return server_configs
 
@@ -596,16 +811,11 @@ def ops_ntpd_check_updates_with_ntp_keys(l_ntpk_db):
        to the NTPD daemon.
     '''
     global g_ntpk_db, ntpq_info
-    add_template_string = " %s MD5 %s"
-    trustedkey_template_string = ":config trustedkey "
-    untrustedkey_template_string = ":config unconfig trustedkey "
+    global ntpd_backend
     t_keys_str = "-"
     unt_keys_str = "-"
     trusted_keys = []
     untrusted_keys = []
-    trusted_key_config = []
-    untrusted_key_config = []
-    keys_file_content = ops_ntpd_get_ntpd_default_keys_file_content()
     if len(l_ntpk_db) > 0 and len(g_ntpk_db) > 0:
         untrusted_keys = set(g_ntpk_db.keys()) - set(l_ntpk_db.keys())
         g_ntpk_db = copy.copy(l_ntpk_db)
@@ -616,25 +826,291 @@ def ops_ntpd_check_updates_with_ntp_keys(l_ntpk_db):
     elif len(l_ntpk_db) == 0:
         untrusted_keys = g_ntpk_db.keys()
         g_ntpk_db = {}
-    keys_file_content += "\n".join([add_template_string % (
-        k, v[0]) for k, v in g_ntpk_db.iteritems()])
+    keys_file_content = ntpd_backend.render_keys(ntpq_info[0], ntpq_info[1],
+                                                 g_ntpk_db)
     if len(trusted_keys) > 0:
-        trusted_key_config += [trustedkey_template_string +
-                               " ".join([str(x) for x in trusted_keys])]
         t_keys_str = " ".join([str(x) for x in trusted_keys])
     if len(untrusted_keys) > 0:
-        untrusted_key_config += [untrustedkey_template_string +
-                                 " ".join([str(x) for x in untrusted_keys])]
         unt_keys_str = " ".join([str(x) for x in untrusted_keys])
     if t_keys_str != "-" or unt_keys_str != "-":
         log_event("NTP_KEY",
                   ["trusted_keys", t_keys_str],
                   ["untrusted_keys", unt_keys_str])
-    key_config = untrusted_key_config + trusted_key_config
-    keys_file_content += "\n"
+    key_config = ntpd_backend.key_configs(trusted_keys, untrusted_keys)
     return key_config, keys_file_content
 
 
+def ops_ntpd_get_ntp_config(idl):
+    '''
+       This function returns the System:ntp_config key/values, empty
+       when they are not set
+    '''
+    ntp_config = {}
+    for ovs_rec in idl.tables[SYSTEM_TABLE].rows.itervalues():
+        if ovs_rec.ntp_config and ovs_rec.ntp_config is not None:
+            ntp_config = ovs_rec.ntp_config
+    return ntp_config
+
+
+def ops_ntpd_get_config_debounce():
+    '''
+       This function returns the debounce window and the max latency,
+       in seconds, for pushing configuration changes to NTPD
+    '''
+    global idl
+    ntp_config = ops_ntpd_get_ntp_config(idl)
+    try:
+        debounce_ms = int(ntp_config.get('config_debounce_ms',
+                                         DEFAULT_CONFIG_DEBOUNCE_MS))
+        max_latency_ms = int(ntp_config.get('config_max_latency_ms',
+                                            DEFAULT_CONFIG_MAX_LATENCY_MS))
+    except ValueError:
+        vlog.err("Invalid config debounce settings, using defaults")
+        debounce_ms = DEFAULT_CONFIG_DEBOUNCE_MS
+        max_latency_ms = DEFAULT_CONFIG_MAX_LATENCY_MS
+    debounce_ms = max(debounce_ms, 0)
+    max_latency_ms = max(max_latency_ms, debounce_ms)
+    return (debounce_ms / 1000.0, max_latency_ms / 1000.0)
+
+
+def ops_ntpd_note_config_change(now):
+    '''
+       This function notes a config change at 'now', applied once the
+       debounce window or the max latency expires
+    '''
+    global config_first_change
+    global config_last_change
+
+    if config_first_change is None:
+        config_first_change = now
+    config_last_change = now
+
+
+def ops_ntpd_check_config_changes(now):
+    '''
+       This function notes the config changes of OVSDB, of the key
+       rotation and of the DNS resolver, and applies the pending ones
+       once the config has been quiet for the debounce window or the max
+       latency has passed since the first one. It returns True when the
+       changes were applied.
+    '''
+    global seqno
+    global config_first_change
+    global config_digest
+    global config_debounce
+    global config_max_latency
+    global rotation_seqno
+    global dns_seqno
+
+    if config_debounce is None:
+        config_debounce, config_max_latency = \
+            ops_ntpd_get_config_debounce()
+    if seqno != idl.change_seqno:
+        seqno = idl.change_seqno
+        digest = ops_ntpd_get_config_digest()
+        if digest != config_digest:
+            # Only note the change, ntpd is reconfigured once the
+            # debounce window expires
+            vlog.dbg("ops-ntpd-debug main - config change at seqno %d"
+                     % (seqno))
+            config_digest = digest
+            ops_ntpd_note_config_change(now)
+            config_debounce, config_max_latency = \
+                ops_ntpd_get_config_debounce()
+    key_rotation.run(now)
+    if rotation_seqno != key_rotation.seqno:
+        # A key switch ended or a retiring key expired, the next
+        # stage is applied like a config change
+        vlog.dbg("ops-ntpd-debug main - key rotation seqno change "
+                 "from %d to %d" % (rotation_seqno, key_rotation.seqno))
+        rotation_seqno = key_rotation.seqno
+        ops_ntpd_note_config_change(now)
+    if dns_seqno != dns_resolver.seqno:
+        # A server name got a new address, handled like a config
+        # change
+        vlog.dbg("ops-ntpd-debug main - DNS seqno change from %d to %d"
+                 % (dns_seqno, dns_resolver.seqno))
+        dns_seqno = dns_resolver.seqno
+        ops_ntpd_note_config_change(now)
+
+    if config_first_change is None:
+        return False
+    if now - config_last_change < config_debounce and \
+            now - config_first_change < config_max_latency:
+        return False
+    vlog.dbg("ops-ntpd-debug main - applying config changes "
+             "pending for %.3f s" % (now - config_first_change))
+    config_first_change = None
+    with perf_stats.measure(PERF_CHECK_UPDATES):
+        ops_ntpd_check_updates_from_ovsdb()
+    return True
+
+
+def ops_ntpd_get_config_deadline():
+    '''
+       This function returns the time at which the pending config
+       changes are applied, None without pending changes
+    '''
+    if config_first_change is None:
+        return None
+    return min(config_last_change + config_debounce,
+               config_first_change + config_max_latency)
+
+
+def ops_ntpd_get_log_settings():
+    '''
+       This function returns the size (bytes) above which the daemon
+       logs are rotated, the number of rotated copies kept, and the log
+       lines or time window (seconds, 0 for the lines) of the diagnostic
+       dump
+    '''
+    global idl
+    ntp_config = ops_ntpd_get_ntp_config(idl)
+    try:
+        max_size_kb = int(ntp_config.get('log_max_size_kb',
+                                         DEFAULT_LOG_MAX_SIZE_KB))
+        rotate_count = int(ntp_config.get('log_rotate_count',
+                                          DEFAULT_LOG_ROTATE_COUNT))
+        diag_lines = int(ntp_config.get('diag_log_lines',
+                                        DEFAULT_DIAG_LOG_LINES))
+        diag_window = int(ntp_config.get('diag_log_window', 0))
+    except ValueError:
+        vlog.err("Invalid log settings, using defaults")
+        max_size_kb = DEFAULT_LOG_MAX_SIZE_KB
+        rotate_count = DEFAULT_LOG_ROTATE_COUNT
+        diag_lines = DEFAULT_DIAG_LOG_LINES
+        diag_window = 0
+    return (max(max_size_kb, 1) * 1024, max(rotate_count, 0),
+            max(diag_lines, 0), max(diag_window, 0))
+
+
+def ops_ntpd_rotate_logs():
+    '''
+       This function rotates the log of every NTPD instance grown above
+       its size limit
+    '''
+    global ntpd_instances
+    (max_size, rotate_count, unused_lines, unused_window) = \
+        ops_ntpd_get_log_settings()
+    for instance in ntpd_instances.itervalues():
+        if instance.log_file is not None:
+            ops_ntpd_log_rotate(instance.log_file, max_size, rotate_count)
+
+
+def ops_ntpd_get_backend():
+    '''
+       This function returns the name of the time daemon backend
+       selected in System:ntp_config
+    '''
+    global idl
+    backend = ops_ntpd_get_ntp_config(idl).get('backend',
+                                               DEFAULT_NTPD_BACKEND)
+    if backend not in NTPD_BACKENDS:
+        vlog.err("Invalid time daemon backend %s, using %s" %
+                 (backend, DEFAULT_NTPD_BACKEND))
+        backend = DEFAULT_NTPD_BACKEND
+    return backend
+
+
+def ops_ntpd_get_hitless_restart():
+    '''
+       This function returns True if the daemons are left running when
+       ops-ntpd exits, to be adopted by its next run
+    '''
+    global idl
+    return ops_ntpd_get_ntp_config(idl).get(
+        'hitless_restart', DEFAULT_HITLESS_RESTART) == "true"
+
+
+def ops_ntpd_get_nts_trusted_certs():
+    '''
+       This function returns the CA certificates trusted to authenticate
+       the NTS servers, set in System:ntp_config, None for the system
+       ones
+    '''
+    global idl
+    return ops_ntpd_get_ntp_config(idl).get('nts_trusted_certs')
+
+
+def ops_ntpd_get_server_policy():
+    '''
+       This function returns the server mode policy set in
+       System:ntp_config, None when the daemons only run as clients.
+       Invalid client networks are skipped.
+    '''
+    global idl
+    ntp_config = ops_ntpd_get_ntp_config(idl)
+    if ntp_config.get('server_enable', "false") != "true":
+        return None
+    allow = []
+    for network in ntp_config.get('server_allow', "").split(","):
+        network = network.strip()
+        if not network:
+            continue
+        if ops_ntpd_conf_parse_network(network) is None:
+            vlog.err("Invalid server mode client network %s, skipped" %
+                     (network))
+            continue
+        allow.append(network)
+    try:
+        average = int(ntp_config.get('server_rate_average',
+                                     DEFAULT_SERVER_RATE_AVERAGE))
+        minimum = int(ntp_config.get('server_rate_minimum',
+                                     DEFAULT_SERVER_RATE_MINIMUM))
+    except ValueError:
+        vlog.err("Invalid server mode rate limit, using defaults")
+        average = DEFAULT_SERVER_RATE_AVERAGE
+        minimum = DEFAULT_SERVER_RATE_MINIMUM
+    return {"allow": sorted(set(allow)),
+            "average": min(max(average, 0), MAX_SERVER_RATE_INTERVAL),
+            "minimum": min(max(minimum, 0), MAX_SERVER_RATE_INTERVAL)}
+
+
+def ops_ntpd_set_backend(name):
+    '''
+       This function selects the time daemon backend. Control commands
+       go through ops_ntpd_run_command().
+    '''
+    global ntpd_backend
+    global warm_start
+    server_policy = ntpd_backend.server_policy
+    nts_trusted_certs = ntpd_backend.nts_trusted_certs
+    ntpd_backend = NTPD_BACKENDS[name](
+        lambda command: ops_ntpd_run_command(command))
+    ntpd_backend.warm_server = warm_start.server()
+    ntpd_backend.server_policy = server_policy
+    ntpd_backend.nts_trusted_certs = nts_trusted_certs
+
+
+def ops_ntpd_switch_backend(name):
+    '''
+       This function stops the daemons of every instance and switches to
+       another time daemon backend. The default VRF daemon is restarted
+       with the last synchronized configuration, the other instances
+       are started again on the next sync, as new VRFs.
+    '''
+    global ntpd_backend
+    global ntpd_instances
+    global g_ntpa_map
+    global g_ntpk_db
+    global ntpq_info
+    vlog.info("Switching the time daemon backend from %s to %s" %
+              (ntpd_backend.name, name))
+    ops_ntpd_stop_ntpd_instances()
+    ops_ntpd_set_backend(name)
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    associations = [v for v in g_ntpa_map.values()
+                    if v[1] == DEFAULT_VRF_NAME]
+    conf_file_content = ntpd_backend.render_conf(instance, ntpq_info[0],
+                                                 associations,
+                                                 g_ntpk_db.keys(),
+                                                 instance.discipline)
+    keys_file_content = ntpd_backend.render_keys(ntpq_info[0], ntpq_info[1],
+                                                 g_ntpk_db)
+    ops_ntpd_start_instance(instance, conf_file_content, keys_file_content,
+                            instance.discipline)
+
+
 def ops_ntpd_check_updates_from_ovsdb():
     '''
         This function checks if there are any updates in the NTP
@@ -644,26 +1120,54 @@ def ops_ntpd_check_updates_from_ovsdb():
     global idl
     global ntpd_command
     global ntpq_process
-    global cmdline_str
     global g_ntpk_db
+    global g_ntpa_map
+    global ntpq_info
     global auth_state
+    global dns_resolver
+    global ntpd_backend
+    global key_rotation
     ovs_rec = None
     associd = 0
+    vrf_names = {}
+    dns_names = set()
+    shm_feeds = {}
     vlog.dbg("ops_ntpd_check_updates_from_ovsdb")
-    authentication_enable = "false"
-    trigger_reconfig = False
 
     update_map = {}
     # Check if ntp authentication is enabled
-    for ovs_rec in idl.tables[SYSTEM_TABLE].rows.itervalues():
-        if ovs_rec.ntp_config and ovs_rec.ntp_config is not None:
-            for key, value in ovs_rec.ntp_config.iteritems():
-                if key == 'authentication_enable':
-                    authentication_enable = value
+    ntp_config = ops_ntpd_get_ntp_config(idl)
+    authentication_enable = ntp_config.get('authentication_enable', "false")
+    rtc_sync_interval = ntp_config.get('rtc_sync_interval',
+                                       DEFAULT_RTC_SYNC_INTERVAL)
+    rtc_drift_threshold = ntp_config.get('rtc_drift_threshold',
+                                         DEFAULT_RTC_DRIFT_THRESHOLD)
+    key_retire_grace = ntp_config.get('key_retire_grace',
+                                      DEFAULT_KEY_RETIRE_GRACE)
     vlog.dbg("Authentication is %s " % (authentication_enable))
-
+    ops_ntpd_rtc_configure(rtc_sync_interval, rtc_drift_threshold)
+
+    backend = ops_ntpd_get_backend()
+    if backend != ntpd_backend.name:
+        ops_ntpd_switch_backend(backend)
+
+    # Pushed to every instance
+    policy_configs = []
+    server_policy = ops_ntpd_get_server_policy()
+    if server_policy != ntpd_backend.server_policy:
+        vlog.info("Server mode changed from %s to %s" %
+                  (ntpd_backend.server_policy, server_policy))
+        ntpd_backend.server_policy = server_policy
+        policy_configs = ntpd_backend.server_policy_configs()
+    nts_trusted_certs = ops_ntpd_get_nts_trusted_certs()
+    if nts_trusted_certs != ntpd_backend.nts_trusted_certs:
+        vlog.info("NTS trusted certificates changed from %s to %s" %
+                  (ntpd_backend.nts_trusted_certs, nts_trusted_certs))
+        ntpd_backend.nts_trusted_certs = nts_trusted_certs
+        policy_configs = policy_configs + ntpd_backend.nts_configs()
+
+    # Keys are trusted or untrusted without touching the associations
     if (auth_state != authentication_enable):
-        trigger_reconfig = True
         log_event(
                   "NTP_GLOBAL",
                   ["old", auth_state], ["new", authentication_enable])
@@ -681,14 +1185,36 @@ def ops_ntpd_check_updates_from_ovsdb():
             trust_enable = ovs_rec.trust_enable
         vlog.dbg("trust_enable is %s and auth is %s" % (trust_enable,
                                                         authentication_enable))
+        if ops_ntpd_conf_parse_key(key_password) is None:
+            vlog.warn("Invalid password of NTP key %s, ignored" % (key_id))
+            continue
         if trust_enable is True and authentication_enable == "true":
             ops_ntpd_setup_ntp_key_map(update_map,
                                        key_id, key_password, trust_enable)
 
+    # Removed keys stay installed while they may still be in use
+    if authentication_enable == "true":
+        try:
+            key_rotation.grace = max(int(key_retire_grace), 0)
+        except ValueError:
+            vlog.err("Invalid key retire grace %s, using %d" %
+                     (key_retire_grace, DEFAULT_KEY_RETIRE_GRACE))
+            key_rotation.grace = DEFAULT_KEY_RETIRE_GRACE
+        used_key_ids = set([int(v[2]) for v in g_ntpa_map.itervalues()
+                            if v[2] not in [DEFAULT_NTP_KEY_ID, NTS_KEY_ID]])
+        update_map = key_rotation.merge_keys(update_map, g_ntpk_db,
+                                             used_key_ids, time.time())
+    else:
+        key_rotation.clear()
+
     key_configs, keys_file_content = \
         ops_ntpd_check_updates_with_ntp_keys(update_map)
     vlog.dbg("Key config changes %s " % (pprint.pformat(key_configs)))
 
+    # Associations refer to their VRF by row uuid
+    for vrf_uuid, ovs_rec in idl.tables[VRF_TABLE].rows.iteritems():
+        vrf_names[str(vrf_uuid)] = ovs_rec.name
+
     update_map = {}
     # Get the NTP association configuration changes
     for ovs_rec in idl.tables[NTP_ASSOCIATION_TABLE].rows.itervalues():
@@ -696,7 +1222,14 @@ def ops_ntpd_check_updates_from_ovsdb():
         prefer = DEFAULT_NTP_PREF
         ntp_version = DEFAULT_NTP_VERSION
         ref_clock_id = DEFAULT_NTP_REF_CLOCK_ID
-        vrf = ovs_rec._data['vrf'].to_json()[1]
+        feed = None
+        nts = False
+        vrf_uuid = ovs_rec._data['vrf'].to_json()[1]
+        if vrf_uuid not in vrf_names:
+            vlog.warn("No VRF for association %s, skipped" %
+                      (ovs_rec.address))
+            continue
+        vrf = vrf_names[vrf_uuid]
         if ovs_rec.address and ovs_rec.address is not None:
             ip_address = ovs_rec.address
         if ovs_rec.key_id and len(ovs_rec.key_id) > 0:
@@ -711,41 +1244,191 @@ def ops_ntpd_check_updates_from_ovsdb():
                     prefer = value
                 if key == 'version':
                     ntp_version = value
+                if key == NTP_REFCLOCK_ATTRIB_FEED:
+                    feed = value
+                if key == 'nts':
+                    nts = value == "true"
+        # NTS authenticates the association in place of a key
+        if nts:
+            if key_id != DEFAULT_NTP_KEY_ID:
+                vlog.warn("Association %s has a key and NTS, key ignored" %
+                          (ip_address))
+            key_id = NTS_KEY_ID
+        if feed is not None and vrf == DEFAULT_VRF_NAME and \
+                ops_ntpd_conf_refclock_driver(ip_address) == \
+                REFCLOCK_DRIVER_SHM:
+            shm_feeds[int(ip_address.split(".")[3])] = feed
+        ntpd_address = ip_address
+        if not ops_ntpd_dns_is_address(ip_address):
+            # Configured once resolved, the resolver seqno then changes
+            dns_names.add((vrf, ip_address))
+            ntpd_address = dns_resolver.lookup(vrf, ip_address)
+            if ntpd_address is None:
+                vlog.dbg("Server %s not resolved yet" % (ip_address))
+                continue
         ops_ntpd_setup_ntp_config_map(
                 update_map, vrf, ip_address,
-                associd, key_id, ref_clock_id, prefer, ntp_version)
+                associd, key_id, ref_clock_id, prefer, ntp_version,
+                ntpd_address)
+    dns_resolver.retain(dns_names)
+    ops_ntpd_update_shm_feeders(shm_feeds)
 
-    server_configs = \
-        ops_ntpd_check_updates_with_ntp_associations(update_map,
-                                                     trigger_reconfig)
+    server_configs = ops_ntpd_check_updates_with_ntp_associations(update_map)
     vlog.dbg("Server config changes %s " %
              (pprint.pformat(server_configs)))
 
-    ops_ntpd_sync_updates_to_ntpd(server_configs, key_configs,
-                                  keys_file_content)
+    ops_ntpd_sync_updates_to_vrf_instances(server_configs,
+                                           key_configs + policy_configs,
+                                           keys_file_content)
+    ops_ntpd_save_applied_state()
+
+
+def ops_ntpd_save_applied_state():
+    '''
+       This function saves the configuration applied to the daemons, so
+       that the next run of ops-ntpd can adopt them. It is only written
+       when it changed.
+    '''
+    global g_ntpa_map
+    global g_ntpk_db
+    global auth_state
+    global ntpd_backend
+    global ntpd_instances
+    global applied_state_digest
+    state = {
+        "backend": ntpd_backend.name,
+        "auth_state": auth_state,
+        "keys": dict([(str(k), list(v)) for k, v in g_ntpk_db.iteritems()]),
+        "associations": sorted([[list(k), list(v)]
+                                for k, v in g_ntpa_map.iteritems()]),
+        "discipline": dict([(vrf_name, instance.discipline) for
+                            vrf_name, instance in ntpd_instances.iteritems()]),
+        "server_policy": ntpd_backend.server_policy,
+        "nts_trusted_certs": ntpd_backend.nts_trusted_certs,
+    }
+    content = json.dumps(state, sort_keys=True)
+    digest = ops_ntpd_conf_digest(content)
+    if digest == applied_state_digest:
+        return
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    try:
+        ops_ntpd_conf_write_atomic(instance.working_dir() +
+                                   NTP_APPLIED_STATE_FILE, content)
+        applied_state_digest = digest
+    except (IOError, OSError) as e:
+        vlog.warn("Unable to save the applied configuration : err %s" %
+                  (str(e)))
+
+
+def ops_ntpd_update_shm_feeders(shm_feeds):
+    '''
+       This function starts a feeder for each SHM reference clock with a
+       local time source, 'shm_feeds' maps a SHM unit to its feed.
+       Feeders of removed or changed feeds are stopped.
+    '''
+    global shm_feeders
+    for unit in shm_feeders.keys():
+        if shm_feeds.get(unit) != shm_feeders[unit].feed:
+            shm_feeders.pop(unit).stop()
+    for unit, feed in shm_feeds.iteritems():
+        if unit not in shm_feeders:
+            shm_feeders[unit] = NTPDShmFeeder(unit, feed)
+            shm_feeders[unit].start()
+
+
+def ops_ntpd_sync_updates_to_vrf_instances(server_configs, key_configs,
+                                           keys_file_content):
+    '''
+       This function renders the configuration of every VRF which has
+       associations, starts the NTPD instances of new VRFs, stops the
+       ones of VRFs left without associations and synchronizes the
+       others.
+    '''
+    global g_ntpa_map
+    global g_ntpk_db
+    global ntpq_info
+    global ntpd_instances
+    global ntpd_backend
+    global perf_stats
+    vrf_names = set([v[1] for v in g_ntpa_map.values()])
+    discipline_vrf = ops_ntpd_vrf_select_discipline(vrf_names)
+
+    for vrf_name in list(ntpd_instances.keys()):
+        if vrf_name != DEFAULT_VRF_NAME and vrf_name not in vrf_names:
+            ops_ntpd_stop_vrf_instance(vrf_name)
+
+    # Release the clock discipline before handing it to another instance
+    for vrf_name in sorted(vrf_names | set([DEFAULT_VRF_NAME]),
+                           key=lambda x: x == discipline_vrf):
+        discipline = (vrf_name == discipline_vrf)
+        associations = [v for v in g_ntpa_map.values() if v[1] == vrf_name]
+        if vrf_name not in ntpd_instances:
+            instance = ops_ntpd_new_vrf_instance(vrf_name)
+            ops_ntpd_start_instance(instance,
+                                    ntpd_backend.render_conf(
+                                        instance, ntpq_info[0], associations,
+                                        g_ntpk_db.keys(), discipline),
+                                    keys_file_content, discipline)
+            continue
+
+        instance = ntpd_instances[vrf_name]
+        conf_file_content = ntpd_backend.render_conf(instance, ntpq_info[0],
+                                                     associations,
+                                                     g_ntpk_db.keys(),
+                                                     discipline)
+
+        configs = []
+        if instance.discipline != discipline:
+            instance.discipline = discipline
+            configs += ntpd_backend.discipline_configs(discipline)
+        with perf_stats.measure(PERF_SYNC_TO_NTPD):
+            ops_ntpd_sync_updates_to_ntpd(instance,
+                                          configs +
+                                          server_configs.get(vrf_name, []),
+                                          key_configs, conf_file_content,
+                                          keys_file_content)
 
 
 def ops_ntpd_init_transaction_mgr():
-    global transaction_queue, sync_mgr
-    transaction_queue = multiprocessing.Queue()
-    sync_mgr = multiprocessing.Process(target=ops_ntpd_sync_mgr_run,
-                                       args=(transaction_queue,))
-    sync_mgr.start()
+    global idl
+    global transaction_mgr
+    global perf_stats
+    transaction_mgr = NTPTransactionMgr(idl, perf_stats)
 
 
-def ops_ntpd_send_info_to_transaction_mgr(ntpd_update_str):
-    global transaction_queue, sync_mgr
-    transaction_queue.put(ntpd_update_str)
+def ops_ntpd_send_info_to_transaction_mgr(ntpd_updates):
+    global transaction_mgr
+    transaction_mgr.queue_info(ntpd_updates)
 
 
 def ops_ntpd_shutdown_transaction_mgr():
-    global transaction_queue, sync_mgr
-    transaction_queue.put("shutdown")
-    transaction_queue.close()
-    transaction_queue.join_thread()
-    sync_mgr.join()
-    transaction_queue = None
-    sync_mgr = None
+    global transaction_mgr
+    # Commit the last status before the IDL is closed
+    transaction_mgr.flush(OPS_NTPD_SHUTDOWN_COMMIT_TIMEOUT)
+    transaction_mgr = None
+
+
+def ops_ntpd_get_config_digest():
+    '''
+       This function returns a digest of the configuration columns
+       read from OVSDB. The IDL also changes when only the status
+       committed by ops-ntpd changed, which must not reconfigure NTPD.
+    '''
+    global idl
+    config = []
+    for ovs_rec in idl.tables[SYSTEM_TABLE].rows.itervalues():
+        config.append(sorted(ovs_rec.ntp_config.items()))
+    for vrf_uuid, ovs_rec in idl.tables[VRF_TABLE].rows.iteritems():
+        config.append((str(vrf_uuid), ovs_rec.name))
+    for ovs_rec in idl.tables[NTP_KEY_TABLE].rows.itervalues():
+        config.append((ovs_rec.key_id, ovs_rec.key_password,
+                       ovs_rec.trust_enable))
+    for ovs_rec in idl.tables[NTP_ASSOCIATION_TABLE].rows.itervalues():
+        config.append((ovs_rec._data[NTP_ASSOCIATION_VRF].to_json(),
+                       ovs_rec.address,
+                       [x.key_id for x in ovs_rec.key_id],
+                       sorted(ovs_rec.association_attributes.items())))
+    return ops_ntpd_conf_digest(repr(sorted(config)))
 
 
 def ops_ntpd_connection_exit_handler(conn, unused_argv, unused_aux):
@@ -779,6 +1462,8 @@ def ops_ntpd_setup_ovsdb_monitoring(remote):
     '''
     global idl
     schema_helper = ovs.db.idl.SchemaHelper(location=ovs_schema)
+    # Status columns, committed on the same connection
+    ops_ntpd_sync_mgr_register_columns(schema_helper)
     schema_helper.register_columns(SYSTEM_TABLE,
                                    [SYSTEM_NTP_CONFIG, SYSTEM_CUR_CFG])
     schema_helper.register_columns(NTP_ASSOCIATION_TABLE,
@@ -790,39 +1475,273 @@ def ops_ntpd_setup_ovsdb_monitoring(remote):
                                    [NTP_KEY_ID,
                                     NTP_KEY_PASSWORD,
                                     NTP_KEY_TRUST_ENABLE])
+    schema_helper.register_columns(VRF_TABLE, [VRF_NAME])
     idl = ovs.db.idl.Idl(remote, schema_helper)
 
 
+def ops_ntpd_setup_instance_files(instance, working_dir):
+    '''
+       This function sets the files of an instance, in its working
+       directory
+    '''
+    instance.conf_file = working_dir + "ops_ntp.conf"
+    instance.keys_file = working_dir + "ops_ntp.keys"
+    instance.log_file = ops_ntpd_setup_ntpd_default_log_file(working_dir)
+    instance.pid_file = working_dir + "ntpd.pid"
+    instance.drift_file = ops_ntpd_state_drift_file(instance.vrf_name)
+
+
 def ops_ntpd_setup_ntpd_default_config():
     '''
        This function sets the default configuration for the NTPD daemon
     '''
+    global ntpd_instances
+    global ntpd_backend
+    global warm_start
     ntp_dir_path = "/etc/ntp/"
+    # The daemons of a previous run are stopped before their working
+    # directories, and pid files, are removed
+    ops_ntpd_stop_stale_ntpd_instances(ntp_dir_path)
     ops_ntpd_create_working_dir(ntp_dir_path)
     ops_ntpd_setup_ntpq_integration(ntp_dir_path)
+    warm_start.load()
+    ntpd_backend.warm_server = warm_start.server()
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    ops_ntpd_setup_instance_files(instance, ntp_dir_path)
+    instance.interface = "eth0"
     conf_file = ops_ntpd_setup_ntpd_default_config_file(ntp_dir_path)
     keys_file = ops_ntpd_setup_ntpd_default_keys_file(ntp_dir_path)
-    log_file = ops_ntpd_setup_ntpd_default_log_file(ntp_dir_path)
     vlog.info("NTP default files setup done")
-    return (conf_file, keys_file, log_file)
+    return (conf_file, keys_file, instance.log_file)
 
 
 def ops_ntpd_start_ntpd(ntpd_info):
     '''
-       This function starts the NTPD daemon
+       This function starts the NTPD daemon of the default VRF
     '''
-    global ntpd_process
     global ntpd_command
-    ntpd_process = None
-    (conf_file, keys_file, log_file) = ntpd_info
-    ntpd_command = "ntpd -I eth0 -c %s -k %s -l %s" % (conf_file, keys_file, log_file)
-    err, out = ops_ntpd_run_command(ntpd_command)
-    if err != "":
-        vlog.emer("%s" % (err))
+    global ntpd_instances
+    global ntpd_backend
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    argv = instance.argv(ntpd_backend.daemon_argv(instance))
+    ntpd_command = " ".join(argv)
+    instance.supervisor = NTPDSupervisor(DEFAULT_VRF_NAME, argv,
+                                         instance.pid_file, instance.log_file)
+    if instance.supervisor.start():
+        vlog.info("ops-ntpd - ntpd started")
+    else:
         vlog.emer("Error with config, ntpd failed, command %s" %
                   (ntpd_command))
-    else:
-        vlog.info("ops-ntpd - ntpd started")
+
+
+def ops_ntpd_new_vrf_instance(vrf_name):
+    '''
+       This function creates the NTPD instance of a VRF, and its working
+       directory
+    '''
+    instance = NTPDInstance(vrf_name)
+    working_dir = ops_ntpd_vrf_working_dir(vrf_name)
+    ops_ntpd_create_working_dir(working_dir)
+    ops_ntpd_setup_instance_files(instance, working_dir)
+    return instance
+
+
+def ops_ntpd_start_instance(instance, conf_file_content, keys_file_content,
+                            discipline):
+    '''
+       This function starts the NTPD of an instance, in the network
+       namespace of its VRF. NTPD is started with the complete
+       configuration, so nothing has to be pushed through ntpq.
+    '''
+    global ntpd_instances
+    global ntpd_backend
+    ops_ntpd_set_file_contents(instance.conf_file, conf_file_content)
+    ops_ntpd_set_file_contents(instance.keys_file, keys_file_content)
+    instance.conf_digest = ops_ntpd_conf_digest(conf_file_content)
+    instance.keys_digest = ops_ntpd_conf_digest(keys_file_content)
+    instance.discipline = discipline
+    argv = instance.argv(ntpd_backend.daemon_argv(instance))
+    # A failed start is retried by the supervisor, with backoff
+    instance.supervisor = NTPDSupervisor(instance.vrf_name, argv,
+                                         instance.pid_file, instance.log_file)
+    instance.supervisor.start()
+    ntpd_instances[instance.vrf_name] = instance
+    vlog.info("ops-ntpd - %s started in VRF %s" %
+              (ntpd_backend.daemon, instance.vrf_name))
+
+
+def ops_ntpd_stop_vrf_instance(vrf_name):
+    '''
+       This function stops the NTPD instance of a VRF
+    '''
+    global ntpd_instances
+    instance = ntpd_instances.pop(vrf_name)
+    instance.supervisor.stop()
+    ops_ntpd_cleanup_working_dir(ops_ntpd_vrf_working_dir(vrf_name))
+    vlog.info("ops-ntpd - ntpd stopped in VRF %s" % (vrf_name))
+
+
+def ops_ntpd_stop_stale_ntpd_instances(ntp_dir_path, adopted=()):
+    '''
+       This function stops the daemons left running by a previous run
+       of ops-ntpd, except the adopted ones
+    '''
+    for pid_file in [ntp_dir_path + "ntpd.pid"] + \
+            glob.glob(NTP_VRF_DIR + "*/ntpd.pid"):
+        if pid_file not in adopted:
+            ops_ntpd_supervisor_stop_stale(pid_file)
+
+
+def ops_ntpd_applied_tuple(values):
+    '''
+       This function converts a JSON list of the applied configuration
+       back to a reconciliation tuple
+    '''
+    return tuple([str(x) if isinstance(x, unicode) else x for x in values])
+
+
+def ops_ntpd_adopt_instance(instance, associations, keys):
+    '''
+       This function adopts the running daemon of an instance, once it
+       answered on its control socket. The backend is primed with the
+       configuration the daemon was last synchronized with, the conf and
+       keys digests are the ones of the files it runs with.
+       It returns the addresses the daemon has associations with, None
+       if the daemon was not adopted.
+    '''
+    global ntpd_instances
+    global ntpd_backend
+    global ntpq_info
+    daemon_argv = ntpd_backend.daemon_argv(instance)
+    supervisor = NTPDSupervisor(instance.vrf_name,
+                                instance.argv(daemon_argv),
+                                instance.pid_file, instance.log_file)
+    if not supervisor.adopt(daemon_argv):
+        return None
+    instance.supervisor = supervisor
+    if not ntpd_backend.probe(instance):
+        vlog.warn("%s %s does not answer, not adopted" %
+                  (ntpd_backend.daemon, instance.vrf_name))
+        supervisor.stop()
+        instance.supervisor = None
+        return None
+    try:
+        instance.conf_digest = ops_ntpd_conf_digest(
+            "".join(ops_ntpd_get_file_contents(instance.conf_file)))
+        instance.keys_digest = ops_ntpd_conf_digest(
+            "".join(ops_ntpd_get_file_contents(instance.keys_file)))
+    except IOError as e:
+        vlog.warn("Unable to read the files of %s %s : err %s" %
+                  (ntpd_backend.daemon, instance.vrf_name, str(e)))
+        supervisor.stop()
+        instance.supervisor = None
+        return None
+    ntpd_backend.render_conf(instance, ntpq_info[0], associations,
+                             keys.keys(), instance.discipline)
+    live = set(ntpd_backend.read_associations(instance).keys())
+    ntpd_instances[instance.vrf_name] = instance
+    return live
+
+
+def ops_ntpd_adopt_ntpd_instances(ntp_dir_path):
+    '''
+       This function adopts the daemons left running by a previous run
+       of ops-ntpd instead of restarting them, so the clock stays
+       synchronized. The reconciliation state is seeded with what the
+       daemons run, the configuration they were last synchronized with
+       restricted to their live associations, so the first sync only
+       pushes the differences with OVSDB.
+       It returns the default files, like
+       ops_ntpd_setup_ntpd_default_config(), None if the default VRF
+       daemon was not adopted.
+    '''
+    global ntpd_instances
+    global ntpd_backend
+    global warm_start
+    global ntpq_info
+    global g_ntpa_map
+    global g_ntpk_db
+    global auth_state
+    applied = ops_ntpd_state_load(ntp_dir_path + NTP_APPLIED_STATE_FILE)
+    if applied.get("backend") != ntpd_backend.name:
+        vlog.info("No %s configuration to adopt" % (ntpd_backend.daemon))
+        return None
+    try:
+        associations = dict([(ops_ntpd_applied_tuple(k),
+                              ops_ntpd_applied_tuple(v))
+                             for (k, v) in applied["associations"]])
+        keys = dict([(int(k), ops_ntpd_applied_tuple(v))
+                     for (k, v) in applied["keys"].iteritems()])
+        disciplines = applied["discipline"]
+        applied_auth_state = str(applied["auth_state"])
+        server_policy = applied.get("server_policy")
+        if server_policy is not None:
+            server_policy = {
+                "allow": [str(x) for x in server_policy["allow"]],
+                "average": int(server_policy["average"]),
+                "minimum": int(server_policy["minimum"])}
+        nts_trusted_certs = applied.get("nts_trusted_certs")
+        if nts_trusted_certs is not None:
+            nts_trusted_certs = str(nts_trusted_certs)
+    except (KeyError, TypeError, ValueError, AttributeError) as e:
+        vlog.warn("Invalid applied configuration : err %s" % (str(e)))
+        return None
+
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    ops_ntpd_setup_instance_files(instance, ntp_dir_path)
+    instance.interface = "eth0"
+    password = ops_ntpd_conf_read_control_key(instance.keys_file,
+                                              controlkey)
+    if password is None:
+        vlog.info("No control key to adopt %s" % (ntpd_backend.daemon))
+        return None
+    ntpq_info = (controlkey, password)
+    warm_start.load()
+    ntpd_backend.warm_server = warm_start.server()
+    # The daemons run with the server mode they were started with
+    ntpd_backend.server_policy = server_policy
+    ntpd_backend.nts_trusted_certs = nts_trusted_certs
+
+    adopted = []
+    vrf_names = set([v[1] for v in associations.values()])
+    for vrf_name in sorted(vrf_names | set([DEFAULT_VRF_NAME]),
+                           key=lambda x: x != DEFAULT_VRF_NAME):
+        if vrf_name != DEFAULT_VRF_NAME:
+            instance = NTPDInstance(vrf_name)
+            ops_ntpd_setup_instance_files(instance,
+                                          ops_ntpd_vrf_working_dir(vrf_name))
+        instance.discipline = disciplines.get(vrf_name,
+                                              vrf_name == DEFAULT_VRF_NAME)
+        applied_map = dict([(k, v) for k, v in associations.iteritems()
+                            if v[1] == vrf_name])
+        live = ops_ntpd_adopt_instance(instance, applied_map.values(), keys)
+        if live is None:
+            if vrf_name == DEFAULT_VRF_NAME:
+                return None
+            # Started again as a new VRF by the first sync
+            continue
+        adopted.append(instance.pid_file)
+        for k, v in applied_map.iteritems():
+            if v[0] in live:
+                g_ntpa_map[k] = v
+        # Associations the daemon has but the applied configuration
+        # does not are removed by the first sync, unless configured
+        for address in live - set([v[0] for v in applied_map.values()]):
+            g_ntpa_map[(vrf_name, address)] = (
+                address, vrf_name, DEFAULT_NTP_KEY_ID,
+                DEFAULT_NTP_REF_CLOCK_ID, DEFAULT_NTP_PREF,
+                DEFAULT_NTP_VERSION)
+        if live != set([v[0] for v in applied_map.values()]):
+            # The conf file does not match the daemon, the first sync
+            # pushes its differences even if the file does not change
+            instance.conf_digest = None
+        vlog.info("%s %s adopted with %d association(s)" %
+                  (ntpd_backend.daemon, vrf_name, len(live)))
+    ops_ntpd_stop_stale_ntpd_instances(ntp_dir_path, adopted)
+    g_ntpk_db = keys
+    auth_state = applied_auth_state
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    return (instance.conf_file, instance.keys_file, instance.log_file)
 
 
 def ops_ntpd_provision_ntpd_daemon():
@@ -834,6 +1753,8 @@ def ops_ntpd_provision_ntpd_daemon():
     global seqno
     global ntpd_started
     global ntpd_info
+    global ntpd_backend
+    global config_digest
     idl.run()
     if seqno != idl.change_seqno:
         vlog.dbg("ops-ntpd-debug - seqno change from %d to %d "
@@ -843,60 +1764,212 @@ def ops_ntpd_provision_ntpd_daemon():
         if ops_ntpd_check_system_status() is False:
             return
         else:
-            # Get the default ntp config, keys file
-            ntpd_info = ops_ntpd_setup_ntpd_default_config()
-            # Kill zombie ntpd process and Start a new ntpd daemon
-            ops_ntpd_cleanup_ntpd_processes()
-            ops_ntpd_start_ntpd(ntpd_info)
+            ops_ntpd_set_backend(ops_ntpd_get_backend())
+            ntpd_backend.server_policy = ops_ntpd_get_server_policy()
+            ntpd_backend.nts_trusted_certs = \
+                ops_ntpd_get_nts_trusted_certs()
+            ntpd_info = None
+            if ops_ntpd_get_hitless_restart():
+                # Keep the daemons of the previous run of ops-ntpd
+                ntpd_info = ops_ntpd_adopt_ntpd_instances("/etc/ntp/")
             ops_ntpd_init_transaction_mgr()
+            if ntpd_info is None:
+                # Get the default ntp config, keys file
+                ntpd_info = ops_ntpd_setup_ntpd_default_config()
+                # Start a new ntpd daemon, the ones left by a previous
+                # run of ops-ntpd are stopped through their pid files
+                ops_ntpd_start_ntpd(ntpd_info)
+                time.sleep(5)
             # Get the ntp config
-            time.sleep(5)
+            config_digest = ops_ntpd_get_config_digest()
             ops_ntpd_check_updates_from_ovsdb()
             ntpd_started = True
 
 
-def ops_ntpd_cleanup_ntpd_processes():
+def ops_ntpd_supervise_ntpd_instances():
+    '''
+       This function reaps the NTPD instances which exited and restarts
+       them once their backoff expired. A restarted NTPD reads the
+       current conf and keys files, nothing has to be pushed.
+    '''
+    global ntpd_instances
+    now = time.time()
+    for instance in ntpd_instances.values():
+        if instance.supervisor is not None:
+            instance.supervisor.poll(now)
+
+
+def ops_ntpd_stop_ntpd_instances():
+    '''
+       This function stops all the NTPD instances
+    '''
+    global ntpd_instances
+    for vrf_name in list(ntpd_instances.keys()):
+        if vrf_name != DEFAULT_VRF_NAME:
+            ops_ntpd_stop_vrf_instance(vrf_name)
+    instance = ntpd_instances[DEFAULT_VRF_NAME]
+    if instance.supervisor is not None:
+        instance.supervisor.stop()
+
+
+def ops_ntpd_show_ntpd_instances(conn, unused_argv, unused_aux):
+    '''
+       unixctl handler listing the NTPD instances and their supervision
+       state
+    '''
+    global ntpd_instances
+    now = time.time()
+    lines = ["%-16s %-8s %-10s %-10s %s" %
+             ("VRF", "PID", "UPTIME", "RESTARTS", "DISCIPLINE")]
+    for vrf_name, instance in sorted(ntpd_instances.iteritems()):
+        supervisor = instance.supervisor
+        if supervisor is None:
+            continue
+        lines.append("%-16s %-8s %-10d %-10d %s" %
+                     (vrf_name, supervisor.pid() or "-",
+                      supervisor.uptime(now), supervisor.restarts,
+                      "yes" if instance.discipline else "no"))
+    conn.reply("\n".join(lines) + "\n")
+
+
+def ops_ntpd_show_ntpd_clients(conn, argv, unused_aux):
+    '''
+       unixctl handler listing the clients with the highest request
+       rate, DEFAULT_TOP_CLIENTS unless a count is given
+    '''
+    global ntpd_backend
+    global client_table
+    count = DEFAULT_TOP_CLIENTS
+    if argv:
+        try:
+            count = int(argv[0])
+        except ValueError:
+            conn.reply_error("Invalid client count %s\n" % (argv[0]))
+            return
+    if ntpd_backend.server_policy is None:
+        conn.reply("NTP server mode is disabled\n")
+        return
+    conn.reply("".join(client_table.dump(time.time(), count)))
+
+
+def ops_ntpd_show_perf(conn, argv, unused_aux):
+    '''
+       unixctl handler listing the latency histograms of the main loop
+       phases, and clearing them with 'reset'
+    '''
+    global perf_stats
+    if argv and argv[0] != "reset":
+        conn.reply_error("Invalid argument %s\n" % (argv[0]))
+        return
+    lines = perf_stats.dump(time.time())
+    if argv:
+        perf_stats.reset()
+    conn.reply("".join(lines))
+
+
+def ops_ntpd_diagnostics_log(log_file, lines, window, now):
+    '''
+       This function returns the lines of 'log_file' for the diagnostic
+       dump: the ones of the last 'window' seconds if set, otherwise the
+       last 'lines' lines, bounded in size in both cases
+    '''
+    try:
+        if window:
+            return ops_ntpd_log_tail(log_file, since=now - window, now=now)
+        return ops_ntpd_log_tail(log_file, lines=lines)
+    except IOError as e:
+        return ["Unable to read %s : err %s\n" % (log_file, str(e))]
+
+
+def ops_ntpd_diagnostics_file(path):
     '''
-       This function cleans up zombie NTPD processes
+       This function returns the lines of the configuration or keys file
+       'path' for the diagnostic dump, bounded in size
     '''
-    err, out = ops_ntpd_run_command("ps -A")
-    for line in out[0].splitlines():
-        if 'ntpd -c' in line or 'ntpq' in line:
-            pid = int(line.split(None, 1)[0])
-            os.kill(pid, signal.SIGKILL)
-            vlog.dbg("Killing zombie ntpd process pid : %s" % pid)
+    try:
+        return ops_ntpd_log_tail(path, lines=None,
+                                 max_bytes=DIAG_CONF_MAX_BYTES)
+    except IOError as e:
+        return ["Unable to read %s : err %s\n" % (path, str(e))]
 
 
 def ops_ntpd_diagnostics_handler(argv):
     global ntpd_info
+    global ntpd_instances
+    global dns_resolver
+    global shm_feeders
+    global warm_start
+    global client_table
+    global key_rotation
+    global perf_stats
     # argv[0] is basic
     # argv[1] is feature name
     feature = argv.pop()
     buff = 'Diagnostic dump for ' + feature + '.\n'
     (conf_file, keys_file, log_file) = ntpd_info
+    (unused_size, unused_count, log_lines, log_window) = \
+        ops_ntpd_get_log_settings()
+    now = time.time()
 
     # Capture the configuration file info with ntpd
-    with open(conf_file, "r") as f:
-        fbuff = ['NTPD configuration file\n']
+    fbuff = ['NTPD configuration file\n']
+    fbuff += ['===============================================\n']
+    fbuff += ops_ntpd_diagnostics_file(conf_file)
+
+    # Capture the keys_file info with ntpd, without the passwords
+    fbuff += ['NTPD keys file\n']
+    fbuff += ['===============================================\n']
+    fbuff += [ops_ntpd_log_redact_keys(line)
+              for line in ops_ntpd_diagnostics_file(keys_file)]
+
+    # Capture the tail, or the last seconds, of the log_file with ntpd
+    fbuff += ['NTPD log file\n']
+    fbuff += ['===============================================\n']
+    fbuff += ops_ntpd_diagnostics_log(log_file, log_lines, log_window, now)
+
+    # Capture the configuration and log files of the other VRF instances
+    for vrf_name, instance in sorted(ntpd_instances.iteritems()):
+        if vrf_name == DEFAULT_VRF_NAME:
+            continue
+        fbuff += ['NTPD configuration file, VRF %s\n' % (vrf_name)]
         fbuff += ['===============================================\n']
-        fbuff += f.readlines()
-
-    # Capture the keys_file info with ntpd
-    with open(keys_file, "r") as f:
-        fbuff += ['NTPD keys file\n']
+        fbuff += ops_ntpd_diagnostics_file(instance.conf_file)
+        fbuff += ['NTPD log file, VRF %s\n' % (vrf_name)]
         fbuff += ['===============================================\n']
-        fbuff += f.readlines()
+        fbuff += ops_ntpd_diagnostics_log(instance.log_file, log_lines,
+                                          log_window, now)
 
-    # Capture the log_file info with ntpd
-    with open(log_file, "r") as f:
-        fbuff += ['NTPD log file\n']
-        fbuff += ['===============================================\n']
-        fbuff += f.readlines()
+    # Capture the server name resolutions
+    fbuff += ['DNS resolver cache\n']
+    fbuff += ['===============================================\n']
+    fbuff += dns_resolver.dump()
+
+    # Capture the SHM reference clock feeders
+    fbuff += ['SHM reference clock feeders\n']
+    fbuff += ['===============================================\n']
+    fbuff += [shm_feeders[unit].dump() for unit in sorted(shm_feeders)]
+
+    # Capture the warm start state
+    fbuff += ['Warm start state\n']
+    fbuff += ['===============================================\n']
+    fbuff += warm_start.dump()
+
+    # Capture the top clients of the server mode
+    fbuff += ['Top NTP clients\n']
+    fbuff += ['===============================================\n']
+    fbuff += client_table.dump(time.time())
 
-    for x in fbuff:
-        buff += x
+    # Capture the staged key rotation
+    fbuff += ['NTP key rotation\n']
+    fbuff += ['===============================================\n']
+    fbuff += key_rotation.dump(time.time())
 
-    return buff
+    # Capture the latency of the main loop phases
+    fbuff += ['Main loop phase latency\n']
+    fbuff += ['===============================================\n']
+    fbuff += perf_stats.dump(time.time())
+
+    return buff + "".join(fbuff)
 
 
 def ops_ntpd_init():
@@ -910,6 +1983,10 @@ def ops_ntpd_init():
     global idl
     global seqno
     global ntpd_started
+    global dns_resolver
+    global key_rotation
+    global perf_stats
+    global transaction_mgr
 
     parser = argparse.ArgumentParser()
     parser.add_argument('-d', '--database', metavar="DATABASE",
@@ -932,11 +2009,18 @@ def ops_ntpd_init():
     ovs.daemon._make_pidfile()
     ovs.unixctl.command_register("exit", "", 0, 0,
                                  ops_ntpd_connection_exit_handler, None)
+    ovs.unixctl.command_register("ntpd/show", "", 0, 0,
+                                 ops_ntpd_show_ntpd_instances, None)
+    ovs.unixctl.command_register("ntpd/clients", "[COUNT]", 0, 1,
+                                 ops_ntpd_show_ntpd_clients, None)
+    ovs.unixctl.command_register("ntpd/perf", "[reset]", 0, 1,
+                                 ops_ntpd_show_perf, None)
     error, unixctl_server = ovs.unixctl.server.UnixctlServer.create(None)
 
     if error:
         ovs.util.ovs_fatal(error, "ops_ntpd_helper: could not create "
                                   "unix-ctl server", vlog)
+    dns_resolver.start()
     while ntpd_started is False:
         ops_ntpd_provision_ntpd_daemon()
         time.sleep(2)
@@ -948,28 +2032,52 @@ def ops_ntpd_init():
     ops_diagdump.init_diag_dump_basic(ops_ntpd_diagnostics_handler)
 
     seqno = idl.change_seqno    # Sequence number when we last processed the db
+    last_refresh = 0
+    last_clients_refresh = 0
+    last_log_rotate = 0
     exiting = False
     while not exiting:
         unixctl_server.run()
         if exiting:
             break
         idl.run()
-        if seqno == idl.change_seqno:
+        transaction_mgr.run()
+        ops_ntpd_supervise_ntpd_instances()
+        now = time.time()
+        if now - last_log_rotate >= LOG_ROTATE_INTERVAL:
+            ops_ntpd_rotate_logs()
+            last_log_rotate = now
+        if ops_ntpd_check_config_changes(now):
+            continue
+
+        if now - last_refresh >= OPS_NTPD_STATUS_REFRESH_INTERVAL:
             ops_ntpd_sync_updates_to_ovsdb()
-            time.sleep(2)
+            last_refresh = now
+        elif now - last_clients_refresh >= CLIENTS_REFRESH_INTERVAL:
+            ops_ntpd_refresh_clients()
+            last_clients_refresh = now
         else:
-            vlog.dbg("ops-ntpd-debug main - seqno change from %d to %d "
-                     % (seqno, idl.change_seqno))
-            ops_ntpd_check_updates_from_ovsdb()
-            seqno = idl.change_seqno
+            ops_ntpd_sync_kernel_status_to_ovsdb()
+
+        sleep = OPS_NTPD_LOOP_INTERVAL
+        deadline = ops_ntpd_get_config_deadline()
+        if deadline is not None:
+            # Wake up in time to honor the debounce window
+            sleep = min(sleep, max(deadline - time.time(), 0))
+        time.sleep(sleep)
 
     # Daemon exit
+    hitless_restart = ops_ntpd_get_hitless_restart()
     unixctl_server.close()
-    if ntpd_process is not None:
-        vlog.dbg("ops-ntpd-debug - killing ntpd")
-    idl.close()
-    ops_ntpd_cleanup_ntpd_processes()
     ops_ntpd_shutdown_transaction_mgr()
+    idl.close()
+    dns_resolver.stop()
+    ops_ntpd_update_shm_feeders({})
+    if hitless_restart:
+        # Adopted by the next run of ops-ntpd
+        vlog.info("Leaving %s running" % (ntpd_backend.daemon))
+    else:
+        ops_ntpd_stop_ntpd_instances()
 
 if __name__ == '__main__':
     try:
@@ -0,0 +1,702 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_BACKEND module
+ - Time daemon drivers. ops-ntpd reconciles the OVSDB configuration,
+   supervises the daemons and publishes their state the same way for
+   every time daemon, a driver covers what is specific to one:
+   - the daemon command line and the rendered configuration files
+   - the changes pushed to a running daemon
+   - the association status and the global statistics
+ - "ntpd" drives classic NTPD through ntpq and ntpdc, it is the default.
+ - "chrony" drives chronyd through chronyc in CSV mode (-c), on the
+   command socket of each instance. Changes chronyd cannot take at
+   runtime (reference clocks, clock discipline) restart it.
+ - The association status of every driver is returned as rows keyed
+   like the ntpq 'apeers' and 'rv' fields, with NTPD units (ms).
+ - The backend is selected with the 'backend' key of System:ntp_config.
+ - Changes of the server mode restart the daemons, with the complete
+   configuration, for every backend.
+ - A daemon adopted on a hitless restart is probed on its control
+   socket first, a daemon which does not answer is restarted.
+ - NTS associations run on chronyd only, NTPD 4.2.8 has no NTS. The
+   "ntpd" driver leaves them out, with a warning.
+'''
+
+import time
+import ovs.vlog
+from ops_ntpd_clients import CLIENT_ADDRESS
+from ops_ntpd_clients import CLIENT_COUNT
+from ops_ntpd_clients import CLIENT_AVGINT
+from ops_ntpd_clients import CLIENT_LSTINT
+from ops_ntpd_clients import CLIENT_LIMITED
+from ops_ntpd_nts import NTS_LAST_KE
+from ops_ntpd_nts import NTS_COOKIES
+from ops_ntpd_conf import ops_ntpd_conf_render_conf
+from ops_ntpd_conf import ops_ntpd_conf_render_chrony_conf
+from ops_ntpd_conf import ops_ntpd_conf_render_keys
+from ops_ntpd_conf import ops_ntpd_conf_render_chrony_keys
+from ops_ntpd_conf import CONTROL_KEY_TYPE
+from ops_ntpd_conf import ops_ntpd_conf_server_lines
+from ops_ntpd_conf import ops_ntpd_conf_refclock_driver
+from ops_ntpd_conf import ops_ntpd_conf_refclock_refid
+from ops_ntpd_conf import NTS_KEY_ID
+from ops_ntpd_conf import CHRONY_MAX_RATELIMIT_INTERVAL
+
+vlog = ovs.vlog.Vlog("ops_ntpd_backend")
+
+DEFAULT_NTPD_BACKEND = "ntpd"
+# Pushed instead of runtime changes the daemon cannot take
+NTPD_BACKEND_RESTART = "restart"
+DEFAULT_NTP_KEY_ID = 0
+DEFAULT_NTP_PREF = "false"
+
+# Association status row keys
+NTPQ_REMOTE = "remote"
+NTPQ_REFID = "refid"
+NTPQ_ST = "st"
+NTPQ_T = "t"
+NTPQ_WHEN = "when"
+NTPQ_POLL = "poll"
+NTPQ_REACH = "reach"
+NTPQ_DELAY = "delay"
+NTPQ_OFFSET = "offset"
+NTPQ_JITTER = "jitter"
+NTPQ_ROOT_DISPERSION = "root_dispersion"
+NTPQ_REFERENCE_TIME = "reference_time"
+NTPQ_PEER_STATUS_WORD = "peer_status_word"
+NTPQ_ASSOCID = "associd"
+
+# ntpq sysstats labels
+NTPQ_UPTIME = "uptime"
+NTPQ_PACKETS_RECEIVED = "packets received"
+NTPQ_CURRENT_VERSION = "current version"
+NTPQ_OLDER_VERSION = "older version"
+NTPQ_BAD_LENGTH_OR_FORMAT = "bad length or format"
+NTPQ_AUTHENTICATION_FAILED = "authentication failed"
+NTPQ_DECLINED = "declined"
+NTPQ_RESTRICTED = "restricted"
+NTPQ_RATE_LIMITED = "rate limited"
+NTPQ_KOD_RESPONSES = "KoD responses"
+
+# NTP global statistics keys
+NTP_STAT_NTP_PKTS_RECEIVED = "ntp_pkts_received"
+NTP_STAT_NTP_PKTS_WITH_CURRENT_VERSION = "ntp_pkts_with_current_version"
+NTP_STAT_NTP_PKTS_WITH_OLDER_VERSION = "ntp_pkts_with_older_version"
+NTP_STAT_NTP_PKTS_WITH_BAD_LENGTH_OR_FORMAT = \
+    "ntp_pkts_with_bad_length_or_format"
+NTP_STAT_NTP_PKTS_WITH_AUTH_FAILED = "ntp_pkts_with_auth_failed"
+NTP_STAT_NTP_PKTS_DECLINED = "ntp_pkts_declined"
+NTP_STAT_NTP_PKTS_RESTRICTED = "ntp_pkts_restricted"
+NTP_STAT_NTP_PKTS_RATE_LIMITED = "ntp_pkts_rate_limited"
+NTP_STAT_NTP_PKTS_KOD_RESPONSES = "ntp_pkts_kod_responses"
+
+translate_sysstats = {
+    NTPQ_PACKETS_RECEIVED: NTP_STAT_NTP_PKTS_RECEIVED,
+    NTPQ_CURRENT_VERSION: NTP_STAT_NTP_PKTS_WITH_CURRENT_VERSION,
+    NTPQ_OLDER_VERSION: NTP_STAT_NTP_PKTS_WITH_OLDER_VERSION,
+    NTPQ_BAD_LENGTH_OR_FORMAT: NTP_STAT_NTP_PKTS_WITH_BAD_LENGTH_OR_FORMAT,
+    NTPQ_AUTHENTICATION_FAILED: NTP_STAT_NTP_PKTS_WITH_AUTH_FAILED,
+    NTPQ_DECLINED: NTP_STAT_NTP_PKTS_DECLINED,
+    NTPQ_RESTRICTED: NTP_STAT_NTP_PKTS_RESTRICTED,
+    NTPQ_RATE_LIMITED: NTP_STAT_NTP_PKTS_RATE_LIMITED,
+    NTPQ_KOD_RESPONSES: NTP_STAT_NTP_PKTS_KOD_RESPONSES,
+}
+
+# chronyc -c field positions
+CHRONY_SOURCES_MODE = 0
+CHRONY_SOURCES_STATE = 1
+CHRONY_SOURCES_NAME = 2
+CHRONY_SOURCES_STRATUM = 3
+CHRONY_SOURCES_POLL = 4
+CHRONY_SOURCES_REACH = 5
+CHRONY_SOURCES_LAST_RX = 6
+CHRONY_SOURCES_OFFSET = 7
+CHRONY_SOURCESTATS_NAME = 0
+CHRONY_SOURCESTATS_STD_DEV = 7
+CHRONY_NTPDATA_ADDRESS = 0
+CHRONY_NTPDATA_ROOT_DISPERSION = 10
+CHRONY_NTPDATA_REFID_NAME = 12
+CHRONY_NTPDATA_REFERENCE_TIME = 13
+CHRONY_SERVERSTATS_NTP_RECEIVED = 0
+CHRONY_SERVERSTATS_NTP_DROPPED = 1
+CHRONY_CLIENTS_ADDRESS = 0
+CHRONY_CLIENTS_NTP = 1
+CHRONY_CLIENTS_NTP_DROPPED = 2
+CHRONY_CLIENTS_NTP_INTERVAL = 3
+CHRONY_CLIENTS_NTP_LAST = 5
+CHRONY_AUTHDATA_NAME = 0
+CHRONY_AUTHDATA_MODE = 1
+CHRONY_AUTHDATA_LAST = 5
+CHRONY_AUTHDATA_COOKIES = 8
+CHRONY_AUTHDATA_MODE_NTS = "NTS"
+# chronyc reports an unknown interval as 127 (log2 seconds)
+CHRONY_CLIENTS_NO_INTERVAL = 127
+
+# ntpq mrulist columns: lstint avgint rstr r m v count rport remote address
+NTPQ_MRU_LSTINT = 0
+NTPQ_MRU_AVGINT = 1
+NTPQ_MRU_FLAGS = 3
+NTPQ_MRU_MODE = 4
+NTPQ_MRU_COUNT = 6
+NTPQ_MRU_ADDRESS = 8
+# Mode of the requests of a client
+NTPQ_MRU_MODE_CLIENT = "3"
+# Rate limited, answered with a KoD
+NTPQ_MRU_LIMITED_FLAGS = "LK"
+
+# chronyc source mode and state, as ntpq peer type and selection
+translate_chrony_mode = {
+    "^": "u",
+    "=": "s",
+    "#": "l",
+}
+translate_chrony_state = {
+    "*": "sel_sys.peer",
+    "+": "sel_candidate",
+    "-": "sel_outlyer",
+    "x": "sel_falsetick",
+    "~": "sel_reject",
+    "?": "sel_reject",
+}
+
+
+class NTPDBackend(object):
+
+    name = None
+    daemon = None
+
+    def __init__(self, run_command):
+        '''
+        A time daemon driver. Control commands are run through
+        'run_command', which returns the (stderr, (stdout, stderr)) of a
+        shell command.
+        '''
+        self.run_command = run_command
+        # (vrf, address) of the last known good server, polled with
+        # iburst on a warm start
+        self.warm_server = None
+        # Server mode policy of every instance, None for client only
+        self.server_policy = None
+        # CA certificates of the NTS servers, None for the system ones
+        self.nts_trusted_certs = None
+
+    def iburst_address(self, vrf_name):
+        if self.warm_server is None or self.warm_server[0] != vrf_name:
+            return None
+        return self.warm_server[1]
+
+    def daemon_argv(self, instance):
+        '''
+        Returns the command line of the daemon of an instance, in the
+        foreground
+        '''
+        raise NotImplementedError
+
+    def render_conf(self, instance, control_key, associations, trusted_keys,
+                    discipline):
+        '''
+        Returns the configuration file content of an instance.
+        'associations' is a list of (address, vrf, key_id, ref_clock_id,
+        prefer, version) tuples.
+        '''
+        raise NotImplementedError
+
+    def render_keys(self, control_key, control_password, keys):
+        return ops_ntpd_conf_render_keys(control_key, control_password, keys)
+
+    def server_add_configs(self, association, iburst=False):
+        '''
+        Returns the configs adding an association, polled with iburst
+        when 'iburst' is True
+        '''
+        raise NotImplementedError
+
+    def server_delete_configs(self, address):
+        raise NotImplementedError
+
+    def key_configs(self, trusted_keys, untrusted_keys):
+        raise NotImplementedError
+
+    def discipline_configs(self, discipline):
+        raise NotImplementedError
+
+    def server_policy_configs(self):
+        return [NTPD_BACKEND_RESTART]
+
+    def nts_configs(self):
+        '''
+        Returns the configs applying a change of the NTS trusted
+        certificates
+        '''
+        return []
+
+    def push(self, instance, configs, keys_changed, control):
+        '''
+        Pushes 'configs' to the running daemon of an instance, after the
+        conf and keys files were rewritten. 'configs' is None when the
+        conf file did not change. 'control' is the (key id, password) of
+        the control key.
+        '''
+        raise NotImplementedError
+
+    def read_associations(self, instance):
+        '''
+        Returns the association status rows of an instance, keyed by
+        address
+        '''
+        raise NotImplementedError
+
+    def read_statistics(self, instance):
+        '''
+        Returns the global statistics of an instance and the daemon
+        uptime, None when the daemon does not report it
+        '''
+        raise NotImplementedError
+
+    def read_clients(self, instance, since):
+        '''
+        Returns the clients of the daemon of an instance seen within the
+        last 'since' seconds, every client when None, as a list of
+        ops_ntpd_clients entries
+        '''
+        raise NotImplementedError
+
+    def read_nts(self, instance):
+        '''
+        Returns the NTS state of the associations of an instance, keyed
+        by address, as ops_ntpd_nts entries
+        '''
+        return {}
+
+    def probe(self, instance):
+        '''
+        Returns True if the daemon of an instance answers on its control
+        socket
+        '''
+        raise NotImplementedError
+
+    def restart(self, instance):
+        instance.supervisor.argv = instance.argv(self.daemon_argv(instance))
+        instance.supervisor.stop()
+        instance.supervisor.start()
+
+
+class NTPDClassicBackend(NTPDBackend):
+
+    name = "ntpd"
+    daemon = "ntpd"
+
+    def daemon_argv(self, instance):
+        argv = ["ntpd", "-n"]
+        if instance.interface is not None:
+            argv += ["-I", instance.interface]
+        return argv + ["-c", instance.conf_file, "-k", instance.keys_file,
+                       "-l", instance.log_file, "-p", instance.pid_file]
+
+    def render_conf(self, instance, control_key, associations, trusted_keys,
+                    discipline):
+        for association in associations:
+            if association[2] == NTS_KEY_ID:
+                vlog.warn("NTPD has no NTS, association %s skipped" %
+                          (association[0]))
+        return ops_ntpd_conf_render_conf(
+            control_key, [x for x in associations if x[2] != NTS_KEY_ID],
+            trusted_keys, discipline, instance.drift_file,
+            self.iburst_address(instance.vrf_name), self.server_policy)
+
+    def server_add_configs(self, association, iburst=False):
+        (addr, vrf, key_id, ref_clk, pref, ver) = association
+        if key_id == NTS_KEY_ID:
+            return []
+        iburst = iburst or addr == self.iburst_address(vrf)
+        # Same lines as in ntp.conf, e.g. server and fudge of a refclock
+        return [":config " + line for line in
+                ops_ntpd_conf_server_lines(addr, key_id, ref_clk, pref, ver,
+                                           iburst)]
+
+    def server_delete_configs(self, address):
+        return [":config unconfig " + address]
+
+    def key_configs(self, trusted_keys, untrusted_keys):
+        configs = []
+        if len(untrusted_keys) > 0:
+            configs += [":config unconfig trustedkey " +
+                        " ".join([str(x) for x in untrusted_keys])]
+        if len(trusted_keys) > 0:
+            configs += [":config trustedkey " +
+                        " ".join([str(x) for x in trusted_keys])]
+        return configs
+
+    def discipline_configs(self, discipline):
+        return [":config %s ntp" % ("enable" if discipline else "disable")]
+
+    def push(self, instance, configs, keys_changed, control):
+        if configs is not None and NTPD_BACKEND_RESTART in configs:
+            vlog.info("Restarting ntpd %s to apply its configuration" %
+                      (instance.vrf_name))
+            self.restart(instance)
+            return
+        if keys_changed:
+            e, o = self.run_command(instance.command(
+                "ntpdc -c \"keytype %s\" -c \"keyid %d\" -c \"passwd %s\" "
+                "-c \"readkeys\"" %
+                (CONTROL_KEY_TYPE.lower(), control[0], control[1])))
+            time.sleep(2)
+            vlog.dbg("NTPDC command was %s: done" % e)
+        if configs is not None:
+            # NTPD only reads ntp.conf at startup, the running daemon is
+            # reconfigured through ntpq
+            command = "ntpq -c \"keytype %s\" -c \"keyid %d\" " \
+                "-c \"passwd %s\"" % \
+                (CONTROL_KEY_TYPE.lower(), control[0], control[1])
+            for config in configs:
+                command += " -c \"%s\"" % (config)
+            e, o = self.run_command(instance.command(command))
+            vlog.dbg("NTPQ command was %s: done" % e)
+
+    def read_associations(self, instance):
+        a_table = {}
+        associations_info_table = {}
+        err, cmd_output = self.run_command(
+            instance.command("ntpq -n -c \"apeers\""))
+        n_out = cmd_output[0].strip().split('\n')[2:]
+        for n in n_out:
+            n = n.strip().split()
+            a_entry = {}
+            a_entry[NTPQ_REMOTE] = n[0]
+            a_entry[NTPQ_REFID] = n[1]
+            a_entry[NTPQ_ASSOCID] = n[2]
+            a_entry[NTPQ_ST] = n[3]
+            a_entry[NTPQ_T] = n[4]
+            a_entry[NTPQ_WHEN] = n[5]
+            a_entry[NTPQ_POLL] = n[6]
+            a_entry[NTPQ_REACH] = n[7]
+            a_entry[NTPQ_DELAY] = n[8]
+            a_entry[NTPQ_OFFSET] = n[9]
+            a_entry[NTPQ_JITTER] = n[10]
+            a_table[a_entry[NTPQ_ASSOCID]] = a_entry
+
+        for assoc_id in a_table.keys():
+            err, cmd_output = self.run_command(
+                instance.command("ntpq -n -c \"rv %s\"" % assoc_id))
+            n_out = " ".join(cmd_output[0].split("\n"))
+            n = n_out.split(",")
+            peer_status_word = [x.strip() for x in n if "sel_" in x][0]
+            root_dispersion = [x.strip() for x in n
+                               if "rootdisp" in x][0].strip().split("=")[1]
+            remote_peer_address = [x.strip() for x in n
+                                   if "srcadr" in x][0].strip().split("=")[1]
+            reference_time = " ".join([n[i] + n[i + 1] for i in
+                                       range(len(n)) if "reftime" in n[i]][0].
+                                      strip().split("=")[1].split()[1:])
+            ref_id = [x.strip() for x in n if "refid" in x][
+                0].strip().split("=")[1]
+            if a_table[assoc_id][NTPQ_REFID][0] == ".":
+                ref_id = a_table[assoc_id][NTPQ_REFID]
+            a_table[assoc_id][NTPQ_REMOTE] = remote_peer_address
+            a_table[assoc_id][NTPQ_ROOT_DISPERSION] = root_dispersion
+            a_table[assoc_id][NTPQ_REFERENCE_TIME] = reference_time
+            a_table[assoc_id][NTPQ_PEER_STATUS_WORD] = peer_status_word
+            a_table[assoc_id][NTPQ_REFID] = ref_id
+            associations_info_table[remote_peer_address] = a_table[assoc_id]
+        return associations_info_table
+
+    def read_statistics(self, instance):
+        err, cmd_output = self.run_command(
+            instance.command("ntpq -n -c \"sysstats\""))
+        n_out = cmd_output[0].strip().split("\n")
+        sysstat_table = {}
+        for n in n_out:
+            n = [i.lstrip() for i in n.strip().split(":")]
+            sysstat_table[n[0]] = n[1]
+        statistics = {}
+        for label, key in translate_sysstats.iteritems():
+            statistics[key] = str(sysstat_table[label])
+        return (statistics, str(sysstat_table[NTPQ_UPTIME]))
+
+    def read_clients(self, instance, since):
+        command = "mrulist"
+        if since is not None:
+            command += " maxlstint=%d" % (since)
+        err, cmd_output = self.run_command(
+            instance.command("ntpq -n -c \"%s\"" % (command)))
+        return ops_ntpd_parse_mrulist(cmd_output[0])
+
+    def probe(self, instance):
+        err, cmd_output = self.run_command(
+            instance.command("ntpq -n -c \"sysstats\""))
+        return any([x.strip().startswith(NTPQ_UPTIME + ":")
+                    for x in cmd_output[0].split("\n")])
+
+
+class NTPDChronyBackend(NTPDBackend):
+
+    name = "chrony"
+    daemon = "chronyd"
+
+    def __init__(self, run_command):
+        NTPDBackend.__init__(self, run_command)
+        # Reference clocks are reported by refid, mapped back to their
+        # association address, per VRF
+        self.refclocks = {}
+
+    def socket(self, instance):
+        return instance.working_dir() + "chronyd.sock"
+
+    def chronyc(self, instance):
+        return "chronyc -h %s" % (self.socket(instance))
+
+    def daemon_argv(self, instance):
+        # Without -x chronyd disciplines the system clock. The listening
+        # interface of NTPD does not apply.
+        argv = ["chronyd", "-d", "-f", instance.conf_file]
+        if not instance.discipline:
+            argv.append("-x")
+        return argv
+
+    def render_conf(self, instance, control_key, associations, trusted_keys,
+                    discipline):
+        self.refclocks[instance.vrf_name] = dict(
+            [(refid, address) for (address, refid) in
+             ops_ntpd_chrony_refclock_refids(associations)])
+        if self.server_policy is not None and \
+                self.server_policy["average"] > CHRONY_MAX_RATELIMIT_INTERVAL:
+            vlog.warn("Server mode rate limit average %d is above the "
+                      "chronyd maximum, using %d" %
+                      (self.server_policy["average"],
+                       CHRONY_MAX_RATELIMIT_INTERVAL))
+        # The NTS cookies are kept next to the daemon files
+        return ops_ntpd_conf_render_chrony_conf(
+            associations, instance.keys_file, self.socket(instance),
+            instance.pid_file, instance.drift_file, self.server_policy,
+            instance.working_dir().rstrip("/"), self.nts_trusted_certs)
+
+    def render_keys(self, control_key, control_password, keys):
+        return ops_ntpd_conf_render_chrony_keys(control_key, control_password,
+                                                keys)
+
+    def server_add_configs(self, association, iburst=False):
+        # Servers are always polled with iburst
+        (addr, vrf, key_id, ref_clk, pref, ver) = association
+        if ops_ntpd_conf_refclock_driver(addr) is not None:
+            return [NTPD_BACKEND_RESTART]
+        config = "add server %s iburst" % (addr)
+        if key_id == NTS_KEY_ID:
+            config += " nts"
+        elif str(key_id) != str(DEFAULT_NTP_KEY_ID):
+            config += " key %s" % (key_id)
+        if pref != DEFAULT_NTP_PREF:
+            config += " prefer"
+        return [config]
+
+    def server_delete_configs(self, address):
+        if ops_ntpd_conf_refclock_driver(address) is not None:
+            return [NTPD_BACKEND_RESTART]
+        return ["delete %s" % (address)]
+
+    def key_configs(self, trusted_keys, untrusted_keys):
+        # Every key of the keys file is trusted, it is reloaded by push()
+        return []
+
+    def discipline_configs(self, discipline):
+        return [NTPD_BACKEND_RESTART]
+
+    def nts_configs(self):
+        # ntstrustedcerts is only read when chronyd starts
+        return [NTPD_BACKEND_RESTART]
+
+    def push(self, instance, configs, keys_changed, control):
+        configs = configs or []
+        if NTPD_BACKEND_RESTART in configs:
+            vlog.info("Restarting chronyd %s to apply its configuration" %
+                      (instance.vrf_name))
+            self.restart(instance)
+            return
+        if keys_changed:
+            configs = configs + ["rekey"]
+        if not configs:
+            return
+        command = self.chronyc(instance) + " -m"
+        for config in configs:
+            command += " \"%s\"" % (config)
+        e, o = self.run_command(instance.command(command))
+        vlog.dbg("CHRONYC command was %s: done" % e)
+
+    def read_csv(self, instance, command):
+        err, cmd_output = self.run_command(instance.command(
+            "%s -c -n %s" % (self.chronyc(instance), command)))
+        return [line.split(",") for line in cmd_output[0].strip().split("\n")
+                if line]
+
+    def read_associations(self, instance):
+        refclocks = self.refclocks.get(instance.vrf_name, {})
+        jitters = dict([(x[CHRONY_SOURCESTATS_NAME],
+                         x[CHRONY_SOURCESTATS_STD_DEV])
+                        for x in self.read_csv(instance, "sourcestats")])
+        ntpdata = dict([(x[CHRONY_NTPDATA_ADDRESS], x)
+                        for x in self.read_csv(instance, "ntpdata")])
+        associations_info_table = {}
+        for assoc_id, n in enumerate(self.read_csv(instance, "sources")):
+            name = n[CHRONY_SOURCES_NAME]
+            address = refclocks.get(name, name)
+            a_entry = {}
+            a_entry[NTPQ_REMOTE] = address
+            a_entry[NTPQ_REFID] = "-"
+            a_entry[NTPQ_ASSOCID] = str(assoc_id + 1)
+            a_entry[NTPQ_ST] = n[CHRONY_SOURCES_STRATUM]
+            a_entry[NTPQ_T] = translate_chrony_mode.get(
+                n[CHRONY_SOURCES_MODE], "u")
+            a_entry[NTPQ_WHEN] = n[CHRONY_SOURCES_LAST_RX]
+            a_entry[NTPQ_POLL] = str(2 ** int(n[CHRONY_SOURCES_POLL]))
+            a_entry[NTPQ_REACH] = n[CHRONY_SOURCES_REACH]
+            # chronyc reports seconds, ntpq milliseconds
+            a_entry[NTPQ_OFFSET] = ops_ntpd_chrony_ms(
+                n[CHRONY_SOURCES_OFFSET])
+            a_entry[NTPQ_JITTER] = ops_ntpd_chrony_ms(jitters.get(name))
+            a_entry[NTPQ_DELAY] = "-"
+            a_entry[NTPQ_ROOT_DISPERSION] = "-"
+            a_entry[NTPQ_REFERENCE_TIME] = "-"
+            a_entry[NTPQ_PEER_STATUS_WORD] = translate_chrony_state.get(
+                n[CHRONY_SOURCES_STATE], "sel_reject")
+            if name in refclocks:
+                a_entry[NTPQ_REFID] = "." + name + "."
+            elif address in ntpdata:
+                data = ntpdata[address]
+                a_entry[NTPQ_REFID] = data[CHRONY_NTPDATA_REFID_NAME]
+                a_entry[NTPQ_ROOT_DISPERSION] = ops_ntpd_chrony_ms(
+                    data[CHRONY_NTPDATA_ROOT_DISPERSION])
+                a_entry[NTPQ_REFERENCE_TIME] = ops_ntpd_chrony_time(
+                    data[CHRONY_NTPDATA_REFERENCE_TIME])
+            associations_info_table[address] = a_entry
+        return associations_info_table
+
+    def read_statistics(self, instance):
+        rows = self.read_csv(instance, "serverstats")
+        statistics = dict([(key, "-") for key in translate_sysstats.values()])
+        if rows:
+            statistics[NTP_STAT_NTP_PKTS_RECEIVED] = \
+                rows[0][CHRONY_SERVERSTATS_NTP_RECEIVED]
+            statistics[NTP_STAT_NTP_PKTS_RATE_LIMITED] = \
+                rows[0][CHRONY_SERVERSTATS_NTP_DROPPED]
+        return (statistics, None)
+
+    def read_clients(self, instance, since):
+        # chronyd has no cursor, the clients seen earlier are skipped
+        clients = []
+        for n in self.read_csv(instance, "clients"):
+            try:
+                count = int(n[CHRONY_CLIENTS_NTP])
+                lstint = int(n[CHRONY_CLIENTS_NTP_LAST])
+                interval = int(n[CHRONY_CLIENTS_NTP_INTERVAL])
+                dropped = int(n[CHRONY_CLIENTS_NTP_DROPPED])
+            except (IndexError, ValueError):
+                continue
+            # Command (chronyc) only clients
+            if count == 0 or (since is not None and lstint > since):
+                continue
+            clients.append({
+                CLIENT_ADDRESS: n[CHRONY_CLIENTS_ADDRESS],
+                CLIENT_COUNT: count,
+                CLIENT_AVGINT: 2.0 ** interval
+                if interval < CHRONY_CLIENTS_NO_INTERVAL else None,
+                CLIENT_LSTINT: lstint,
+                CLIENT_LIMITED: dropped > 0,
+            })
+        return clients
+
+    def read_nts(self, instance):
+        # The age of the last NTS-KE handshake is '-' before the first
+        nts = {}
+        for n in self.read_csv(instance, "authdata"):
+            try:
+                if n[CHRONY_AUTHDATA_MODE] != CHRONY_AUTHDATA_MODE_NTS:
+                    continue
+                last = n[CHRONY_AUTHDATA_LAST]
+                nts[n[CHRONY_AUTHDATA_NAME]] = {
+                    NTS_LAST_KE: int(last) if last.isdigit() else None,
+                    NTS_COOKIES: int(n[CHRONY_AUTHDATA_COOKIES]),
+                }
+            except (IndexError, ValueError):
+                continue
+        return nts
+
+    def probe(self, instance):
+        return len(self.read_csv(instance, "tracking")) > 0
+
+
+def ops_ntpd_parse_mrulist(output):
+    '''
+    Returns the clients of an ntpq mrulist output. The servers NTPD
+    polls are in the MRU list too, only client mode entries are kept.
+    '''
+    clients = []
+    lines = output.split("\n")
+    for i, line in enumerate(lines):
+        if line.startswith("==="):
+            break
+    for line in lines[i + 1:]:
+        n = line.split()
+        if len(n) <= NTPQ_MRU_ADDRESS or \
+                n[NTPQ_MRU_MODE] != NTPQ_MRU_MODE_CLIENT:
+            continue
+        try:
+            clients.append({
+                CLIENT_ADDRESS: n[NTPQ_MRU_ADDRESS],
+                CLIENT_COUNT: int(n[NTPQ_MRU_COUNT]),
+                CLIENT_AVGINT: int(n[NTPQ_MRU_AVGINT]),
+                CLIENT_LSTINT: int(n[NTPQ_MRU_LSTINT]),
+                CLIENT_LIMITED: n[NTPQ_MRU_FLAGS] in NTPQ_MRU_LIMITED_FLAGS,
+            })
+        except ValueError:
+            continue
+    return clients
+
+
+def ops_ntpd_chrony_refclock_refids(associations):
+    '''
+    Returns the (address, refid) of the reference clocks of a chrony
+    configuration, as rendered by ops_ntpd_conf_render_chrony_conf()
+    '''
+    return [(a[0], ops_ntpd_conf_refclock_refid(a[0], a[3]))
+            for a in associations
+            if ops_ntpd_conf_refclock_driver(a[0]) is not None]
+
+
+def ops_ntpd_chrony_ms(seconds):
+    try:
+        return "%.3f" % (float(seconds) * 1000)
+    except (TypeError, ValueError):
+        return "-"
+
+
+def ops_ntpd_chrony_time(seconds):
+    '''
+    Returns a chronyc timestamp in the format of the ntpq reftime
+    '''
+    try:
+        seconds = float(seconds)
+    except ValueError:
+        return "-"
+    return time.strftime("%a, %b %d %Y %H:%M:%S", time.localtime(seconds)) +\
+        ".%03d" % (int((seconds % 1) * 1000))
+
+NTPD_BACKENDS = {
+    NTPDClassicBackend.name: NTPDClassicBackend,
+    NTPDChronyBackend.name: NTPDChronyBackend,
+}
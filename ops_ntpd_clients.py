@@ -0,0 +1,169 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_CLIENTS module
+ - Client load of the daemons in server mode, from the MRU (most
+   recently used) list of NTPD, or the client list of chronyd.
+ - Fetches are incremental: only the clients seen since the previous
+   fetch of an instance are read (the 'maxlstint' cursor of the NTPD
+   mrulist, ntpq does the nonce exchange of each fetch). A client not
+   in a fetch sent nothing since the previous one.
+ - The packets a client sent are counted since the last fetch it was
+   in, so its rate is taken over that time, not the time since the
+   previous fetch of the instance.
+ - The request rate of a client is smoothed over the fetches. The
+   table is bounded, the least active clients are evicted first.
+ - Kept in memory only, never written to OVSDB. It is read through
+   unixctl ('ntpd/clients') and the diagnostic dump.
+'''
+
+import math
+import ovs.vlog
+
+vlog = ovs.vlog.Vlog("ops_ntpd_clients")
+
+# Seconds between two fetches of the client list of an instance
+CLIENTS_REFRESH_INTERVAL = 10
+# Added to the cursor, for the clients seen while the previous fetch ran
+CLIENTS_CURSOR_MARGIN = 2
+MAX_TRACKED_CLIENTS = 1024
+DEFAULT_TOP_CLIENTS = 20
+# Weight of the last fetch in the smoothed request rate
+CLIENTS_RATE_WEIGHT = 0.5
+
+# Client entry keys, as returned by the backends
+CLIENT_ADDRESS = "address"
+CLIENT_COUNT = "count"
+CLIENT_AVGINT = "avgint"
+CLIENT_LSTINT = "lstint"
+CLIENT_LIMITED = "limited"
+
+
+class NTPDClientTable(object):
+
+    def __init__(self, max_clients=MAX_TRACKED_CLIENTS):
+        '''
+        The clients of every instance, keyed by (vrf, address), at most
+        'max_clients'
+        '''
+        self.max_clients = max_clients
+        self.clients = {}
+        # VRF -> time of its last fetch
+        self.fetched = {}
+        self.evictions = 0
+
+    def cursor(self, vrf_name, now):
+        '''
+        Returns the last seen interval (seconds) of the clients to
+        fetch for 'vrf_name', None for every client
+        '''
+        last = self.fetched.get(vrf_name)
+        if last is None:
+            return None
+        return int(math.ceil(now - last)) + CLIENTS_CURSOR_MARGIN
+
+    def update(self, vrf_name, now, entries):
+        '''
+        Merges the 'entries' fetched from the daemon of 'vrf_name'
+        '''
+        last = self.fetched.get(vrf_name)
+        self.fetched[vrf_name] = now
+        seen = set()
+        for entry in entries:
+            key = (vrf_name, entry[CLIENT_ADDRESS])
+            seen.add(key)
+            client = self.clients.get(key)
+            if client is None or now <= client["fetched"]:
+                # A new client, its rate is its average interval
+                avgint = entry[CLIENT_AVGINT]
+                self.clients[key] = {
+                    "count": entry[CLIENT_COUNT],
+                    "fetched": now,
+                    "rate": 1.0 / avgint if avgint else 0.0,
+                    "last_seen": now - entry[CLIENT_LSTINT],
+                    "limited": entry[CLIENT_LIMITED],
+                }
+                continue
+            delta = entry[CLIENT_COUNT] - client["count"]
+            if delta < 0:
+                # The daemon dropped and re-created the entry
+                delta = entry[CLIENT_COUNT]
+            # The count grew since the last fetch the client was in
+            client["rate"] += CLIENTS_RATE_WEIGHT * \
+                (float(delta) / (now - client["fetched"]) - client["rate"])
+            client["count"] = entry[CLIENT_COUNT]
+            client["fetched"] = now
+            client["last_seen"] = now - entry[CLIENT_LSTINT]
+            client["limited"] = entry[CLIENT_LIMITED]
+
+        if last is not None:
+            for key, client in self.clients.iteritems():
+                if key[0] == vrf_name and key not in seen:
+                    client["rate"] *= 1 - CLIENTS_RATE_WEIGHT
+        self.evict()
+
+    def evict(self):
+        excess = len(self.clients) - self.max_clients
+        if excess <= 0:
+            return
+        keys = sorted(self.clients.keys(),
+                      key=lambda k: (self.clients[k]["rate"],
+                                     self.clients[k]["last_seen"]))
+        for key in keys[:excess]:
+            del self.clients[key]
+        self.evictions += excess
+        vlog.dbg("Evicted %d NTP clients" % (excess))
+
+    def prune(self, vrf_names):
+        '''
+        Drops the clients of the VRFs not in 'vrf_names'
+        '''
+        for key in [k for k in self.clients if k[0] not in vrf_names]:
+            del self.clients[key]
+        for vrf_name in [v for v in self.fetched if v not in vrf_names]:
+            del self.fetched[vrf_name]
+
+    def clear(self):
+        self.clients = {}
+        self.fetched = {}
+
+    def top(self, count=DEFAULT_TOP_CLIENTS):
+        '''
+        Returns the (vrf, address, client) of the 'count' clients with
+        the highest request rate
+        '''
+        keys = sorted(self.clients.keys(),
+                      key=lambda k: (-self.clients[k]["rate"],
+                                     -self.clients[k]["count"], k))
+        return [(k[0], k[1], self.clients[k]) for k in keys[:count]]
+
+    def dump(self, now, count=DEFAULT_TOP_CLIENTS):
+        '''
+        Returns the top clients table, for unixctl and diagnostics
+        '''
+        lines = ["%-16s %-40s %10s %10s %10s %s\n" %
+                 ("VRF", "CLIENT", "RATE/S", "PACKETS", "LAST SEEN",
+                  "LIMITED")]
+        for (vrf_name, address, client) in self.top(count):
+            lines.append("%-16s %-40s %10.3f %10d %10d %s\n" %
+                         (vrf_name, address, client["rate"], client["count"],
+                          max(int(now - client["last_seen"]), 0),
+                          "yes" if client["limited"] else "no"))
+        lines.append("%d client(s) tracked, %d evicted\n" %
+                     (len(self.clients), self.evictions))
+        return lines
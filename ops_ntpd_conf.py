@@ -0,0 +1,375 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_CONF module
+ - Renders the complete ntp.conf and keys files from the OVSDB state.
+   The output only depends on its input (entries are sorted), so the
+   digest of the rendered content tells whether NTPD needs a reload.
+ - Files are replaced atomically: the content is written to a temporary
+   file in the same directory, synced and renamed over the old file, so
+   NTPD never reads a partially written file.
+ - Reference clocks are associations on the NTPD pseudo address
+   127.127.<driver>.<unit>: PPS (ATOM driver, /dev/pps<unit>, with the
+   kernel PPS discipline) and SHM (shared memory segment <unit>). They
+   get a 'fudge' line with their refid and are polled every 16 seconds.
+ - The chrony.conf of the chrony backend is rendered from the same
+   associations.
+ - The driftfile and the 'iburst' server of a warm start come from the
+   warm start state (ops_ntpd_state).
+ - In server mode the daemon serves the allowed client networks, every
+   network when none is given. Clients are rate limited ('discard' and
+   'restrict ... limited kod' for NTPD, 'ratelimit' for chronyd), the
+   servers of the associations and the loopback (ntpq) are not. chronyd
+   only takes the average interval, up to 2^12 seconds.
+ - Keys are MD5, SHA-1, SHA-256 or AES-128-CMAC. NTP_Key has no
+   algorithm column, the key_password of a non MD5 key is
+   '<algorithm>:<hex key>'. NTPD reads a key of more than 20 characters
+   as hex, chronyd needs a 'HEX:' prefix. The control key is SHA-1.
+ - An NTS association has NTS_KEY_ID in place of a key id. It is only
+   rendered for chronyd, which keeps its NTS cookies in 'ntsdumpdir'
+   across restarts.
+'''
+
+import os
+import socket
+import string
+import hashlib
+
+CONF_HEADER = "#This is generated from ops-ntpd"
+
+DEFAULT_NTP_KEY_ID = 0
+NTS_KEY_ID = "nts"
+DEFAULT_NTP_PREF = "false"
+
+REFCLOCK_ADDRESS_PREFIX = "127.127."
+REFCLOCK_DRIVER_PPS = 22
+REFCLOCK_DRIVER_SHM = 28
+# Default refids, and fudge options, per driver. flag3 makes the ATOM
+# driver hand the PPS signal to the kernel discipline.
+REFCLOCK_DRIVERS = {
+    REFCLOCK_DRIVER_PPS: ("PPS", " flag3 1"),
+    REFCLOCK_DRIVER_SHM: ("SHM", ""),
+}
+REFCLOCK_POLL = 4
+# chrony refclock drivers, and the device of a unit
+CHRONY_REFCLOCK_DRIVERS = {
+    REFCLOCK_DRIVER_PPS: ("PPS", "/dev/pps%d"),
+    REFCLOCK_DRIVER_SHM: ("SHM", "%d"),
+}
+
+# Key algorithms, as stored in NTP_Key:key_password, with their NTPD and
+# chronyd key types and the length of their hex key (None for the MD5
+# password)
+KEY_ALGORITHM_MD5 = "md5"
+KEY_ALGORITHMS = {
+    KEY_ALGORITHM_MD5: ("MD5", "MD5", None),
+    "sha1": ("SHA1", "SHA1", 40),
+    "sha256": ("SHA256", "SHA256", 64),
+    "aes128cmac": ("AES128CMAC", "AES128", 32),
+}
+KEY_ALGORITHM_SEPARATOR = ":"
+# ASCII, NTPD and chronyd read it the same way
+CONTROL_KEY_TYPE = "SHA1"
+CONTROL_KEY_LENGTH = 20
+
+# Server mode client restrictions
+SERVER_CLIENT_FLAGS = "kod limited nomodify notrap nopeer noquery"
+# Longest 'ratelimit interval' chronyd accepts (log2 seconds)
+CHRONY_MAX_RATELIMIT_INTERVAL = 12
+SERVER_SOURCE_FLAGS = "nomodify notrap noquery"
+
+
+def ops_ntpd_conf_render_conf(control_key, associations, trusted_keys,
+                              discipline=True, drift_file=None,
+                              iburst_address=None, server_policy=None):
+    '''
+    Returns the ntp.conf content.
+    'associations' is a list of (address, vrf, key_id, ref_clock_id,
+    prefer, version) tuples, 'trusted_keys' a list of key ids.
+    Without 'discipline' NTPD polls its servers but leaves the system
+    clock alone. The server 'iburst_address' is polled with 'iburst'.
+    NTPD serves clients as set by 'server_policy', see
+    ops_ntpd_conf_server_policy_lines().
+    '''
+    trusted = [str(control_key)] + \
+        [str(k) for k in sorted(trusted_keys, key=int)]
+    conf = [CONF_HEADER,
+            "tinker panic 0"]
+    if drift_file is not None:
+        conf.append("driftfile %s" % (drift_file))
+    conf += ["trustedkey %s" % (" ".join(trusted)),
+             "requestkey %s" % (control_key),
+             "controlkey %s" % (control_key),
+             "enable mode7"]
+    if not discipline:
+        conf.append("disable ntp")
+    conf += ops_ntpd_conf_server_policy_lines(server_policy)
+    for (addr, vrf, key_id, ref_clk, pref, ver) in sorted(associations):
+        conf += ops_ntpd_conf_server_lines(addr, key_id, ref_clk, pref, ver,
+                                           addr == iburst_address)
+    return "\n".join(conf) + "\n"
+
+
+def ops_ntpd_conf_parse_network(network):
+    '''
+    Returns the (family, address, mask) of an 'address/prefix' network,
+    None if it is not valid
+    '''
+    try:
+        (address, prefix) = network.split("/")
+        prefix = int(prefix)
+    except ValueError:
+        return None
+    for family, bits in [(socket.AF_INET, 32), (socket.AF_INET6, 128)]:
+        try:
+            packed = socket.inet_pton(family, address)
+        except (socket.error, ValueError):
+            continue
+        if prefix < 0 or prefix > bits:
+            return None
+        mask = ((1 << bits) - 1) ^ ((1 << (bits - prefix)) - 1)
+        mask = "".join([chr((mask >> (8 * i)) & 0xff)
+                        for i in reversed(range(bits / 8))])
+        packed = "".join([chr(ord(a) & ord(m))
+                          for a, m in zip(packed, mask)])
+        return (family, socket.inet_ntop(family, packed),
+                socket.inet_ntop(family, mask))
+    return None
+
+
+def ops_ntpd_conf_server_policy_lines(server_policy):
+    '''
+    Returns the ntp.conf lines of the server mode. 'server_policy' is
+    None when NTPD only runs as a client, otherwise a dict with the
+    'allow' client networks, every network when empty, and the log2
+    'average' and 'minimum' intervals (seconds) between the requests of
+    a client.
+    '''
+    if server_policy is None:
+        return []
+    serve = "" if not server_policy["allow"] else " noserve"
+    lines = ["discard average %d minimum %d" %
+             (server_policy["average"], server_policy["minimum"]),
+             "restrict default %s%s" % (SERVER_CLIENT_FLAGS, serve),
+             "restrict -6 default %s%s" % (SERVER_CLIENT_FLAGS, serve),
+             "restrict source %s" % (SERVER_SOURCE_FLAGS),
+             "restrict 127.0.0.1",
+             "restrict -6 ::1"]
+    for network in server_policy["allow"]:
+        (family, address, mask) = ops_ntpd_conf_parse_network(network)
+        lines.append("restrict %s%s mask %s %s" %
+                     ("-6 " if family == socket.AF_INET6 else "", address,
+                      mask, SERVER_CLIENT_FLAGS))
+    return lines
+
+
+def ops_ntpd_conf_refclock_driver(address):
+    '''
+    Returns the refclock driver of an association address, None if it
+    is not a supported reference clock
+    '''
+    if not address.startswith(REFCLOCK_ADDRESS_PREFIX):
+        return None
+    try:
+        driver = int(address.split(".")[2])
+    except (IndexError, ValueError):
+        return None
+    if driver not in REFCLOCK_DRIVERS:
+        return None
+    return driver
+
+
+def ops_ntpd_conf_refclock_refid(address, ref_clock_id):
+    '''
+    Returns the refid of a reference clock, the configured one or the
+    default one of its driver
+    '''
+    # '-' and '.LOCL.' are the defaults of regular servers
+    if ref_clock_id and ref_clock_id[0] not in "-.":
+        return ref_clock_id
+    return REFCLOCK_DRIVERS[ops_ntpd_conf_refclock_driver(address)][0]
+
+
+def ops_ntpd_conf_server_lines(address, key_id, ref_clock_id, prefer,
+                               version, iburst=False):
+    '''
+    Returns the ntp.conf lines of an association. The same lines are
+    pushed to a running NTPD with ':config'.
+    '''
+    driver = ops_ntpd_conf_refclock_driver(address)
+    if driver is not None:
+        refid = ops_ntpd_conf_refclock_refid(address, ref_clock_id)
+        fudge = REFCLOCK_DRIVERS[driver][1]
+        server = "server %s minpoll %d maxpoll %d" % \
+            (address, REFCLOCK_POLL, REFCLOCK_POLL)
+        if prefer != DEFAULT_NTP_PREF:
+            server += " prefer"
+        return [server, "fudge %s refid %s%s" % (address, refid, fudge)]
+
+    server = "server %s version %s" % (address, version)
+    if str(key_id) != str(DEFAULT_NTP_KEY_ID):
+        server += " key %s" % (key_id)
+    if prefer != DEFAULT_NTP_PREF:
+        server += " prefer"
+    if iburst:
+        server += " iburst"
+    return [server]
+
+
+def ops_ntpd_conf_render_chrony_conf(associations, keys_file, cmd_socket,
+                                     pid_file, drift_file=None,
+                                     server_policy=None, nts_dump_dir=None,
+                                     nts_trusted_certs=None):
+    '''
+    Returns the chrony.conf content, for the same 'associations' and
+    'server_policy' as ops_ntpd_conf_render_conf(). chronyd is
+    controlled through the Unix 'cmd_socket' only, and trusts every key
+    of 'keys_file'. NTS servers are authenticated with the CA
+    certificates of 'nts_trusted_certs', the system ones when None.
+    '''
+    conf = [CONF_HEADER,
+            "keyfile %s" % (keys_file),
+            "bindcmdaddress %s" % (cmd_socket),
+            "cmdport 0",
+            "pidfile %s" % (pid_file),
+            "makestep 1 3"]
+    if drift_file is not None:
+        conf.append("driftfile %s" % (drift_file))
+    if nts_dump_dir is not None:
+        conf.append("ntsdumpdir %s" % (nts_dump_dir))
+    if nts_trusted_certs is not None:
+        conf.append("ntstrustedcerts %s" % (nts_trusted_certs))
+    if server_policy is not None:
+        # chronyd has no minimum interval, rate limited requests are
+        # dropped instead of answered with a KoD. It refuses to start
+        # with an interval above its maximum.
+        conf += ["allow %s" % (network)
+                 for network in server_policy["allow"]] or ["allow"]
+        conf.append("ratelimit interval %d burst 8" %
+                    (min(server_policy["average"],
+                         CHRONY_MAX_RATELIMIT_INTERVAL)))
+    for (addr, vrf, key_id, ref_clk, pref, ver) in sorted(associations):
+        driver = ops_ntpd_conf_refclock_driver(addr)
+        if driver is not None:
+            (name, device) = CHRONY_REFCLOCK_DRIVERS[driver]
+            line = "refclock %s %s refid %s poll %d" % \
+                (name, device % (int(addr.split(".")[3])),
+                 ops_ntpd_conf_refclock_refid(addr, ref_clk), REFCLOCK_POLL)
+        else:
+            # chronyd uses NTPv4, the version is not configurable
+            line = "server %s iburst" % (addr)
+            if key_id == NTS_KEY_ID:
+                line += " nts"
+            elif str(key_id) != str(DEFAULT_NTP_KEY_ID):
+                line += " key %s" % (key_id)
+        if pref != DEFAULT_NTP_PREF:
+            line += " prefer"
+        conf.append(line)
+    return "\n".join(conf) + "\n"
+
+
+def ops_ntpd_conf_parse_key(password):
+    '''
+    Returns the (algorithm, key) of an NTP_Key key_password, None if it
+    is not valid
+    '''
+    (algorithm, separator, key) = password.partition(KEY_ALGORITHM_SEPARATOR)
+    if not separator or algorithm not in KEY_ALGORITHMS or \
+            algorithm == KEY_ALGORITHM_MD5:
+        # A bare MD5 password, it may contain the separator
+        return (KEY_ALGORITHM_MD5, password)
+    if len(key) != KEY_ALGORITHMS[algorithm][2] or \
+            key.strip(string.hexdigits):
+        return None
+    return (algorithm, key.lower())
+
+
+def ops_ntpd_conf_render_keys(control_key, control_password, keys):
+    '''
+    Returns the keys file content.
+    'keys' maps a key id to a (password, trust_enable) tuple, the
+    password as stored in NTP_Key.
+    '''
+    content = [CONF_HEADER,
+               " %s %s %s" % (control_key, CONTROL_KEY_TYPE, control_password)]
+    for key_id in sorted(keys.keys(), key=int):
+        (algorithm, key) = ops_ntpd_conf_parse_key(keys[key_id][0])
+        content.append(" %s %s %s" % (key_id, KEY_ALGORITHMS[algorithm][0],
+                                      key))
+    return "\n".join(content) + "\n"
+
+
+def ops_ntpd_conf_render_chrony_keys(control_key, control_password, keys):
+    '''
+    Returns the chronyd keys file content, for the same keys as
+    ops_ntpd_conf_render_keys()
+    '''
+    content = [CONF_HEADER,
+               "%s %s %s" % (control_key, CONTROL_KEY_TYPE, control_password)]
+    for key_id in sorted(keys.keys(), key=int):
+        (algorithm, key) = ops_ntpd_conf_parse_key(keys[key_id][0])
+        if algorithm != KEY_ALGORITHM_MD5:
+            key = "HEX:" + key
+        content.append("%s %s %s" % (key_id, KEY_ALGORITHMS[algorithm][1],
+                                     key))
+    return "\n".join(content) + "\n"
+
+
+def ops_ntpd_conf_read_control_key(keys_file, control_key):
+    '''
+    Returns the password of the control key of a rendered keys file,
+    None if the file or the key is missing, or if the key is not of the
+    control key type (the daemon can not be controlled with it)
+    '''
+    try:
+        with open(keys_file, "r") as f:
+            for line in f:
+                fields = line.split()
+                if len(fields) == 3 and fields[0] == str(control_key):
+                    if fields[1] != CONTROL_KEY_TYPE:
+                        return None
+                    return fields[2]
+    except IOError:
+        pass
+    return None
+
+
+def ops_ntpd_conf_digest(content):
+    '''
+    Returns the digest used to detect changes of rendered content
+    '''
+    return hashlib.sha1(content).hexdigest()
+
+
+def ops_ntpd_conf_write_atomic(filename, content):
+    '''
+    Replaces 'filename' with 'content' using write, fsync and rename
+    '''
+    dirname = os.path.dirname(filename) or "."
+    tmp_filename = "%s.tmp" % (filename)
+    with open(tmp_filename, "w") as f:
+        f.write(content)
+        f.flush()
+        os.fsync(f.fileno())
+    os.rename(tmp_filename, filename)
+    # Persist the rename itself
+    fd = os.open(dirname, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+    finally:
+        os.close(fd)
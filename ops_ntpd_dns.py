@@ -0,0 +1,353 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_DNS module
+ - Resolves the server names of the NTP associations, so that NTPD is
+   only ever configured with addresses and never blocks on DNS.
+ - Names are resolved by a worker thread, the main loop only reads the
+   cache. A name is resolved again when the TTL of its DNS answer
+   expires, and the resolver sequence number changes whenever the
+   address of a name changes, so that ops-ntpd reconfigures NTPD.
+ - The DNS queries are sent to the nameservers of resolv.conf, in the
+   network namespace of the VRF of the association. Names unknown to DNS
+   fall back to the system resolver (e.g. /etc/hosts).
+ - On failure the last known address is kept and the name is retried
+   on a short interval.
+'''
+
+import os
+import time
+import random
+import socket
+import struct
+import ctypes
+import threading
+import ovs.vlog
+from ops_ntpd_vrf import ops_ntpd_vrf_netns
+
+vlog = ovs.vlog.Vlog("ops_ntpd_dns")
+
+RESOLV_CONF = "/etc/resolv.conf"
+# Per namespace resolv.conf, as used by 'ip netns exec'
+NETNS_RESOLV_CONF = "/etc/netns/%s/resolv.conf"
+NETNS_DIR = "/var/run/netns/"
+CLONE_NEWNET = 0x40000000
+
+DNS_PORT = 53
+DNS_TIMEOUT = 2
+DNS_TYPE_A = 1
+DNS_TYPE_CNAME = 5
+DNS_TYPE_AAAA = 28
+DNS_CLASS_IN = 1
+DNS_RCODE_NXDOMAIN = 3
+
+# TTL bounds (seconds). Names resolved without DNS get the default TTL.
+DEFAULT_DNS_TTL = 300
+MIN_DNS_TTL = 30
+MAX_DNS_TTL = 86400
+# Retry interval (seconds) of names which failed to resolve
+DNS_RETRY_INTERVAL = 30
+
+
+def ops_ntpd_dns_is_address(address):
+    '''
+    Returns True if 'address' is an IPv4 or IPv6 address, not a name
+    '''
+    for family in [socket.AF_INET, socket.AF_INET6]:
+        try:
+            socket.inet_pton(family, address)
+            return True
+        except (socket.error, ValueError):
+            pass
+    return False
+
+
+def ops_ntpd_dns_nameservers(netns):
+    '''
+    Returns the (address, port) of the nameservers of a namespace
+    '''
+    filename = RESOLV_CONF
+    if netns is not None and os.path.exists(NETNS_RESOLV_CONF % (netns)):
+        filename = NETNS_RESOLV_CONF % (netns)
+    nameservers = []
+    try:
+        with open(filename, "r") as f:
+            for line in f:
+                fields = line.split()
+                if len(fields) >= 2 and fields[0] == "nameserver":
+                    nameservers.append((fields[1], DNS_PORT))
+    except IOError as e:
+        vlog.warn("Unable to read %s : err %s" % (filename, str(e)))
+    return nameservers
+
+
+def ops_ntpd_dns_build_query(query_id, name, qtype):
+    labels = [l for l in name.rstrip(".").split(".")]
+    qname = "".join([struct.pack("B", len(l)) + l for l in labels]) + "\0"
+    # Recursion desired, one question
+    return struct.pack("!HHHHHH", query_id, 0x0100, 1, 0, 0, 0) + \
+        qname + struct.pack("!HH", qtype, DNS_CLASS_IN)
+
+
+def ops_ntpd_dns_skip_name(msg, offset):
+    '''
+    Returns the offset following the (possibly compressed) name at
+    'offset'
+    '''
+    while True:
+        length = ord(msg[offset])
+        if length & 0xc0 == 0xc0:
+            return offset + 2
+        if length == 0:
+            return offset + 1
+        offset += length + 1
+
+
+def ops_ntpd_dns_parse_response(msg, query_id, qtype):
+    '''
+    Returns the (addresses, ttl) of a DNS response. The TTL is the lowest
+    one of the answer chain (CNAMEs included). Returns ([], None) when
+    the name does not exist or has no address of type 'qtype'.
+    '''
+    (rid, flags, qdcount, ancount, nscount, arcount) = \
+        struct.unpack("!HHHHHH", msg[:12])
+    if rid != query_id or not flags & 0x8000:
+        raise ValueError("unexpected DNS response")
+    rcode = flags & 0xf
+    if rcode == DNS_RCODE_NXDOMAIN:
+        return ([], None)
+    if rcode != 0:
+        raise ValueError("DNS error rcode %d" % (rcode))
+    offset = 12
+    for i in range(qdcount):
+        offset = ops_ntpd_dns_skip_name(msg, offset) + 4
+    addresses = []
+    ttl = None
+    for i in range(ancount):
+        offset = ops_ntpd_dns_skip_name(msg, offset)
+        (rtype, rclass, rttl, rdlength) = \
+            struct.unpack("!HHIH", msg[offset:offset + 10])
+        offset += 10
+        rdata = msg[offset:offset + rdlength]
+        offset += rdlength
+        if rclass != DNS_CLASS_IN:
+            continue
+        if rtype == qtype == DNS_TYPE_A:
+            addresses.append(socket.inet_ntop(socket.AF_INET, rdata))
+        elif rtype == qtype == DNS_TYPE_AAAA:
+            addresses.append(socket.inet_ntop(socket.AF_INET6, rdata))
+        elif rtype != DNS_TYPE_CNAME:
+            continue
+        ttl = rttl if ttl is None else min(ttl, rttl)
+    if not addresses:
+        return ([], None)
+    return (addresses, ttl)
+
+
+def ops_ntpd_dns_query(nameservers, name, qtype):
+    '''
+    Sends a query to each nameserver in turn, returns the (addresses,
+    ttl) of the first answer. Raises socket.error if none answered.
+    '''
+    error = socket.error("no nameserver")
+    for (address, port) in nameservers:
+        family = socket.AF_INET6 if ":" in address else socket.AF_INET
+        sock = socket.socket(family, socket.SOCK_DGRAM)
+        try:
+            sock.settimeout(DNS_TIMEOUT)
+            query_id = random.randint(0, 0xffff)
+            sock.sendto(ops_ntpd_dns_build_query(query_id, name, qtype),
+                        (address, port))
+            # Drop stray datagrams, e.g. late answers to an earlier query
+            while True:
+                msg, source = sock.recvfrom(4096)
+                if msg[:2] == struct.pack("!H", query_id):
+                    break
+            return ops_ntpd_dns_parse_response(msg, query_id, qtype)
+        except (ValueError, IndexError, struct.error) as e:
+            error = socket.error("malformed DNS response from %s : %s" %
+                                 (address, str(e)))
+        except socket.error as e:
+            error = e
+        finally:
+            sock.close()
+    raise error
+
+
+def ops_ntpd_dns_resolve(name, nameservers):
+    '''
+    Returns the (addresses, ttl) of a name, IPv4 first. Raises
+    socket.error when the name cannot be resolved.
+    '''
+    for qtype in [DNS_TYPE_A, DNS_TYPE_AAAA]:
+        try:
+            (addresses, ttl) = ops_ntpd_dns_query(nameservers, name, qtype)
+        except socket.error as e:
+            vlog.dbg("DNS query for %s failed : err %s" % (name, str(e)))
+            break
+        if addresses:
+            return (addresses, max(MIN_DNS_TTL, min(ttl, MAX_DNS_TTL)))
+    # Not in DNS, the system resolver also looks at /etc/hosts
+    return (ops_ntpd_dns_getaddrinfo(name), DEFAULT_DNS_TTL)
+
+
+def ops_ntpd_dns_getaddrinfo(name):
+    infos = socket.getaddrinfo(name, None, 0, socket.SOCK_DGRAM)
+    return [x[4][0] for x in infos if x[0] == socket.AF_INET] + \
+        [x[4][0] for x in infos if x[0] == socket.AF_INET6]
+
+
+def ops_ntpd_dns_setns(fd):
+    libc = ctypes.CDLL(None, use_errno=True)
+    if libc.setns(fd, CLONE_NEWNET) != 0:
+        err = ctypes.get_errno()
+        raise OSError(err, os.strerror(err))
+
+
+class NTPDResolver(object):
+
+    def __init__(self):
+        '''
+        Cache of the association names, keyed by (vrf, name). The main
+        loop registers names through lookup(), the worker thread resolves
+        them.
+        '''
+        self.lock = threading.Lock()
+        self.wakeup = threading.Condition(self.lock)
+        self.cache = {}
+        # Changes whenever the address of a cached name changes
+        self.seqno = 0
+        self.exiting = False
+        self.thread = None
+
+    def start(self):
+        self.exiting = False
+        self.thread = threading.Thread(target=self.run,
+                                       name="ops_ntpd_dns")
+        self.thread.daemon = True
+        self.thread.start()
+
+    def stop(self):
+        with self.lock:
+            self.exiting = True
+            self.wakeup.notify()
+        if self.thread is not None:
+            self.thread.join()
+            self.thread = None
+
+    def lookup(self, vrf_name, name):
+        '''
+        Returns the cached address of a name, None if it is not resolved
+        yet. An unknown name is queued for resolution.
+        '''
+        with self.lock:
+            entry = self.cache.get((vrf_name, name))
+            if entry is None:
+                self.cache[(vrf_name, name)] = {"address": None,
+                                                "expires": 0}
+                self.wakeup.notify()
+                return None
+            return entry["address"]
+
+    def retain(self, keys):
+        '''
+        Forgets the names which are not in 'keys' anymore
+        '''
+        with self.lock:
+            for key in list(self.cache.keys()):
+                if key not in keys:
+                    del self.cache[key]
+
+    def dump(self):
+        '''
+        Returns the cache content, for diagnostics
+        '''
+        now = time.time()
+        with self.lock:
+            return ["%s %s -> %s, expires in %d s\n" %
+                    (vrf_name, name, entry["address"],
+                     max(entry["expires"] - now, 0))
+                    for (vrf_name, name), entry in sorted(
+                        self.cache.iteritems())]
+
+    def next_expired(self):
+        '''
+        Waits for a cache entry to expire and returns its key, None when
+        exiting
+        '''
+        with self.lock:
+            while not self.exiting:
+                now = time.time()
+                timeout = None
+                for key, entry in self.cache.iteritems():
+                    if entry["expires"] <= now:
+                        return key
+                    if timeout is None or entry["expires"] - now < timeout:
+                        timeout = entry["expires"] - now
+                self.wakeup.wait(timeout)
+            return None
+
+    def resolve(self, vrf_name, name):
+        netns = ops_ntpd_vrf_netns(vrf_name)
+        if netns is None:
+            return ops_ntpd_dns_resolve(name, ops_ntpd_dns_nameservers(None))
+        # The namespace of a thread can be switched on its own, the
+        # sockets created meanwhile belong to the VRF namespace
+        own_fd = os.open("/proc/self/ns/net", os.O_RDONLY)
+        try:
+            vrf_fd = os.open(NETNS_DIR + netns, os.O_RDONLY)
+            try:
+                ops_ntpd_dns_setns(vrf_fd)
+            finally:
+                os.close(vrf_fd)
+            try:
+                return ops_ntpd_dns_resolve(name,
+                                            ops_ntpd_dns_nameservers(netns))
+            finally:
+                ops_ntpd_dns_setns(own_fd)
+        finally:
+            os.close(own_fd)
+
+    def run(self):
+        while True:
+            key = self.next_expired()
+            if key is None:
+                return
+            (vrf_name, name) = key
+            try:
+                (addresses, ttl) = self.resolve(vrf_name, name)
+                if not addresses:
+                    raise socket.error("no address")
+            except (socket.error, OSError) as e:
+                vlog.warn("Unable to resolve %s in VRF %s : err %s" %
+                          (name, vrf_name, str(e)))
+                (addresses, ttl) = ([], DNS_RETRY_INTERVAL)
+            with self.lock:
+                entry = self.cache.get(key)
+                if entry is None:
+                    continue
+                entry["expires"] = time.time() + ttl
+                # Keep the current address while it is still valid,
+                # and the last known one when resolution failed
+                if not addresses or entry["address"] in addresses:
+                    continue
+                vlog.info("%s in VRF %s resolved to %s, ttl %d s" %
+                          (name, vrf_name, addresses[0], ttl))
+                entry["address"] = addresses[0]
+                self.seqno += 1
+
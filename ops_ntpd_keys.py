@@ -0,0 +1,161 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_KEYS module
+ - Staged rotation of the authentication keys, in three stages:
+   . install: a new key is added to the keys file and trusted next to
+     the old one (readkeys and trustedkey, no association is touched)
+   . switch: the associations moved to the new key are switched one at
+     a time per daemon. NTPD and chronyd only set the key of an
+     association when it is mobilized, so a switched association is
+     re-mobilized (with iburst). The next one is switched once the
+     switched one answered its last 8 polls with its new key (reach
+     377), so the others keep their state and the clock stays
+     synchronized.
+   . retire: a key removed from OVSDB stays installed and trusted for a
+     grace period, and as long as an association still uses it.
+ - A key whose password changes keeps its id, the daemons reread it
+   without touching the associations. This is the rotation which never
+   resets an association: NTPD 4.2.8 ignores a server line for an
+   association which is already mobilized, so a new key id always
+   needs the switch stage.
+'''
+
+import ovs.vlog
+
+vlog = ovs.vlog.Vlog("ops_ntpd_keys")
+
+# Seconds a key removed from OVSDB stays installed and trusted
+DEFAULT_KEY_RETIRE_GRACE = 3600
+# Seconds after which the next association is switched, even if the
+# switched one is not fully reachable again (8 polls of 64 s and more)
+KEY_SWITCH_TIMEOUT = 1200
+# Reach register of an association which answered its last 8 polls
+KEY_SWITCH_REACH = "377"
+
+
+class NTPDKeyRotation(object):
+
+    def __init__(self, grace=DEFAULT_KEY_RETIRE_GRACE):
+        self.grace = grace
+        # Key id -> (key map value, retire time) of the retiring keys
+        self.retiring = {}
+        # Retiring keys whose grace period ended
+        self.expired = set()
+        # VRF -> ((vrf, address), start time) of the association being
+        # switched in that VRF
+        self.switching = {}
+        # Changed when a switch ends or a grace period ends, the
+        # configuration is then applied again
+        self.seqno = 0
+
+    def merge_keys(self, keys, applied_keys, used_key_ids, now):
+        '''
+        Returns the keys to install: the 'keys' from OVSDB, and the
+        'applied_keys' removed from OVSDB until their grace period ended
+        and no key id of 'used_key_ids' refers to them
+        '''
+        for key_id in keys:
+            self.retiring.pop(key_id, None)
+            self.expired.discard(key_id)
+        for key_id, value in applied_keys.iteritems():
+            if key_id not in keys and key_id not in self.retiring:
+                vlog.info("Retiring NTP key %s in %d s" %
+                          (key_id, self.grace))
+                self.retiring[key_id] = (value, now + self.grace)
+        merged = dict(keys)
+        for key_id, (value, retire_time) in self.retiring.items():
+            if now >= retire_time and key_id not in used_key_ids:
+                vlog.info("Retired NTP key %s" % (key_id))
+                del self.retiring[key_id]
+                self.expired.discard(key_id)
+                continue
+            merged[key_id] = value
+        return merged
+
+    def select_switches(self, switches, now):
+        '''
+        Returns the associations of 'switches', (vrf, address) keys,
+        to switch to their new key now: one per VRF, when no other is
+        being switched in that VRF
+        '''
+        selected = {}
+        for key in sorted(switches):
+            if key[0] in self.switching or key[0] in selected:
+                continue
+            selected[key[0]] = key
+            self.switching[key[0]] = (key, now)
+            vlog.info("Switching the key of NTP association %s %s" %
+                      (key[0], key[1]))
+        return selected.values()
+
+    def observe(self, vrf_name, address, reach):
+        '''
+        Ends the switch of an association once it is fully reachable
+        again
+        '''
+        switch = self.switching.get(vrf_name)
+        if switch is None or switch[0][1] != address or \
+                reach != KEY_SWITCH_REACH:
+            return
+        vlog.info("Switched the key of NTP association %s %s" %
+                  (vrf_name, address))
+        del self.switching[vrf_name]
+        self.seqno += 1
+
+    def prune(self, keys):
+        '''
+        Ends the switches of the associations not in 'keys'
+        '''
+        for vrf_name, (key, start) in self.switching.items():
+            if key not in keys:
+                del self.switching[vrf_name]
+                self.seqno += 1
+
+    def clear(self):
+        '''
+        Drops the retiring keys, e.g. when authentication is disabled
+        '''
+        self.retiring = {}
+        self.expired = set()
+
+    def run(self, now):
+        for vrf_name, (key, start) in self.switching.items():
+            if now - start >= KEY_SWITCH_TIMEOUT:
+                vlog.warn("NTP association %s %s not reachable %d s after "
+                          "its key switch" % (key[0], key[1],
+                                              KEY_SWITCH_TIMEOUT))
+                del self.switching[vrf_name]
+                self.seqno += 1
+        for key_id, (value, retire_time) in self.retiring.iteritems():
+            if now >= retire_time and key_id not in self.expired:
+                self.expired.add(key_id)
+                self.seqno += 1
+
+    def dump(self, now):
+        '''
+        Returns the rotation state, for unixctl and diagnostics
+        '''
+        lines = []
+        for vrf_name, (key, start) in sorted(self.switching.iteritems()):
+            lines.append("Switching the key of %s %s for %d s\n" %
+                         (key[0], key[1], int(now - start)))
+        for key_id, (value, retire_time) in sorted(self.retiring.iteritems()):
+            lines.append("Retiring key %s in %d s\n" %
+                         (key_id, max(int(retire_time - now), 0)))
+        return lines
@@ -0,0 +1,169 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_LOG module
+ - Size capped rotation of the daemon log files (ops_ntp.log). The
+   daemons keep their log open (ntpd -l, and the stdout and stderr given
+   by the supervisor), always in append mode, so a full log is copied to
+   '<log>.1' (the older copies shifted to '<log>.2' ...) and truncated
+   in place. The daemons keep writing at the new end of the file, no
+   signal or restart is needed. Lines written between the copy and the
+   truncation are lost.
+ - Bounded reads for the diagnostic dump: the tail of a log, or the lines
+   of a time window, read backwards from the end in blocks, and never
+   more than a byte limit, whatever the size of the log. The
+   configuration and keys files are read the same way.
+ - Key passwords are redacted from the keys files before they are
+   dumped.
+'''
+
+import os
+import time
+import errno
+import shutil
+import calendar
+
+import ovs.vlog
+
+vlog = ovs.vlog.Vlog("ops_ntpd_log")
+
+# Log file rotation, overridable in System:ntp_config
+DEFAULT_LOG_MAX_SIZE_KB = 1024
+DEFAULT_LOG_ROTATE_COUNT = 2
+# Seconds between two checks of the log file sizes
+LOG_ROTATE_INTERVAL = 60
+
+# Log lines in the diagnostic dump, unless a time window is given
+DEFAULT_DIAG_LOG_LINES = 500
+# Bytes read at most from a log for the diagnostic dump
+DIAG_LOG_MAX_BYTES = 256 * 1024
+# Bytes read at most from a configuration or keys file for the dump
+DIAG_CONF_MAX_BYTES = 64 * 1024
+LOG_READ_BLOCK = 8192
+
+LOG_REDACTED = "<redacted>"
+
+
+def ops_ntpd_log_rotate(log_file, max_size, count):
+    '''
+    Rotates 'log_file' if it is larger than 'max_size' bytes, keeping
+    'count' copies. Returns True if it was rotated.
+    '''
+    try:
+        if os.path.getsize(log_file) <= max_size:
+            return False
+        for index in range(count - 1, 0, -1):
+            older = "%s.%d" % (log_file, index)
+            if os.path.exists(older):
+                os.rename(older, "%s.%d" % (log_file, index + 1))
+        with open(log_file, "r+") as log:
+            if count > 0:
+                with open(log_file + ".1", "w") as copy:
+                    shutil.copyfileobj(log, copy, LOG_READ_BLOCK)
+            log.truncate(0)
+    except (OSError, IOError) as e:
+        if e.errno != errno.ENOENT:
+            vlog.warn("Unable to rotate %s : err %s" % (log_file, str(e)))
+        return False
+    vlog.info("Rotated %s" % (log_file))
+    return True
+
+
+def ops_ntpd_log_line_time(line, now):
+    '''
+    Returns the time of a log line, None if it has no timestamp. ntpd
+    writes '18 Oct 23:21:35 ntpd[123]: ...' in local time, chronyd
+    '2016-10-18T23:21:35Z ...' in UTC.
+    '''
+    fields = line.split(" ", 3)
+    try:
+        if fields[0].endswith("Z") and "T" in fields[0]:
+            return calendar.timegm(time.strptime(fields[0],
+                                                 "%Y-%m-%dT%H:%M:%SZ"))
+        if len(fields) < 4:
+            return None
+        year = time.localtime(now).tm_year
+        stamp = time.strptime("%d %s" % (year, " ".join(fields[:3])),
+                              "%Y %d %b %H:%M:%S")
+        line_time = time.mktime(stamp)
+        if line_time > now + 86400:
+            # Written last year
+            stamp = time.strptime("%d %s" % (year - 1, " ".join(fields[:3])),
+                                  "%Y %d %b %H:%M:%S")
+            line_time = time.mktime(stamp)
+        return line_time
+    except ValueError:
+        return None
+
+
+def ops_ntpd_log_tail(log_file, lines=DEFAULT_DIAG_LOG_LINES, since=None,
+                      now=None, max_bytes=DIAG_LOG_MAX_BYTES):
+    '''
+    Returns the last 'lines' lines of 'log_file' (all the lines read when
+    None), or the lines written since the time 'since' when given,
+    reading at most 'max_bytes' from its end. The lines without a
+    timestamp belong to the line before.
+    '''
+    if now is None:
+        now = time.time()
+    blocks = []
+    newlines = 0
+    with open(log_file, "r") as log:
+        log.seek(0, os.SEEK_END)
+        position = log.tell()
+        start = max(position - max_bytes, 0)
+        while position > start:
+            size = min(LOG_READ_BLOCK, position - start)
+            position -= size
+            log.seek(position)
+            block = log.read(size)
+            blocks.append(block)
+            newlines += block.count("\n")
+            if since is None and lines is not None and newlines > lines:
+                break
+            if since is not None:
+                first = block.split("\n", 2)
+                stamp = ops_ntpd_log_line_time(first[1], now) \
+                    if len(first) > 2 else None
+                if stamp is not None and stamp < since:
+                    break
+    content = "".join(reversed(blocks)).splitlines(True)
+    if position > 0 and content:
+        # Partial first line
+        content = content[1:]
+    if since is None:
+        if lines is None:
+            return content
+        return content[-lines:] if lines > 0 else []
+    for index, line in enumerate(content):
+        stamp = ops_ntpd_log_line_time(line, now)
+        if stamp is not None and stamp >= since:
+            return content[index:]
+    return []
+
+
+def ops_ntpd_log_redact_keys(line):
+    '''
+    Returns a line of a keys file ('<id> <type> <key>', for ntpd and
+    chronyd) without its key
+    '''
+    fields = line.split()
+    if len(fields) < 3 or fields[0].startswith("#"):
+        return line
+    return "%s%s %s %s\n" % (line[:len(line) - len(line.lstrip())],
+                             fields[0], fields[1], LOG_REDACTED)
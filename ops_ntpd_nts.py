@@ -0,0 +1,123 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_NTS module
+ - State of the NTS (Network Time Security, RFC 8915) associations.
+   An NTS association gets its keys and a set of cookies from an NTS-KE
+   (key establishment, TLS) handshake with its server. Every NTS
+   request spends a cookie, every response carries a fresh one, so the
+   handshake is only done again when the cookies run out (responses
+   lost) or the server rotated its keys (NAK).
+ - chronyd reports the age of the last handshake and the number of
+   cookies held. The handshakes are counted from the changes of the
+   age. The cookie refreshes are the responses received, each one
+   carrying a fresh cookie, counted from the reach register.
+ - NTPD 4.2.8 has no NTS, only the chrony backend runs NTS
+   associations.
+'''
+
+import ovs.vlog
+from ops_ntpd_stats import STATS_REACH_BITS
+from ops_ntpd_stats import ops_ntpd_stats_parse_interval
+from ops_ntpd_stats import ops_ntpd_stats_parse_reach
+from ops_ntpd_stats import ops_ntpd_stats_reach_polls
+from ops_ntpd_stats import ops_ntpd_stats_reach_zeros
+
+vlog = ovs.vlog.Vlog("ops_ntpd_nts")
+
+# Seconds the handshake time derived from its age may move between two
+# refreshes without a new handshake (the age is rounded)
+NTS_KE_TOLERANCE = 2
+
+# NTS entry keys, as returned by the backends
+NTS_LAST_KE = "last_ke"
+NTS_COOKIES = "cookies"
+
+# Association status keys
+NTS_STATUS_COOKIES = "nts_cookies"
+NTS_STATUS_KE_COUNT = "nts_ke_count"
+NTS_STATUS_COOKIE_REFRESHES = "nts_cookie_refreshes"
+NTS_STATUS_LAST_KE = "nts_last_ke"
+
+NTS_DEFAULT_STR = "-"
+
+
+class NTPDNTSTracker(object):
+
+    def __init__(self):
+        # (vrf, address) -> counters of an NTS association
+        self.associations = {}
+
+    def update(self, key, entry, now, when, poll, reach):
+        '''
+        Returns the association status of the NTS association 'key',
+        from its 'entry' reported by the daemon, None if not reported,
+        and its ntpq 'when', 'poll' and 'reach' values
+        '''
+        state = self.associations.setdefault(key, {
+            "ke_time": None, "cookies": 0, "ke_count": 0,
+            "cookie_refreshes": 0, "last_when": None, "last_reach": None})
+        # Every response carries a fresh cookie
+        state["cookie_refreshes"] += self.responses(
+            state, ops_ntpd_stats_parse_interval(when),
+            ops_ntpd_stats_parse_interval(poll),
+            ops_ntpd_stats_parse_reach(reach))
+        status = {NTS_STATUS_COOKIES: str(state["cookies"]),
+                  NTS_STATUS_KE_COUNT: str(state["ke_count"]),
+                  NTS_STATUS_COOKIE_REFRESHES: str(state["cookie_refreshes"]),
+                  NTS_STATUS_LAST_KE: NTS_DEFAULT_STR}
+        if entry is None:
+            return status
+        if entry[NTS_LAST_KE] is not None:
+            ke_time = now - entry[NTS_LAST_KE]
+            if state["ke_time"] is None or \
+                    ke_time > state["ke_time"] + NTS_KE_TOLERANCE:
+                state["ke_count"] += 1
+                vlog.dbg("NTS-KE handshake of %s %s" % (key[0], key[1]))
+            state["ke_time"] = ke_time
+            status[NTS_STATUS_LAST_KE] = str(entry[NTS_LAST_KE])
+        state["cookies"] = entry[NTS_COOKIES]
+        status[NTS_STATUS_COOKIES] = str(state["cookies"])
+        status[NTS_STATUS_KE_COUNT] = str(state["ke_count"])
+        return status
+
+    def responses(self, state, when, poll, reach):
+        '''
+        Returns the number of responses received since the previous
+        refresh, from the bits shifted into the reach register
+        '''
+        received = when is not None and \
+            (state["last_when"] is None or when < state["last_when"])
+        count = 0
+        if reach is not None and state["last_reach"] is not None:
+            polls = ops_ntpd_stats_reach_polls(state["last_reach"], reach,
+                                               received, when,
+                                               state["last_when"], poll)
+            # The register only holds the last STATS_REACH_BITS polls
+            bits = min(polls, STATS_REACH_BITS)
+            count = bits - ops_ntpd_stats_reach_zeros(reach, bits)
+        state["last_when"] = when
+        state["last_reach"] = reach
+        return count
+
+    def prune(self, keys):
+        '''
+        Drops the associations not in 'keys'
+        '''
+        for key in [k for k in self.associations if k not in keys]:
+            del self.associations[key]
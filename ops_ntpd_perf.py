@@ -0,0 +1,140 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_PERF module
+ - Latency of the phases of the ops-ntpd main loop: status collection,
+   daemon control commands, reconfiguration, hardware clock sync, and
+   the transaction building and OVSDB commit of the status updates.
+ - Each phase keeps a histogram with fixed buckets, its count, total and
+   maximum. Recording a sample is O(1) and the memory used per phase is
+   constant, so the timing can stay on in production.
+ - The histograms are in memory only, listed by the 'ntpd/perf' unixctl
+   command and the diagnostic dump.
+'''
+
+import time
+import contextlib
+
+# Phases
+PERF_ASSOCIATIONS_INFO = "associations_info"
+PERF_GLOBAL_STATUS = "global_status"
+PERF_DAEMON_COMMAND = "daemon_command"
+PERF_RTC_SYNC = "rtc_sync"
+PERF_CHECK_UPDATES = "check_updates"
+PERF_SYNC_TO_NTPD = "sync_to_ntpd"
+PERF_STATUS_UPDATE = "status_update"
+PERF_STATUS_COMMIT = "status_commit"
+
+# Listing order of the phases
+PERF_PHASES = [PERF_ASSOCIATIONS_INFO, PERF_GLOBAL_STATUS,
+               PERF_DAEMON_COMMAND, PERF_RTC_SYNC, PERF_CHECK_UPDATES,
+               PERF_SYNC_TO_NTPD, PERF_STATUS_UPDATE, PERF_STATUS_COMMIT]
+
+# Upper bounds of the histogram buckets (milliseconds), the last bucket
+# holds the samples above the last bound
+PERF_BUCKETS_MS = [1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000]
+
+
+class NTPDPhaseHistogram(object):
+
+    def __init__(self):
+        self.buckets = [0] * (len(PERF_BUCKETS_MS) + 1)
+        self.count = 0
+        self.total = 0.0
+        self.max = 0.0
+
+    def add(self, ms):
+        index = 0
+        while index < len(PERF_BUCKETS_MS) and ms > PERF_BUCKETS_MS[index]:
+            index += 1
+        self.buckets[index] += 1
+        self.count += 1
+        self.total += ms
+        self.max = max(self.max, ms)
+
+    def quantile(self, q):
+        '''
+        Returns the upper bound of the bucket holding the quantile 'q',
+        the maximum for the last bucket
+        '''
+        rank = q * self.count
+        seen = 0
+        for index, count in enumerate(self.buckets):
+            seen += count
+            if seen >= rank and count:
+                if index < len(PERF_BUCKETS_MS):
+                    return min(PERF_BUCKETS_MS[index], self.max)
+                break
+        return self.max
+
+
+class NTPDPerf(object):
+
+    def __init__(self):
+        self.phases = {}
+        self.since = time.time()
+
+    def record(self, phase, seconds):
+        if phase not in self.phases:
+            self.phases[phase] = NTPDPhaseHistogram()
+        self.phases[phase].add(max(seconds, 0) * 1000)
+
+    @contextlib.contextmanager
+    def measure(self, phase):
+        '''
+        Records the time spent in the 'with' block under 'phase', also
+        when it raises
+        '''
+        start = time.time()
+        try:
+            yield
+        finally:
+            self.record(phase, time.time() - start)
+
+    def reset(self):
+        self.phases = {}
+        self.since = time.time()
+
+    def dump(self, now):
+        '''
+        Returns the histograms, for unixctl and diagnostics
+        '''
+        lines = ["Phase latency over the last %d s (ms)\n" %
+                 (int(now - self.since)),
+                 "%-18s %8s %9s %9s %9s %9s\n" %
+                 ("PHASE", "COUNT", "AVG", "P50", "P99", "MAX")]
+        names = [p for p in PERF_PHASES if p in self.phases] + \
+            sorted([p for p in self.phases if p not in PERF_PHASES])
+        for name in names:
+            histogram = self.phases[name]
+            lines.append("%-18s %8d %9.3f %9.3f %9.3f %9.3f\n" %
+                         (name, histogram.count,
+                          histogram.total / histogram.count,
+                          histogram.quantile(0.50),
+                          histogram.quantile(0.99), histogram.max))
+            buckets = []
+            for index, count in enumerate(histogram.buckets):
+                if not count:
+                    continue
+                if index < len(PERF_BUCKETS_MS):
+                    buckets.append("<=%d:%d" % (PERF_BUCKETS_MS[index],
+                                                count))
+                else:
+                    buckets.append(">%d:%d" % (PERF_BUCKETS_MS[-1], count))
+            lines.append("%-18s %s\n" % ("", " ".join(buckets)))
+        return lines
@@ -0,0 +1,127 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_RTC module
+ - Disciplines the hardware clock (RTC) from the NTP synchronized
+   system clock.
+ - The RTC is written once after the first synchronization and then
+   on a configurable interval, and only when it has drifted from the
+   system clock by more than a configurable threshold.
+ - The RTC is accessed through the rtc driver ioctls, the same way
+   'hwclock' does, without forking a process.
+'''
+
+import os
+import time
+import fcntl
+import struct
+import calendar
+import ovs.vlog
+
+vlog = ovs.vlog.Vlog("ops_ntpd_rtc")
+
+RTC_DEVICE = "/dev/rtc0"
+
+# struct rtc_time from <linux/rtc.h> is nine ints (tm_sec ... tm_isdst)
+RTC_TIME_FORMAT = "9i"
+RTC_TIME_SIZE = struct.calcsize(RTC_TIME_FORMAT)
+
+# _IOR('p', 0x09, struct rtc_time) and _IOW('p', 0x0a, struct rtc_time)
+RTC_RD_TIME = 0x80007009 | (RTC_TIME_SIZE << 16)
+RTC_SET_TIME = 0x4000700a | (RTC_TIME_SIZE << 16)
+
+# Defaults, overridden through System:ntp_config
+DEFAULT_RTC_SYNC_INTERVAL = 3600
+DEFAULT_RTC_DRIFT_THRESHOLD = 1
+
+g_rtc_sync_interval = DEFAULT_RTC_SYNC_INTERVAL
+g_rtc_drift_threshold = DEFAULT_RTC_DRIFT_THRESHOLD
+g_rtc_last_check = None
+
+
+def ops_ntpd_rtc_read(fd):
+    '''
+    Returns the RTC time in seconds since the epoch. The RTC is kept
+    in UTC.
+    '''
+    buf = fcntl.ioctl(fd, RTC_RD_TIME, "\0" * RTC_TIME_SIZE)
+    (tm_sec, tm_min, tm_hour, tm_mday, tm_mon, tm_year,
+     tm_wday, tm_yday, tm_isdst) = struct.unpack(RTC_TIME_FORMAT, buf)
+    return calendar.timegm((tm_year + 1900, tm_mon + 1, tm_mday,
+                            tm_hour, tm_min, tm_sec, 0, 0, 0))
+
+
+def ops_ntpd_rtc_write(fd, seconds):
+    tm = time.gmtime(seconds)
+    buf = struct.pack(RTC_TIME_FORMAT, tm.tm_sec, tm.tm_min, tm.tm_hour,
+                      tm.tm_mday, tm.tm_mon - 1, tm.tm_year - 1900,
+                      0, 0, 0)
+    fcntl.ioctl(fd, RTC_SET_TIME, buf)
+
+
+def ops_ntpd_rtc_configure(sync_interval, drift_threshold):
+    '''
+    Update the RTC sync schedule. An interval of 0 disables the
+    periodic sync, the RTC is then written only after the first
+    synchronization.
+    '''
+    global g_rtc_sync_interval, g_rtc_drift_threshold
+    try:
+        g_rtc_sync_interval = max(0, int(sync_interval))
+    except (ValueError, TypeError):
+        g_rtc_sync_interval = DEFAULT_RTC_SYNC_INTERVAL
+    try:
+        g_rtc_drift_threshold = max(1, int(drift_threshold))
+    except (ValueError, TypeError):
+        g_rtc_drift_threshold = DEFAULT_RTC_DRIFT_THRESHOLD
+
+
+def ops_ntpd_rtc_sync(synchronized):
+    '''
+    Called on every status refresh. Writes the RTC when the system
+    clock is synchronized and the sync schedule is due.
+    '''
+    global g_rtc_last_check
+    if not synchronized:
+        return
+    now = time.time()
+    if g_rtc_last_check is not None:
+        if g_rtc_sync_interval == 0 or \
+                now - g_rtc_last_check < g_rtc_sync_interval:
+            return
+    g_rtc_last_check = now
+
+    try:
+        fd = os.open(RTC_DEVICE, os.O_RDONLY)
+    except OSError as e:
+        vlog.warn("Unable to open %s : err %s" % (RTC_DEVICE, str(e)))
+        return
+    try:
+        # The RTC only holds whole seconds
+        drift = ops_ntpd_rtc_read(fd) - int(now)
+        if abs(drift) <= g_rtc_drift_threshold:
+            vlog.dbg("RTC drift %.3f s is within threshold" % drift)
+            return
+        # The RTC has a resolution of one second, round to the closest
+        ops_ntpd_rtc_write(fd, int(time.time() + 0.5))
+        vlog.info("RTC updated from system clock, drift was %.3f s" %
+                  drift)
+    except (IOError, OSError) as e:
+        vlog.warn("Unable to sync RTC : err %s" % (str(e)))
+    finally:
+        os.close(fd)
@@ -0,0 +1,310 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_SHM module
+ - Feeds the NTPD SHM reference clock (driver 28, 127.127.28.<unit>)
+   from a local time source, so that the time of a local GNSS or PTP
+   daemon reaches NTPD through shared memory instead of the network.
+ - The samples are written into the System V shared memory segment
+   0x4E545030 + <unit> with the count/valid protocol of the SHM driver
+   (mode 1), from a worker thread per unit.
+ - Sources are pluggable, selected by the 'refclock_feed' association
+   attribute, "<source>:<path>":
+   - phc: PTP hardware clock device (e.g. /dev/ptp0) read with
+     clock_gettime, converted from TAI to UTC.
+   - socket: Unix datagram socket bound at <path>, each datagram is a
+     "<clock time> [<receive time>]" sample in seconds since the epoch.
+'''
+
+import os
+import time
+import errno
+import socket
+import ctypes
+import threading
+import ovs.vlog
+from ops_ntpd_timex import ops_ntpd_timex_tai_offset
+
+vlog = ovs.vlog.Vlog("ops_ntpd_shm")
+
+NTP_REFCLOCK_ATTRIB_FEED = "refclock_feed"
+
+# Segment key of unit N. Units 0 and 1 are only accessible by root.
+SHM_KEY_BASE = 0x4e545030
+IPC_CREAT = 0o1000
+IPC_RMID = 0
+# About 1 microsecond
+SHM_PRECISION = -20
+
+# Poll interval (seconds) of the sources without their own pace, and
+# retry interval of the sources which failed
+SHM_FEED_INTERVAL = 1
+SHM_FEED_RETRY_INTERVAL = 10
+# Used when the kernel does not know the TAI-UTC offset
+DEFAULT_TAI_OFFSET = 37
+CLOCKFD = 3
+
+
+class ShmTime(ctypes.Structure):
+    # struct shmTime of ntpd refclock_shm.c
+    _fields_ = [("mode", ctypes.c_int),
+                ("count", ctypes.c_int),
+                ("clockTimeStampSec", ctypes.c_long),
+                ("clockTimeStampUSec", ctypes.c_int),
+                ("receiveTimeStampSec", ctypes.c_long),
+                ("receiveTimeStampUSec", ctypes.c_int),
+                ("leap", ctypes.c_int),
+                ("precision", ctypes.c_int),
+                ("nsamples", ctypes.c_int),
+                ("valid", ctypes.c_int),
+                ("clockTimeStampNSec", ctypes.c_uint),
+                ("receiveTimeStampNSec", ctypes.c_uint),
+                ("dummy", ctypes.c_int * 8)]
+
+
+class Timespec(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long),
+                ("tv_nsec", ctypes.c_long)]
+
+libc = ctypes.CDLL(None, use_errno=True)
+libc.shmat.restype = ctypes.c_void_p
+libc.shmat.argtypes = [ctypes.c_int, ctypes.c_void_p, ctypes.c_int]
+libc.shmdt.argtypes = [ctypes.c_void_p]
+libc.shmctl.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_void_p]
+libc.clock_gettime.argtypes = [ctypes.c_int, ctypes.POINTER(Timespec)]
+
+
+def ops_ntpd_shm_attach(unit, create=True):
+    '''
+    Returns the (segment id, shmTime) of a unit, with the permissions
+    NTPD gives the segment when it creates it
+    '''
+    perm = 0o600 if unit < 2 else 0o666
+    flags = perm | (IPC_CREAT if create else 0)
+    shmid = libc.shmget(SHM_KEY_BASE + unit, ctypes.sizeof(ShmTime), flags)
+    if shmid < 0:
+        err = ctypes.get_errno()
+        raise OSError(err, "shmget unit %d : %s" % (unit, os.strerror(err)))
+    addr = libc.shmat(shmid, None, 0)
+    if addr in [None, ctypes.c_void_p(-1).value]:
+        err = ctypes.get_errno()
+        raise OSError(err, "shmat unit %d : %s" % (unit, os.strerror(err)))
+    return (shmid, ShmTime.from_address(addr))
+
+
+def ops_ntpd_shm_detach(shm, shmid=None):
+    '''
+    Detaches a segment, and removes it when 'shmid' is given
+    '''
+    libc.shmdt(ctypes.addressof(shm))
+    if shmid is not None:
+        libc.shmctl(shmid, IPC_RMID, None)
+
+
+def ops_ntpd_shm_write_sample(shm, clock_time, receive_time):
+    '''
+    Writes one sample. NTPD only uses it if 'count' did not change while
+    it read the sample, and clears 'valid' once it did.
+    '''
+    shm.mode = 1
+    shm.valid = 0
+    shm.count += 1
+    shm.clockTimeStampSec = int(clock_time)
+    shm.clockTimeStampUSec = int((clock_time % 1) * 1e6)
+    shm.clockTimeStampNSec = int((clock_time % 1) * 1e9)
+    shm.receiveTimeStampSec = int(receive_time)
+    shm.receiveTimeStampUSec = int((receive_time % 1) * 1e6)
+    shm.receiveTimeStampNSec = int((receive_time % 1) * 1e9)
+    shm.leap = 0
+    shm.precision = SHM_PRECISION
+    shm.count += 1
+    shm.valid = 1
+
+
+class PHCSource(object):
+
+    def __init__(self, path):
+        '''
+        PTP hardware clock. The PHC runs on the PTP timescale (TAI), the
+        sample is converted to UTC.
+        '''
+        self.path = path
+        self.fd = None
+
+    def open(self):
+        self.fd = os.open(self.path, os.O_RDONLY)
+
+    def close(self):
+        if self.fd is not None:
+            os.close(self.fd)
+            self.fd = None
+
+    def read(self, timeout):
+        '''
+        Returns a (clock time, receive time) sample, the receive time is
+        the system time at the middle of the PHC read
+        '''
+        time.sleep(timeout)
+        clock_id = ((~self.fd) << 3) | CLOCKFD
+        ts = Timespec()
+        before = time.time()
+        if libc.clock_gettime(clock_id, ctypes.byref(ts)) != 0:
+            err = ctypes.get_errno()
+            raise OSError(err, os.strerror(err))
+        after = time.time()
+        try:
+            tai_offset = ops_ntpd_timex_tai_offset() or DEFAULT_TAI_OFFSET
+        except OSError:
+            tai_offset = DEFAULT_TAI_OFFSET
+        return (ts.tv_sec + ts.tv_nsec / 1e9 - tai_offset,
+                (before + after) / 2)
+
+
+class SocketSource(object):
+
+    def __init__(self, path):
+        '''
+        Unix datagram socket written by a local daemon
+        '''
+        self.path = path
+        self.sock = None
+
+    def open(self):
+        try:
+            os.unlink(self.path)
+        except OSError as e:
+            if e.errno != errno.ENOENT:
+                raise
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+        self.sock.bind(self.path)
+
+    def close(self):
+        if self.sock is not None:
+            self.sock.close()
+            self.sock = None
+            try:
+                os.unlink(self.path)
+            except OSError:
+                pass
+
+    def read(self, timeout):
+        '''
+        Returns the sample of the next datagram, None on timeout.
+        Malformed datagrams are dropped.
+        '''
+        self.sock.settimeout(timeout)
+        try:
+            msg = self.sock.recv(256)
+        except socket.timeout:
+            return None
+        receive_time = time.time()
+        fields = msg.split()
+        try:
+            if len(fields) == 1:
+                return (float(fields[0]), receive_time)
+            if len(fields) == 2:
+                return (float(fields[0]), float(fields[1]))
+        except ValueError:
+            pass
+        vlog.dbg("Malformed sample on %s : %r" % (self.path, msg))
+        return None
+
+SHM_FEED_SOURCES = {
+    "phc": PHCSource,
+    "socket": SocketSource,
+}
+
+
+def ops_ntpd_shm_parse_feed(feed):
+    '''
+    Returns the source of a "<source>:<path>" feed, None if malformed
+    '''
+    (kind, sep, path) = feed.partition(":")
+    if not sep or kind not in SHM_FEED_SOURCES or not path.startswith("/"):
+        return None
+    return SHM_FEED_SOURCES[kind](path)
+
+
+class NTPDShmFeeder(object):
+
+    def __init__(self, unit, feed):
+        '''
+        Writes the samples of the 'feed' source into the SHM segment of
+        'unit' from a worker thread
+        '''
+        self.unit = unit
+        self.feed = feed
+        self.source = ops_ntpd_shm_parse_feed(feed)
+        self.exiting = threading.Event()
+        self.thread = None
+        self.samples = 0
+        self.errors = 0
+        self.last_sample = None
+
+    def start(self):
+        self.exiting.clear()
+        self.thread = threading.Thread(target=self.run,
+                                       name="ops_ntpd_shm%d" % (self.unit))
+        self.thread.daemon = True
+        self.thread.start()
+
+    def stop(self):
+        self.exiting.set()
+        if self.thread is not None:
+            self.thread.join()
+            self.thread = None
+
+    def dump(self):
+        '''
+        Returns the feeder state, for diagnostics
+        '''
+        last = "never" if self.last_sample is None else \
+            "%.3f s ago" % (time.time() - self.last_sample)
+        return "unit %d <- %s, %d samples, %d errors, last %s\n" % \
+            (self.unit, self.feed, self.samples, self.errors, last)
+
+    def run(self):
+        if self.source is None:
+            vlog.err("Invalid feed %s of SHM unit %d" %
+                     (self.feed, self.unit))
+            return
+        shm = None
+        while not self.exiting.is_set():
+            try:
+                if shm is None:
+                    (shmid, shm) = ops_ntpd_shm_attach(self.unit)
+                    self.source.open()
+                    vlog.info("Feeding SHM unit %d from %s" %
+                              (self.unit, self.feed))
+                sample = self.source.read(SHM_FEED_INTERVAL)
+                if sample is not None:
+                    ops_ntpd_shm_write_sample(shm, sample[0], sample[1])
+                    self.samples += 1
+                    self.last_sample = time.time()
+            except (OSError, IOError, socket.error) as e:
+                vlog.warn("SHM unit %d feed %s failed : err %s" %
+                          (self.unit, self.feed, str(e)))
+                self.errors += 1
+                self.source.close()
+                if shm is not None:
+                    ops_ntpd_shm_detach(shm)
+                    shm = None
+                self.exiting.wait(SHM_FEED_RETRY_INTERVAL)
+        self.source.close()
+        if shm is not None:
+            ops_ntpd_shm_detach(shm)
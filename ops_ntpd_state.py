@@ -0,0 +1,165 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_STATE module
+ - Warm start state, kept on persistent storage across reboots and
+   ops-ntpd restarts.
+ - Every instance has a driftfile, written by the time daemon itself,
+   so that it starts with the frequency correction it last converged
+   to instead of zero.
+ - The last known good server, the one the clock was stable on, is
+   saved. On the next start it is configured with 'iburst', so that the
+   first samples arrive within seconds. Its offset is not saved, the
+   offset after a restart depends on the RTC, not on the last run.
+ - The offset of the clock disciplining instance is stable once it
+   stayed within STABLE_OFFSET_MS for STABLE_OFFSET_HOLD seconds. The
+   time from the daemon start to the beginning of that period is
+   reported as the time to stable offset.
+'''
+
+import os
+import json
+import ovs.vlog
+from ops_ntpd_conf import ops_ntpd_conf_write_atomic
+
+vlog = ovs.vlog.Vlog("ops_ntpd_state")
+
+# Persistent storage of the warm start state
+NTP_STATE_DIR = "/var/lib/ntp/"
+NTP_STATE_FILE = NTP_STATE_DIR + "ops_ntp.state"
+
+# Stable offset band (milliseconds) and hold time (seconds)
+STABLE_OFFSET_MS = 1.0
+STABLE_OFFSET_HOLD = 256
+# The state is saved again at most this often (seconds), unless the
+# server changes
+STATE_SAVE_INTERVAL = 3600
+
+
+def ops_ntpd_state_drift_file(vrf_name):
+    return NTP_STATE_DIR + vrf_name + ".drift"
+
+
+def ops_ntpd_state_load(filename):
+    '''
+    Returns the saved state, an empty one when there is none
+    '''
+    try:
+        with open(filename, "r") as f:
+            state = json.load(f)
+        if not isinstance(state, dict):
+            raise ValueError("not an object")
+        return state
+    except IOError:
+        return {}
+    except ValueError as e:
+        vlog.warn("Ignoring warm start state %s : err %s" %
+                  (filename, str(e)))
+        return {}
+
+
+class NTPDWarmStart(object):
+
+    def __init__(self, state_file):
+        '''
+        Warm start state of the clock disciplining instance, saved in
+        'state_file'. Nothing is read before load().
+        '''
+        self.state_file = state_file
+        self.state = {}
+        # Start time of the tracked daemon
+        self.started = None
+        # Start of the current period within the stable offset band
+        self.in_band_since = None
+        self.time_to_stable = None
+        self.saved = None
+
+    def load(self):
+        '''
+        Reads the saved state. The directory, which also holds the
+        driftfiles, is created if needed and kept across restarts.
+        '''
+        dirname = os.path.dirname(self.state_file)
+        if not os.path.isdir(dirname):
+            try:
+                os.makedirs(dirname, 0o700)
+            except OSError as e:
+                vlog.warn("Unable to create %s : err %s" % (dirname, str(e)))
+        self.state = ops_ntpd_state_load(self.state_file)
+        if self.server() is not None:
+            vlog.info("Warm start from server %s in VRF %s" %
+                      (self.state["server"], self.state["vrf"]))
+
+    def server(self):
+        '''
+        Returns the (vrf, address) of the last known good server, None
+        if there is none
+        '''
+        if "vrf" not in self.state or "server" not in self.state:
+            return None
+        return (str(self.state["vrf"]), str(self.state["server"]))
+
+    def update(self, now, started, vrf_name, peer, offset):
+        '''
+        Tracks the offset of the system peer 'peer' of the daemon of
+        'vrf_name' started at 'started'. 'peer' is None, and 'offset'
+        meaningless, when the daemon is not synchronized.
+        '''
+        if started != self.started:
+            self.started = started
+            self.in_band_since = None
+            self.time_to_stable = None
+        try:
+            offset = float(offset)
+        except (TypeError, ValueError):
+            peer = None
+        if peer is None or abs(offset) > STABLE_OFFSET_MS:
+            self.in_band_since = None
+            return
+        if self.in_band_since is None:
+            self.in_band_since = now
+        if now - self.in_band_since < STABLE_OFFSET_HOLD:
+            return
+        if self.time_to_stable is None:
+            self.time_to_stable = int(self.in_band_since - started)
+            vlog.info("Offset stable within %.1f ms, %d s after start" %
+                      (STABLE_OFFSET_MS, self.time_to_stable))
+        if self.server() != (vrf_name, peer) or self.saved is None or \
+                now - self.saved >= STATE_SAVE_INTERVAL:
+            self.save(now, vrf_name, peer)
+
+    def save(self, now, vrf_name, peer):
+        state = {"vrf": vrf_name, "server": peer, "saved": int(now)}
+        # A failed save is retried on the save interval
+        self.state = state
+        self.saved = now
+        try:
+            ops_ntpd_conf_write_atomic(self.state_file,
+                                       json.dumps(state, sort_keys=True))
+        except (IOError, OSError) as e:
+            vlog.warn("Unable to save the warm start state : err %s" %
+                      (str(e)))
+
+    def dump(self):
+        '''
+        Returns the warm start state, for diagnostics
+        '''
+        return ["Last known good server %s\n" % (self.server(),),
+                "Time to stable offset %s s\n" %
+                (self.time_to_stable if self.time_to_stable is not None
+                 else "-")]
@@ -0,0 +1,307 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_STATS module
+ - Keeps clock-health statistics for every NTP association.
+ - Statistics are updated incrementally on each status refresh.
+   Every update is O(1) and the memory used per association is
+   constant, so no history of samples is kept or scanned.
+ - Offset percentiles use the P-square quantile estimator.
+   More info: Jain & Chlamtac, "The P^2 algorithm for dynamic
+   calculation of quantiles and histograms without storing
+   observations", CACM 28(10), 1985.
+ - Allan deviation is computed from the offset (phase) samples taken
+   at every new poll, for tau = N x polling interval.
+ - Lost polls are counted from the reach register: the bits shifted in
+   since the previous refresh which are 0.
+'''
+
+import math
+
+# Quantiles reported for the offset
+STATS_OFFSET_QUANTILES = [("offset_p50", 0.50),
+                          ("offset_p95", 0.95),
+                          ("offset_p99", 0.99)]
+
+# Allan deviation is reported for tau = N x polling interval
+STATS_ALLAN_TAU_MULTIPLIERS = [1, 4, 16]
+
+# Association status keys
+STATS_ALLAN_DEVIATION_KEY = "allan_deviation_tau_%d"
+STATS_SAMPLES = "stats_samples"
+STATS_REACH_LOSS_COUNT = "reach_loss_count"
+
+# ntpd reach register, one bit per poll
+STATS_REACH_BITS = 8
+STATS_REACH_MASK = (1 << STATS_REACH_BITS) - 1
+
+STATS_DEFAULT_STR = "-"
+
+# Per association statistics, keyed by the remote peer address
+g_assoc_stats = {}
+
+
+class P2Quantile(object):
+    '''
+    Streaming estimator for a single quantile using five markers.
+    '''
+
+    def __init__(self, quantile):
+        self.p = quantile
+        self.count = 0
+        self.heights = []
+        self.positions = [1, 2, 3, 4, 5]
+        self.desired = [1, 1 + 2 * quantile, 1 + 4 * quantile,
+                        3 + 2 * quantile, 5]
+        self.increments = [0, quantile / 2, quantile,
+                           (1 + quantile) / 2, 1]
+
+    def add(self, x):
+        self.count += 1
+        if self.count <= 5:
+            self.heights.append(x)
+            self.heights.sort()
+            return
+
+        q = self.heights
+        n = self.positions
+        if x < q[0]:
+            q[0] = x
+            k = 0
+        elif x >= q[4]:
+            q[4] = x
+            k = 3
+        else:
+            k = 0
+            while x >= q[k + 1]:
+                k += 1
+
+        for i in range(k + 1, 5):
+            n[i] += 1
+        for i in range(5):
+            self.desired[i] += self.increments[i]
+
+        # Adjust the heights of the three middle markers if needed
+        for i in range(1, 4):
+            d = self.desired[i] - n[i]
+            if (d >= 1 and n[i + 1] - n[i] > 1) or \
+                    (d <= -1 and n[i - 1] - n[i] < -1):
+                d = 1 if d > 0 else -1
+                h = self._parabolic(i, d)
+                if not q[i - 1] < h < q[i + 1]:
+                    h = self._linear(i, d)
+                q[i] = h
+                n[i] += d
+
+    def _parabolic(self, i, d):
+        q = self.heights
+        n = self.positions
+        return q[i] + float(d) / (n[i + 1] - n[i - 1]) * \
+            ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+             (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]))
+
+    def _linear(self, i, d):
+        q = self.heights
+        n = self.positions
+        return q[i] + d * (q[i + d] - q[i]) / (n[i + d] - n[i])
+
+    def value(self):
+        if self.count == 0:
+            return None
+        if self.count <= 5:
+            # Not enough samples for the markers yet, use the exact value
+            idx = int(round(self.p * (len(self.heights) - 1)))
+            return self.heights[idx]
+        return self.heights[2]
+
+
+class AllanDeviation(object):
+    '''
+    Overlapping Allan deviation computed from phase samples for a fixed
+    set of tau multipliers. Only the last 2 x max(multiplier) samples are
+    kept in a ring buffer.
+    '''
+
+    def __init__(self, multipliers):
+        self.multipliers = multipliers
+        self.size = 2 * max(multipliers) + 1
+        self.reset(None)
+
+    def reset(self, tau0):
+        self.tau0 = tau0
+        self.ring = [0.0] * self.size
+        self.count = 0
+        self.sums = dict((m, 0.0) for m in self.multipliers)
+        self.terms = dict((m, 0) for m in self.multipliers)
+
+    def add(self, x, tau0):
+        # Samples are only comparable at a constant sampling interval
+        if tau0 != self.tau0:
+            self.reset(tau0)
+        self.ring[self.count % self.size] = x
+        self.count += 1
+        for m in self.multipliers:
+            if self.count > 2 * m:
+                x1 = self.ring[(self.count - 1 - m) % self.size]
+                x2 = self.ring[(self.count - 1 - 2 * m) % self.size]
+                d = x - 2 * x1 + x2
+                self.sums[m] += d * d
+                self.terms[m] += 1
+
+    def value(self, m):
+        if self.terms[m] == 0 or not self.tau0:
+            return None
+        tau = m * self.tau0
+        return math.sqrt(self.sums[m] / (2.0 * tau * tau * self.terms[m]))
+
+
+def ops_ntpd_stats_reach_polls(last_reach, reach, received, when, last_when,
+                               poll):
+    '''
+    Returns the number of polls since the previous refresh. Each poll
+    shifts the reach register left and sets its low bit when the peer
+    answered, so this is the smallest shift turning 'last_reach' into
+    'reach', at least 1 when a reply was 'received'. An unreachable peer
+    leaves the register at 0, its polls are counted from 'when', the
+    time since its last reply.
+    '''
+    if reach == 0 and last_reach == 0:
+        if when is None or last_when is None or not poll:
+            return 0
+        return max(when // poll - last_when // poll, 0)
+    for shift in range(1 if received else 0, STATS_REACH_BITS):
+        mask = STATS_REACH_MASK & (STATS_REACH_MASK << shift)
+        if (last_reach << shift) & mask == reach & mask:
+            return shift
+    return STATS_REACH_BITS
+
+
+def ops_ntpd_stats_reach_zeros(reach, polls):
+    '''
+    Returns the number of polls without reply among the last 'polls'
+    bits shifted into the reach register
+    '''
+    bits = min(polls, STATS_REACH_BITS)
+    zeros = bits - bin(reach & ((1 << bits) - 1)).count("1")
+    # Only an unreachable peer is seen polled more often than the register
+    # holds, all its polls were lost
+    return zeros + polls - bits
+
+
+class AssociationStats(object):
+
+    def __init__(self):
+        self.quantiles = [(key, P2Quantile(q))
+                          for key, q in STATS_OFFSET_QUANTILES]
+        self.adev = AllanDeviation(STATS_ALLAN_TAU_MULTIPLIERS)
+        self.samples = 0
+        self.reach_loss = 0
+        self.last_when = None
+        self.last_reach = None
+
+    def add(self, when, poll, reach, offset):
+        '''
+        Account one status refresh. A new sample is taken only when
+        ntpd has polled the association since the previous refresh.
+        '''
+        new_poll = when is not None and \
+            (self.last_when is None or when < self.last_when)
+        if reach is not None and self.last_reach is not None:
+            polls = ops_ntpd_stats_reach_polls(self.last_reach, reach,
+                                               new_poll, when, self.last_when,
+                                               poll)
+            self.reach_loss += ops_ntpd_stats_reach_zeros(reach, polls)
+        self.last_when = when
+        self.last_reach = reach
+        if not new_poll or offset is None:
+            return
+        self.samples += 1
+        for key, estimator in self.quantiles:
+            estimator.add(offset)
+        if poll:
+            # ntpq reports offset in milliseconds, phase is in seconds
+            self.adev.add(offset / 1000.0, poll)
+
+    def status(self):
+        status = {}
+        for key, estimator in self.quantiles:
+            value = estimator.value()
+            status[key] = STATS_DEFAULT_STR if value is None \
+                else "%.3f" % value
+        for m in STATS_ALLAN_TAU_MULTIPLIERS:
+            value = self.adev.value(m)
+            status[STATS_ALLAN_DEVIATION_KEY % m] = STATS_DEFAULT_STR \
+                if value is None else "%.3e" % value
+        status[STATS_SAMPLES] = str(self.samples)
+        status[STATS_REACH_LOSS_COUNT] = str(self.reach_loss)
+        return status
+
+
+def ops_ntpd_stats_parse_interval(value):
+    '''
+    ntpq prints 'when' and 'poll' either in seconds or with a
+    m/h/d suffix once they are too large for the column.
+    '''
+    units = {"m": 60, "h": 3600, "d": 86400}
+    try:
+        if value[-1] in units:
+            return int(value[:-1]) * units[value[-1]]
+        return int(value)
+    except (ValueError, IndexError, TypeError):
+        return None
+
+
+def ops_ntpd_stats_parse_float(value):
+    try:
+        return float(value)
+    except (ValueError, TypeError):
+        return None
+
+
+def ops_ntpd_stats_parse_reach(value):
+    try:
+        return int(value, 8)
+    except (ValueError, TypeError):
+        return None
+
+
+def ops_ntpd_stats_update(address, when, poll, reach, offset):
+    '''
+    Feed the latest ntpq values of an association and return its
+    statistics as association_status key/values.
+    '''
+    global g_assoc_stats
+    stats = g_assoc_stats.get(address)
+    if stats is None:
+        stats = AssociationStats()
+        g_assoc_stats[address] = stats
+    stats.add(ops_ntpd_stats_parse_interval(when),
+              ops_ntpd_stats_parse_interval(poll),
+              ops_ntpd_stats_parse_reach(reach),
+              ops_ntpd_stats_parse_float(offset))
+    return stats.status()
+
+
+def ops_ntpd_stats_prune(addresses):
+    '''
+    Drop the statistics of associations which are no longer present.
+    '''
+    global g_assoc_stats
+    for address in list(g_assoc_stats.keys()):
+        if address not in addresses:
+            del g_assoc_stats[address]
@@ -0,0 +1,315 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_SUPERVISOR module
+ - Runs NTPD in the foreground ('ntpd -n') as a child of ops-ntpd, so
+   the daemon is tracked, and signalled, through its process handle
+   instead of being looked up in the process table.
+ - An NTPD which exited is reaped on the next poll and restarted after
+   a backoff. The backoff doubles on every exit, up to a maximum, and
+   is reset once NTPD stayed up long enough.
+ - The restart count and the uptime of NTPD are kept for the status.
+ - NTPD writes a pid file. A restarted ops-ntpd uses it to stop the NTPD
+   left over by its previous run, once it checked that the pid still
+   belongs to that NTPD.
+ - The same applies to chronyd, when it is the time daemon backend.
+ - On a hitless restart of ops-ntpd the daemon is adopted instead: a
+   pid file naming a live daemon started with the expected command line
+   is supervised as is, through /proc, since it is not a child of this
+   ops-ntpd. Its exit status is then unknown. Its pid is checked against
+   the pid file and the working directory before it is reported alive
+   or signalled, so a reused pid is never taken for the daemon.
+'''
+
+import os
+import time
+import signal
+import subprocess
+import ovs.vlog
+
+vlog = ovs.vlog.Vlog("ops_ntpd_supervisor")
+
+# Restart backoff (seconds)
+DEFAULT_RESTART_BACKOFF = 1
+MAX_RESTART_BACKOFF = 60
+# NTPD running for this long (seconds) is stable, the backoff is reset
+RESTART_BACKOFF_RESET = 120
+# Time (seconds) given to NTPD to exit on SIGTERM before SIGKILL
+STOP_TIMEOUT = 5
+# Time daemons which may be left over by a previous run
+SUPERVISED_DAEMONS = ["ntpd", "chronyd"]
+
+
+def ops_ntpd_supervisor_read_pid(pid_file):
+    try:
+        with open(pid_file, "r") as f:
+            return int(f.read().strip())
+    except (IOError, ValueError):
+        return None
+
+
+def ops_ntpd_supervisor_owns_pid(pid, pid_file):
+    '''
+    Returns True if 'pid' is a time daemon started with a file of the
+    working directory of 'pid_file' (the pid file itself for NTPD, the
+    configuration file for chronyd), so that a stale pid reused by
+    another process is never signalled
+    '''
+    try:
+        with open("/proc/%d/cmdline" % (pid), "r") as f:
+            argv = f.read().split("\0")
+    except IOError:
+        return False
+    working_dir = os.path.dirname(pid_file)
+    return any([os.path.dirname(x) == working_dir for x in argv
+                if os.path.isabs(x)]) and \
+        any([os.path.basename(x) in SUPERVISED_DAEMONS for x in argv])
+
+
+def ops_ntpd_supervisor_runs_argv(pid, argv):
+    '''
+    Returns True if 'pid' runs the command line 'argv'. The program is
+    compared by name, it may be run through an interpreter.
+    '''
+    try:
+        with open("/proc/%d/cmdline" % (pid), "r") as f:
+            cmdline = f.read().split("\0")[:-1]
+    except IOError:
+        return False
+    if len(cmdline) < len(argv):
+        return False
+    cmdline = cmdline[len(cmdline) - len(argv):]
+    return os.path.basename(cmdline[0]) == os.path.basename(argv[0]) and \
+        cmdline[1:] == argv[1:]
+
+
+def ops_ntpd_supervisor_start_time(pid):
+    '''
+    Returns the start time of a process, None if it is unknown
+    '''
+    try:
+        with open("/proc/%d/stat" % (pid), "r") as f:
+            # The command name may hold spaces, fields follow its ')'
+            fields = f.read().rsplit(")", 1)[1].split()
+        with open("/proc/stat", "r") as f:
+            btime = [int(x.split()[1]) for x in f if x.startswith("btime")]
+        return btime[0] + float(fields[19]) / os.sysconf("SC_CLK_TCK")
+    except (IOError, IndexError, ValueError, OSError):
+        return None
+
+
+def ops_ntpd_supervisor_stop_stale(pid_file):
+    '''
+    Stops the NTPD left over by a previous run of ops-ntpd
+    '''
+    pid = ops_ntpd_supervisor_read_pid(pid_file)
+    if pid is None or not ops_ntpd_supervisor_owns_pid(pid, pid_file):
+        return
+    vlog.info("Stopping stale ntpd, pid %d" % (pid))
+    sig = signal.SIGTERM
+    deadline = time.time() + STOP_TIMEOUT
+    while ops_ntpd_supervisor_owns_pid(pid, pid_file):
+        if time.time() >= deadline:
+            sig = signal.SIGKILL
+        try:
+            os.kill(pid, sig)
+        except OSError:
+            break
+        time.sleep(0.1)
+    try:
+        os.unlink(pid_file)
+    except OSError:
+        pass
+
+
+class NTPDAdoptedProcess(object):
+
+    def __init__(self, pid, pid_file):
+        '''
+        A daemon started by a previous run of ops-ntpd, with the subset
+        of the subprocess.Popen interface used by NTPDSupervisor. Its
+        ownership is checked again through 'pid_file' on every poll.
+        '''
+        self.pid = pid
+        self.pid_file = pid_file
+        self.returncode = None
+
+    def poll(self):
+        if self.returncode is not None:
+            return self.returncode
+        if not ops_ntpd_supervisor_owns_pid(self.pid, self.pid_file):
+            # Exited, the pid may have been reused by another process
+            self.returncode = -1
+            return self.returncode
+        try:
+            with open("/proc/%d/stat" % (self.pid), "r") as f:
+                state = f.read().rsplit(")", 1)[1].split()[0]
+            if state != "Z":
+                return None
+        except (IOError, IndexError):
+            pass
+        # Reaped by init, the exit status is lost
+        self.returncode = -1
+        return self.returncode
+
+    def send_signal(self, sig):
+        # Never signal a pid which no longer belongs to the daemon
+        if self.poll() is None:
+            os.kill(self.pid, sig)
+
+    def terminate(self):
+        self.send_signal(signal.SIGTERM)
+
+    def kill(self):
+        self.send_signal(signal.SIGKILL)
+
+    def wait(self):
+        while self.poll() is None:
+            time.sleep(0.1)
+        return self.returncode
+
+
+class NTPDSupervisor(object):
+
+    def __init__(self, name, argv, pid_file, log_file):
+        '''
+        Supervises the NTPD started with 'argv'. NTPD must run in the
+        foreground and write its pid to 'pid_file'.
+        '''
+        self.name = name
+        self.argv = argv
+        self.pid_file = pid_file
+        self.log_file = log_file
+        self.process = None
+        self.started = None
+        self.restarts = 0
+        self.backoff = DEFAULT_RESTART_BACKOFF
+        self.restart_at = None
+
+    def spawn(self, now):
+        self.started = now
+        try:
+            with open(os.devnull, "r") as devnull, \
+                    open(self.log_file, "a") as log:
+                # NTPD gets its own process group, signals sent to the
+                # ops-ntpd group do not reach it
+                self.process = subprocess.Popen(self.argv, stdin=devnull,
+                                                stdout=log, stderr=log,
+                                                close_fds=True,
+                                                preexec_fn=os.setpgrp)
+        except (OSError, IOError) as e:
+            vlog.err("Unable to start ntpd %s, command %s : err %s" %
+                     (self.name, " ".join(self.argv), str(e)))
+            self.process = None
+            self.schedule_restart(now)
+            return False
+        vlog.info("ntpd %s started, pid %d" % (self.name, self.process.pid))
+        return True
+
+    def adopt(self, daemon_argv):
+        '''
+        Supervises the daemon a previous ops-ntpd run left running, if
+        its pid file names a live daemon running 'daemon_argv' (the
+        command line without the network namespace wrapper). Returns
+        False if there is no such daemon.
+        '''
+        pid = ops_ntpd_supervisor_read_pid(self.pid_file)
+        if pid is None or not ops_ntpd_supervisor_owns_pid(pid,
+                                                           self.pid_file):
+            return False
+        if not ops_ntpd_supervisor_runs_argv(pid, daemon_argv):
+            vlog.info("ntpd %s, pid %d, runs another command line, not "
+                      "adopted" % (self.name, pid))
+            return False
+        self.process = NTPDAdoptedProcess(pid, self.pid_file)
+        self.started = ops_ntpd_supervisor_start_time(pid) or time.time()
+        self.restart_at = None
+        vlog.info("ntpd %s adopted, pid %d" % (self.name, pid))
+        return True
+
+    def schedule_restart(self, now):
+        if now - self.started >= RESTART_BACKOFF_RESET:
+            self.backoff = DEFAULT_RESTART_BACKOFF
+        self.restart_at = now + self.backoff
+        self.backoff = min(self.backoff * 2, MAX_RESTART_BACKOFF)
+
+    def start(self):
+        '''
+        Starts NTPD, after stopping the one of a previous ops-ntpd run
+        '''
+        ops_ntpd_supervisor_stop_stale(self.pid_file)
+        self.restart_at = None
+        return self.spawn(time.time())
+
+    def poll(self, now):
+        '''
+        Reaps NTPD if it exited and restarts it once the backoff expired.
+        Returns True if NTPD was restarted.
+        '''
+        if self.process is not None:
+            code = self.process.poll()
+            if code is None:
+                return False
+            vlog.err("ntpd %s, pid %d, exited with %d after %d s" %
+                     (self.name, self.process.pid, code,
+                      now - self.started))
+            self.process = None
+            self.schedule_restart(now)
+            vlog.info("ntpd %s restart in %d s" %
+                      (self.name, self.restart_at - now))
+        if self.restart_at is None or now < self.restart_at:
+            return False
+        self.restart_at = None
+        self.restarts += 1
+        return self.spawn(now)
+
+    def stop(self):
+        '''
+        Stops NTPD, SIGKILL if it does not exit in time
+        '''
+        self.restart_at = None
+        if self.process is None:
+            return
+        process = self.process
+        self.process = None
+        try:
+            process.terminate()
+            deadline = time.time() + STOP_TIMEOUT
+            while process.poll() is None and time.time() < deadline:
+                time.sleep(0.1)
+            if process.poll() is None:
+                vlog.warn("ntpd %s did not exit, killing it" % (self.name))
+                process.kill()
+                process.wait()
+        except OSError as e:
+            vlog.warn("Unable to stop ntpd %s : err %s" % (self.name, str(e)))
+        try:
+            os.unlink(self.pid_file)
+        except OSError:
+            pass
+        vlog.info("ntpd %s stopped" % (self.name))
+
+    def pid(self):
+        if self.process is None:
+            return None
+        return self.process.pid
+
+    def uptime(self, now):
+        if self.process is None:
+            return 0
+        return int(now - self.started)
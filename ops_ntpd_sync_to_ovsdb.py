@@ -19,6 +19,9 @@ NOTES:
  OPS_NTPD_SYNC_TO_OVSDB script
  - This script pushes status updates from NTPD
    (modified and given by OPS-NTPD).
+ - OPS-NTPD commits the status on its own IDL connection, without
+   blocking its main loop: one transaction is in flight at a time, and
+   the updates given meanwhile are merged into the next one.
  - Intention of detaching this code from OPS_NTPD
    daemon script is so that
    we can use this script as a standlone script to
@@ -27,11 +30,14 @@ NOTES:
 
 import json
 import sys
+import time
 from time import sleep
 import ovs.dirs
 from ovs.db import error
 import ovs.db.idl
 import ovs.vlog
+from ops_ntpd_perf import PERF_STATUS_UPDATE
+from ops_ntpd_perf import PERF_STATUS_COMMIT
 
 vlog = ovs.vlog.Vlog("ops_ntpd_sync_mgr")
 
@@ -48,45 +54,62 @@ ovs_schema = '/usr/share/openvswitch/vswitch.ovsschema'
 NTP_ASSOCIATION_TABLE = 'NTP_Association'
 NTP_KEY_TABLE = 'NTP_Key'
 SYSTEM_TABLE = 'System'
+VRF_TABLE = 'VRF'
 
 # Columns definitions
 SYSTEM_CUR_CFG = 'cur_cfg'
 SYSTEM_NTP_STATUS = 'ntp_status'
 SYSTEM_NTP_STATISTICS = 'ntp_statistics'
 NTP_ASSOCIATION_ADDRESS = 'address'
+NTP_ASSOCIATION_VRF = 'vrf'
 NTP_ASSOCIATION_STATUS = 'association_status'
+VRF_NAME = 'name'
 
 
 class NTPTransactionMgr(object):
 
-    def __init__(self, location=None):
+    def __init__(self, idl=None, perf=None):
         '''
-        Create a IDL connection to the OVSDB and register all the
-        columns with schema helper.
+        Commits on 'idl', which must have the columns of
+        ops_ntpd_sync_mgr_register_columns(). Without it, create a IDL
+        connection to the OVSDB and register all the columns with
+        schema helper. The update and commit latencies are recorded in
+        'perf' if given.
         '''
-        self.idl = None
+        self.idl = idl
         self.txn = None
-        self.schema_helper = ovs.db.idl.SchemaHelper(
-            location=ovs_schema)
-        self.schema_helper.register_columns(SYSTEM_TABLE,
-                                            [SYSTEM_NTP_STATUS,
-                                             SYSTEM_NTP_STATISTICS,
-                                             SYSTEM_CUR_CFG])
-        self.schema_helper.register_columns(NTP_ASSOCIATION_TABLE,
-                                            [NTP_ASSOCIATION_ADDRESS,
-                                             NTP_ASSOCIATION_STATUS])
-        self.idl = ovs.db.idl.Idl(def_db, self.schema_helper)
+        self.perf = perf
+        # Updates waiting for the transaction in flight, and the start
+        # of that transaction
+        self.pending = None
+        self.commit_start = None
+        self.own_idl = idl is None
+        if self.own_idl:
+            self.schema_helper = ovs.db.idl.SchemaHelper(
+                location=ovs_schema)
+            ops_ntpd_sync_mgr_register_columns(self.schema_helper)
+            self.idl = ovs.db.idl.Idl(def_db, self.schema_helper)
+            while not self.idl.run():
+                sleep(.1)
         self.address = None
-        while not self.idl.run():
-            sleep(.1)
 
     def set_ntp_association_status(self, row, entry):
         setattr(row, 'association_status', entry)
 
-    def find_row_by_ip_addr(self, server_ip_addr):
+    def find_vrf_uuid_by_name(self, vrf_name):
+        '''
+        Return the uuid of the VRF row named 'vrf_name', None if there is
+        no such VRF
+        '''
+        for vrf_uuid, ovs_rec in self.idl.tables[VRF_TABLE].rows.iteritems():
+            if ovs_rec.name == vrf_name:
+                return str(vrf_uuid)
+        return None
+
+    def find_row_by_ip_addr(self, vrf_uuid, server_ip_addr):
         '''
         Walk through the rows in the NTP Association table (if any)
-        looking for a row with mac addr passed in argument
+        looking for a row with the VRF and ip addr passed in argument
         If row is found, set variable tbl_found to True and return
         the row object to caller function
         '''
@@ -94,7 +117,9 @@ class NTPTransactionMgr(object):
         ovs_rec = None
         for ovs_rec in \
                 self.idl.tables[NTP_ASSOCIATION_TABLE].rows.itervalues():
-            if ovs_rec.address == server_ip_addr:
+            if ovs_rec.address == server_ip_addr and \
+                    ovs_rec._data[NTP_ASSOCIATION_VRF].to_json()[1] == \
+                    vrf_uuid:
                 tbl_found = True
                 break
         return ovs_rec, tbl_found
@@ -102,12 +127,18 @@ class NTPTransactionMgr(object):
     def update_row_in_ntp_association_table(self, entry):
         '''
         Update a row with NTP Association table with latest modified values.
+        The associations are given per VRF name.
         '''
-        for k, v in entry["associations_info"].iteritems():
-            server_ip_addr = k
-            row, row_found = self.find_row_by_ip_addr(server_ip_addr)
-            if row_found:
-                self.set_ntp_association_status(row, v)
+        for vrf_name, associations in entry["associations_info"].iteritems():
+            vrf_uuid = self.find_vrf_uuid_by_name(vrf_name)
+            if vrf_uuid is None:
+                continue
+            for k, v in associations.iteritems():
+                server_ip_addr = k
+                row, row_found = self.find_row_by_ip_addr(vrf_uuid,
+                                                          server_ip_addr)
+                if row_found:
+                    self.set_ntp_association_status(row, v)
         return
 
     def update_system_table(self, entry):
@@ -117,26 +148,128 @@ class NTPTransactionMgr(object):
         ovs_rec = None
         for ovs_rec in self.idl.tables[SYSTEM_TABLE].rows.itervalues():
             break
-        setattr(ovs_rec, 'ntp_status', entry["status"])
-        setattr(ovs_rec, 'ntp_statistics', entry["statistics"])
+        if "status" in entry:
+            # ntp_status is published both by the ntpq refresh and by the
+            # kernel clock readout, so merge instead of replacing it.
+            ntp_status = dict(ovs_rec.ntp_status)
+            ntp_status.update(entry["status"])
+            setattr(ovs_rec, 'ntp_status', ntp_status)
+        if "statistics" in entry:
+            setattr(ovs_rec, 'ntp_statistics', entry["statistics"])
         return ovs_rec
 
-    def update_info(self, ntp_info):
+    def build_txn(self, ntp_info):
+        start = time.time()
         self.txn = ovs.db.idl.Transaction(self.idl)
-        # Update NTP associations table
-        self.update_row_in_ntp_association_table(ntp_info)
-        # Update NTP status with SYSTEM table
-        self.update_system_table(ntp_info)
-        status = self.txn.commit_block()
-        if status != ovs.db.idl.Transaction.SUCCESS:
+        try:
+            # Update NTP associations table
+            if "associations_info" in ntp_info:
+                self.update_row_in_ntp_association_table(ntp_info)
+            # Update NTP status with SYSTEM table
+            self.update_system_table(ntp_info)
+        except:
+            # The IDL holds one transaction at a time
+            self.txn.abort()
+            self.txn = None
+            raise
+        self.commit_start = time.time()
+        if self.perf is not None:
+            self.perf.record(PERF_STATUS_UPDATE, self.commit_start - start)
+
+    def end_txn(self, status):
+        if self.perf is not None:
+            self.perf.record(PERF_STATUS_COMMIT,
+                             time.time() - self.commit_start)
+        self.txn = None
+        if status not in [ovs.db.idl.Transaction.SUCCESS,
+                          ovs.db.idl.Transaction.UNCHANGED]:
             vlog.err("ops_ntpd_sync_mgr update_row for ntp config in SYSTEM \
                     table failed")
 
+    def update_info(self, ntp_info):
+        '''
+        Commits 'ntp_info', blocking until the commit completes
+        '''
+        self.build_txn(ntp_info)
+        self.end_txn(self.txn.commit_block())
+
+    def queue_info(self, ntp_info):
+        '''
+        Commits 'ntp_info' without blocking. Until the transaction in
+        flight completes, the updates are merged: the latest association
+        status of each VRF and statistics, and all the status keys.
+        '''
+        if self.pending is None:
+            self.pending = {}
+        for vrf_name, associations in \
+                ntp_info.get("associations_info", {}).iteritems():
+            self.pending.setdefault("associations_info", {})[vrf_name] = \
+                associations
+        if "statistics" in ntp_info:
+            self.pending["statistics"] = ntp_info["statistics"]
+        if "status" in ntp_info:
+            self.pending.setdefault("status", {}).update(ntp_info["status"])
+        self.run()
+
+    def run(self):
+        '''
+        Completes the transaction in flight and starts the next one, to
+        be called after every run of the IDL
+        '''
+        if self.txn is not None:
+            status = self.txn.commit()
+            if status == ovs.db.idl.Transaction.INCOMPLETE:
+                return
+            self.end_txn(status)
+        if self.pending is None:
+            return
+        ntp_info = self.pending
+        self.pending = None
+        self.build_txn(ntp_info)
+        status = self.txn.commit()
+        if status != ovs.db.idl.Transaction.INCOMPLETE:
+            self.end_txn(status)
+
+    def flush(self, timeout):
+        '''
+        Commits the pending updates, waiting at most 'timeout' seconds
+        '''
+        deadline = time.time() + timeout
+        while (self.txn is not None or self.pending is not None) and \
+                time.time() < deadline:
+            self.idl.run()
+            self.run()
+            if self.txn is not None:
+                sleep(.01)
+        if self.txn is not None or self.pending is not None:
+            vlog.warn("ops_ntpd_sync_mgr status updates not committed")
+
     def close(self):
-        self.idl.close()
+        if self.own_idl:
+            self.idl.close()
+
+
+def ops_ntpd_sync_mgr_register_columns(schema_helper):
+    '''
+    Registers the columns written by the transaction manager, and the
+    ones it looks rows up with
+    '''
+    schema_helper.register_columns(SYSTEM_TABLE,
+                                   [SYSTEM_NTP_STATUS,
+                                    SYSTEM_NTP_STATISTICS,
+                                    SYSTEM_CUR_CFG])
+    schema_helper.register_columns(NTP_ASSOCIATION_TABLE,
+                                   [NTP_ASSOCIATION_ADDRESS,
+                                    NTP_ASSOCIATION_VRF,
+                                    NTP_ASSOCIATION_STATUS])
+    schema_helper.register_columns(VRF_TABLE, [VRF_NAME])
 
 
 def ops_ntpd_sync_mgr_run(transaction_queue):
+    '''
+    Commits the status updates of 'transaction_queue', JSON strings, on
+    its own IDL connection
+    '''
     ops_ntpd_sync_mgr = NTPTransactionMgr()
     while(True):
         str_obj = transaction_queue.get()
@@ -144,9 +277,10 @@ def ops_ntpd_sync_mgr_run(transaction_queue):
             break
         ntp_info = {}
         msg_info = json.loads(str_obj)
-        ntp_info["associations_info"] = msg_info['associations_info']
-        ntp_info["statistics"] = msg_info['statistics']
-        ntp_info["status"] = msg_info['status']
+        # A message carries any subset of these sections
+        for section in ["associations_info", "statistics", "status"]:
+            if section in msg_info:
+                ntp_info[section] = msg_info[section]
         ops_ntpd_sync_mgr.update_info(ntp_info)
     ops_ntpd_sync_mgr.close()
 
@@ -0,0 +1,129 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_TIMEX module
+ - Reads the kernel clock discipline state with adjtimex(2).
+ - The kernel clock is disciplined by ntpd, so its offset, frequency,
+   error estimates and sync status are available without querying
+   ntpd. A read-only adjtimex call (modes = 0) is a single syscall.
+'''
+
+import ctypes
+import ctypes.util
+
+
+class Timeval(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long),
+                ("tv_usec", ctypes.c_long)]
+
+
+class Timex(ctypes.Structure):
+    '''
+    struct timex from <sys/timex.h>
+    '''
+    _fields_ = [("modes", ctypes.c_uint),
+                ("offset", ctypes.c_long),
+                ("freq", ctypes.c_long),
+                ("maxerror", ctypes.c_long),
+                ("esterror", ctypes.c_long),
+                ("status", ctypes.c_int),
+                ("constant", ctypes.c_long),
+                ("precision", ctypes.c_long),
+                ("tolerance", ctypes.c_long),
+                ("time", Timeval),
+                ("tick", ctypes.c_long),
+                ("ppsfreq", ctypes.c_long),
+                ("jitter", ctypes.c_long),
+                ("shift", ctypes.c_int),
+                ("stabil", ctypes.c_long),
+                ("jitcnt", ctypes.c_long),
+                ("calcnt", ctypes.c_long),
+                ("errcnt", ctypes.c_long),
+                ("stbcnt", ctypes.c_long),
+                ("tai", ctypes.c_int),
+                ("reserved", ctypes.c_int * 11)]
+
+# Status bits
+STA_UNSYNC = 0x0040
+STA_NANO = 0x2000
+
+# Frequency is in ppm with a 16 bit fractional part
+TIMEX_FREQ_SCALE = 65536.0
+
+# adjtimex() return values
+translate_clock_state = {
+    0: "ok",
+    1: "insert_leap",
+    2: "delete_leap",
+    3: "leap_in_progress",
+    4: "leap_occurred",
+    5: "error"
+}
+
+# System:ntp_status keys
+NTP_KERNEL_OFFSET = "kernel_offset"
+NTP_KERNEL_FREQUENCY = "kernel_frequency"
+NTP_KERNEL_MAXERROR = "kernel_maxerror"
+NTP_KERNEL_ESTERROR = "kernel_esterror"
+NTP_KERNEL_SYNC_STATUS = "kernel_sync_status"
+NTP_KERNEL_CLOCK_STATE = "kernel_clock_state"
+
+libc = ctypes.CDLL(ctypes.util.find_library("c"), use_errno=True)
+libc.adjtimex.argtypes = [ctypes.POINTER(Timex)]
+libc.adjtimex.restype = ctypes.c_int
+
+
+def ops_ntpd_timex_read():
+    '''
+    Returns the kernel clock state as System:ntp_status key/values.
+    Offset and errors are in microseconds, frequency is in ppm.
+    '''
+    tx = Timex()
+    tx.modes = 0
+    state = libc.adjtimex(ctypes.byref(tx))
+    if state < 0:
+        raise OSError(ctypes.get_errno(), "adjtimex failed")
+
+    offset = float(tx.offset)
+    if tx.status & STA_NANO:
+        offset /= 1000.0
+
+    kernel_status = {}
+    kernel_status[NTP_KERNEL_OFFSET] = "%.3f" % offset
+    kernel_status[NTP_KERNEL_FREQUENCY] = "%.3f" % (tx.freq /
+                                                    TIMEX_FREQ_SCALE)
+    kernel_status[NTP_KERNEL_MAXERROR] = str(tx.maxerror)
+    kernel_status[NTP_KERNEL_ESTERROR] = str(tx.esterror)
+    if tx.status & STA_UNSYNC:
+        kernel_status[NTP_KERNEL_SYNC_STATUS] = "unsynchronized"
+    else:
+        kernel_status[NTP_KERNEL_SYNC_STATUS] = "synchronized"
+    kernel_status[NTP_KERNEL_CLOCK_STATE] = \
+        translate_clock_state.get(state, "unknown")
+    return kernel_status
+
+
+def ops_ntpd_timex_tai_offset():
+    '''
+    Returns the TAI-UTC offset (seconds) known to the kernel, 0 if unset
+    '''
+    tx = Timex()
+    tx.modes = 0
+    if libc.adjtimex(ctypes.byref(tx)) < 0:
+        raise OSError(ctypes.get_errno(), "adjtimex failed")
+    return tx.tai
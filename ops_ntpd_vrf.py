@@ -0,0 +1,106 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License..
+
+'''
+NOTES:
+ OPS_NTPD_VRF module
+ - One NTPD instance runs for the default VRF, in the namespace of
+   ops-ntpd, and one for every other VRF which has associations, in
+   the network namespace named after the VRF.
+ - The NTPD, ntpq and ntpdc commands of an instance are run through
+   'ip netns exec', so every instance is controlled through its own
+   socket on the loopback of its namespace.
+ - Only one instance disciplines the system clock: the default VRF
+   instance when it has associations, otherwise the first VRF with
+   associations in name order. The others run with 'disable ntp' and
+   only report the state of their servers.
+'''
+
+import os
+import pipes
+
+DEFAULT_VRF_NAME = "vrf_default"
+
+# Working directories of the non default VRF instances
+NTP_VRF_DIR = "/etc/ntp/vrf/"
+
+
+class NTPDInstance(object):
+
+    def __init__(self, vrf_name):
+        '''
+        An NTPD instance serving the associations of 'vrf_name'.
+        '''
+        self.vrf_name = vrf_name
+        self.netns = ops_ntpd_vrf_netns(vrf_name)
+        self.conf_file = None
+        self.keys_file = None
+        self.log_file = None
+        self.pid_file = None
+        # Persistent frequency correction, written by the daemon
+        self.drift_file = None
+        # Digests of the conf/keys content NTPD was last loaded with
+        self.conf_digest = None
+        self.keys_digest = None
+        self.discipline = True
+        # NTPDSupervisor of the running NTPD
+        self.supervisor = None
+        # Interface NTPD listens on, all when None
+        self.interface = None
+
+    def command(self, command):
+        '''
+        Returns the shell 'command' wrapped to run in the namespace of the
+        instance
+        '''
+        if self.netns is None:
+            return command
+        return "ip netns exec %s %s" % (pipes.quote(self.netns), command)
+
+    def working_dir(self):
+        return os.path.dirname(self.conf_file) + "/"
+
+    def argv(self, argv):
+        '''
+        Same as command(), for an argument list
+        '''
+        if self.netns is None:
+            return argv
+        return ["ip", "netns", "exec", self.netns] + argv
+
+
+def ops_ntpd_vrf_netns(vrf_name):
+    '''
+    Returns the network namespace of a VRF, None for the namespace of
+    ops-ntpd itself
+    '''
+    if vrf_name == DEFAULT_VRF_NAME:
+        return None
+    return vrf_name
+
+
+def ops_ntpd_vrf_working_dir(vrf_name):
+    return NTP_VRF_DIR + vrf_name + "/"
+
+
+def ops_ntpd_vrf_select_discipline(vrf_names):
+    '''
+    Returns the VRF whose instance disciplines the system clock, given
+    the VRFs which have associations
+    '''
+    if DEFAULT_VRF_NAME in vrf_names or len(vrf_names) == 0:
+        return DEFAULT_VRF_NAME
+    return sorted(vrf_names)[0]
@@ -32,3 +32,12 @@ class NtpAssociationValidator(BaseValidator):
             if (not ipaddress.is_valid_ip_address(ip_address)):
                 details = "Invalid IP address %s." % (ip_address)
                 raise ValidationError(error.VERIFICATION_FAILED, details)
+        if hasattr(ntp_association_row, "association_attributes") and \
+                hasattr(ntp_association_row, "key_id"):
+            attributes = get_column_data_from_row(ntp_association_row,
+                                                  "association_attributes")
+            key_id = get_column_data_from_row(ntp_association_row, "key_id")
+            # NTS authenticates the association in place of a key
+            if attributes and attributes.get("nts") == "true" and key_id:
+                details = "NTS and a key can not be used together."
+                raise ValidationError(error.VERIFICATION_FAILED, details)
@@ -18,7 +18,14 @@ from setuptools import setup
 setup(
     name='ops_ntpd',
     version='1.0',
-    py_modules=['ops_ntpd', 'ops_ntpd_sync_to_ovsdb'],
+    py_modules=['ops_ntpd', 'ops_ntpd_sync_to_ovsdb', 'ops_ntpd_stats',
+                'ops_ntpd_rtc', 'ops_ntpd_timex', 'ops_ntpd_conf',
+                'ops_ntpd_vrf', 'ops_ntpd_dns',
+                'ops_ntpd_supervisor', 'ops_ntpd_shm',
+                'ops_ntpd_backend', 'ops_ntpd_state',
+                'ops_ntpd_clients', 'ops_ntpd_keys',
+                'ops_ntpd_nts', 'ops_ntpd_perf',
+                'ops_ntpd_log'],
     entry_points={
         'console_scripts': ['ops_ntpd = ops_ntpd:ops_ntpd_init',
                             'ops_ntpd_sync_to_ovsdb = \
@@ -26,6 +26,7 @@
 #include <sys/wait.h>
 #include <arpa/inet.h>
 #include <ctype.h>
+#include <time.h>
 #include "vtysh/command.h"
 #include "memory.h"
 #include "vtysh/vtysh.h"
@@ -55,8 +56,15 @@ char g_NTP_version_default[] = NTP_ASSOC_ATTRIB_VERSION_DEFAULT;
 static const struct ovsrec_vrf *
 get_ovsrec_vrf_with_name(char *name)
 {
-    /* TODO change this later when multiple VRFs are supported */
-    return ovsrec_vrf_first(idl);
+    const struct ovsrec_vrf *vrf_row = NULL;
+
+    OVSREC_VRF_FOR_EACH(vrf_row, idl) {
+        if (0 == strcmp(vrf_row->name, name)) {
+            return vrf_row;
+        }
+    }
+
+    return NULL;
 }
 
 /*================================================================================================*/
@@ -96,6 +104,226 @@ vtysh_ovsdb_ntp_auth_enable_set(ntp_cli_ntp_auth_enable_params_t *pntp_auth_enab
     END_DB_TXN(ntp_auth_enable_txn);
 }
 
+/*================================================================================================*/
+/* NTP server mode, System Table ntp_config keys */
+
+const int
+vtysh_ovsdb_ntp_serve_set(bool no_form)
+{
+    const struct ovsrec_system *ovs_system = NULL;
+    struct ovsdb_idl_txn *ntp_serve_txn = NULL;
+
+    /* Start of transaction */
+    START_DB_TXN(ntp_serve_txn);
+
+    /* Get access to the System Table */
+    ovs_system = ovsrec_system_first(idl);
+    if (NULL == ovs_system) {
+         vty_out(vty, "Could not access the System Table\n");
+         ERRONEOUS_DB_TXN(ntp_serve_txn, "Could not access the System Table");
+    }
+
+    smap_replace((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ENABLE,
+                 (no_form) ? NTP_FALSE_STR : NTP_TRUE_STR);
+    ovsrec_system_set_ntp_config(ovs_system, &ovs_system->ntp_config);
+
+    /* End of transaction. */
+    END_DB_TXN(ntp_serve_txn);
+}
+
+/* Normalizes a client network "<address>/<prefix>" to its network
+ * address, host bits cleared. Returns false if it is not a valid network.
+ */
+static bool
+ntp_serve_parse_network(const char *arg, char *network, size_t size)
+{
+    char address[INET6_ADDRSTRLEN];
+    unsigned char packed[sizeof(struct in6_addr)];
+    const char *slash = strchr(arg, '/');
+    char *end = NULL;
+    long prefix = 0;
+    int family = AF_INET;
+    int bits = 32;
+    int i = 0;
+
+    if ((NULL == slash) || ((size_t)(slash - arg) >= sizeof(address)) || ('\0' == slash[1])) {
+        return false;
+    }
+    memcpy(address, arg, slash - arg);
+    address[slash - arg] = '\0';
+    prefix = strtol(slash + 1, &end, 10);
+    if ('\0' != *end) {
+        return false;
+    }
+
+    if (strchr(address, ':')) {
+        family = AF_INET6;
+        bits = 128;
+    }
+    if ((inet_pton(family, address, packed) <= 0) || (prefix < 0) || (prefix > bits)) {
+        return false;
+    }
+
+    for (i = 0; i < bits / 8; i++) {
+        if (prefix <= i * 8) {
+            packed[i] = 0;
+        } else if (prefix < (i + 1) * 8) {
+            packed[i] &= 0xff << ((i + 1) * 8 - prefix);
+        }
+    }
+    if (NULL == inet_ntop(family, packed, address, sizeof(address))) {
+        return false;
+    }
+    snprintf(network, size, "%s/%ld", address, prefix);
+    return true;
+}
+
+/* "ntp serve allow" adds a client network to the comma separated list,
+ * the no form removes it.
+ */
+const int
+vtysh_ovsdb_ntp_serve_allow_set(const char *arg, bool no_form)
+{
+    const struct ovsrec_system *ovs_system = NULL;
+    struct ovsdb_idl_txn *ntp_serve_txn = NULL;
+    char network[INET6_ADDRSTRLEN + 8];
+    char allow[NTP_SERVER_ALLOW_MAX * (INET6_ADDRSTRLEN + 8)] = "";
+    char current[sizeof(allow)] = "";
+    char *entry = NULL;
+    char *saveptr = NULL;
+    const char *buf = NULL;
+    bool found = false;
+    int count = 0;
+
+    if (!ntp_serve_parse_network(arg, network, sizeof(network))) {
+        vty_out(vty, "Invalid client network %s%s", arg, VTY_NEWLINE);
+        return CMD_ERR_NOTHING_TODO;
+    }
+
+    /* Start of transaction */
+    START_DB_TXN(ntp_serve_txn);
+
+    /* Get access to the System Table */
+    ovs_system = ovsrec_system_first(idl);
+    if (NULL == ovs_system) {
+         vty_out(vty, "Could not access the System Table\n");
+         ERRONEOUS_DB_TXN(ntp_serve_txn, "Could not access the System Table");
+    }
+
+    buf = smap_get(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ALLOW);
+    if (buf) {
+        strncpy(current, buf, sizeof(current) - 1);
+    }
+    for (entry = strtok_r(current, ",", &saveptr); entry; entry = strtok_r(NULL, ",", &saveptr)) {
+        if (0 == strcmp(entry, network)) {
+            found = true;
+            if (no_form) {
+                continue;
+            }
+        }
+        if (count++) {
+            strncat(allow, ",", sizeof(allow) - strlen(allow) - 1);
+        }
+        strncat(allow, entry, sizeof(allow) - strlen(allow) - 1);
+    }
+
+    if (no_form && !found) {
+        cli_do_config_abort(ntp_serve_txn);
+        vty_out(vty, "Client network %s is not configured%s", network, VTY_NEWLINE);
+        return CMD_ERR_NOTHING_TODO;
+    }
+    if (!no_form && !found) {
+        if (count >= NTP_SERVER_ALLOW_MAX) {
+            cli_do_config_abort(ntp_serve_txn);
+            vty_out(vty, "Maximum number of client networks (%d) reached%s",
+                    NTP_SERVER_ALLOW_MAX, VTY_NEWLINE);
+            return CMD_ERR_NOTHING_TODO;
+        }
+        if (count) {
+            strncat(allow, ",", sizeof(allow) - strlen(allow) - 1);
+        }
+        strncat(allow, network, sizeof(allow) - strlen(allow) - 1);
+    }
+
+    if ('\0' == allow[0]) {
+        smap_remove((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ALLOW);
+    } else {
+        smap_replace((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ALLOW, allow);
+    }
+    ovsrec_system_set_ntp_config(ovs_system, &ovs_system->ntp_config);
+
+    /* End of transaction. */
+    END_DB_TXN(ntp_serve_txn);
+}
+
+/* "ntp serve rate-limit" sets the intervals, the no form restores the
+ * defaults of ops-ntpd.
+ */
+const int
+vtysh_ovsdb_ntp_serve_rate_limit_set(const char *average, const char *minimum, bool no_form)
+{
+    const struct ovsrec_system *ovs_system = NULL;
+    struct ovsdb_idl_txn *ntp_serve_txn = NULL;
+
+    /* Start of transaction */
+    START_DB_TXN(ntp_serve_txn);
+
+    /* Get access to the System Table */
+    ovs_system = ovsrec_system_first(idl);
+    if (NULL == ovs_system) {
+         vty_out(vty, "Could not access the System Table\n");
+         ERRONEOUS_DB_TXN(ntp_serve_txn, "Could not access the System Table");
+    }
+
+    if (no_form) {
+        smap_remove((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE);
+        smap_remove((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM);
+    } else {
+        smap_replace((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE, average);
+        smap_replace((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM, minimum);
+    }
+    ovsrec_system_set_ntp_config(ovs_system, &ovs_system->ntp_config);
+
+    /* End of transaction. */
+    END_DB_TXN(ntp_serve_txn);
+}
+
+/* "ntp nts trusted-certificates" sets the CA certificates of the NTS-KE
+ * servers, the no form trusts the system CAs again.
+ */
+const int
+vtysh_ovsdb_ntp_nts_trusted_certs_set(const char *path, bool no_form)
+{
+    const struct ovsrec_system *ovs_system = NULL;
+    struct ovsdb_idl_txn *ntp_nts_txn = NULL;
+
+    if (!no_form && (('/' != path[0]) || (strlen(path) > NTP_NTS_CERTS_PATH_MAX))) {
+        vty_out(vty, "Certificates path should be an absolute path of at most %d characters%s",
+                NTP_NTS_CERTS_PATH_MAX, VTY_NEWLINE);
+        return CMD_ERR_NOTHING_TODO;
+    }
+
+    /* Start of transaction */
+    START_DB_TXN(ntp_nts_txn);
+
+    /* Get access to the System Table */
+    ovs_system = ovsrec_system_first(idl);
+    if (NULL == ovs_system) {
+         vty_out(vty, "Could not access the System Table\n");
+         ERRONEOUS_DB_TXN(ntp_nts_txn, "Could not access the System Table");
+    }
+
+    if (no_form) {
+        smap_remove((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS);
+    } else {
+        smap_replace((struct smap *)&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS, path);
+    }
+    ovsrec_system_set_ntp_config(ovs_system, &ovs_system->ntp_config);
+
+    /* End of transaction. */
+    END_DB_TXN(ntp_nts_txn);
+}
+
 /*================================================================================================*/
 /* NTP internal server name validation functions */
 static const bool
@@ -187,17 +415,42 @@ ntp_auth_key_replace_parameters(const struct ovsrec_ntp_key *ntp_auth_key_row, n
             ovsrec_ntp_key_set_key_id(ntp_auth_key_row, atoi(pntp_auth_key_params->key));
         }
 
-        ovsrec_ntp_key_set_key_password(ntp_auth_key_row, pntp_auth_key_params->md5_pwd);
+        if (0 == strcmp(pntp_auth_key_params->algorithm, NTP_KEY_ALGORITHM_MD5)) {
+            ovsrec_ntp_key_set_key_password(ntp_auth_key_row, pntp_auth_key_params->password);
+        } else {
+            char password[sizeof(NTP_KEY_ALGORITHM_AES128CMAC) + NTP_KEY_HEX_LEN_MAX + 1];
+            char *c = NULL;
+
+            snprintf(password, sizeof(password), NTP_KEY_PASSWORD_FMT,
+                     pntp_auth_key_params->algorithm, pntp_auth_key_params->password);
+            /* Hex keys are stored lower case, as shown in the running-config */
+            for (c = password; *c; c++) {
+                *c = tolower((unsigned char)*c);
+            }
+            ovsrec_ntp_key_set_key_password(ntp_auth_key_row, password);
+        }
     }
 
     return CMD_SUCCESS;
 }
 
+/* Hex key length of the key algorithms, 0 for the MD5 password */
+static const struct {
+    const char *algorithm;
+    size_t hex_len;
+} ntp_key_algorithms[] = {
+    { NTP_KEY_ALGORITHM_MD5,        0 },
+    { NTP_KEY_ALGORITHM_SHA1,       40 },
+    { NTP_KEY_ALGORITHM_SHA256,     64 },
+    { NTP_KEY_ALGORITHM_AES128CMAC, 32 },
+};
+
 /* Following function tests whether the value of keyid lies in the range [1-65534]
  * Also if requested it returns pointer to the row in the "NTP_Key" table
+ * The password is checked against its algorithm, MD5 when NULL.
  */
 const int
-ntp_sanitize_auth_key(const char *pkey, const struct ovsrec_ntp_key **pntp_auth_key_row, char *password)
+ntp_sanitize_auth_key(const char *pkey, const struct ovsrec_ntp_key **pntp_auth_key_row, const char *algorithm, char *password)
 {
     /* Check key range */
     if (pkey) {
@@ -221,9 +474,36 @@ ntp_sanitize_auth_key(const char *pkey, const struct ovsrec_ntp_key **pntp_auth_
 
     if (password) {
         int pwdlen = strlen(password);
+        const char *secret = NULL;
+        size_t hex_len = 0;
+        int i;
+
+        if (NULL == algorithm) {
+            algorithm = NTP_KEY_ALGORITHM_MD5;
+        }
+        for (i = 0; i < sizeof(ntp_key_algorithms) / sizeof(ntp_key_algorithms[0]); i++) {
+            if (0 == strcmp(algorithm, ntp_key_algorithms[i].algorithm)) {
+                break;
+            }
+        }
+        if (i == sizeof(ntp_key_algorithms) / sizeof(ntp_key_algorithms[0])) {
+            vty_out(vty, "Unknown key algorithm %s\n", algorithm);
+            return CMD_ERR_NOTHING_TODO;
+        }
+        hex_len = ntp_key_algorithms[i].hex_len;
 
-        if ((pwdlen < NTP_KEY_KEY_PASSWORD_LEN_MIN) || (pwdlen > NTP_KEY_KEY_PASSWORD_LEN_MAX)) {
-            vty_out(vty, "Password length should be between %d & %d chars\n", NTP_KEY_KEY_PASSWORD_LEN_MIN, NTP_KEY_KEY_PASSWORD_LEN_MAX);
+        if (0 == hex_len) {
+            if ((pwdlen < NTP_KEY_KEY_PASSWORD_LEN_MIN) || (pwdlen > NTP_KEY_KEY_PASSWORD_LEN_MAX)) {
+                vty_out(vty, "Password length should be between %d & %d chars\n", NTP_KEY_KEY_PASSWORD_LEN_MIN, NTP_KEY_KEY_PASSWORD_LEN_MAX);
+                return CMD_ERR_NOTHING_TODO;
+            }
+            /* It would be read back as a key of another algorithm */
+            if (0 != strcmp(ntp_key_parse_password(password, &secret), NTP_KEY_ALGORITHM_MD5)) {
+                vty_out(vty, "MD5 password should not start with \"%.*s\"\n", (int)(secret - password), password);
+                return CMD_ERR_NOTHING_TODO;
+            }
+        } else if ((pwdlen != hex_len) || (strspn(password, "0123456789abcdefABCDEF") != hex_len)) {
+            vty_out(vty, "%s key should be %d hexadecimal digits\n", algorithm, (int)hex_len);
             return CMD_ERR_NOTHING_TODO;
         }
     }
@@ -240,7 +520,7 @@ vtysh_ovsdb_ntp_auth_key_set(ntp_cli_ntp_auth_key_params_t *pntp_auth_key_params
     int retval = CMD_SUCCESS;
 
     /* Sanitize the key & get the row in the NTP_Key Table */
-    retval = ntp_sanitize_auth_key(pntp_auth_key_params->key, NULL, pntp_auth_key_params->md5_pwd);
+    retval = ntp_sanitize_auth_key(pntp_auth_key_params->key, NULL, pntp_auth_key_params->algorithm, pntp_auth_key_params->password);
     if (CMD_SUCCESS != retval) {
         return retval;
     }
@@ -291,7 +571,7 @@ vtysh_ovsdb_ntp_trusted_key_set(ntp_cli_ntp_trusted_key_params_t *pntp_trusted_k
     int retval = CMD_SUCCESS;
 
     /* Sanitize the key & get the row in the NTP_Key Table */
-    retval = ntp_sanitize_auth_key(pntp_trusted_key_params->key, &ntp_auth_key_row, NULL);
+    retval = ntp_sanitize_auth_key(pntp_trusted_key_params->key, &ntp_auth_key_row, NULL, NULL);
     if (CMD_SUCCESS != retval) {
         return retval;
     }
@@ -374,8 +654,7 @@ ntp_server_replace_parameters(const struct ovsrec_ntp_association *ntp_assoc_row
             /* Set the server name */
             ovsrec_ntp_association_set_address(ntp_assoc_row, ntp_server_params->server_name);
 
-            /* Set the VRF name */
-            /* TODO: set the "n_vrf" parameter for the following function call correctly when multiple VRFs are supported */
+            /* Set the VRF, checked to exist by ntp_server_sanitize_parameters() */
             const struct ovsrec_vrf *vrf_row = get_ovsrec_vrf_with_name(ntp_server_params->vrf_name);
             ovsrec_ntp_association_set_vrf(ntp_assoc_row, vrf_row);
 
@@ -418,8 +697,27 @@ ntp_server_replace_parameters(const struct ovsrec_ntp_association *ntp_assoc_row
             smap_replace(&smap_assoc_attribs, NTP_ASSOC_ATTRIB_VERSION, ntp_server_params->version);
         }
 
+        /* A key and NTS are exclusive, either one replaces the other */
         if (ntp_server_params->keyid) {
             ovsrec_ntp_association_set_key_id(ntp_assoc_row, (struct ovsrec_ntp_key *)ntp_server_params->key_row);
+            smap_remove(&smap_assoc_attribs, NTP_ASSOC_ATTRIB_NTS);
+        }
+
+        if (ntp_server_params->nts) {
+            ovsrec_ntp_association_set_key_id(ntp_assoc_row, NULL);
+            smap_replace(&smap_assoc_attribs, NTP_ASSOC_ATTRIB_NTS, NTP_TRUE_STR);
+        }
+
+        if (ntp_server_params->refid) {
+            smap_replace(&smap_assoc_attribs, NTP_ASSOC_ATTRIB_REF_CLOCK_ID, ntp_server_params->refid);
+        }
+
+        /* The refid is only given for reference clocks, one reconfigured
+         * without a feed is no longer fed by ops-ntpd */
+        if (ntp_server_params->feed) {
+            smap_replace(&smap_assoc_attribs, NTP_REFCLOCK_ATTRIB_FEED, ntp_server_params->feed);
+        } else if (ntp_server_params->refid) {
+            smap_remove(&smap_assoc_attribs, NTP_REFCLOCK_ATTRIB_FEED);
         }
 
         ovsrec_ntp_association_set_association_attributes(ntp_assoc_row, &smap_assoc_attribs);
@@ -446,9 +744,15 @@ ntp_server_sanitize_parameters(ntp_cli_ntp_server_params_t *pntp_server_params)
         return CMD_ERR_NOTHING_TODO;
     }
 
+    /* Check that the VRF exists */
+    if (NULL == get_ovsrec_vrf_with_name(pntp_server_params->vrf_name)) {
+        vty_out(vty, "VRF %s does not exist%s", pntp_server_params->vrf_name, VTY_NEWLINE);
+        return CMD_ERR_NOTHING_TODO;
+    }
+
     /* Check sanity for the key */
     if (pntp_server_params->keyid) {
-        retval = ntp_sanitize_auth_key(pntp_server_params->keyid, (const struct ovsrec_ntp_key **)(&(pntp_server_params->key_row)), NULL);
+        retval = ntp_sanitize_auth_key(pntp_server_params->keyid, (const struct ovsrec_ntp_key **)(&(pntp_server_params->key_row)), NULL, NULL);
         if (CMD_SUCCESS != retval) {
             return retval;
         }
@@ -456,54 +760,52 @@ ntp_server_sanitize_parameters(ntp_cli_ntp_server_params_t *pntp_server_params)
 
     /* Check sanity for the version */
     if (pntp_server_params->version) {
-        int ntp_ver = atoi(pntp_server_params->version);
-
-        if ((ntp_ver < atoi(NTP_ASSOC_ATTRIB_VERSION_3)) || (ntp_ver > atoi(NTP_ASSOC_ATTRIB_VERSION_4))) {
+        /* Compare the whole string, atoi() would accept trailing characters */
+        if ((0 != strcmp(pntp_server_params->version, NTP_ASSOC_ATTRIB_VERSION_3)) &&
+            (0 != strcmp(pntp_server_params->version, NTP_ASSOC_ATTRIB_VERSION_4))) {
             vty_out(vty, "NTP version should lie between [%s-%s]\n", NTP_ASSOC_ATTRIB_VERSION_3, NTP_ASSOC_ATTRIB_VERSION_4);
             return CMD_ERR_NOTHING_TODO;
         }
     }
 
-    return CMD_SUCCESS;
-}
-
-const int
-ntp_server_check_max_number_of_servers(ntp_cli_ntp_server_params_t *pntp_server_params)
-{
-    /* Check for more than 8 NTP servers */
-    if (!pntp_server_params->no_form) {
-        int counter = 0;
-        const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
-        OVSREC_NTP_ASSOCIATION_FOR_EACH(ntp_assoc_row, idl) {
-            counter++;
+    /* NTS authenticates NTPv4 packets, instead of a key */
+    if (pntp_server_params->nts) {
+        if (pntp_server_params->keyid) {
+            vty_out(vty, "NTS and key-id can not be used together%s", VTY_NEWLINE);
+            return CMD_ERR_NOTHING_TODO;
         }
-
-        if (counter >= NTP_ASSOC_MAX_SERVERS) {
-            vty_out (vty, "Maximum number of configurable"
-                          " NTP server limit has been reached%s",
-                     VTY_NEWLINE);
+        if (pntp_server_params->version &&
+            (0 != strcmp(pntp_server_params->version, NTP_ASSOC_ATTRIB_VERSION_4))) {
+            vty_out(vty, "NTS needs NTP version %s%s", NTP_ASSOC_ATTRIB_VERSION_4, VTY_NEWLINE);
             return CMD_ERR_NOTHING_TODO;
         }
+        pntp_server_params->version = NTP_ASSOC_ATTRIB_VERSION_4;
     }
 
     return CMD_SUCCESS;
 }
 
-const int
-vtysh_ovsdb_ntp_server_set(ntp_cli_ntp_server_params_t *ntp_server_params)
+/* Number of rows in the NTP Association table. Walked once per transaction. */
+static int
+ntp_server_get_count()
 {
+    int counter = 0;
     const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
-    struct ovsdb_idl_txn *ntp_association_txn = NULL;
-    bool ntp_server_exists = 0;
-    int retval = CMD_SUCCESS;
 
-    retval = ntp_server_sanitize_parameters(ntp_server_params);
-    if (CMD_SUCCESS != retval) {
-        return retval;
+    OVSREC_NTP_ASSOCIATION_FOR_EACH(ntp_assoc_row, idl) {
+        counter++;
     }
 
-    /* Start of transaction */
-    START_DB_TXN(ntp_association_txn);
+    return counter;
+}
+
+/* Apply one "ntp server" configuration within an already started transaction.
+ * pserver_count holds the number of servers and is updated on insert/delete.
+ */
+static int
+ntp_server_apply(struct ovsdb_idl_txn *ntp_association_txn, ntp_cli_ntp_server_params_t *ntp_server_params, int *pserver_count)
+{
+    const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
 
     /* See if it already exists. */
     ntp_assoc_row = ntp_ovsrec_get_assoc(ntp_server_params->vrf_name, ntp_server_params->server_name);
@@ -512,36 +814,233 @@ vtysh_ovsdb_ntp_server_set(ntp_cli_ntp_server_params_t *ntp_server_params)
             /* Nothing to delete */
             vty_out(vty, "This server does not exist\n");
         } else {
-
-            retval = ntp_server_check_max_number_of_servers(ntp_server_params);
-            if (CMD_SUCCESS != retval) {
-                /* End of transaction. */
-                END_DB_TXN(ntp_association_txn);
-                return retval;
+            /* Check for more than 8 NTP servers */
+            if (*pserver_count >= NTP_ASSOC_MAX_SERVERS) {
+                vty_out (vty, "Maximum number of configurable"
+                              " NTP server limit has been reached%s",
+                         VTY_NEWLINE);
+                return CMD_ERR_NOTHING_TODO;
             }
             VLOG_DBG("Inserting a row into the NTP Assoc table\n");
 
             ntp_assoc_row = ovsrec_ntp_association_insert(ntp_association_txn);
             if (NULL == ntp_assoc_row) {
                 VLOG_ERR("Could not insert a row into the NTP Assoc Table\n");
-                ERRONEOUS_DB_TXN(ntp_association_txn, "Could not insert a row into the NTP Assoc Table");
-            } else {
-                VLOG_DBG("Inserted a row into the NTP Assoc Table successfully\n");
-                ntp_server_replace_parameters(ntp_assoc_row, ntp_server_params, ntp_server_exists);
+                vty_out(vty, "Could not insert a row into the NTP Assoc Table\n");
+                return CMD_OVSDB_FAILURE;
             }
+
+            VLOG_DBG("Inserted a row into the NTP Assoc Table successfully\n");
+            ntp_server_replace_parameters(ntp_assoc_row, ntp_server_params, false);
+            (*pserver_count)++;
         }
     } else {
-        ntp_server_exists = 1;
-
         if (ntp_server_params->no_form) {
             VLOG_DBG("Deleting a row from the NTP Assoc table\n");
             ovsrec_ntp_association_delete(ntp_assoc_row);
+            (*pserver_count)--;
         } else {
             VLOG_DBG("This server already exists. Replacing parameters\n");
-            ntp_server_replace_parameters(ntp_assoc_row, ntp_server_params, ntp_server_exists);
+            ntp_server_replace_parameters(ntp_assoc_row, ntp_server_params, true);
+        }
+    }
+
+    return CMD_SUCCESS;
+}
+
+const int
+vtysh_ovsdb_ntp_server_set(ntp_cli_ntp_server_params_t *ntp_server_params)
+{
+    struct ovsdb_idl_txn *ntp_association_txn = NULL;
+    int server_count = 0;
+    int retval = CMD_SUCCESS;
+
+    retval = ntp_server_sanitize_parameters(ntp_server_params);
+    if (CMD_SUCCESS != retval) {
+        return retval;
+    }
+
+    /* Start of transaction */
+    START_DB_TXN(ntp_association_txn);
+
+    server_count = ntp_server_get_count();
+    retval = ntp_server_apply(ntp_association_txn, ntp_server_params, &server_count);
+    if (CMD_SUCCESS != retval) {
+        cli_do_config_abort(ntp_association_txn);
+        return retval;
+    }
+
+    /* End of transaction. */
+    END_DB_TXN(ntp_association_txn);
+}
+
+/* "ntp refclock" configures a reference clock as an association on the
+ * ntpd pseudo address of its driver, in the default VRF.
+ */
+const int
+vtysh_ovsdb_ntp_refclock_set(const char *type, const char *unit, ntp_cli_ntp_server_params_t *ntp_server_params)
+{
+    struct ovsdb_idl_txn *ntp_association_txn = NULL;
+    char address[INET_ADDRSTRLEN];
+    int server_count = 0;
+    int retval = CMD_SUCCESS;
+    const char *c = NULL;
+
+    snprintf(address, sizeof(address), NTP_REFCLOCK_ADDRESS_FMT,
+             (0 == strcmp(type, NTP_REFCLOCK_PPS_KW)) ? NTP_REFCLOCK_DRIVER_PPS : NTP_REFCLOCK_DRIVER_SHM,
+             atoi(unit));
+    ntp_server_params->server_name = address;
+
+    if (ntp_server_params->refid) {
+        for (c = ntp_server_params->refid; *c; c++) {
+            if (!isalnum((unsigned char)*c)) {
+                break;
+            }
+        }
+        if (*c || (strlen(ntp_server_params->refid) > NTP_REFCLOCK_REFID_MAX_LEN)) {
+            vty_out(vty, "Reference clock identifier should be 1 to %d letters or digits%s",
+                    NTP_REFCLOCK_REFID_MAX_LEN, VTY_NEWLINE);
+            return CMD_ERR_NOTHING_TODO;
+        }
+    } else if (!ntp_server_params->no_form) {
+        ntp_server_params->refid = (0 == strcmp(type, NTP_REFCLOCK_PPS_KW)) ?
+                                   NTP_REFCLOCK_PPS_REFID : NTP_REFCLOCK_SHM_REFID;
+    }
+
+    /* Start of transaction */
+    START_DB_TXN(ntp_association_txn);
+
+    server_count = ntp_server_get_count();
+    retval = ntp_server_apply(ntp_association_txn, ntp_server_params, &server_count);
+    if (CMD_SUCCESS != retval) {
+        cli_do_config_abort(ntp_association_txn);
+        return retval;
+    }
+
+    /* End of transaction. */
+    END_DB_TXN(ntp_association_txn);
+}
+
+/* "ntp refclock shm ... feed" has ops-ntpd write the samples of a local
+ * time source into the shared memory segment of the reference clock.
+ */
+static bool
+ntp_refclock_feed_format(const char *source, const char *path, char *feed, size_t size)
+{
+    if (('/' != path[0]) || (strlen(path) > NTP_REFCLOCK_FEED_PATH_MAX)) {
+        vty_out(vty, "Feed path should be an absolute path of at most %d characters%s",
+                NTP_REFCLOCK_FEED_PATH_MAX, VTY_NEWLINE);
+        return false;
+    }
+    snprintf(feed, size, NTP_REFCLOCK_FEED_FMT, source, path);
+    return true;
+}
+
+/* Parse the server list of "ntp servers".
+ * Each entry is a server name optionally followed by
+ * "prefer", "version <3-4>", "key-id <1-65534>" and "nts".
+ * Returns the number of entries or -1 if the list is malformed.
+ */
+static int
+ntp_servers_parse(int argc, const char *argv[], bool no_form, ntp_cli_ntp_server_params_t *pntp_servers_params)
+{
+    ntp_cli_ntp_server_params_t *cur = NULL;
+    int count = 0;
+    int i = 0;
+
+    for (i = 0; i < argc; i++) {
+        if (0 == strcmp(argv[i], NTP_SERVERS_PREFER_KW)) {
+            if (!cur || no_form) {
+                return -1;
+            }
+            cur->prefer = (char *)argv[i];
+        } else if (0 == strcmp(argv[i], NTP_SERVERS_VERSION_KW)) {
+            if (!cur || no_form || (i + 1 >= argc)) {
+                return -1;
+            }
+            cur->version = (char *)argv[++i];
+        } else if (0 == strcmp(argv[i], NTP_SERVERS_KEY_ID_KW)) {
+            if (!cur || no_form || (i + 1 >= argc)) {
+                return -1;
+            }
+            cur->keyid = (char *)argv[++i];
+        } else if (0 == strcmp(argv[i], NTP_SERVERS_NTS_KW)) {
+            if (!cur || no_form) {
+                return -1;
+            }
+            cur->nts = (char *)argv[i];
+        } else {
+            cur = &pntp_servers_params[count++];
+            ntp_server_get_default_cfg(cur);
+            cur->vrf_name = DEFAULT_VRF_NAME;
+            cur->server_name = (char *)argv[i];
+            cur->no_form = no_form;
+            /* As for "ntp server", options which are not given are left unchanged */
+            cur->version = NULL;
+        }
+    }
+
+    return count;
+}
+
+/* Apply a list of servers in a single transaction, so that ops-ntpd
+ * reconfigures ntpd once for the whole list. The list is applied
+ * entirely or not at all.
+ */
+const int
+vtysh_ovsdb_ntp_servers_set(int argc, const char *argv[], bool no_form)
+{
+    ntp_cli_ntp_server_params_t *ntp_servers_params = NULL;
+    struct ovsdb_idl_txn *ntp_association_txn = NULL;
+    int server_count = 0;
+    int count = 0;
+    int i = 0;
+    int retval = CMD_SUCCESS;
+
+    ntp_servers_params = calloc(argc, sizeof(ntp_cli_ntp_server_params_t));
+    if (NULL == ntp_servers_params) {
+        return CMD_WARNING;
+    }
+
+    count = ntp_servers_parse(argc, argv, no_form, ntp_servers_params);
+    if (count <= 0) {
+        vty_out(vty, "Invalid server list%s", VTY_NEWLINE);
+        free(ntp_servers_params);
+        return CMD_ERR_NOTHING_TODO;
+    }
+
+    /* Validate every entry before touching the database */
+    for (i = 0; i < count; i++) {
+        retval = ntp_server_sanitize_parameters(&ntp_servers_params[i]);
+        if (CMD_SUCCESS != retval) {
+            vty_out(vty, "No server configured, %s was rejected%s", ntp_servers_params[i].server_name, VTY_NEWLINE);
+            free(ntp_servers_params);
+            return retval;
         }
     }
 
+    /* Start of transaction */
+    ntp_association_txn = cli_do_config_start();
+    if (NULL == ntp_association_txn) {
+        vty_out(vty, "ovsdb_idl_txn_create failed: %s: %d\n", __FILE__, __LINE__);
+        cli_do_config_abort(ntp_association_txn);
+        free(ntp_servers_params);
+        return CMD_OVSDB_FAILURE;
+    }
+
+    server_count = ntp_server_get_count();
+    for (i = 0; i < count; i++) {
+        retval = ntp_server_apply(ntp_association_txn, &ntp_servers_params[i], &server_count);
+        if (CMD_SUCCESS != retval) {
+            vty_out(vty, "No server configured, %s was rejected%s", ntp_servers_params[i].server_name, VTY_NEWLINE);
+            cli_do_config_abort(ntp_association_txn);
+            free(ntp_servers_params);
+            return retval;
+        }
+    }
+
+    free(ntp_servers_params);
+
     /* End of transaction. */
     END_DB_TXN(ntp_association_txn);
 }
@@ -608,6 +1107,8 @@ vtysh_ovsdb_show_ntp_associations()
 
         if (ntp_assoc_row->key_id) {
             vty_out(vty, "  %5ld", ((struct ovsrec_ntp_key *)ntp_assoc_row->key_id)->key_id);
+        } else if (smap_get_bool(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_NTS, false)) {
+            vty_out(vty, "  %5s", NTP_SERVERS_NTS_KW);
         } else {
             vty_out(vty, "  %5s", NTP_DEFAULT_STR);
         }
@@ -672,8 +1173,10 @@ vtysh_ovsdb_show_ntp_status()
 {
     const struct ovsrec_system *ovs_system = NULL;
     const char *buf = NULL;
-    const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
+    const char *peer = NULL;
     bool status = 0;
+    time_t last_change = 0;
+    char time_str[32];
 
     /* Get access to the System Table */
     ovs_system = ovsrec_system_first(idl);
@@ -687,28 +1190,74 @@ vtysh_ovsdb_show_ntp_status()
     status = smap_get_bool(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_AUTHENTICATION_ENABLE, false);
     vty_out(vty, "NTP authentication is %s\n", ((status) ? SYSTEM_NTP_CONFIG_AUTHENTICATION_ENABLED : SYSTEM_NTP_CONFIG_AUTHENTICATION_DISABLED));
 
+    status = smap_get_bool(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ENABLE, false);
+    vty_out(vty, "NTP server mode is %s\n", ((status) ? "enabled" : "disabled"));
+    if (status) {
+        buf = smap_get(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ALLOW);
+        vty_out(vty, "Serving clients: %s\n", ((buf && *buf) ? buf : "any"));
+        vty_out(vty, "Client rate limit: average %d, minimum %d (log2 seconds)\n",
+                smap_get_int(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE,
+                             NTP_SERVER_RATE_AVERAGE_DEFAULT),
+                smap_get_int(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM,
+                             NTP_SERVER_RATE_MINIMUM_DEFAULT));
+    }
+
     buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_UPTIME);
     vty_out(vty, "Uptime: %s second(s)\n", ((buf) ? buf : NTP_DEFAULT_STR));
 
-    OVSREC_NTP_ASSOCIATION_FOR_EACH(ntp_assoc_row, idl) {
-        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_PEER_STATUS_WORD);
-        if (buf) {
-            VLOG_DBG("System status word: %s\n", buf);
+    buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_NTPD_RESTARTS);
+    if (buf) {
+        vty_out(vty, "NTP daemon restarts: %s", buf);
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_NTPD_UPTIME);
+        vty_out(vty, ", running for %s second(s)\n", ((buf) ? buf : NTP_DEFAULT_STR));
+    }
 
-            if (0 == strcmp(buf, NTP_ASSOC_STATUS_PEER_STATUS_WORD_SYSTEMPEER)) {
-                buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_STRATUM);
-                vty_out(vty, "Synchronized to NTP Server %s at stratum %s\n", ntp_assoc_row->address, ((buf) ? buf : ""));
+    /* Set once the offset settled after the NTP daemon (re)started */
+    buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_TIME_TO_STABLE_OFFSET);
+    if (buf && strcmp(buf, NTP_DEFAULT_STR)) {
+        vty_out(vty, "Time to stable offset: %s second(s)\n", buf);
+    }
 
-                buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_POLLING_INTERVAL);
-                vty_out(vty, "Poll interval = %s seconds\n", ((buf) ? buf : ""));
+    buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_KERNEL_SYNC_STATUS);
+    if (buf) {
+        vty_out(vty, "Kernel clock is %s", buf);
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_KERNEL_CLOCK_STATE);
+        vty_out(vty, " (state %s)\n", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_KERNEL_OFFSET);
+        vty_out(vty, "Kernel offset: %s us", ((buf) ? buf : NTP_DEFAULT_STR));
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_KERNEL_FREQUENCY);
+        vty_out(vty, ", frequency: %s ppm\n", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_KERNEL_MAXERROR);
+        vty_out(vty, "Kernel maximum error: %s us", ((buf) ? buf : NTP_DEFAULT_STR));
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_KERNEL_ESTERROR);
+        vty_out(vty, ", estimated error: %s us\n", ((buf) ? buf : NTP_DEFAULT_STR));
+    }
 
-                buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_TIME_OFFSET);
-                vty_out(vty, "Time accuracy is within %s seconds\n", ((buf) ? buf : ""));
+    /* The sync summary is precomputed by ops-ntpd, no need to walk the associations */
+    buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_STATE);
+    if (buf && (0 == strcmp(buf, SYSTEM_NTP_STATUS_SYNC_STATE_SYNCHRONIZED))) {
+        VLOG_DBG("System sync state: %s\n", buf);
 
-                buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_REFERENCE_TIME);
-                vty_out(vty, "Reference time: %s (UTC)\n", ((buf) ? buf : ""));
-            }
-        }
+        peer = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_PEER);
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_STRATUM);
+        vty_out(vty, "Synchronized to NTP Server %s at stratum %s\n", ((peer) ? peer : ""), ((buf) ? buf : ""));
+
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_POLL);
+        vty_out(vty, "Poll interval = %s seconds\n", ((buf) ? buf : ""));
+
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_OFFSET);
+        vty_out(vty, "Time accuracy is within %s seconds\n", ((buf) ? buf : ""));
+
+        buf = smap_get(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_REFTIME);
+        vty_out(vty, "Reference time: %s (UTC)\n", ((buf) ? buf : ""));
+    }
+
+    last_change = smap_get_int(&ovs_system->ntp_status, SYSTEM_NTP_STATUS_SYNC_LAST_CHANGE, 0);
+    if (last_change > 0) {
+        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", gmtime(&last_change));
+        vty_out(vty, "Sync state last changed: %s (UTC)\n", time_str);
     }
 }
 
@@ -753,6 +1302,107 @@ vtysh_ovsdb_show_ntp_statistics()
     vty_out(vty, "%20s    %s\n", "KOD pkts", ((buf) ? buf : NTP_DEFAULT_STR));
 }
 
+static void
+vtysh_ovsdb_show_ntp_statistics_associations()
+{
+    const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
+    int i = 0;
+    const char *buf = NULL;
+    char ser_name[39];
+
+    vty_out(vty, "------------------------------------------------------------------------------"
+                 "------------------------------------------------------------\n");
+    vty_out(vty, " %3s  %39s  %10s  %10s  %10s",
+        "ID", "NAME", "OFFSET-P50", "OFFSET-P95", "OFFSET-P99");
+    vty_out(vty, "  %10s  %10s  %10s  %7s  %10s\n",
+        "ADEV-1", "ADEV-4", "ADEV-16", "SAMPLES", "REACH-LOSS");
+    vty_out(vty, "------------------------------------------------------------------------------"
+                 "------------------------------------------------------------\n");
+
+    OVSREC_NTP_ASSOCIATION_FOR_EACH(ntp_assoc_row, idl) {
+        vty_out(vty, " %3d", ++i);
+
+        snprintf(ser_name, sizeof(ser_name), "%s", ntp_assoc_row->address);
+        vty_out(vty, "  %39s", ser_name);
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_OFFSET_P50);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_OFFSET_P95);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_OFFSET_P99);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_ALLAN_DEV_TAU_1);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_ALLAN_DEV_TAU_4);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_ALLAN_DEV_TAU_16);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_STATS_SAMPLES);
+        vty_out(vty, "  %7s", ((buf) ? buf : NTP_DEFAULT_ZERO_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_REACH_LOSS_COUNT);
+        vty_out(vty, "  %10s", ((buf) ? buf : NTP_DEFAULT_ZERO_STR));
+
+        vty_out(vty, "\n");
+    }
+
+    vty_out(vty, "------------------------------------------------------------------------------"
+                 "------------------------------------------------------------\n");
+    vty_out(vty, "Offsets are in milliseconds. ADEV-N is the Allan deviation at tau = N x poll interval.\n");
+}
+
+static void
+vtysh_ovsdb_show_ntp_nts()
+{
+    const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
+    const struct ovsrec_system *ovs_system = NULL;
+    int i = 0;
+    const char *buf = NULL;
+    char ser_name[39];
+
+    ovs_system = ovsrec_system_first(idl);
+    buf = (ovs_system) ? smap_get(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS) : NULL;
+    vty_out(vty, "Trusted certificates: %s\n", ((buf) ? buf : "system"));
+
+    vty_out(vty, "------------------------------------------------------------------------------------------\n");
+    vty_out(vty, " %3s  %39s  %7s  %8s  %16s  %7s\n",
+        "ID", "NAME", "COOKIES", "KE-COUNT", "COOKIE-REFRESHES", "LAST-KE");
+    vty_out(vty, "------------------------------------------------------------------------------------------\n");
+
+    OVSREC_NTP_ASSOCIATION_FOR_EACH(ntp_assoc_row, idl) {
+        if (!smap_get_bool(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_NTS, false)) {
+            continue;
+        }
+        vty_out(vty, " %3d", ++i);
+
+        snprintf(ser_name, sizeof(ser_name), "%s", ntp_assoc_row->address);
+        vty_out(vty, "  %39s", ser_name);
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_NTS_COOKIES);
+        vty_out(vty, "  %7s", ((buf) ? buf : NTP_DEFAULT_ZERO_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_NTS_KE_COUNT);
+        vty_out(vty, "  %8s", ((buf) ? buf : NTP_DEFAULT_ZERO_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_NTS_COOKIE_REFRESHES);
+        vty_out(vty, "  %16s", ((buf) ? buf : NTP_DEFAULT_ZERO_STR));
+
+        buf = smap_get(&ntp_assoc_row->association_status, NTP_ASSOC_STATUS_NTS_LAST_KE);
+        vty_out(vty, "  %7s", ((buf) ? buf : NTP_DEFAULT_STR));
+
+        vty_out(vty, "\n");
+    }
+
+    vty_out(vty, "------------------------------------------------------------------------------------------\n");
+    vty_out(vty, "LAST-KE is the age in seconds of the last NTS-KE handshake.\n");
+}
+
 static void
 vtysh_ovsdb_show_ntp_trusted_keys()
 {
@@ -776,17 +1426,43 @@ vtysh_ovsdb_show_ntp_authentication_keys()
 {
     const struct ovsrec_ntp_key *ntp_auth_key_row = NULL;
 
-    vty_out(vty,"---------------------------\n");
-    vty_out(vty,"%8s   %16s\n", "Auth-key", "MD5 password");
-    vty_out(vty,"---------------------------\n");
+    const char *algorithm = NULL;
+    const char *secret = NULL;
+
+    vty_out(vty,"------------------------------------------\n");
+    vty_out(vty,"%8s   %-10s   %s\n", "Auth-key", "Algorithm", "Key");
+    vty_out(vty,"------------------------------------------\n");
 
     OVSREC_NTP_KEY_FOR_EACH(ntp_auth_key_row, idl) {
         if (ntp_auth_key_row) {
-            vty_out(vty, "%8ld   %16s\n", ntp_auth_key_row->key_id, ntp_auth_key_row->key_password);
+            algorithm = ntp_key_parse_password(ntp_auth_key_row->key_password, &secret);
+            vty_out(vty, "%8ld   %-10s   %s\n", ntp_auth_key_row->key_id, algorithm, secret);
         }
     }
 
-    vty_out(vty,"---------------------------\n");
+    vty_out(vty,"------------------------------------------\n");
+}
+
+/* The top clients are kept in memory by ops-ntpd, never in OVSDB */
+static void
+ntp_show_clients_from_daemon()
+{
+    FILE *fp = NULL;
+    char line[NTP_CLIENTS_LINE_MAX];
+    int status = 0;
+
+    fp = popen(NTP_CLIENTS_APPCTL_CMD " 2>/dev/null", "r");
+    if (NULL == fp) {
+        vty_out(vty, "Could not reach ops-ntpd\n");
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        vty_out(vty, "%s", line);
+    }
+    status = pclose(fp);
+    if ((-1 == status) || !WIFEXITED(status) || (0 != WEXITSTATUS(status))) {
+        vty_out(vty, "Could not reach ops-ntpd\n");
+    }
 }
 
 /*================================================================================================*/
@@ -829,6 +1505,31 @@ DEFUN ( vtysh_show_ntp_statistics,
     return CMD_SUCCESS;
 }
 
+DEFUN ( vtysh_show_ntp_statistics_associations,
+        vtysh_show_ntp_statistics_associations_cmd,
+        "show ntp statistics associations",
+        SHOW_STR
+        NTP_SHOW_STR
+        NTP_SHOW_STATISTICS_STR
+        NTP_SHOW_STATISTICS_ASSOC_STR
+      )
+{
+    vtysh_ovsdb_show_ntp_statistics_associations();
+    return CMD_SUCCESS;
+}
+
+DEFUN ( vtysh_show_ntp_nts,
+        vtysh_show_ntp_nts_cmd,
+        "show ntp nts",
+        SHOW_STR
+        NTP_SHOW_STR
+        NTP_SHOW_NTS_STR
+      )
+{
+    vtysh_ovsdb_show_ntp_nts();
+    return CMD_SUCCESS;
+}
+
 DEFUN ( vtysh_show_ntp_trusted_keys,
         vtysh_show_ntp_trusted_keys_cmd,
         "show ntp trusted-keys",
@@ -853,11 +1554,23 @@ DEFUN ( vtysh_show_ntp_authentication_keys,
     return CMD_SUCCESS;
 }
 
+DEFUN ( vtysh_show_ntp_clients,
+        vtysh_show_ntp_clients_cmd,
+        "show ntp clients",
+        SHOW_STR
+        NTP_SHOW_STR
+        NTP_SHOW_CLIENTS_STR
+      )
+{
+    ntp_show_clients_from_daemon();
+    return CMD_SUCCESS;
+}
+
 /* CONFIG CLIs */
 DEFUN ( vtysh_set_ntp_server,
         vtysh_set_ntp_server_cmd,
         "ntp server WORD "
-        "{prefer | version <3-4> | key-id <1-65534>}",
+        "{prefer | version <3-4> | key-id <1-65534> | vrf WORD | nts}",
         NTP_STR
         NTP_SERVER_STR
         NTP_SERVER_NAME_STR
@@ -866,6 +1579,9 @@ DEFUN ( vtysh_set_ntp_server,
         NTP_SERVER_VERSION_NUM_STR
         NTP_KEY_ID_STR
         NTP_KEY_NUM_STR
+        NTP_SERVER_VRF_STR
+        NTP_SERVER_VRF_NAME_STR
+        NTP_SERVER_NTS_STR
       )
 {
     int ret_code = CMD_SUCCESS;
@@ -875,9 +1591,6 @@ DEFUN ( vtysh_set_ntp_server,
     /* Set various parameters needed by the "ntp server" command handler */
     ntp_server_params.vrf_name = DEFAULT_VRF_NAME;
     ntp_server_params.server_name = (char *)argv[0];
-    ntp_server_params.prefer = (char *)argv[1];
-    ntp_server_params.version = (char *)argv[2];
-    ntp_server_params.keyid = (char *)argv[3];
 
     if (vty_flags & CMD_FLAG_NO_CMD) {
         ntp_server_params.no_form = 1;
@@ -885,6 +1598,21 @@ DEFUN ( vtysh_set_ntp_server,
         ntp_server_params.prefer = NULL;
         ntp_server_params.version = NULL;
         ntp_server_params.keyid = NULL;
+        ntp_server_params.nts = NULL;
+
+        /* The no form only takes the VRF */
+        if ((argc > 1) && argv[1]) {
+            ntp_server_params.vrf_name = (char *)argv[1];
+        }
+    } else {
+        ntp_server_params.prefer = (char *)argv[1];
+        ntp_server_params.version = (char *)argv[2];
+        ntp_server_params.keyid = (char *)argv[3];
+
+        if ((argc > 4) && argv[4]) {
+            ntp_server_params.vrf_name = (char *)argv[4];
+        }
+        ntp_server_params.nts = (argc > 5) ? (char *)argv[5] : NULL;
     }
 
     /* Finally call the handler */
@@ -896,10 +1624,110 @@ DEFUN ( vtysh_set_ntp_server,
 
 DEFUN_NO_FORM ( vtysh_set_ntp_server,
         vtysh_set_ntp_server_cmd,
-        "ntp server WORD",
+        "ntp server WORD {vrf WORD}",
         NTP_STR
         NTP_SERVER_STR
         NTP_SERVER_NAME_STR
+        NTP_SERVER_VRF_STR
+        NTP_SERVER_VRF_NAME_STR
+      );
+
+
+DEFUN ( vtysh_set_ntp_refclock,
+        vtysh_set_ntp_refclock_cmd,
+        "ntp refclock (pps|shm) <0-3> {prefer | refid WORD}",
+        NTP_STR
+        NTP_REFCLOCK_STR
+        NTP_REFCLOCK_PPS_STR
+        NTP_REFCLOCK_SHM_STR
+        NTP_REFCLOCK_UNIT_STR
+        NTP_REFCLOCK_PREFER_STR
+        NTP_REFCLOCK_REFID_STR
+        NTP_REFCLOCK_REFID_ID_STR
+      )
+{
+    ntp_cli_ntp_server_params_t ntp_server_params;
+    ntp_server_get_default_cfg(&ntp_server_params);
+
+    /* The version is meaningless for a reference clock */
+    ntp_server_params.version = NULL;
+    ntp_server_params.vrf_name = DEFAULT_VRF_NAME;
+
+    if (vty_flags & CMD_FLAG_NO_CMD) {
+        ntp_server_params.no_form = 1;
+    } else {
+        ntp_server_params.prefer = (char *)argv[2];
+        ntp_server_params.refid = (char *)argv[3];
+    }
+
+    return vtysh_ovsdb_ntp_refclock_set(argv[0], argv[1], &ntp_server_params);
+}
+
+
+DEFUN_NO_FORM ( vtysh_set_ntp_refclock,
+        vtysh_set_ntp_refclock_cmd,
+        "ntp refclock (pps|shm) <0-3>",
+        NTP_STR
+        NTP_REFCLOCK_STR
+        NTP_REFCLOCK_PPS_STR
+        NTP_REFCLOCK_SHM_STR
+        NTP_REFCLOCK_UNIT_STR
+      );
+
+
+DEFUN ( vtysh_set_ntp_refclock_feed,
+        vtysh_set_ntp_refclock_feed_cmd,
+        "ntp refclock shm <0-3> feed (phc|socket) WORD {prefer | refid WORD}",
+        NTP_STR
+        NTP_REFCLOCK_STR
+        NTP_REFCLOCK_SHM_STR
+        NTP_REFCLOCK_UNIT_STR
+        NTP_REFCLOCK_FEED_STR
+        NTP_REFCLOCK_FEED_PHC_STR
+        NTP_REFCLOCK_FEED_SOCKET_STR
+        NTP_REFCLOCK_FEED_PATH_STR
+        NTP_REFCLOCK_PREFER_STR
+        NTP_REFCLOCK_REFID_STR
+        NTP_REFCLOCK_REFID_ID_STR
+      )
+{
+    ntp_cli_ntp_server_params_t ntp_server_params;
+    char feed[NTP_REFCLOCK_FEED_PATH_MAX + 16];
+
+    ntp_server_get_default_cfg(&ntp_server_params);
+
+    if (!ntp_refclock_feed_format(argv[1], argv[2], feed, sizeof(feed))) {
+        return CMD_ERR_NOTHING_TODO;
+    }
+
+    ntp_server_params.version = NULL;
+    ntp_server_params.vrf_name = DEFAULT_VRF_NAME;
+    ntp_server_params.feed = feed;
+    ntp_server_params.prefer = (char *)argv[3];
+    ntp_server_params.refid = (char *)argv[4];
+
+    return vtysh_ovsdb_ntp_refclock_set(NTP_REFCLOCK_SHM_KW, argv[0], &ntp_server_params);
+}
+
+
+DEFUN ( vtysh_set_ntp_servers,
+        vtysh_set_ntp_servers_cmd,
+        "ntp servers .LINE",
+        NTP_STR
+        NTP_SERVERS_STR
+        NTP_SERVERS_LIST_STR
+      )
+{
+    return vtysh_ovsdb_ntp_servers_set(argc, argv, (vty_flags & CMD_FLAG_NO_CMD));
+}
+
+
+DEFUN_NO_FORM ( vtysh_set_ntp_servers,
+        vtysh_set_ntp_servers_cmd,
+        "ntp servers .LINE",
+        NTP_STR
+        NTP_SERVERS_STR
+        NTP_SERVERS_LIST_STR
       );
 
 
@@ -936,14 +1764,114 @@ DEFUN_NO_FORM ( vtysh_set_ntp_authentication_enable,
       );
 
 
+DEFUN ( vtysh_set_ntp_serve,
+        vtysh_set_ntp_serve_cmd,
+        "ntp serve",
+        NTP_STR
+        NTP_SERVE_STR
+      )
+{
+    return vtysh_ovsdb_ntp_serve_set(vty_flags & CMD_FLAG_NO_CMD);
+}
+
+
+DEFUN_NO_FORM ( vtysh_set_ntp_serve,
+        vtysh_set_ntp_serve_cmd,
+        "ntp serve",
+        NTP_STR
+        NTP_SERVE_STR
+      );
+
+
+DEFUN ( vtysh_set_ntp_serve_allow,
+        vtysh_set_ntp_serve_allow_cmd,
+        "ntp serve allow (A.B.C.D/M|X:X::X:X/M)",
+        NTP_STR
+        NTP_SERVE_STR
+        NTP_SERVE_ALLOW_STR
+        NTP_SERVE_ALLOW_IPV4_STR
+        NTP_SERVE_ALLOW_IPV6_STR
+      )
+{
+    return vtysh_ovsdb_ntp_serve_allow_set(argv[0], vty_flags & CMD_FLAG_NO_CMD);
+}
+
+
+DEFUN_NO_FORM ( vtysh_set_ntp_serve_allow,
+        vtysh_set_ntp_serve_allow_cmd,
+        "ntp serve allow (A.B.C.D/M|X:X::X:X/M)",
+        NTP_STR
+        NTP_SERVE_STR
+        NTP_SERVE_ALLOW_STR
+        NTP_SERVE_ALLOW_IPV4_STR
+        NTP_SERVE_ALLOW_IPV6_STR
+      );
+
+
+DEFUN ( vtysh_set_ntp_serve_rate_limit,
+        vtysh_set_ntp_serve_rate_limit_cmd,
+        "ntp serve rate-limit average <0-16> minimum <0-16>",
+        NTP_STR
+        NTP_SERVE_STR
+        NTP_SERVE_RATE_LIMIT_STR
+        NTP_SERVE_AVERAGE_STR
+        NTP_SERVE_INTERVAL_STR
+        NTP_SERVE_MINIMUM_STR
+        NTP_SERVE_INTERVAL_STR
+      )
+{
+    if (vty_flags & CMD_FLAG_NO_CMD) {
+        return vtysh_ovsdb_ntp_serve_rate_limit_set(NULL, NULL, true);
+    }
+    return vtysh_ovsdb_ntp_serve_rate_limit_set(argv[0], argv[1], false);
+}
+
+
+DEFUN_NO_FORM ( vtysh_set_ntp_serve_rate_limit,
+        vtysh_set_ntp_serve_rate_limit_cmd,
+        "ntp serve rate-limit",
+        NTP_STR
+        NTP_SERVE_STR
+        NTP_SERVE_RATE_LIMIT_STR
+      );
+
+
+DEFUN ( vtysh_set_ntp_nts_trusted_certs,
+        vtysh_set_ntp_nts_trusted_certs_cmd,
+        "ntp nts trusted-certificates WORD",
+        NTP_STR
+        NTP_NTS_STR
+        NTP_NTS_TRUSTED_CERTS_STR
+        NTP_NTS_CERTS_PATH_STR
+      )
+{
+    if (vty_flags & CMD_FLAG_NO_CMD) {
+        return vtysh_ovsdb_ntp_nts_trusted_certs_set(NULL, true);
+    }
+    return vtysh_ovsdb_ntp_nts_trusted_certs_set(argv[0], false);
+}
+
+
+DEFUN_NO_FORM ( vtysh_set_ntp_nts_trusted_certs,
+        vtysh_set_ntp_nts_trusted_certs_cmd,
+        "ntp nts trusted-certificates",
+        NTP_STR
+        NTP_NTS_STR
+        NTP_NTS_TRUSTED_CERTS_STR
+      );
+
+
 DEFUN ( vtysh_set_ntp_authentication_key,
         vtysh_set_ntp_authentication_key_cmd,
-        "ntp authentication-key <1-65534> md5 WORD",
+        "ntp authentication-key <1-65534> (md5|sha1|sha256|aes128cmac) WORD",
         NTP_STR
         NTP_AUTH_KEY_STR
         NTP_KEY_NUM_STR
         NTP_MD5_STR
-        NTP_MD5_PASSWORD_STR
+        NTP_SHA1_STR
+        NTP_SHA256_STR
+        NTP_AES128CMAC_STR
+        NTP_KEY_PASSWORD_STR
       )
 {
     int ret_code = CMD_SUCCESS;
@@ -952,11 +1880,13 @@ DEFUN ( vtysh_set_ntp_authentication_key,
 
     /* Set various parameters needed by the "ntp auth key" command handler */
     ntp_auth_key_params.key = (char *)argv[0];
-    ntp_auth_key_params.md5_pwd = (char *)argv[1];
+    ntp_auth_key_params.algorithm = (char *)argv[1];
+    ntp_auth_key_params.password = (char *)argv[2];
 
     if (vty_flags & CMD_FLAG_NO_CMD) {
         ntp_auth_key_params.no_form = 1;
-        ntp_auth_key_params.md5_pwd = NULL;
+        ntp_auth_key_params.algorithm = NULL;
+        ntp_auth_key_params.password = NULL;
     }
 
     /* Finally call the handler */
@@ -1074,19 +2004,45 @@ void cli_post_init(void)
     install_element (VIEW_NODE, &vtysh_show_ntp_statistics_cmd);
     install_element (ENABLE_NODE, &vtysh_show_ntp_statistics_cmd);
 
+    install_element (VIEW_NODE, &vtysh_show_ntp_statistics_associations_cmd);
+    install_element (ENABLE_NODE, &vtysh_show_ntp_statistics_associations_cmd);
+
     install_element (VIEW_NODE, &vtysh_show_ntp_trusted_keys_cmd);
     install_element (ENABLE_NODE, &vtysh_show_ntp_trusted_keys_cmd);
 
     install_element (VIEW_NODE, &vtysh_show_ntp_authentication_keys_cmd);
     install_element (ENABLE_NODE, &vtysh_show_ntp_authentication_keys_cmd);
 
+    install_element (VIEW_NODE, &vtysh_show_ntp_clients_cmd);
+    install_element (ENABLE_NODE, &vtysh_show_ntp_clients_cmd);
+
+    install_element (VIEW_NODE, &vtysh_show_ntp_nts_cmd);
+    install_element (ENABLE_NODE, &vtysh_show_ntp_nts_cmd);
+
     /* CONFIG CMDS */
     install_element (CONFIG_NODE, &vtysh_set_ntp_server_cmd);
     install_element (CONFIG_NODE, &no_vtysh_set_ntp_server_cmd);
 
+    install_element (CONFIG_NODE, &vtysh_set_ntp_servers_cmd);
+    install_element (CONFIG_NODE, &no_vtysh_set_ntp_servers_cmd);
+
+    install_element (CONFIG_NODE, &vtysh_set_ntp_refclock_cmd);
+    install_element (CONFIG_NODE, &no_vtysh_set_ntp_refclock_cmd);
+    install_element (CONFIG_NODE, &vtysh_set_ntp_refclock_feed_cmd);
+
     install_element (CONFIG_NODE, &vtysh_set_ntp_authentication_enable_cmd);
     install_element (CONFIG_NODE, &no_vtysh_set_ntp_authentication_enable_cmd);
 
+    install_element (CONFIG_NODE, &vtysh_set_ntp_serve_cmd);
+    install_element (CONFIG_NODE, &no_vtysh_set_ntp_serve_cmd);
+    install_element (CONFIG_NODE, &vtysh_set_ntp_serve_allow_cmd);
+    install_element (CONFIG_NODE, &no_vtysh_set_ntp_serve_allow_cmd);
+    install_element (CONFIG_NODE, &vtysh_set_ntp_serve_rate_limit_cmd);
+    install_element (CONFIG_NODE, &no_vtysh_set_ntp_serve_rate_limit_cmd);
+
+    install_element (CONFIG_NODE, &vtysh_set_ntp_nts_trusted_certs_cmd);
+    install_element (CONFIG_NODE, &no_vtysh_set_ntp_nts_trusted_certs_cmd);
+
     install_element (CONFIG_NODE, &vtysh_set_ntp_authentication_key_cmd);
     install_element (CONFIG_NODE, &no_vtysh_set_ntp_authentication_key_cmd);
 
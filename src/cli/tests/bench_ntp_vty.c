@@ -0,0 +1,172 @@
+/* Microbenchmarks for the NTP CLI commands.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * File: bench_ntp_vty.c
+ *
+ * Purpose: Time the show, running-config and config handlers against the
+ *          in-memory IDL with large row counts. The mocked smap is a list,
+ *          so the numbers are meant for comparing revisions of the CLI
+ *          code, not as absolute vtysh latencies.
+ *
+ * Usage: bench_ntp_vty [rows ...]
+ */
+
+#include "../ntp_vty.c"
+#include "mock_ovsdb.h"
+
+#define BENCH_MIN_TIME_NS   200000000ULL
+#define BENCH_DEFAULT_ROWS  { 8, 1000, 10000 }
+
+typedef void (*bench_fn)(void);
+
+static uint64_t
+bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Repeat the operation until BENCH_MIN_TIME_NS has elapsed */
+static void
+bench_run(const char *name, int rows, bench_fn fn)
+{
+    uint64_t start, elapsed = 0, iterations = 0;
+    size_t output = 0;
+
+    start = bench_now_ns();
+    while (elapsed < BENCH_MIN_TIME_NS) {
+        mock_vty_clear();
+        fn();
+        output = mock_vty_output_len();
+        iterations++;
+        elapsed = bench_now_ns() - start;
+    }
+    printf("%-36s rows %6d  %12.1f us/op  %8zu bytes out\n",
+           name, rows, (double)elapsed / iterations / 1000.0, output);
+}
+
+static void
+bench_populate(int rows)
+{
+    char name[32];
+    int i;
+
+    mock_ovsdb_reset();
+    for (i = 0; i < rows; i++) {
+        struct ovsrec_ntp_key *key = mock_ovsdb_add_key((i % NTP_KEY_KEY_ID_MAX) + 1, "password", i & 1);
+        struct ovsrec_ntp_association *row = NULL;
+
+        snprintf(name, sizeof(name), "10.%d.%d.%d", (i >> 16) & 0xff, (i >> 8) & 0xff, (i & 0xff) + 1);
+        row = mock_ovsdb_add_association(name, (i & 1) ? key : NULL);
+
+        /* The status a running ops-ntpd publishes */
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_PEER_STATUS_WORD,
+                     NTP_ASSOC_STATUS_PEER_STATUS_WORD_CANDIDATE);
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_REMOTE_PEER_ADDRESS, name);
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_REMOTE_PEER_REF_ID, ".GPS.");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_STRATUM, "1");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_PEER_TYPE, NTP_ASSOC_STATUS_PEER_TYPE_UNI_MANY_CAST);
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_LAST_POLLED, "12");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_POLLING_INTERVAL, "64");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_REACHABILITY_REGISTER, "377");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_NETWORK_DELAY, "0.412");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_TIME_OFFSET, "-0.010");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_JITTER, "0.020");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_OFFSET_P50, "-0.010");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_OFFSET_P95, "0.030");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_OFFSET_P99, "0.050");
+        smap_replace(&row->association_status, NTP_ASSOC_STATUS_STATS_SAMPLES, "100");
+    }
+}
+
+static void
+bench_show_ntp_associations(void)
+{
+    vtysh_ovsdb_show_ntp_associations();
+}
+
+static void
+bench_show_ntp_statistics_associations(void)
+{
+    vtysh_ovsdb_show_ntp_statistics_associations();
+}
+
+static void
+bench_show_ntp_status(void)
+{
+    vtysh_ovsdb_show_ntp_status();
+}
+
+static void
+bench_show_ntp_authentication_keys(void)
+{
+    vtysh_ovsdb_show_ntp_authentication_keys();
+}
+
+static void
+bench_show_running_config(void)
+{
+    mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback);
+}
+
+/* Key lookup walks the NTP_Key table, use the last key as the worst case */
+static void
+bench_ntp_authentication_key(void)
+{
+    const char *argv[] = { "65534", "md5", "password" };
+    mock_vty_run(&vtysh_set_ntp_authentication_key_cmd, false, 3, argv);
+}
+
+/* Server lookup walks the NTP_Association table. The server count check
+ * rejects the insert, so the table does not grow between iterations. */
+static void
+bench_ntp_server(void)
+{
+    const char *argv[] = { "192.168.1.1", NULL, "4", NULL };
+    mock_vty_run(&vtysh_set_ntp_server_cmd, false, 4, argv);
+}
+
+int
+main(int argc, char *argv[])
+{
+    int default_rows[] = BENCH_DEFAULT_ROWS;
+    int nrows = sizeof(default_rows) / sizeof(default_rows[0]);
+    int i;
+
+    cli_pre_init();
+    cli_post_init();
+
+    for (i = 0; i < ((argc > 1) ? argc - 1 : nrows); i++) {
+        int rows = (argc > 1) ? atoi(argv[i + 1]) : default_rows[i];
+
+        bench_populate(rows);
+        bench_run("show ntp associations", rows, bench_show_ntp_associations);
+        bench_run("show ntp statistics associations", rows, bench_show_ntp_statistics_associations);
+        bench_run("show ntp status", rows, bench_show_ntp_status);
+        bench_run("show ntp authentication-keys", rows, bench_show_ntp_authentication_keys);
+        bench_run("show running-config (ntp)", rows, bench_show_running_config);
+        bench_run("ntp authentication-key", rows, bench_ntp_authentication_key);
+        bench_run("ntp server", rows, bench_ntp_server);
+    }
+
+    mock_ovsdb_reset();
+    return 0;
+}
@@ -0,0 +1,200 @@
+/* Fuzz target for the NTP CLI parameter sanitizers.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * File: fuzz_ntp_vty.c
+ *
+ * Purpose: libFuzzer entry point. The first input byte selects the target,
+ *          the rest is the parameter string. For the "ntp server" and
+ *          "ntp servers" targets the string is split on spaces into the
+ *          command arguments.
+ *
+ *          Without libFuzzer (NTP_FUZZ_STANDALONE) the files given on the
+ *          command line are replayed, which is how the seed corpus runs
+ *          as a regular test.
+ */
+
+#include "../ntp_vty.c"
+#include "mock_ovsdb.h"
+
+#define FUZZ_MAX_INPUT 512
+#define FUZZ_MAX_ARGS  6
+
+enum fuzz_target {
+    FUZZ_SERVER_NAME,
+    FUZZ_AUTH_KEY,
+    FUZZ_AUTH_KEY_PASSWORD,
+    FUZZ_NTP_SERVER_CMD,
+    FUZZ_NTP_AUTH_KEY_CMD,
+    FUZZ_NTP_SERVERS_CMD,
+    FUZZ_NTP_SERVE_ALLOW_CMD,
+    FUZZ_TARGET_MAX
+};
+
+static void
+fuzz_ntp_server_cmd(char *str)
+{
+    const char *argv[FUZZ_MAX_ARGS] = { NULL, NULL, NULL, NULL, NULL, NULL };
+    const char *no_argv[2] = { NULL, NULL };
+    char *saveptr = NULL;
+    char *token = NULL;
+    int argc = 0;
+
+    for (token = strtok_r(str, " ", &saveptr); token && argc < FUZZ_MAX_ARGS;
+         token = strtok_r(NULL, " ", &saveptr)) {
+        argv[argc++] = token;
+    }
+    if (!argv[0]) {
+        return;
+    }
+    mock_vty_run(&vtysh_set_ntp_server_cmd, false, FUZZ_MAX_ARGS, argv);
+    /* Whatever was accepted must render in the running-config */
+    mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback);
+    no_argv[0] = argv[0];
+    no_argv[1] = argv[4];
+    mock_vty_run(&no_vtysh_set_ntp_server_cmd, true, 2, no_argv);
+}
+
+static void
+fuzz_ntp_auth_key_cmd(char *str)
+{
+    const char *argv[3] = { str, "md5", "password" };
+    char *sep = strchr(str, ' ');
+
+    if (sep) {
+        *sep = '\0';
+        argv[2] = sep + 1;
+        sep = strchr(sep + 1, ' ');
+        if (sep) {
+            /* "<key> <algorithm> <password>" */
+            *sep = '\0';
+            argv[1] = argv[2];
+            argv[2] = sep + 1;
+        }
+    }
+    mock_vty_run(&vtysh_set_ntp_authentication_key_cmd, false, 3, argv);
+    mock_vty_run(&vtysh_set_ntp_trusted_key_cmd, false, 1, argv);
+}
+
+static void
+fuzz_ntp_servers_cmd(char *str)
+{
+    const char *argv[FUZZ_MAX_INPUT];
+    char *saveptr = NULL;
+    char *token = NULL;
+    int argc = 0;
+
+    for (token = strtok_r(str, " ", &saveptr); token;
+         token = strtok_r(NULL, " ", &saveptr)) {
+        argv[argc++] = token;
+    }
+    if (0 == argc) {
+        return;
+    }
+    mock_vty_run(&vtysh_set_ntp_servers_cmd, false, argc, argv);
+    mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback);
+    mock_vty_run(&no_vtysh_set_ntp_servers_cmd, true, argc, argv);
+}
+
+static void
+fuzz_ntp_serve_allow_cmd(char *str)
+{
+    const char *argv[1] = { str };
+
+    mock_vty_run(&vtysh_set_ntp_serve_allow_cmd, false, 1, argv);
+    mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback);
+    mock_vty_run(&no_vtysh_set_ntp_serve_allow_cmd, true, 1, argv);
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialized = false;
+    const struct ovsrec_ntp_key *row = NULL;
+    char str[FUZZ_MAX_INPUT + 1];
+
+    if (!initialized) {
+        cli_pre_init();
+        cli_post_init();
+        initialized = true;
+    }
+
+    if ((size < 1) || (size > FUZZ_MAX_INPUT)) {
+        return 0;
+    }
+    memcpy(str, data + 1, size - 1);
+    str[size - 1] = '\0';
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+    mock_ovsdb_add_key(1, "password", true);
+    mock_ovsdb_add_key(NTP_KEY_KEY_ID_MAX, "password", false);
+    mock_ovsdb_add_vrf("red");
+
+    switch (data[0] % FUZZ_TARGET_MAX) {
+    case FUZZ_SERVER_NAME:
+        ntp_internal_is_valid_server_name(str);
+        break;
+    case FUZZ_AUTH_KEY:
+        ntp_sanitize_auth_key(str, &row, NULL, NULL);
+        break;
+    case FUZZ_AUTH_KEY_PASSWORD:
+        ntp_sanitize_auth_key(NULL, NULL, NULL, str);
+        ntp_sanitize_auth_key(NULL, NULL, NTP_KEY_ALGORITHM_SHA256, str);
+        break;
+    case FUZZ_NTP_SERVER_CMD:
+        fuzz_ntp_server_cmd(str);
+        break;
+    case FUZZ_NTP_AUTH_KEY_CMD:
+        fuzz_ntp_auth_key_cmd(str);
+        mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback);
+        break;
+    case FUZZ_NTP_SERVERS_CMD:
+        fuzz_ntp_servers_cmd(str);
+        break;
+    case FUZZ_NTP_SERVE_ALLOW_CMD:
+        fuzz_ntp_serve_allow_cmd(str);
+        break;
+    }
+    return 0;
+}
+
+#ifdef NTP_FUZZ_STANDALONE
+int
+main(int argc, char *argv[])
+{
+    uint8_t buf[FUZZ_MAX_INPUT];
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        size_t size;
+
+        if (!f) {
+            fprintf(stderr, "Unable to open %s\n", argv[i]);
+            return 1;
+        }
+        size = fread(buf, 1, sizeof(buf), f);
+        fclose(f);
+        LLVMFuzzerTestOneInput(buf, size);
+    }
+    mock_ovsdb_reset();
+    printf("Replayed %d input(s)\n", argc - 1);
+    return 0;
+}
+#endif /* NTP_FUZZ_STANDALONE */
@@ -0,0 +1,697 @@
+/* In-memory OVSDB and vty used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * File: mock_ovsdb.c
+ *
+ * Purpose: Implementation of the mocked IDL, smap, vty and vtysh config
+ *          helpers the ntpd_cli sources link against.
+ */
+
+#include <stdarg.h>
+#include <strings.h>
+#include "vtysh/command.h"
+#include "vtysh/vtysh_ovsdb_if.h"
+#include "openswitch-idl.h"
+#include "mock_ovsdb.h"
+
+/*================================================================================================*/
+/* smap */
+
+void
+smap_init(struct smap *smap)
+{
+    smap->head = NULL;
+}
+
+void
+smap_destroy(struct smap *smap)
+{
+    struct smap_node *node = smap->head;
+
+    while (node) {
+        struct smap_node *next = node->next;
+        free(node->key);
+        free(node->value);
+        free(node);
+        node = next;
+    }
+    smap->head = NULL;
+}
+
+static struct smap_node *
+smap_find(const struct smap *smap, const char *key)
+{
+    struct smap_node *node;
+
+    for (node = smap->head; node; node = node->next) {
+        if (0 == strcmp(node->key, key)) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+void
+smap_add(struct smap *smap, const char *key, const char *value)
+{
+    struct smap_node *node = malloc(sizeof *node);
+
+    node->key = strdup(key);
+    node->value = strdup(value);
+    node->next = smap->head;
+    smap->head = node;
+}
+
+void
+smap_replace(struct smap *smap, const char *key, const char *value)
+{
+    struct smap_node *node = smap_find(smap, key);
+
+    if (node) {
+        char *old = node->value;
+        node->value = strdup(value);
+        free(old);
+    } else {
+        smap_add(smap, key, value);
+    }
+}
+
+bool
+smap_remove(struct smap *smap, const char *key)
+{
+    struct smap_node **pnode;
+
+    for (pnode = &smap->head; *pnode; pnode = &(*pnode)->next) {
+        if (0 == strcmp((*pnode)->key, key)) {
+            struct smap_node *node = *pnode;
+            *pnode = node->next;
+            free(node->key);
+            free(node->value);
+            free(node);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+smap_clone(struct smap *dst, const struct smap *src)
+{
+    struct smap_node *node;
+
+    smap_init(dst);
+    for (node = src->head; node; node = node->next) {
+        smap_add(dst, node->key, node->value);
+    }
+}
+
+const char *
+smap_get(const struct smap *smap, const char *key)
+{
+    struct smap_node *node = smap_find(smap, key);
+    return node ? node->value : NULL;
+}
+
+bool
+smap_get_bool(const struct smap *smap, const char *key, bool def)
+{
+    const char *value = smap_get(smap, key);
+
+    if (!value) {
+        return def;
+    }
+    return def ? (0 != strcasecmp(value, "false")) : (0 == strcasecmp(value, "true"));
+}
+
+int
+smap_get_int(const struct smap *smap, const char *key, int def)
+{
+    const char *value = smap_get(smap, key);
+    return value ? atoi(value) : def;
+}
+
+size_t
+smap_count(const struct smap *smap)
+{
+    const struct smap_node *node;
+    size_t count = 0;
+
+    for (node = smap->head; node; node = node->next) {
+        count++;
+    }
+    return count;
+}
+
+static void
+smap_assign(struct smap *dst, const struct smap *src)
+{
+    struct smap copy;
+
+    if (dst == src) {
+        return;
+    }
+    smap_clone(&copy, src);
+    smap_destroy(dst);
+    *dst = copy;
+}
+
+/*================================================================================================*/
+/* IDL */
+
+/* Rows are kept in insertion order. The ovsrec struct is the first member
+ * so a row pointer can be turned back into its list node. */
+struct mock_vrf_row {
+    struct ovsrec_vrf row;
+    struct mock_vrf_row *next;
+};
+
+struct mock_ntp_key_row {
+    struct ovsrec_ntp_key row;
+    struct mock_ntp_key_row *next;
+};
+
+struct mock_ntp_association_row {
+    struct ovsrec_ntp_association row;
+    struct mock_ntp_association_row *next;
+};
+
+struct ovsdb_idl {
+    struct ovsrec_system system;
+    bool has_system;
+    struct mock_vrf_row *vrfs;
+    struct mock_ntp_key_row *keys;
+    struct mock_ntp_key_row *keys_tail;
+    struct mock_ntp_association_row *assocs;
+    struct mock_ntp_association_row *assocs_tail;
+};
+
+struct ovsdb_idl_txn {
+    int unused;
+};
+
+static struct ovsdb_idl mock_idl;
+static struct ovsdb_idl_txn mock_txn;
+
+struct ovsdb_idl *idl = &mock_idl;
+struct mock_ovsdb_stats mock_ovsdb_stats;
+
+struct ovsdb_idl_table_class ovsrec_table_system = { "System" };
+struct ovsdb_idl_table_class ovsrec_table_vrf = { "VRF" };
+struct ovsdb_idl_table_class ovsrec_table_ntp_association = { "NTP_Association" };
+struct ovsdb_idl_table_class ovsrec_table_ntp_key = { "NTP_Key" };
+
+struct ovsdb_idl_column ovsrec_system_col_ntp_config = { "ntp_config" };
+struct ovsdb_idl_column ovsrec_system_col_ntp_status = { "ntp_status" };
+struct ovsdb_idl_column ovsrec_system_col_ntp_statistics = { "ntp_statistics" };
+struct ovsdb_idl_column ovsrec_vrf_col_name = { "name" };
+struct ovsdb_idl_column ovsrec_ntp_association_col_address = { "address" };
+struct ovsdb_idl_column ovsrec_ntp_association_col_vrf = { "vrf" };
+struct ovsdb_idl_column ovsrec_ntp_association_col_key_id = { "key_id" };
+struct ovsdb_idl_column ovsrec_ntp_association_col_association_attributes = { "association_attributes" };
+struct ovsdb_idl_column ovsrec_ntp_association_col_association_status = { "association_status" };
+struct ovsdb_idl_column ovsrec_ntp_key_col_key_id = { "key_id" };
+struct ovsdb_idl_column ovsrec_ntp_key_col_key_password = { "key_password" };
+struct ovsdb_idl_column ovsrec_ntp_key_col_trust_enable = { "trust_enable" };
+
+void
+ovsdb_idl_add_table(struct ovsdb_idl *idl_ __attribute__((unused)),
+                    const struct ovsdb_idl_table_class *table __attribute__((unused)))
+{
+}
+
+void
+ovsdb_idl_add_column(struct ovsdb_idl *idl_ __attribute__((unused)),
+                     const struct ovsdb_idl_column *column __attribute__((unused)))
+{
+}
+
+static void
+mock_ovsdb_free_association(struct mock_ntp_association_row *node)
+{
+    free(node->row.address);
+    smap_destroy(&node->row.association_attributes);
+    smap_destroy(&node->row.association_status);
+    free(node);
+}
+
+static void
+mock_ovsdb_free_key(struct mock_ntp_key_row *node)
+{
+    free(node->row.key_password);
+    free(node);
+}
+
+void
+mock_ovsdb_reset(void)
+{
+    struct mock_ntp_association_row *assoc = mock_idl.assocs;
+    struct mock_ntp_key_row *key = mock_idl.keys;
+    struct mock_vrf_row *vrf = mock_idl.vrfs;
+
+    while (assoc) {
+        struct mock_ntp_association_row *next = assoc->next;
+        mock_ovsdb_free_association(assoc);
+        assoc = next;
+    }
+    while (key) {
+        struct mock_ntp_key_row *next = key->next;
+        mock_ovsdb_free_key(key);
+        key = next;
+    }
+    while (vrf) {
+        struct mock_vrf_row *next = vrf->next;
+        free(vrf->row.name);
+        free(vrf);
+        vrf = next;
+    }
+    if (mock_idl.has_system) {
+        smap_destroy(&mock_idl.system.ntp_config);
+        smap_destroy(&mock_idl.system.ntp_status);
+        smap_destroy(&mock_idl.system.ntp_statistics);
+    }
+    memset(&mock_idl, 0, sizeof mock_idl);
+    memset(&mock_ovsdb_stats, 0, sizeof mock_ovsdb_stats);
+
+    mock_idl.has_system = true;
+    mock_idl.vrfs = calloc(1, sizeof *mock_idl.vrfs);
+    mock_idl.vrfs->row.name = strdup(DEFAULT_VRF_NAME);
+}
+
+struct ovsrec_system *
+mock_ovsdb_system(void)
+{
+    return mock_idl.has_system ? &mock_idl.system : NULL;
+}
+
+const struct ovsrec_system *
+ovsrec_system_first(const struct ovsdb_idl *idl_ __attribute__((unused)))
+{
+    return mock_ovsdb_system();
+}
+
+void
+ovsrec_system_set_ntp_config(const struct ovsrec_system *row, const struct smap *config)
+{
+    smap_assign(&((struct ovsrec_system *)row)->ntp_config, config);
+}
+
+const struct ovsrec_vrf *
+ovsrec_vrf_first(const struct ovsdb_idl *idl_ __attribute__((unused)))
+{
+    return mock_idl.vrfs ? &mock_idl.vrfs->row : NULL;
+}
+
+const struct ovsrec_vrf *
+ovsrec_vrf_next(const struct ovsrec_vrf *row)
+{
+    struct mock_vrf_row *next = ((struct mock_vrf_row *)row)->next;
+    return next ? &next->row : NULL;
+}
+
+/* NTP_Key */
+const struct ovsrec_ntp_key *
+ovsrec_ntp_key_first(const struct ovsdb_idl *idl_ __attribute__((unused)))
+{
+    return mock_idl.keys ? &mock_idl.keys->row : NULL;
+}
+
+const struct ovsrec_ntp_key *
+ovsrec_ntp_key_next(const struct ovsrec_ntp_key *row)
+{
+    struct mock_ntp_key_row *next = ((struct mock_ntp_key_row *)row)->next;
+    return next ? &next->row : NULL;
+}
+
+struct ovsrec_ntp_key *
+ovsrec_ntp_key_insert(struct ovsdb_idl_txn *txn __attribute__((unused)))
+{
+    struct mock_ntp_key_row *node = calloc(1, sizeof *node);
+
+    node->row.key_password = strdup("");
+    if (mock_idl.keys_tail) {
+        mock_idl.keys_tail->next = node;
+    } else {
+        mock_idl.keys = node;
+    }
+    mock_idl.keys_tail = node;
+    return &node->row;
+}
+
+void
+ovsrec_ntp_key_delete(const struct ovsrec_ntp_key *row)
+{
+    struct mock_ntp_key_row **pnode = &mock_idl.keys;
+    struct mock_ntp_key_row *prev = NULL;
+    struct mock_ntp_association_row *assoc;
+
+    /* key_id is a weak reference from NTP_Association */
+    for (assoc = mock_idl.assocs; assoc; assoc = assoc->next) {
+        if (assoc->row.key_id == row) {
+            assoc->row.key_id = NULL;
+        }
+    }
+
+    while (*pnode) {
+        if (&(*pnode)->row == row) {
+            struct mock_ntp_key_row *node = *pnode;
+            *pnode = node->next;
+            if (mock_idl.keys_tail == node) {
+                mock_idl.keys_tail = prev;
+            }
+            mock_ovsdb_free_key(node);
+            return;
+        }
+        prev = *pnode;
+        pnode = &(*pnode)->next;
+    }
+}
+
+void
+ovsrec_ntp_key_set_key_id(const struct ovsrec_ntp_key *row, int64_t key_id)
+{
+    ((struct ovsrec_ntp_key *)row)->key_id = key_id;
+}
+
+void
+ovsrec_ntp_key_set_key_password(const struct ovsrec_ntp_key *row, const char *password)
+{
+    struct ovsrec_ntp_key *key = (struct ovsrec_ntp_key *)row;
+    char *old = key->key_password;
+
+    key->key_password = strdup(password ? password : "");
+    free(old);
+}
+
+void
+ovsrec_ntp_key_set_trust_enable(const struct ovsrec_ntp_key *row, bool trust_enable)
+{
+    ((struct ovsrec_ntp_key *)row)->trust_enable = trust_enable;
+}
+
+/* NTP_Association */
+const struct ovsrec_ntp_association *
+ovsrec_ntp_association_first(const struct ovsdb_idl *idl_ __attribute__((unused)))
+{
+    return mock_idl.assocs ? &mock_idl.assocs->row : NULL;
+}
+
+const struct ovsrec_ntp_association *
+ovsrec_ntp_association_next(const struct ovsrec_ntp_association *row)
+{
+    struct mock_ntp_association_row *next = ((struct mock_ntp_association_row *)row)->next;
+    return next ? &next->row : NULL;
+}
+
+struct ovsrec_ntp_association *
+ovsrec_ntp_association_insert(struct ovsdb_idl_txn *txn __attribute__((unused)))
+{
+    struct mock_ntp_association_row *node = calloc(1, sizeof *node);
+
+    node->row.address = strdup("");
+    if (mock_idl.assocs_tail) {
+        mock_idl.assocs_tail->next = node;
+    } else {
+        mock_idl.assocs = node;
+    }
+    mock_idl.assocs_tail = node;
+    return &node->row;
+}
+
+void
+ovsrec_ntp_association_delete(const struct ovsrec_ntp_association *row)
+{
+    struct mock_ntp_association_row **pnode = &mock_idl.assocs;
+    struct mock_ntp_association_row *prev = NULL;
+
+    while (*pnode) {
+        if (&(*pnode)->row == row) {
+            struct mock_ntp_association_row *node = *pnode;
+            *pnode = node->next;
+            if (mock_idl.assocs_tail == node) {
+                mock_idl.assocs_tail = prev;
+            }
+            mock_ovsdb_free_association(node);
+            return;
+        }
+        prev = *pnode;
+        pnode = &(*pnode)->next;
+    }
+}
+
+void
+ovsrec_ntp_association_set_address(const struct ovsrec_ntp_association *row, const char *address)
+{
+    struct ovsrec_ntp_association *assoc = (struct ovsrec_ntp_association *)row;
+    char *old = assoc->address;
+
+    assoc->address = strdup(address);
+    free(old);
+}
+
+void
+ovsrec_ntp_association_set_vrf(const struct ovsrec_ntp_association *row, const struct ovsrec_vrf *vrf)
+{
+    ((struct ovsrec_ntp_association *)row)->vrf = (struct ovsrec_vrf *)vrf;
+}
+
+void
+ovsrec_ntp_association_set_key_id(const struct ovsrec_ntp_association *row, const struct ovsrec_ntp_key *key)
+{
+    ((struct ovsrec_ntp_association *)row)->key_id = (struct ovsrec_ntp_key *)key;
+}
+
+void
+ovsrec_ntp_association_set_association_attributes(const struct ovsrec_ntp_association *row, const struct smap *attributes)
+{
+    smap_assign(&((struct ovsrec_ntp_association *)row)->association_attributes, attributes);
+}
+
+void
+ovsrec_ntp_association_set_association_status(const struct ovsrec_ntp_association *row, const struct smap *status)
+{
+    smap_assign(&((struct ovsrec_ntp_association *)row)->association_status, status);
+}
+
+/* Helpers */
+struct ovsrec_ntp_key *
+mock_ovsdb_add_key(int64_t key_id, const char *password, bool trust_enable)
+{
+    struct ovsrec_ntp_key *row = ovsrec_ntp_key_insert(&mock_txn);
+
+    ovsrec_ntp_key_set_key_id(row, key_id);
+    ovsrec_ntp_key_set_key_password(row, password);
+    ovsrec_ntp_key_set_trust_enable(row, trust_enable);
+    return row;
+}
+
+struct ovsrec_vrf *
+mock_ovsdb_add_vrf(const char *name)
+{
+    struct mock_vrf_row *vrf = calloc(1, sizeof *vrf);
+    struct mock_vrf_row **tail = &mock_idl.vrfs;
+
+    vrf->row.name = strdup(name);
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = vrf;
+    return &vrf->row;
+}
+
+struct ovsrec_ntp_association *
+mock_ovsdb_add_association(const char *address, const struct ovsrec_ntp_key *key)
+{
+    struct ovsrec_ntp_association *row = ovsrec_ntp_association_insert(&mock_txn);
+
+    ovsrec_ntp_association_set_address(row, address);
+    ovsrec_ntp_association_set_vrf(row, ovsrec_vrf_first(idl));
+    ovsrec_ntp_association_set_key_id(row, key);
+    smap_replace(&row->association_attributes, NTP_ASSOC_ATTRIB_VERSION, NTP_ASSOC_ATTRIB_VERSION_DEFAULT);
+    smap_replace(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER, "false");
+    return row;
+}
+
+size_t
+mock_ovsdb_count_associations(void)
+{
+    const struct ovsrec_ntp_association *row;
+    size_t count = 0;
+
+    OVSREC_NTP_ASSOCIATION_FOR_EACH(row, idl) {
+        count++;
+    }
+    return count;
+}
+
+size_t
+mock_ovsdb_count_keys(void)
+{
+    const struct ovsrec_ntp_key *row;
+    size_t count = 0;
+
+    OVSREC_NTP_KEY_FOR_EACH(row, idl) {
+        count++;
+    }
+    return count;
+}
+
+/* Transactions */
+struct ovsdb_idl_txn *
+cli_do_config_start(void)
+{
+    mock_ovsdb_stats.txn_started++;
+    return &mock_txn;
+}
+
+enum ovsdb_idl_txn_status
+cli_do_config_finish(struct ovsdb_idl_txn *txn __attribute__((unused)))
+{
+    mock_ovsdb_stats.txn_committed++;
+    return TXN_SUCCESS;
+}
+
+void
+cli_do_config_abort(struct ovsdb_idl_txn *txn __attribute__((unused)))
+{
+    mock_ovsdb_stats.txn_aborted++;
+}
+
+/*================================================================================================*/
+/* vty */
+
+struct vty {
+    char *buf;
+    size_t len;
+    size_t size;
+};
+
+static struct vty mock_vty;
+struct vty *vty = &mock_vty;
+
+static void
+mock_vty_append(const char *format, va_list args)
+{
+    va_list args_copy;
+    int n;
+
+    va_copy(args_copy, args);
+    n = vsnprintf(mock_vty.buf + mock_vty.len, mock_vty.size - mock_vty.len, format, args_copy);
+    va_end(args_copy);
+    if (n < 0) {
+        return;
+    }
+
+    if (mock_vty.len + n + 1 > mock_vty.size) {
+        size_t size = mock_vty.size ? mock_vty.size : 4096;
+        while (mock_vty.len + n + 1 > size) {
+            size *= 2;
+        }
+        mock_vty.buf = realloc(mock_vty.buf, size);
+        mock_vty.size = size;
+        vsnprintf(mock_vty.buf + mock_vty.len, mock_vty.size - mock_vty.len, format, args);
+    }
+    mock_vty.len += n;
+}
+
+int
+vty_out(struct vty *vty_ __attribute__((unused)), const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    mock_vty_append(format, args);
+    va_end(args);
+    return 0;
+}
+
+const char *
+mock_vty_output(void)
+{
+    return mock_vty.buf ? mock_vty.buf : "";
+}
+
+size_t
+mock_vty_output_len(void)
+{
+    return mock_vty.len;
+}
+
+void
+mock_vty_clear(void)
+{
+    mock_vty.len = 0;
+    if (mock_vty.buf) {
+        mock_vty.buf[0] = '\0';
+    }
+}
+
+void
+install_element(enum node_type node __attribute__((unused)),
+                struct cmd_element *cmd __attribute__((unused)))
+{
+}
+
+int
+mock_vty_run(struct cmd_element *cmd, bool no_form, int argc, const char *argv[])
+{
+    return cmd->func(cmd, vty, no_form ? CMD_FLAG_NO_CMD : 0, argc, argv);
+}
+
+/*================================================================================================*/
+/* vtysh running-config */
+
+vtysh_ret_val
+vtysh_ovsdb_cli_print(vtysh_ovsdb_cbmsg *p_msg __attribute__((unused)), const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    mock_vty_append(format, args);
+    va_end(args);
+    vty_out(vty, "\n");
+    return e_vtysh_ok;
+}
+
+void
+vtysh_ovsdb_config_logmsg(int loglevel __attribute__((unused)),
+                          const char *format __attribute__((unused)), ...)
+{
+}
+
+vtysh_ret_val
+install_show_run_config_subcontext(vtysh_contextid index __attribute__((unused)),
+                                   int subcontext __attribute__((unused)),
+                                   vtysh_context_callback callback __attribute__((unused)),
+                                   void *arg1 __attribute__((unused)),
+                                   void *arg2 __attribute__((unused)))
+{
+    return e_vtysh_ok;
+}
+
+vtysh_ret_val
+mock_vty_show_running_config(vtysh_context_callback callback)
+{
+    vtysh_ovsdb_cbmsg msg;
+
+    memset(&msg, 0, sizeof msg);
+    msg.idl = idl;
+    msg.contextid = e_vtysh_config_context;
+    msg.clientid = e_vtysh_config_context_ntp;
+    return callback(&msg);
+}
@@ -0,0 +1,68 @@
+/* In-memory OVSDB and vty used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * File: mock_ovsdb.h
+ *
+ * Purpose: The rows live in memory and every change is applied at once,
+ *          there is no transaction isolation. The database starts with
+ *          one System row and the default VRF.
+ */
+
+#ifndef MOCK_OVSDB_H
+#define MOCK_OVSDB_H
+
+#include <stddef.h>
+#include "vswitch-idl.h"
+#include "vtysh/vtysh_ovsdb_config.h"
+
+/* Transaction counters */
+struct mock_ovsdb_stats {
+    int txn_started;
+    int txn_committed;
+    int txn_aborted;
+};
+
+extern struct ovsdb_idl *idl;
+extern struct mock_ovsdb_stats mock_ovsdb_stats;
+
+/* Drop all the rows and recreate the System and default VRF rows */
+void mock_ovsdb_reset(void);
+struct ovsrec_system *mock_ovsdb_system(void);
+
+/* Row helpers for populating the database directly */
+struct ovsrec_vrf *mock_ovsdb_add_vrf(const char *name);
+struct ovsrec_ntp_key *mock_ovsdb_add_key(int64_t key_id, const char *password,
+                                          bool trust_enable);
+struct ovsrec_ntp_association *mock_ovsdb_add_association(const char *address,
+                                                          const struct ovsrec_ntp_key *key);
+size_t mock_ovsdb_count_associations(void);
+size_t mock_ovsdb_count_keys(void);
+
+/* Everything written with vty_out() and vtysh_ovsdb_cli_print() */
+const char *mock_vty_output(void);
+size_t mock_vty_output_len(void);
+void mock_vty_clear(void);
+
+/* Run a CLI command handler the way vtysh does */
+int mock_vty_run(struct cmd_element *cmd, bool no_form, int argc, const char *argv[]);
+
+/* Run a running-config callback */
+vtysh_ret_val mock_vty_show_running_config(vtysh_context_callback callback);
+
+#endif /* MOCK_OVSDB_H */
@@ -0,0 +1,88 @@
+/* Mock of the OpenSwitch/OVS header openswitch-idl.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_OPENSWITCH_IDL_H
+#define MOCK_OPENSWITCH_IDL_H
+
+#define DEFAULT_VRF_NAME                              "vrf_default"
+
+#define SYSTEM_NTP_CONFIG_AUTHENTICATION_ENABLE       "authentication_enable"
+#define SYSTEM_NTP_CONFIG_AUTHENTICATION_ENABLED      "enabled"
+#define SYSTEM_NTP_CONFIG_AUTHENTICATION_DISABLED     "disabled"
+
+#define SYSTEM_NTP_STATUS_UPTIME                      "uptime"
+
+#define SYSTEM_NTP_STATS_PKTS_RCVD                    "ntp_pkts_received"
+#define SYSTEM_NTP_STATS_PKTS_CUR_VER                 "ntp_pkts_with_current_version"
+#define SYSTEM_NTP_STATS_PKTS_OLD_VER                 "ntp_pkts_with_older_version"
+#define SYSTEM_NTP_STATS_PKTS_BAD_LEN_OR_FORMAT       "ntp_pkts_with_bad_length_or_format"
+#define SYSTEM_NTP_STATS_PKTS_AUTH_FAILED             "ntp_pkts_with_auth_failed"
+#define SYSTEM_NTP_STATS_PKTS_DECLINED                "ntp_pkts_declined"
+#define SYSTEM_NTP_STATS_PKTS_RESTRICTED              "ntp_pkts_restricted"
+#define SYSTEM_NTP_STATS_PKTS_RATE_LIMITED            "ntp_pkts_rate_limited"
+#define SYSTEM_NTP_STATS_PKTS_KOD_RESPONSES           "ntp_pkts_kod_responses"
+
+#define NTP_ASSOC_MAX_SERVERS                         8
+
+#define NTP_ASSOC_ATTRIB_REF_CLOCK_ID                 "ref_clock_id"
+#define NTP_ASSOC_ATTRIB_PREFER                       "prefer"
+#define NTP_ASSOC_ATTRIB_PREFER_DEFAULT_VAL           false
+#define NTP_ASSOC_ATTRIB_VERSION                      "version"
+#define NTP_ASSOC_ATTRIB_VERSION_3                    "3"
+#define NTP_ASSOC_ATTRIB_VERSION_4                    "4"
+#define NTP_ASSOC_ATTRIB_VERSION_DEFAULT              NTP_ASSOC_ATTRIB_VERSION_3
+
+#define NTP_ASSOC_STATUS_REMOTE_PEER_ADDRESS          "remote_peer_address"
+#define NTP_ASSOC_STATUS_REMOTE_PEER_REF_ID           "remote_peer_ref_id"
+#define NTP_ASSOC_STATUS_STRATUM                      "stratum"
+#define NTP_ASSOC_STATUS_PEER_TYPE                    "peer_type"
+#define NTP_ASSOC_STATUS_LAST_POLLED                  "last_polled"
+#define NTP_ASSOC_STATUS_POLLING_INTERVAL             "polling_interval"
+#define NTP_ASSOC_STATUS_REACHABILITY_REGISTER        "reachability_register"
+#define NTP_ASSOC_STATUS_NETWORK_DELAY                "network_delay"
+#define NTP_ASSOC_STATUS_TIME_OFFSET                  "time_offset"
+#define NTP_ASSOC_STATUS_JITTER                       "jitter"
+#define NTP_ASSOC_STATUS_ROOT_DISPERSION              "root_dispersion"
+#define NTP_ASSOC_STATUS_REFERENCE_TIME               "reference_time"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD             "peer_status_word"
+#define NTP_ASSOC_STATUS_ASSOCID                      "associd"
+
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_REJECT      "reject"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_FALSETICK   "falsetick"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_EXCESS      "excess"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_OUTLIER     "outlier"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_CANDIDATE   "candidate"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_BACKUP      "backup"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_SYSTEMPEER  "system_peer"
+#define NTP_ASSOC_STATUS_PEER_STATUS_WORD_PPSPEER     "pps_peer"
+
+#define NTP_ASSOC_STATUS_PEER_TYPE_UNI_MANY_CAST      "uni_or_many_cast"
+#define NTP_ASSOC_STATUS_PEER_TYPE_B_M_CAST           "bcast_or_mcast_client"
+#define NTP_ASSOC_STATUS_PEER_TYPE_LOCAL_REF_CLOCK    "local_ref_clock"
+#define NTP_ASSOC_STATUS_PEER_TYPE_SYMM_PEER          "symm_peer"
+#define NTP_ASSOC_STATUS_PEER_TYPE_MANYCAST           "manycast_server"
+#define NTP_ASSOC_STATUS_PEER_TYPE_BROADCAST          "bcast_server"
+#define NTP_ASSOC_STATUS_PEER_TYPE_MULTICAST          "mcast_server"
+
+#define NTP_KEY_KEY_ID_MIN                            1
+#define NTP_KEY_KEY_ID_MAX                            65534
+#define NTP_KEY_KEY_PASSWORD_LEN_MIN                  8
+#define NTP_KEY_KEY_PASSWORD_LEN_MAX                  16
+#endif
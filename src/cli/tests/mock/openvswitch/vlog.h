@@ -0,0 +1,35 @@
+/* Mock of the OpenSwitch/OVS header openvswitch/vlog.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_OPENVSWITCH_VLOG_H
+#define MOCK_OPENVSWITCH_VLOG_H
+#define VLOG_DEFINE_THIS_MODULE(MODULE) \
+    static const char *vlog_module_name __attribute__((unused)) = #MODULE
+
+static inline void __attribute__((format(printf, 1, 2)))
+mock_vlog(const char *format __attribute__((unused)), ...)
+{
+}
+
+#define VLOG_DBG(...) mock_vlog(__VA_ARGS__)
+#define VLOG_INFO(...) mock_vlog(__VA_ARGS__)
+#define VLOG_WARN(...) mock_vlog(__VA_ARGS__)
+#define VLOG_ERR(...) mock_vlog(__VA_ARGS__)
+#endif
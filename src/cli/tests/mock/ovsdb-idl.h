@@ -0,0 +1,43 @@
+/* Mock of the OpenSwitch/OVS header ovsdb-idl.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_OVSDB_IDL_H
+#define MOCK_OVSDB_IDL_H
+#include <stdbool.h>
+
+struct ovsdb_idl;
+struct ovsdb_idl_txn;
+struct ovsdb_idl_table_class { const char *name; };
+struct ovsdb_idl_column { const char *name; };
+
+enum ovsdb_idl_txn_status {
+    TXN_UNCOMMITTED,
+    TXN_UNCHANGED,
+    TXN_INCOMPLETE,
+    TXN_ABORTED,
+    TXN_SUCCESS,
+    TXN_TRY_AGAIN,
+    TXN_NOT_LOCKED,
+    TXN_ERROR
+};
+
+void ovsdb_idl_add_table(struct ovsdb_idl *, const struct ovsdb_idl_table_class *);
+void ovsdb_idl_add_column(struct ovsdb_idl *, const struct ovsdb_idl_column *);
+#endif
@@ -0,0 +1,48 @@
+/* Mock of the OpenSwitch/OVS header smap.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_SMAP_H
+#define MOCK_SMAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct smap_node {
+    char *key;
+    char *value;
+    struct smap_node *next;
+};
+
+struct smap {
+    struct smap_node *head;
+};
+
+#define SMAP_INITIALIZER(SMAP) { NULL }
+
+void smap_init(struct smap *);
+void smap_destroy(struct smap *);
+void smap_clone(struct smap *dst, const struct smap *src);
+void smap_add(struct smap *, const char *, const char *);
+void smap_replace(struct smap *, const char *, const char *);
+bool smap_remove(struct smap *, const char *);
+const char *smap_get(const struct smap *, const char *);
+bool smap_get_bool(const struct smap *, const char *, bool def);
+int smap_get_int(const struct smap *, const char *, int def);
+size_t smap_count(const struct smap *);
+#endif
@@ -0,0 +1,101 @@
+/* Mock of the OpenSwitch/OVS header vswitch-idl.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_VSWITCH_IDL_H
+#define MOCK_VSWITCH_IDL_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "ovsdb-idl.h"
+#include "smap.h"
+
+struct ovsrec_vrf {
+    char *name;
+};
+
+struct ovsrec_ntp_key {
+    int64_t key_id;
+    char *key_password;
+    bool trust_enable;
+};
+
+struct ovsrec_ntp_association {
+    char *address;
+    struct ovsrec_vrf *vrf;
+    struct ovsrec_ntp_key *key_id;
+    struct smap association_attributes;
+    struct smap association_status;
+};
+
+struct ovsrec_system {
+    struct smap ntp_config;
+    struct smap ntp_status;
+    struct smap ntp_statistics;
+};
+
+extern struct ovsdb_idl_table_class ovsrec_table_system;
+extern struct ovsdb_idl_table_class ovsrec_table_vrf;
+extern struct ovsdb_idl_table_class ovsrec_table_ntp_association;
+extern struct ovsdb_idl_table_class ovsrec_table_ntp_key;
+
+extern struct ovsdb_idl_column ovsrec_system_col_ntp_config;
+extern struct ovsdb_idl_column ovsrec_system_col_ntp_status;
+extern struct ovsdb_idl_column ovsrec_system_col_ntp_statistics;
+extern struct ovsdb_idl_column ovsrec_vrf_col_name;
+extern struct ovsdb_idl_column ovsrec_ntp_association_col_address;
+extern struct ovsdb_idl_column ovsrec_ntp_association_col_vrf;
+extern struct ovsdb_idl_column ovsrec_ntp_association_col_key_id;
+extern struct ovsdb_idl_column ovsrec_ntp_association_col_association_attributes;
+extern struct ovsdb_idl_column ovsrec_ntp_association_col_association_status;
+extern struct ovsdb_idl_column ovsrec_ntp_key_col_key_id;
+extern struct ovsdb_idl_column ovsrec_ntp_key_col_key_password;
+extern struct ovsdb_idl_column ovsrec_ntp_key_col_trust_enable;
+
+const struct ovsrec_system *ovsrec_system_first(const struct ovsdb_idl *);
+void ovsrec_system_set_ntp_config(const struct ovsrec_system *, const struct smap *);
+
+const struct ovsrec_vrf *ovsrec_vrf_first(const struct ovsdb_idl *);
+const struct ovsrec_vrf *ovsrec_vrf_next(const struct ovsrec_vrf *);
+#define OVSREC_VRF_FOR_EACH(ROW, IDL) \
+    for ((ROW) = ovsrec_vrf_first(IDL); (ROW); (ROW) = ovsrec_vrf_next(ROW))
+
+const struct ovsrec_ntp_key *ovsrec_ntp_key_first(const struct ovsdb_idl *);
+const struct ovsrec_ntp_key *ovsrec_ntp_key_next(const struct ovsrec_ntp_key *);
+#define OVSREC_NTP_KEY_FOR_EACH(ROW, IDL) \
+    for ((ROW) = ovsrec_ntp_key_first(IDL); (ROW); (ROW) = ovsrec_ntp_key_next(ROW))
+struct ovsrec_ntp_key *ovsrec_ntp_key_insert(struct ovsdb_idl_txn *);
+void ovsrec_ntp_key_delete(const struct ovsrec_ntp_key *);
+void ovsrec_ntp_key_set_key_id(const struct ovsrec_ntp_key *, int64_t);
+void ovsrec_ntp_key_set_key_password(const struct ovsrec_ntp_key *, const char *);
+void ovsrec_ntp_key_set_trust_enable(const struct ovsrec_ntp_key *, bool);
+
+const struct ovsrec_ntp_association *ovsrec_ntp_association_first(const struct ovsdb_idl *);
+const struct ovsrec_ntp_association *ovsrec_ntp_association_next(const struct ovsrec_ntp_association *);
+#define OVSREC_NTP_ASSOCIATION_FOR_EACH(ROW, IDL) \
+    for ((ROW) = ovsrec_ntp_association_first(IDL); (ROW); \
+         (ROW) = ovsrec_ntp_association_next(ROW))
+struct ovsrec_ntp_association *ovsrec_ntp_association_insert(struct ovsdb_idl_txn *);
+void ovsrec_ntp_association_delete(const struct ovsrec_ntp_association *);
+void ovsrec_ntp_association_set_address(const struct ovsrec_ntp_association *, const char *);
+void ovsrec_ntp_association_set_vrf(const struct ovsrec_ntp_association *, const struct ovsrec_vrf *);
+void ovsrec_ntp_association_set_key_id(const struct ovsrec_ntp_association *, const struct ovsrec_ntp_key *);
+void ovsrec_ntp_association_set_association_attributes(const struct ovsrec_ntp_association *, const struct smap *);
+void ovsrec_ntp_association_set_association_status(const struct ovsrec_ntp_association *, const struct smap *);
+#endif
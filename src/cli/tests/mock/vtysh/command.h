@@ -0,0 +1,71 @@
+/* Mock of the OpenSwitch/OVS header vtysh/command.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_VTYSH_COMMAND_H
+#define MOCK_VTYSH_COMMAND_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define CMD_SUCCESS              0
+#define CMD_WARNING              1
+#define CMD_ERR_NO_MATCH         2
+#define CMD_ERR_AMBIGUOUS        3
+#define CMD_ERR_INCOMPLETE       4
+#define CMD_ERR_EXEED_ARGC_MAX   5
+#define CMD_ERR_NOTHING_TODO     6
+#define CMD_OVSDB_FAILURE        12
+
+#define CMD_FLAG_NO_CMD          (1 << 0)
+
+#define VTY_NEWLINE "\n"
+#define SHOW_STR "Show running system information\n"
+#define NO_STR "Negate a command or set its defaults\n"
+
+enum node_type { VIEW_NODE, ENABLE_NODE, CONFIG_NODE };
+
+struct vty;
+struct cmd_element {
+    const char *string;
+    int (*func)(struct cmd_element *, struct vty *, int, int, const char *[]);
+    const char *doc;
+};
+
+extern struct vty *vty;
+extern int vty_out(struct vty *, const char *, ...) __attribute__((format(printf, 2, 3)));
+extern void install_element(enum node_type, struct cmd_element *);
+
+#define DEFUN(funcname, cmdname, cmdstr, helpstr)                         \
+    static int funcname(struct cmd_element *, struct vty *, int, int,      \
+                        const char *[]);                                   \
+    struct cmd_element cmdname = { cmdstr, funcname, helpstr };            \
+    static int funcname(struct cmd_element *self __attribute__((unused)),  \
+                        struct vty *vty __attribute__((unused)),           \
+                        int vty_flags __attribute__((unused)),             \
+                        int argc __attribute__((unused)),                  \
+                        const char *argv[] __attribute__((unused)))
+
+#define DEFUN_NO_FORM(funcname, cmdname, cmdstr, helpstr)                 \
+    struct cmd_element no_##cmdname = { "no " cmdstr, funcname, NO_STR helpstr }
+
+#endif
@@ -0,0 +1,26 @@
+/* Mock of the OpenSwitch/OVS header vtysh/vtysh.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_VTYSH_VTYSH_H
+#define MOCK_VTYSH_VTYSH_H
+#include "vtysh/command.h"
+#define IS_VALID_IPV4(i) \
+    (!(((i) >= 0x7f000000 && (i) <= 0x7fffffff) || ((i) >= 0xe0000000)))
+#endif
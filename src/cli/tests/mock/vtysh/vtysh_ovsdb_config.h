@@ -0,0 +1,60 @@
+/* Mock of the OpenSwitch/OVS header vtysh/vtysh_ovsdb_config.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_VTYSH_OVSDB_CONFIG_H
+#define MOCK_VTYSH_OVSDB_CONFIG_H
+#include <stdbool.h>
+
+typedef enum vtysh_ret_val_enum {
+    e_vtysh_error = -1,
+    e_vtysh_ok = 0
+} vtysh_ret_val;
+
+typedef enum vtysh_contextid_enum {
+    e_vtysh_config_context = 0,
+    e_vtysh_config_context_ntp
+} vtysh_contextid;
+
+typedef enum vtysh_ovsdb_config_loglevel {
+    VTYSH_OVSDB_CONFIG_ERR,
+    VTYSH_OVSDB_CONFIG_WARN,
+    VTYSH_OVSDB_CONFIG_INFO,
+    VTYSH_OVSDB_CONFIG_DBG
+} vtysh_ovsdb_config_loglevel;
+
+typedef struct vtysh_ovsdb_cbmsg_struct {
+    const struct ovsdb_idl *idl;
+    int contextid;
+    int clientid;
+    void *feature_row;
+    bool disp_header_cfg;
+    bool skip_subcontext_list;
+} vtysh_ovsdb_cbmsg;
+typedef vtysh_ovsdb_cbmsg *vtysh_ovsdb_cbmsg_ptr;
+
+typedef vtysh_ret_val (*vtysh_context_callback)(void *);
+
+vtysh_ret_val vtysh_ovsdb_cli_print(vtysh_ovsdb_cbmsg *, const char *, ...);
+void vtysh_ovsdb_config_logmsg(int, const char *, ...)
+    __attribute__((format(printf, 2, 3)));
+vtysh_ret_val install_show_run_config_subcontext(vtysh_contextid, int,
+                                                 vtysh_context_callback,
+                                                 void *, void *);
+#endif
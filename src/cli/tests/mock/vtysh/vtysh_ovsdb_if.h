@@ -0,0 +1,27 @@
+/* Mock of the OpenSwitch/OVS header vtysh/vtysh_ovsdb_if.h used by the ntpd_cli tests.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#ifndef MOCK_VTYSH_OVSDB_IF_H
+#define MOCK_VTYSH_OVSDB_IF_H
+#include "ovsdb-idl.h"
+struct ovsdb_idl_txn *cli_do_config_start(void);
+enum ovsdb_idl_txn_status cli_do_config_finish(struct ovsdb_idl_txn *);
+void cli_do_config_abort(struct ovsdb_idl_txn *);
+#endif
@@ -0,0 +1,771 @@
+/* Unit tests for the NTP CLI commands.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation; either version 2, or (at your option) any
+ * later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ * File: test_ntp_vty.c
+ *
+ * Purpose: The CLI sources are included so the static validators and
+ *          handlers can be called directly. The IDL is the in-memory mock.
+ */
+
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../ntp_vty.c"
+#include "mock_ovsdb.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                \
+                    __FILE__, __LINE__, #cond);                         \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+#define CHECK_OUTPUT(str)                                               \
+    do {                                                                \
+        if (!strstr(mock_vty_output(), (str))) {                        \
+            fprintf(stderr, "%s:%d: \"%s\" not found in output:\n%s\n", \
+                    __FILE__, __LINE__, (str), mock_vty_output());      \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+static int
+run_ntp_server(bool no_form, const char *name, const char *prefer,
+               const char *version, const char *keyid)
+{
+    const char *argv[] = { name, prefer, version, keyid };
+    return mock_vty_run(no_form ? &no_vtysh_set_ntp_server_cmd : &vtysh_set_ntp_server_cmd,
+                        no_form, 4, argv);
+}
+
+static int
+run_ntp_server_vrf(bool no_form, const char *name, const char *vrf)
+{
+    const char *argv[] = { name, NULL, NULL, NULL, vrf };
+    const char *no_argv[] = { name, vrf };
+    return no_form ? mock_vty_run(&no_vtysh_set_ntp_server_cmd, true, 2, no_argv)
+                   : mock_vty_run(&vtysh_set_ntp_server_cmd, false, 5, argv);
+}
+
+static int
+run_ntp_server_nts(const char *name, const char *version, const char *keyid)
+{
+    const char *argv[] = { name, NULL, version, keyid, NULL, "nts" };
+    return mock_vty_run(&vtysh_set_ntp_server_cmd, false, 6, argv);
+}
+
+static int
+run_ntp_refclock(bool no_form, const char *type, const char *unit, const char *prefer, const char *refid)
+{
+    const char *argv[] = { type, unit, prefer, refid };
+    return no_form ? mock_vty_run(&no_vtysh_set_ntp_refclock_cmd, true, 2, argv)
+                   : mock_vty_run(&vtysh_set_ntp_refclock_cmd, false, 4, argv);
+}
+
+static int
+run_ntp_refclock_feed(const char *unit, const char *source, const char *path, const char *prefer, const char *refid)
+{
+    const char *argv[] = { unit, source, path, prefer, refid };
+    return mock_vty_run(&vtysh_set_ntp_refclock_feed_cmd, false, 5, argv);
+}
+
+static int
+run_ntp_auth_key(bool no_form, const char *key, const char *algorithm, const char *password)
+{
+    const char *argv[] = { key, algorithm, password };
+    return mock_vty_run(no_form ? &no_vtysh_set_ntp_authentication_key_cmd : &vtysh_set_ntp_authentication_key_cmd,
+                        no_form, 3, argv);
+}
+
+static int
+run_ntp_trusted_key(bool no_form, const char *key)
+{
+    const char *argv[] = { key };
+    return mock_vty_run(no_form ? &no_vtysh_set_ntp_trusted_key_cmd : &vtysh_set_ntp_trusted_key_cmd,
+                        no_form, 1, argv);
+}
+
+static void
+test_is_valid_ipv4_address(void)
+{
+    CHECK(ntp_internal_is_valid_ipv4_address("10.1.1.1"));
+    CHECK(ntp_internal_is_valid_ipv4_address("192.168.0.254"));
+    CHECK(!ntp_internal_is_valid_ipv4_address("0.1.2.3"));
+    CHECK(!ntp_internal_is_valid_ipv4_address("127.0.0.1"));
+    CHECK(!ntp_internal_is_valid_ipv4_address("224.0.0.1"));
+    CHECK(!ntp_internal_is_valid_ipv4_address("255.255.255.255"));
+    CHECK(!ntp_internal_is_valid_ipv4_address("256.1.1.1"));
+    CHECK(!ntp_internal_is_valid_ipv4_address("1.2.3"));
+    CHECK(!ntp_internal_is_valid_ipv4_address(""));
+}
+
+static void
+test_is_valid_server_name(void)
+{
+    CHECK(!ntp_internal_is_valid_server_name(NULL));
+    CHECK(ntp_internal_is_valid_server_name("pool.ntp.org"));
+    CHECK(ntp_internal_is_valid_server_name("ntp-1"));
+    CHECK(ntp_internal_is_valid_server_name("10.1.1.1"));
+    CHECK(!ntp_internal_is_valid_server_name("10.1.1"));
+    CHECK(!ntp_internal_is_valid_server_name("1.2.3.4.5"));
+    CHECK(!ntp_internal_is_valid_server_name("127.0.0.1"));
+}
+
+static void
+test_sanitize_auth_key(void)
+{
+    const struct ovsrec_ntp_key *row = NULL;
+    char pwd_short[] = "1234567";
+    char pwd_min[] = "12345678";
+    char pwd_max[] = "1234567890123456";
+    char pwd_long[] = "12345678901234567";
+    char sha1_key[] = "0123456789abcdef0123456789ABCDEF01234567";
+    char sha256_key[] = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+    char aes_key[] = "0123456789abcdef0123456789abcdef";
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("0", NULL, NULL, NULL));
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("65535", NULL, NULL, NULL));
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("-1", NULL, NULL, NULL));
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, NULL, NULL));
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("65534", NULL, NULL, NULL));
+    CHECK_OUTPUT("KeyID should lie between [1-65534]");
+
+    CHECK(CMD_OVSDB_FAILURE == ntp_sanitize_auth_key("5", &row, NULL, NULL));
+    CHECK(NULL == row);
+    mock_ovsdb_add_key(5, "password", false);
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("5", &row, NULL, NULL));
+    CHECK(row && (5 == row->key_id));
+
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("1", NULL, NULL, pwd_short));
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, NULL, pwd_min));
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, NULL, pwd_max));
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("1", NULL, NULL, pwd_long));
+    CHECK_OUTPUT("Password length should be between 8 & 16 chars");
+
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, "md5", pwd_min));
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("1", NULL, "md5", "sha1:1234"));
+    CHECK_OUTPUT("MD5 password should not start with \"sha1:\"");
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, "sha1", sha1_key));
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, "sha256", sha256_key));
+    CHECK(CMD_SUCCESS == ntp_sanitize_auth_key("1", NULL, "aes128cmac", aes_key));
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("1", NULL, "sha256", sha1_key));
+    CHECK_OUTPUT("sha256 key should be 64 hexadecimal digits");
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("1", NULL, "aes128cmac", "0123456789abcdef0123456789abcdeg"));
+    CHECK(CMD_ERR_NOTHING_TODO == ntp_sanitize_auth_key("1", NULL, "sha512", sha256_key));
+    CHECK_OUTPUT("Unknown key algorithm sha512");
+}
+
+static void
+test_ntp_server(void)
+{
+    const struct ovsrec_ntp_association *row = NULL;
+    char name[32];
+    int i;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+
+    CHECK(CMD_SUCCESS == run_ntp_server(false, "10.1.1.1", NULL, NULL, NULL));
+    CHECK(1 == mock_ovsdb_count_associations());
+    row = ovsrec_ntp_association_first(idl);
+    CHECK(0 == strcmp(row->address, "10.1.1.1"));
+    CHECK(0 == strcmp(row->vrf->name, DEFAULT_VRF_NAME));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_VERSION), "3"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER), "false"));
+    CHECK(0 == strcmp(smap_get(&row->association_status, NTP_ASSOC_STATUS_ASSOCID), NTP_DEFAULT_STR));
+
+    /* Reconfiguring an existing server updates it in place */
+    CHECK(CMD_SUCCESS == run_ntp_server(false, "10.1.1.1", "prefer", "4", NULL));
+    CHECK(1 == mock_ovsdb_count_associations());
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_VERSION), "4"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER), "true"));
+
+    /* Key must exist */
+    CHECK(CMD_OVSDB_FAILURE == run_ntp_server(false, "10.1.1.1", NULL, NULL, "7"));
+    mock_ovsdb_add_key(7, "password", true);
+    CHECK(CMD_SUCCESS == run_ntp_server(false, "10.1.1.1", NULL, NULL, "7"));
+    CHECK(row->key_id && (7 == row->key_id->key_id));
+
+    /* Invalid parameters */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server(false, "127.0.0.1", NULL, NULL, NULL));
+    CHECK_OUTPUT("Invalid IP address");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server(false, "10.1.1.2", NULL, "5", NULL));
+    CHECK_OUTPUT("NTP version should lie between [3-4]");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server(false, "10.1.1.2", NULL, "4abc", NULL));
+    CHECK(CMD_ERR_NOTHING_TODO ==
+          run_ntp_server(false, "a123456789012345678901234567890123456789012345678901234567", NULL, NULL, NULL));
+    CHECK(1 == mock_ovsdb_count_associations());
+
+    /* Server limit */
+    for (i = 2; i <= NTP_ASSOC_MAX_SERVERS; i++) {
+        snprintf(name, sizeof(name), "10.1.1.%d", i);
+        CHECK(CMD_SUCCESS == run_ntp_server(false, name, NULL, NULL, NULL));
+    }
+    CHECK(NTP_ASSOC_MAX_SERVERS == mock_ovsdb_count_associations());
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server(false, "10.1.2.1", NULL, NULL, NULL));
+    CHECK_OUTPUT("Maximum number of configurable NTP server limit has been reached");
+    CHECK(NTP_ASSOC_MAX_SERVERS == mock_ovsdb_count_associations());
+
+    /* No form */
+    CHECK(CMD_SUCCESS == run_ntp_server(true, "10.1.1.2", NULL, NULL, NULL));
+    CHECK(NTP_ASSOC_MAX_SERVERS - 1 == mock_ovsdb_count_associations());
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == run_ntp_server(true, "10.1.1.2", NULL, NULL, NULL));
+    CHECK_OUTPUT("This server does not exist");
+}
+
+static int
+run_ntp_servers(bool no_form, const char *line)
+{
+    const char *argv[16];
+    char buf[256];
+    char *saveptr = NULL;
+    char *token = NULL;
+    int argc = 0;
+
+    snprintf(buf, sizeof(buf), "%s", line);
+    for (token = strtok_r(buf, " ", &saveptr); token; token = strtok_r(NULL, " ", &saveptr)) {
+        argv[argc++] = token;
+    }
+    return mock_vty_run(no_form ? &no_vtysh_set_ntp_servers_cmd : &vtysh_set_ntp_servers_cmd,
+                        no_form, argc, argv);
+}
+
+static void
+test_ntp_servers(void)
+{
+    const struct ovsrec_ntp_association *row = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+    mock_ovsdb_add_key(5, "password", false);
+
+    /* The whole list is applied in one transaction */
+    CHECK(CMD_SUCCESS == run_ntp_servers(false, "10.1.1.1 prefer 10.1.1.2 version 4 key-id 5 pool.ntp.org"));
+    CHECK(3 == mock_ovsdb_count_associations());
+    CHECK(1 == mock_ovsdb_stats.txn_committed);
+    row = ovsrec_ntp_association_first(idl);
+    CHECK(0 == strcmp(row->address, "10.1.1.1"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER), "true"));
+    row = ovsrec_ntp_association_next(row);
+    CHECK(0 == strcmp(row->address, "10.1.1.2"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_VERSION), "4"));
+    CHECK(row->key_id && (5 == row->key_id->key_id));
+    row = ovsrec_ntp_association_next(row);
+    CHECK(0 == strcmp(row->address, "pool.ntp.org"));
+
+    /* One invalid entry rejects the whole list */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(false, "10.1.1.3 127.0.0.1"));
+    CHECK_OUTPUT("No server configured, 127.0.0.1 was rejected");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(false, "10.1.1.3 version 5"));
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(false, "prefer 10.1.1.3"));
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(false, "10.1.1.3 key-id"));
+    CHECK_OUTPUT("Invalid server list");
+    CHECK(3 == mock_ovsdb_count_associations());
+
+    /* The server limit applies to the list as a whole */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(false, "10.1.2.1 10.1.2.2 10.1.2.3 10.1.2.4 10.1.2.5 10.1.2.6"));
+    CHECK_OUTPUT("Maximum number of configurable NTP server limit has been reached");
+    CHECK(1 == mock_ovsdb_stats.txn_aborted);
+    CHECK(CMD_SUCCESS == run_ntp_servers(false, "10.1.2.1 10.1.2.2 10.1.2.3 10.1.2.4 10.1.2.5"));
+    CHECK(NTP_ASSOC_MAX_SERVERS == mock_ovsdb_count_associations());
+
+    /* No form */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(true, "10.1.1.1 prefer"));
+    CHECK(CMD_SUCCESS == run_ntp_servers(true, "10.1.1.1 10.1.1.2 pool.ntp.org"));
+    CHECK(NTP_ASSOC_MAX_SERVERS - 3 == mock_ovsdb_count_associations());
+    CHECK(3 == mock_ovsdb_stats.txn_committed);
+}
+
+static void
+test_ntp_server_vrf(void)
+{
+    const struct ovsrec_ntp_association *row = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+    mock_ovsdb_add_vrf("red");
+
+    /* The same server can be configured in several VRFs */
+    CHECK(CMD_SUCCESS == run_ntp_server(false, "10.1.1.1", NULL, NULL, NULL));
+    CHECK(CMD_SUCCESS == run_ntp_server_vrf(false, "10.1.1.1", "red"));
+    CHECK(2 == mock_ovsdb_count_associations());
+    row = ovsrec_ntp_association_first(idl);
+    CHECK(0 == strcmp(row->vrf->name, DEFAULT_VRF_NAME));
+    row = ovsrec_ntp_association_next(row);
+    CHECK(0 == strcmp(row->vrf->name, "red"));
+
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server_vrf(false, "10.1.1.2", "blue"));
+    CHECK_OUTPUT("VRF blue does not exist");
+    CHECK(2 == mock_ovsdb_count_associations());
+
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK_OUTPUT("ntp server 10.1.1.1\n");
+    CHECK_OUTPUT("ntp server 10.1.1.1 vrf red\n");
+
+    /* The no form only removes the server of the given VRF */
+    CHECK(CMD_SUCCESS == run_ntp_server_vrf(true, "10.1.1.1", "red"));
+    CHECK(1 == mock_ovsdb_count_associations());
+    row = ovsrec_ntp_association_first(idl);
+    CHECK(0 == strcmp(row->vrf->name, DEFAULT_VRF_NAME));
+    CHECK(CMD_SUCCESS == run_ntp_server_vrf(true, "10.1.1.1", NULL));
+    CHECK(0 == mock_ovsdb_count_associations());
+}
+
+static void
+test_ntp_server_nts(void)
+{
+    const struct ovsrec_ntp_association *row = NULL;
+    const struct smap *config = NULL;
+    const char *certs_argv[] = { "/etc/ntp/nts-ca.pem" };
+    const char *relative_argv[] = { "nts-ca.pem" };
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+    mock_ovsdb_add_key(7, "password", true);
+    config = &mock_ovsdb_system()->ntp_config;
+
+    /* NTS implies NTPv4 */
+    CHECK(CMD_SUCCESS == run_ntp_server_nts("10.1.1.1", NULL, NULL));
+    row = ovsrec_ntp_association_first(idl);
+    CHECK(smap_get_bool(&row->association_attributes, NTP_ASSOC_ATTRIB_NTS, false));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_VERSION), "4"));
+
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server_nts("10.1.1.2", "3", NULL));
+    CHECK_OUTPUT("NTS needs NTP version 4");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server_nts("10.1.1.2", NULL, "7"));
+    CHECK_OUTPUT("NTS and key-id can not be used together");
+    CHECK(1 == mock_ovsdb_count_associations());
+
+    /* A key replaces NTS, and NTS replaces the key */
+    CHECK(CMD_SUCCESS == run_ntp_server(false, "10.1.1.1", NULL, NULL, "7"));
+    CHECK(row->key_id && (7 == row->key_id->key_id));
+    CHECK(NULL == smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_NTS));
+    CHECK(CMD_SUCCESS == run_ntp_server_nts("10.1.1.1", "4", NULL));
+    CHECK(NULL == row->key_id);
+    CHECK(smap_get_bool(&row->association_attributes, NTP_ASSOC_ATTRIB_NTS, false));
+
+    CHECK(CMD_SUCCESS == run_ntp_servers(false, "10.1.1.2 nts 10.1.1.3 key-id 7"));
+    CHECK(3 == mock_ovsdb_count_associations());
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(false, "10.1.1.4 key-id 7 nts"));
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_servers(true, "10.1.1.2 nts"));
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_set_ntp_nts_trusted_certs_cmd, false, 1, certs_argv));
+    CHECK(0 == strcmp(smap_get(config, SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS), "/etc/ntp/nts-ca.pem"));
+    CHECK(CMD_ERR_NOTHING_TODO == mock_vty_run(&vtysh_set_ntp_nts_trusted_certs_cmd, false, 1, relative_argv));
+    CHECK_OUTPUT("Certificates path should be an absolute path");
+
+    smap_replace((struct smap *)&row->association_status, NTP_ASSOC_STATUS_NTS_COOKIES, "8");
+    smap_replace((struct smap *)&row->association_status, NTP_ASSOC_STATUS_NTS_KE_COUNT, "2");
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_nts_cmd, false, 0, NULL));
+    CHECK_OUTPUT("Trusted certificates: /etc/ntp/nts-ca.pem");
+    CHECK_OUTPUT("10.1.1.1        8         2                 0");
+    CHECK(!strstr(mock_vty_output(), "10.1.1.3"));
+
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_associations_cmd, false, 0, NULL));
+    CHECK_OUTPUT("    4    nts");
+
+    mock_vty_clear();
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK_OUTPUT("ntp server 10.1.1.1 nts version 4\n");
+    CHECK_OUTPUT("ntp nts trusted-certificates /etc/ntp/nts-ca.pem\n");
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&no_vtysh_set_ntp_nts_trusted_certs_cmd, true, 0, NULL));
+    CHECK(NULL == smap_get(config, SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS));
+}
+
+static void
+test_ntp_refclock(void)
+{
+    const struct ovsrec_ntp_association *row = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+
+    /* Reference clocks are associations on the ntpd pseudo addresses */
+    CHECK(CMD_SUCCESS == run_ntp_refclock(false, "pps", "0", NULL, NULL));
+    CHECK(CMD_SUCCESS == run_ntp_refclock(false, "shm", "2", "prefer", "GPS"));
+    CHECK(2 == mock_ovsdb_count_associations());
+    row = ovsrec_ntp_association_first(idl);
+    CHECK(0 == strcmp(row->address, "127.127.22.0"));
+    CHECK(0 == strcmp(row->vrf->name, DEFAULT_VRF_NAME));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_REF_CLOCK_ID), "PPS"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER), "false"));
+    row = ovsrec_ntp_association_next(row);
+    CHECK(0 == strcmp(row->address, "127.127.28.2"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_REF_CLOCK_ID), "GPS"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER), "true"));
+
+    mock_vty_clear();
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK(0 == strcmp(mock_vty_output(),
+                      "ntp refclock pps 0\n"
+                      "ntp refclock shm 2 refid GPS prefer\n"));
+
+    /* The pseudo addresses are not valid servers */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_server(false, "127.127.28.2", NULL, NULL, NULL));
+
+    /* Invalid reference clock identifiers */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_refclock(false, "shm", "1", NULL, "GNSS1"));
+    CHECK_OUTPUT("Reference clock identifier should be 1 to 4 letters or digits");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_refclock(false, "shm", "1", NULL, "G.S"));
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_refclock(false, "shm", "1", NULL, "G\xe9S"));
+    CHECK(2 == mock_ovsdb_count_associations());
+
+    /* No form */
+    CHECK(CMD_SUCCESS == run_ntp_refclock(true, "shm", "2", NULL, NULL));
+    CHECK(1 == mock_ovsdb_count_associations());
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == run_ntp_refclock(true, "shm", "2", NULL, NULL));
+    CHECK_OUTPUT("This server does not exist");
+
+    /* SHM reference clocks fed by ops-ntpd from a local time source */
+    CHECK(CMD_SUCCESS == run_ntp_refclock_feed("3", "phc", "/dev/ptp0", NULL, "PTP"));
+    CHECK(CMD_SUCCESS == run_ntp_refclock_feed("2", "socket", "/var/run/gnss.sock", "prefer", NULL));
+    CHECK(3 == mock_ovsdb_count_associations());
+    row = ovsrec_ntp_association_next(ovsrec_ntp_association_first(idl));
+    CHECK(0 == strcmp(row->address, "127.127.28.3"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_REFCLOCK_ATTRIB_FEED), "phc:/dev/ptp0"));
+    CHECK(0 == strcmp(smap_get(&row->association_attributes, NTP_ASSOC_ATTRIB_REF_CLOCK_ID), "PTP"));
+
+    mock_vty_clear();
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK(0 == strcmp(mock_vty_output(),
+                      "ntp refclock pps 0\n"
+                      "ntp refclock shm 3 feed phc /dev/ptp0 refid PTP\n"
+                      "ntp refclock shm 2 feed socket /var/run/gnss.sock prefer\n"));
+
+    /* Reconfigured without a feed, the reference clock is no longer fed */
+    CHECK(CMD_SUCCESS == run_ntp_refclock(false, "shm", "2", NULL, NULL));
+    row = ovsrec_ntp_association_next(row);
+    CHECK(0 == strcmp(row->address, "127.127.28.2"));
+    CHECK(NULL == smap_get(&row->association_attributes, NTP_REFCLOCK_ATTRIB_FEED));
+    mock_vty_clear();
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK(0 == strcmp(mock_vty_output(),
+                      "ntp refclock pps 0\n"
+                      "ntp refclock shm 3 feed phc /dev/ptp0 refid PTP\n"
+                      "ntp refclock shm 2 prefer\n"));
+
+    /* Invalid feed paths */
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_refclock_feed("1", "phc", "ptp0", NULL, NULL));
+    CHECK_OUTPUT("Feed path should be an absolute path of at most 64 characters");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_refclock_feed("1", "socket",
+          "/var/run/a-socket-path-which-is-much-longer-than-the-allowed-length", NULL, NULL));
+    CHECK(3 == mock_ovsdb_count_associations());
+
+    /* The no form removes a fed reference clock like any other */
+    CHECK(CMD_SUCCESS == run_ntp_refclock(true, "shm", "3", NULL, NULL));
+    CHECK(2 == mock_ovsdb_count_associations());
+}
+
+static void
+test_ntp_keys(void)
+{
+    const struct ovsrec_ntp_key *row = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+
+    CHECK(CMD_SUCCESS == run_ntp_auth_key(false, "10", "md5", "password1"));
+    CHECK(1 == mock_ovsdb_count_keys());
+    row = ovsrec_ntp_key_first(idl);
+    CHECK((10 == row->key_id) && (0 == strcmp(row->key_password, "password1")));
+
+    CHECK(CMD_SUCCESS == run_ntp_auth_key(false, "10", "md5", "password2"));
+    CHECK(1 == mock_ovsdb_count_keys());
+    CHECK(0 == strcmp(row->key_password, "password2"));
+
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_auth_key(false, "11", "md5", "short"));
+    CHECK(1 == mock_ovsdb_count_keys());
+
+    CHECK(CMD_SUCCESS == run_ntp_trusted_key(false, "10"));
+    CHECK(row->trust_enable);
+    CHECK(CMD_SUCCESS == run_ntp_trusted_key(true, "10"));
+    CHECK(!row->trust_enable);
+    CHECK(CMD_OVSDB_FAILURE == run_ntp_trusted_key(false, "11"));
+
+    /* Hex keys are stored lower case, behind their algorithm */
+    CHECK(CMD_SUCCESS == run_ntp_auth_key(false, "10", "aes128cmac", "0123456789ABCDEF0123456789abcdef"));
+    CHECK(1 == mock_ovsdb_count_keys());
+    CHECK(0 == strcmp(row->key_password, "aes128cmac:0123456789abcdef0123456789abcdef"));
+    mock_vty_clear();
+    vtysh_ovsdb_show_ntp_authentication_keys();
+    CHECK_OUTPUT("      10   aes128cmac   0123456789abcdef0123456789abcdef\n");
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_auth_key(false, "11", "sha1", "password11"));
+    CHECK(1 == mock_ovsdb_count_keys());
+
+    CHECK(CMD_SUCCESS == run_ntp_auth_key(true, "10", NULL, NULL));
+    CHECK(0 == mock_ovsdb_count_keys());
+}
+
+static void
+test_ntp_authentication_enable(void)
+{
+    mock_ovsdb_reset();
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_set_ntp_authentication_enable_cmd, false, 0, NULL));
+    CHECK(smap_get_bool(&mock_ovsdb_system()->ntp_config, SYSTEM_NTP_CONFIG_AUTHENTICATION_ENABLE, false));
+    CHECK(CMD_SUCCESS == mock_vty_run(&no_vtysh_set_ntp_authentication_enable_cmd, true, 0, NULL));
+    CHECK(!smap_get_bool(&mock_ovsdb_system()->ntp_config, SYSTEM_NTP_CONFIG_AUTHENTICATION_ENABLE, true));
+}
+
+static int
+run_ntp_serve_allow(bool no_form, const char *network)
+{
+    const char *argv[] = { network };
+    return mock_vty_run(no_form ? &no_vtysh_set_ntp_serve_allow_cmd : &vtysh_set_ntp_serve_allow_cmd,
+                        no_form, 1, argv);
+}
+
+static void
+test_ntp_serve(void)
+{
+    const struct smap *config = NULL;
+    const char *rate_argv[] = { "4", "2" };
+    char network[INET6_ADDRSTRLEN + 8];
+    int i = 0;
+
+    mock_ovsdb_reset();
+    config = &mock_ovsdb_system()->ntp_config;
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_set_ntp_serve_cmd, false, 0, NULL));
+    CHECK(smap_get_bool(config, SYSTEM_NTP_CONFIG_SERVER_ENABLE, false));
+    CHECK(CMD_SUCCESS == mock_vty_run(&no_vtysh_set_ntp_serve_cmd, true, 0, NULL));
+    CHECK(!smap_get_bool(config, SYSTEM_NTP_CONFIG_SERVER_ENABLE, true));
+
+    /* Networks are stored with their host bits cleared, once */
+    CHECK(ntp_serve_parse_network("10.1.2.3/16", network, sizeof(network)));
+    CHECK(0 == strcmp(network, "10.1.0.0/16"));
+    CHECK(ntp_serve_parse_network("fd00:1:2::5/33", network, sizeof(network)));
+    CHECK(0 == strcmp(network, "fd00:1::/33"));
+    CHECK(!ntp_serve_parse_network("10.1.0.0/33", network, sizeof(network)));
+    CHECK(!ntp_serve_parse_network("10.1.0.0/", network, sizeof(network)));
+    CHECK(!ntp_serve_parse_network("10.1.0.0", network, sizeof(network)));
+    CHECK(!ntp_serve_parse_network("fd00::/129", network, sizeof(network)));
+
+    CHECK(CMD_SUCCESS == run_ntp_serve_allow(false, "10.1.2.3/16"));
+    CHECK(CMD_SUCCESS == run_ntp_serve_allow(false, "fd00::/8"));
+    CHECK(CMD_SUCCESS == run_ntp_serve_allow(false, "10.1.0.0/16"));
+    CHECK(0 == strcmp(smap_get(config, SYSTEM_NTP_CONFIG_SERVER_ALLOW), "10.1.0.0/16,fd00::/8"));
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_serve_allow(false, "10.1.0.0/40"));
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_serve_allow(true, "10.2.0.0/16"));
+    CHECK(CMD_SUCCESS == run_ntp_serve_allow(true, "10.1.0.0/16"));
+    CHECK(0 == strcmp(smap_get(config, SYSTEM_NTP_CONFIG_SERVER_ALLOW), "fd00::/8"));
+    CHECK(CMD_SUCCESS == run_ntp_serve_allow(true, "fd00::/8"));
+    CHECK(NULL == smap_get(config, SYSTEM_NTP_CONFIG_SERVER_ALLOW));
+
+    for (i = 0; i < NTP_SERVER_ALLOW_MAX; i++) {
+        snprintf(network, sizeof(network), "10.%d.0.0/16", i);
+        CHECK(CMD_SUCCESS == run_ntp_serve_allow(false, network));
+    }
+    CHECK(CMD_ERR_NOTHING_TODO == run_ntp_serve_allow(false, "192.168.0.0/16"));
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_set_ntp_serve_rate_limit_cmd, false, 2, rate_argv));
+    CHECK(4 == smap_get_int(config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE, 0));
+    CHECK(2 == smap_get_int(config, SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM, 0));
+    CHECK(CMD_SUCCESS == mock_vty_run(&no_vtysh_set_ntp_serve_rate_limit_cmd, true, 0, NULL));
+    CHECK(NULL == smap_get(config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE));
+    CHECK(NULL == smap_get(config, SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM));
+}
+
+static void
+test_running_config(void)
+{
+    struct ovsrec_ntp_key *key = NULL;
+    struct ovsrec_ntp_association *row = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+
+    key = mock_ovsdb_add_key(1, "password", true);
+    mock_ovsdb_add_key(2, "password2", false);
+    mock_ovsdb_add_key(3, "sha1:0123456789abcdef0123456789abcdef01234567", true);
+    mock_ovsdb_add_association("10.1.1.1", NULL);
+    row = mock_ovsdb_add_association("pool.ntp.org", key);
+    smap_replace(&row->association_attributes, NTP_ASSOC_ATTRIB_VERSION, "4");
+    smap_replace(&row->association_attributes, NTP_ASSOC_ATTRIB_PREFER, "true");
+
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK(0 == strcmp(mock_vty_output(),
+                      "ntp authentication-key 1 md5 password\n"
+                      "ntp trusted-key 1\n"
+                      "ntp authentication-key 2 md5 password2\n"
+                      "ntp authentication-key 3 sha1 0123456789abcdef0123456789abcdef01234567\n"
+                      "ntp trusted-key 3\n"
+                      "ntp server 10.1.1.1\n"
+                      "ntp server pool.ntp.org key-id 1 version 4 prefer\n"));
+
+    smap_replace(&mock_ovsdb_system()->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ENABLE, "true");
+    smap_replace(&mock_ovsdb_system()->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ALLOW, "10.1.0.0/16,fd00::/8");
+    smap_replace(&mock_ovsdb_system()->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE, "4");
+    mock_vty_clear();
+    CHECK(e_vtysh_ok == mock_vty_show_running_config(vtysh_config_context_ntp_clientcallback));
+    CHECK_OUTPUT("ntp server pool.ntp.org key-id 1 version 4 prefer\n"
+                 "ntp serve\n"
+                 "ntp serve allow 10.1.0.0/16\n"
+                 "ntp serve allow fd00::/8\n"
+                 "ntp serve rate-limit average 4 minimum 1\n");
+}
+
+static void
+test_show_ntp_status(void)
+{
+    struct ovsrec_system *system = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+    system = mock_ovsdb_system();
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_status_cmd, false, 0, NULL));
+    CHECK_OUTPUT("NTP authentication is disabled");
+    CHECK(!strstr(mock_vty_output(), "Synchronized to"));
+    CHECK(!strstr(mock_vty_output(), "NTP daemon restarts"));
+    CHECK(!strstr(mock_vty_output(), "Time to stable offset"));
+    CHECK_OUTPUT("NTP server mode is disabled");
+    CHECK(!strstr(mock_vty_output(), "Serving clients"));
+
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_SYNC_STATE, "synchronized");
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_SYNC_PEER, "10.1.1.1");
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_SYNC_STRATUM, "2");
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_SYNC_LAST_CHANGE, "86400");
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_NTPD_RESTARTS, "2");
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_NTPD_UPTIME, "42");
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_TIME_TO_STABLE_OFFSET, "-");
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_status_cmd, false, 0, NULL));
+    CHECK_OUTPUT("Synchronized to NTP Server 10.1.1.1 at stratum 2");
+    CHECK_OUTPUT("Sync state last changed: 1970-01-02 00:00:00 (UTC)");
+    CHECK_OUTPUT("NTP daemon restarts: 2, running for 42 second(s)");
+    CHECK(!strstr(mock_vty_output(), "Time to stable offset"));
+
+    smap_replace(&system->ntp_status, SYSTEM_NTP_STATUS_TIME_TO_STABLE_OFFSET, "95");
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_status_cmd, false, 0, NULL));
+    CHECK_OUTPUT("Time to stable offset: 95 second(s)");
+
+    smap_replace(&system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ENABLE, "true");
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_status_cmd, false, 0, NULL));
+    CHECK_OUTPUT("NTP server mode is enabled");
+    CHECK_OUTPUT("Serving clients: any");
+    CHECK_OUTPUT("Client rate limit: average 3, minimum 1 (log2 seconds)");
+}
+
+static void
+test_show_ntp_associations(void)
+{
+    struct ovsrec_ntp_association *row = NULL;
+
+    mock_ovsdb_reset();
+    mock_vty_clear();
+
+    row = mock_ovsdb_add_association("10.1.1.1", NULL);
+    smap_replace(&row->association_status, NTP_ASSOC_STATUS_PEER_STATUS_WORD,
+                 NTP_ASSOC_STATUS_PEER_STATUS_WORD_SYSTEMPEER);
+    smap_replace(&row->association_status, NTP_ASSOC_STATUS_REMOTE_PEER_ADDRESS, "10.1.1.1");
+    smap_replace(&row->association_status, NTP_ASSOC_STATUS_REMOTE_PEER_REF_ID, ".GPS.");
+
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_associations_cmd, false, 0, NULL));
+    CHECK_OUTPUT("*  1");
+    CHECK_OUTPUT(".GPS.");
+}
+
+static void
+test_show_ntp_clients(void)
+{
+    char dir[] = "/tmp/test_ntp_vty.XXXXXX";
+    char path[PATH_MAX];
+    char *old_path = getenv("PATH") ? strdup(getenv("PATH")) : NULL;
+    FILE *fp = NULL;
+
+    CHECK(NULL != mkdtemp(dir));
+    snprintf(path, sizeof(path), "%s/ovs-appctl", dir);
+    fp = fopen(path, "w");
+    CHECK(NULL != fp);
+    if (NULL == fp) {
+        return;
+    }
+    /* ops-ntpd stand-in, answering ntpd/clients only */
+    fprintf(fp, "#!/bin/sh\n"
+                "[ \"$3\" = ntpd/clients ] || exit 2\n"
+                "echo 'VRF  CLIENT  RATE/S'\n"
+                "echo 'vrf_default  10.1.1.5  4.000'\n");
+    fclose(fp);
+    chmod(path, 0700);
+    setenv("PATH", dir, 1);
+
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_clients_cmd, false, 0, NULL));
+    CHECK_OUTPUT("vrf_default  10.1.1.5  4.000\n");
+    CHECK(!strstr(mock_vty_output(), "Could not reach ops-ntpd"));
+
+    /* ops-ntpd not running */
+    unlink(path);
+    mock_vty_clear();
+    CHECK(CMD_SUCCESS == mock_vty_run(&vtysh_show_ntp_clients_cmd, false, 0, NULL));
+    CHECK_OUTPUT("Could not reach ops-ntpd");
+
+    rmdir(dir);
+    if (old_path) {
+        setenv("PATH", old_path, 1);
+        free(old_path);
+    }
+}
+
+int
+main(void)
+{
+    cli_pre_init();
+    cli_post_init();
+
+    test_is_valid_ipv4_address();
+    test_is_valid_server_name();
+    test_sanitize_auth_key();
+    test_ntp_server();
+    test_ntp_servers();
+    test_ntp_server_vrf();
+    test_ntp_server_nts();
+    test_ntp_refclock();
+    test_ntp_keys();
+    test_ntp_authentication_enable();
+    test_ntp_serve();
+    test_running_config();
+    test_show_ntp_status();
+    test_show_ntp_associations();
+    test_show_ntp_clients();
+
+    mock_ovsdb_reset();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All ntpd_cli tests passed\n");
+    return 0;
+}
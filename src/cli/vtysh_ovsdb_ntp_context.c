@@ -46,15 +46,20 @@ vtysh_config_context_ntp_clientcallback(void *p_private)
     const char *buf = NULL;
     const struct ovsrec_ntp_key *ntp_auth_key_row = NULL;
     const struct ovsrec_ntp_association *ntp_assoc_row = NULL;
-    char str_temp[80] = "";
+    const struct ovsrec_system *ovs_system = NULL;
+    const char *refclock = NULL;
+    const char *next = NULL;
+    char str_temp[128] = "";
     bool status = false;
+    int unit = 0;
 
     vtysh_ovsdb_config_logmsg(VTYSH_OVSDB_CONFIG_DBG,
                               "vtysh_config_context_ntp_clientcallback entered");
 
     /* Generate CLI for the NTP_Key Table */
     OVSREC_NTP_KEY_FOR_EACH(ntp_auth_key_row, p_msg->idl) {
-        vtysh_ovsdb_cli_print(p_msg, "ntp authentication-key %d md5 %s", ntp_auth_key_row->key_id, ntp_auth_key_row->key_password);
+        buf = ntp_key_parse_password(ntp_auth_key_row->key_password, &next);
+        vtysh_ovsdb_cli_print(p_msg, "ntp authentication-key %d %s %s", ntp_auth_key_row->key_id, buf, next);
 
         if (ntp_auth_key_row->trust_enable) {
             vtysh_ovsdb_cli_print(p_msg, "ntp trusted-key %d", ntp_auth_key_row->key_id);
@@ -64,23 +69,83 @@ vtysh_config_context_ntp_clientcallback(void *p_private)
     /* Generate CLI for the NTP_Association Table */
     OVSREC_NTP_ASSOCIATION_FOR_EACH(ntp_assoc_row, p_msg->idl) {
         memset(str_temp, 0, sizeof(str_temp));
+
+        refclock = ntp_refclock_parse_address(ntp_assoc_row->address, &unit);
+        if (refclock) {
+            buf = smap_get(&ntp_assoc_row->association_attributes, NTP_REFCLOCK_ATTRIB_FEED);
+            if (buf && strchr(buf, ':')) {
+                snprintf(str_temp, sizeof(str_temp), " feed %.*s %s",
+                         (int)(strchr(buf, ':') - buf), buf, strchr(buf, ':') + 1);
+            }
+            buf = smap_get(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_REF_CLOCK_ID);
+            if (buf && (0 != strcmp(buf, (0 == strcmp(refclock, NTP_REFCLOCK_PPS_KW)) ?
+                                         NTP_REFCLOCK_PPS_REFID : NTP_REFCLOCK_SHM_REFID))) {
+                strncat(str_temp, " refid ", sizeof(str_temp) - strlen(str_temp) - 1);
+                strncat(str_temp, buf, sizeof(str_temp) - strlen(str_temp) - 1);
+            }
+            if (smap_get_bool(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_PREFER, false)) {
+                strncat(str_temp, " prefer", sizeof(str_temp) - strlen(str_temp) - 1);
+            }
+            vtysh_ovsdb_cli_print(p_msg, "ntp refclock %s %d%s", refclock, unit, str_temp);
+            continue;
+        }
+
         if (NULL != ntp_assoc_row->key_id) {
             snprintf(str_temp, sizeof(str_temp), " key-id %ld", ((struct ovsrec_ntp_key *)ntp_assoc_row->key_id)->key_id);
         }
 
+        if (smap_get_bool(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_NTS, false)) {
+            strncat(str_temp, " nts", sizeof(str_temp) - strlen(str_temp) - 1);
+        }
+
         buf = smap_get(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_VERSION);
         if (buf && (0 != strncmp(buf, NTP_ASSOC_ATTRIB_VERSION_DEFAULT, strlen(NTP_ASSOC_ATTRIB_VERSION_DEFAULT)))) {
-            strcat(str_temp, " version ");
-            strcat(str_temp, buf);
+            strncat(str_temp, " version ", sizeof(str_temp) - strlen(str_temp) - 1);
+            strncat(str_temp, buf, sizeof(str_temp) - strlen(str_temp) - 1);
         }
 
         status = smap_get_bool(&ntp_assoc_row->association_attributes, NTP_ASSOC_ATTRIB_PREFER, false);
         if (status != NTP_ASSOC_ATTRIB_PREFER_DEFAULT_VAL) {
-            strcat(str_temp, " prefer");
+            strncat(str_temp, " prefer", sizeof(str_temp) - strlen(str_temp) - 1);
+        }
+
+        if (ntp_assoc_row->vrf && (0 != strcmp(ntp_assoc_row->vrf->name, DEFAULT_VRF_NAME))) {
+            strncat(str_temp, " vrf ", sizeof(str_temp) - strlen(str_temp) - 1);
+            strncat(str_temp, ntp_assoc_row->vrf->name, sizeof(str_temp) - strlen(str_temp) - 1);
         }
 
         vtysh_ovsdb_cli_print(p_msg, "ntp server %s%s", ntp_assoc_row->address, str_temp);
     }
 
+    /* Generate CLI for the server mode keys of System:ntp_config */
+    ovs_system = ovsrec_system_first(p_msg->idl);
+    if (NULL == ovs_system) {
+        return e_vtysh_ok;
+    }
+
+    if (smap_get_bool(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ENABLE, false)) {
+        vtysh_ovsdb_cli_print(p_msg, "ntp serve");
+    }
+
+    buf = smap_get(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_ALLOW);
+    for (; buf && *buf; buf = (next) ? next + 1 : NULL) {
+        next = strchr(buf, ',');
+        vtysh_ovsdb_cli_print(p_msg, "ntp serve allow %.*s",
+                              (int)((next) ? (size_t)(next - buf) : strlen(buf)), buf);
+    }
+
+    if (smap_get(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE)) {
+        vtysh_ovsdb_cli_print(p_msg, "ntp serve rate-limit average %d minimum %d",
+                              smap_get_int(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_AVERAGE,
+                                           NTP_SERVER_RATE_AVERAGE_DEFAULT),
+                              smap_get_int(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_SERVER_RATE_MINIMUM,
+                                           NTP_SERVER_RATE_MINIMUM_DEFAULT));
+    }
+
+    buf = smap_get(&ovs_system->ntp_config, SYSTEM_NTP_CONFIG_NTS_TRUSTED_CERTS);
+    if (buf) {
+        vtysh_ovsdb_cli_print(p_msg, "ntp nts trusted-certificates %s", buf);
+    }
+
     return e_vtysh_ok;
 }